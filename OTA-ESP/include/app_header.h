@@ -0,0 +1,37 @@
+// Prathik Narsetty
+// Application header convention for MSPM0 target images
+//
+// Target applications carry a 16-byte header at APP_HEADER_OFFSET, right
+// after the vector table. The build leaves length and crc erased (0xFFFFFFFF)
+// and tools/app_header.py fills them in. The CRC is the BSL CRC32 (see
+// bsl_frames.h) over [0, length) with the 4 bytes of the crc field left out,
+// so the target can recompute it with its CRC module at boot. The gateway
+// reads the header back to see which image the target holds, and confirms
+// the whole image with the BSL's stand-alone verification before it skips
+// programming, since a session that stopped after its first frame leaves a
+// matching header in front of a partly programmed image.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class ImageSource;
+
+#define APP_HEADER_OFFSET 0xC0         // after the 48-entry MSPM0G vector table
+#define APP_HEADER_MAGIC  0x48505041   // "APPH"
+
+struct __attribute__((packed)) AppHeader {
+  uint32_t magic;
+  uint32_t version;    // set by the application, only reported
+  uint32_t length;     // image bytes from address 0, header included
+  uint32_t crc;
+};
+static_assert(sizeof(AppHeader) == 16, "app header must stay 16 bytes");
+
+#define APP_HEADER_CRC_OFFSET (APP_HEADER_OFFSET + offsetof(AppHeader, crc))
+
+// Read `image` to the end and return its header if it has one whose length
+// and CRC match the image. imageCrc is the BSL CRC32 of all of [0, length),
+// crc field included, as stand-alone verification reports it. Consumes the
+// source.
+bool appHeaderFromImage(ImageSource& image, AppHeader& out, uint32_t& imageCrc);
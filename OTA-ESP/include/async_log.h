@@ -0,0 +1,85 @@
+// Prathik Narsetty
+// Asynchronous, rate-limited logging for the OTA gateway
+//
+// Log calls only capture a record (level, timestamp, format pointer and up to
+// four arguments) into a lock-free ring buffer; formatting and the actual
+// Serial output happen later in a low-priority drain task. A log call on the
+// BSL programming path therefore costs a few atomic operations instead of
+// blocking on the 115200 baud console.
+//
+// Format strings must be string literals and "%s" arguments must point to
+// storage that outlives the record (string literals in practice), because only
+// the pointers are queued. Supported conversions: %d %u %x %X %c %s %%, with
+// optional '0' flag and field width. Length modifiers (l, h) are accepted and
+// ignored; every argument is captured as a pointer-sized integer.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+// Compile-time threshold; calls above it compile to nothing
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Number of records held between drains (must be a power of two)
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 64
+#endif
+
+#define LOG_MAX_ARGS 4
+
+// Per call-site state, one static instance per log statement
+struct LogSite {
+  const char* fmt;
+  uint8_t level;
+  uint16_t maxPerSecond;     // 0 = unlimited
+  uint32_t windowStartMs;
+  uint16_t windowCount;
+  uint16_t suppressed;       // records dropped by the rate limit since last emit
+};
+
+void logBegin();
+// Write out every queued record now, e.g. before light sleep. Holds off the
+// drain task meanwhile, so lines never interleave.
+void logFlush();
+uint32_t logDroppedCount();
+bool logEmit(LogSite* site, const uintptr_t* args, uint8_t argCount);
+size_t logFormat(char* out, size_t outSize, const char* fmt,
+                 const uintptr_t* args, uint8_t argCount);
+
+template <typename T>
+inline uintptr_t logArg(T* value) { return reinterpret_cast<uintptr_t>(value); }
+template <typename T>
+inline uintptr_t logArg(T value) { return static_cast<uintptr_t>(value); }
+
+template <typename... Args>
+inline bool logWrite(LogSite* site, Args... args) {
+  static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+  const uintptr_t packed[LOG_MAX_ARGS + 1] = { logArg(args)..., 0 };
+  return logEmit(site, packed, sizeof...(Args));
+}
+
+#define LOG_AT(lvl, rate, fmt, ...)                                   \
+  do {                                                                \
+    if ((lvl) <= LOG_LEVEL) {                                         \
+      static LogSite logSite_ = { fmt, (lvl), (rate), 0, 0, 0 };      \
+      logWrite(&logSite_, ##__VA_ARGS__);                             \
+    }                                                                 \
+  } while (0)
+
+#define LOGE(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, 0, fmt, ##__VA_ARGS__)
+#define LOGW(fmt, ...) LOG_AT(LOG_LEVEL_WARN, 0, fmt, ##__VA_ARGS__)
+#define LOGI(fmt, ...) LOG_AT(LOG_LEVEL_INFO, 0, fmt, ##__VA_ARGS__)
+#define LOGD(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, 0, fmt, ##__VA_ARGS__)
+
+// Rate-limited variants for per-packet sites: at most `rate` records per second
+#define LOGI_RATE(rate, fmt, ...) LOG_AT(LOG_LEVEL_INFO, rate, fmt, ##__VA_ARGS__)
+#define LOGW_RATE(rate, fmt, ...) LOG_AT(LOG_LEVEL_WARN, rate, fmt, ##__VA_ARGS__)
+#define LOGD_RATE(rate, fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, rate, fmt, ##__VA_ARGS__)
@@ -0,0 +1,228 @@
+// Prathik Narsetty
+// MSPM0 BSL command frames
+//
+// Every BSL core command travels in the same envelope:
+//
+//   [0x80] [len LSB] [len MSB] [cmd] [cmd data ...] [CRC32, 4 bytes LE]
+//
+// where len counts cmd + cmd data and the CRC covers the same bytes (CRC32,
+// reflected poly 0xEDB88320, seed 0xFFFFFFFF, no final inversion - identical
+// to softwareCRC() in the MSPM0 host reference). Frames whose content never
+// changes are built here at compile time and live in flash; frames carrying
+// runtime fields get typed builders whose layout is fixed by constexpr offsets.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// BSL Protocol Constants
+#define PACKET_HEADER (0x80)
+#define CMD_CONNECTION (0x12)
+#define CMD_GET_ID (0x19)
+#define CMD_RX_PASSWORD (0x21)
+#define CMD_MASS_ERASE (0x15)
+#define CMD_PROGRAMDATA (0x20)
+#define CMD_MEMORY_READ_BACK (0x29)  // Read back programmed data
+#define CMD_STANDALONE_VERIFICATION (0x26)  // CRC32 of a memory range
+#define CMD_START_APP (0x40)
+#define CMD_CHANGE_BAUD_RATE (0x52)  // Change baud rate command
+
+// Response packet types (byte following the response length)
+#define RSP_HEADER (0x08)
+#define RSP_MEMORY_READ_BACK (0x30)
+#define RSP_DEVICE_INFO (0x31)
+#define RSP_STANDALONE_VERIFICATION (0x32)
+#define RSP_MESSAGE (0x3B)
+
+// Baud rate codes understood by CMD_CHANGE_BAUD_RATE
+#define BSL_BAUD_4800 (0x01)
+#define BSL_BAUD_9600 (0x02)
+#define BSL_BAUD_19200 (0x03)
+#define BSL_BAUD_38400 (0x04)
+#define BSL_BAUD_57600 (0x05)
+#define BSL_BAUD_115200 (0x06)
+#define BSL_BAUD_1000000 (0x07)
+#define BSL_BAUD_2000000 (0x08)
+#define BSL_BAUD_3000000 (0x09)
+
+// BSL Error Codes: message statuses from the BSL core and UART ACK errors
+// (0x51..0x57) are passed through; the rest are raised on the host side
+enum {
+    eBSL_success = 0,
+    eBSL_unknownError = 7,
+    eBSL_criticalFailure = 8,
+    eBSL_timeout = 0x60,       // no (complete) reply in time
+    eBSL_badResponse = 0x61,   // reply with a bad header, CRC or type
+    eBSL_cancelled = 0x62      // the session was cancelled between frames
+};
+typedef uint8_t BSL_error_t;
+
+// Frame layout
+constexpr size_t BSL_HEADER_OFFSET = 0;
+constexpr size_t BSL_LENGTH_OFFSET = 1;
+constexpr size_t BSL_CMD_OFFSET = 3;
+constexpr size_t BSL_CMD_DATA_OFFSET = 4;
+constexpr size_t BSL_CRC_BYTES = 4;
+constexpr size_t BSL_FRAME_OVERHEAD = BSL_CMD_DATA_OFFSET + BSL_CRC_BYTES;
+constexpr size_t BSL_ADDRESS_BYTES = 4;
+constexpr size_t BSL_PASSWORD_BYTES = 32;
+
+// Response layout: the target first answers with a one-byte UART ACK (0x00 on
+// success, 0x51..0x57 on framing errors) followed by a packet with the same
+// envelope as commands, starting with 0x08.
+constexpr size_t BSL_RSP_ACK_OFFSET = 0;
+constexpr size_t BSL_RSP_HEADER_OFFSET = 1;
+constexpr size_t BSL_RSP_TYPE_OFFSET = 4;
+constexpr size_t BSL_RSP_DATA_OFFSET = 5;
+constexpr size_t BSL_RSP_OVERHEAD = BSL_RSP_DATA_OFFSET + BSL_CRC_BYTES;
+
+// Largest frame the target BSL accepts by default (240 data bytes + address)
+constexpr size_t BSL_MAX_FRAME_BYTES = 256;
+
+constexpr uint32_t bslCrc32(const uint8_t* data, size_t len, uint32_t crc = 0xFFFFFFFF) {
+  while (len--) {
+    crc ^= *data++;
+    for (uint8_t i = 0; i < 8; ++i)
+      crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+  }
+  return crc;
+}
+
+constexpr void bslPutLE16(uint8_t* out, uint16_t value) {
+  out[0] = value & 0xFF;
+  out[1] = (value >> 8) & 0xFF;
+}
+
+constexpr void bslPutLE32(uint8_t* out, uint32_t value) {
+  out[0] = value & 0xFF;
+  out[1] = (value >> 8) & 0xFF;
+  out[2] = (value >> 16) & 0xFF;
+  out[3] = (value >> 24) & 0xFF;
+}
+
+constexpr uint32_t bslGetLE32(const uint8_t* in) {
+  return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// Writes header, length and CRC around cmd + dataLen bytes already in place.
+// Returns the total frame length.
+constexpr size_t bslSealFrame(uint8_t* frame, uint8_t cmd, size_t dataLen) {
+  frame[BSL_HEADER_OFFSET] = PACKET_HEADER;
+  bslPutLE16(&frame[BSL_LENGTH_OFFSET], (uint16_t)(1 + dataLen));
+  frame[BSL_CMD_OFFSET] = cmd;
+  bslPutLE32(&frame[BSL_CMD_DATA_OFFSET + dataLen], bslCrc32(&frame[BSL_CMD_OFFSET], 1 + dataLen));
+  return BSL_FRAME_OVERHEAD + dataLen;
+}
+
+// A complete frame with N bytes of command data, usable as a constant
+template <size_t N>
+struct BslFrame {
+  static constexpr size_t size = BSL_FRAME_OVERHEAD + N;
+  uint8_t bytes[size];
+};
+
+template <size_t N>
+constexpr BslFrame<N> bslCommandFrame(uint8_t cmd, const uint8_t (&data)[N]) {
+  BslFrame<N> frame{};
+  for (size_t i = 0; i < N; i++) {
+    frame.bytes[BSL_CMD_DATA_OFFSET + i] = data[i];
+  }
+  bslSealFrame(frame.bytes, cmd, N);
+  return frame;
+}
+
+constexpr BslFrame<0> bslCommandFrame(uint8_t cmd) {
+  BslFrame<0> frame{};
+  bslSealFrame(frame.bytes, cmd, 0);
+  return frame;
+}
+
+// Builder for frames of the form [cmd][address][payload...], e.g. Program Data
+template <uint8_t Cmd, size_t MaxPayload>
+class BslAddressedFrame {
+ public:
+  static constexpr size_t ADDRESS_OFFSET = BSL_CMD_DATA_OFFSET;
+  static constexpr size_t PAYLOAD_OFFSET = ADDRESS_OFFSET + BSL_ADDRESS_BYTES;
+  static constexpr size_t CAPACITY = PAYLOAD_OFFSET + MaxPayload + BSL_CRC_BYTES;
+  static_assert(CAPACITY <= BSL_MAX_FRAME_BYTES, "frame exceeds BSL buffer");
+  static_assert(BSL_ADDRESS_BYTES + MaxPayload + 1 <= 0xFFFF, "length field overflow");
+
+  // Payload area, so callers can read image data straight into the frame
+  uint8_t* payload() { return &bytes_[PAYLOAD_OFFSET]; }
+  static constexpr size_t maxPayload() { return MaxPayload; }
+
+  // Finalize a frame whose payload was written through payload().
+  // Returns the number of bytes to send, or 0 if payloadLen is too large.
+  size_t seal(uint32_t address, size_t payloadLen) {
+    if (payloadLen > MaxPayload) {
+      return 0;
+    }
+    bslPutLE32(&bytes_[ADDRESS_OFFSET], address);
+    length_ = bslSealFrame(bytes_, Cmd, BSL_ADDRESS_BYTES + payloadLen);
+    return length_;
+  }
+
+  size_t build(uint32_t address, const uint8_t* data, size_t payloadLen) {
+    if (payloadLen > MaxPayload) {
+      return 0;
+    }
+    for (size_t i = 0; i < payloadLen; i++) {
+      bytes_[PAYLOAD_OFFSET + i] = data[i];
+    }
+    return seal(address, payloadLen);
+  }
+
+  // Zero-copy variant for payloads already in memory (a memory-mapped
+  // image): only the header and CRC are built. Send the first HEADER_BYTES of
+  // data(), then the payload, then crc(). Returns the total frame length.
+  static constexpr size_t HEADER_BYTES = PAYLOAD_OFFSET;
+  size_t sealExternal(uint32_t address, const uint8_t* payload, size_t payloadLen) {
+    if (payloadLen > MaxPayload) {
+      return 0;
+    }
+    bytes_[BSL_HEADER_OFFSET] = PACKET_HEADER;
+    bslPutLE16(&bytes_[BSL_LENGTH_OFFSET], (uint16_t)(1 + BSL_ADDRESS_BYTES + payloadLen));
+    bytes_[BSL_CMD_OFFSET] = Cmd;
+    bslPutLE32(&bytes_[ADDRESS_OFFSET], address);
+    uint32_t crc = bslCrc32(&bytes_[BSL_CMD_OFFSET], 1 + BSL_ADDRESS_BYTES);
+    bslPutLE32(crc_, bslCrc32(payload, payloadLen, crc));
+    length_ = BSL_FRAME_OVERHEAD + BSL_ADDRESS_BYTES + payloadLen;
+    return length_;
+  }
+
+  const uint8_t* data() const { return bytes_; }
+  const uint8_t* crc() const { return crc_; }
+  size_t length() const { return length_; }
+
+ private:
+  uint8_t bytes_[CAPACITY] = {};
+  uint8_t crc_[BSL_CRC_BYTES] = {};
+  size_t length_ = 0;
+};
+
+template <size_t MaxPayload>
+using BslProgramDataFrame = BslAddressedFrame<CMD_PROGRAMDATA, MaxPayload>;
+
+// [cmd][address][length, 4 bytes]: Memory Read Back, Stand-alone Verification
+template <uint8_t Cmd>
+class BslRangeFrame {
+ public:
+  static constexpr size_t ADDRESS_OFFSET = BSL_CMD_DATA_OFFSET;
+  static constexpr size_t LENGTH_OFFSET = ADDRESS_OFFSET + BSL_ADDRESS_BYTES;
+  static constexpr size_t DATA_BYTES = BSL_ADDRESS_BYTES + 4;
+  static constexpr size_t SIZE = BSL_FRAME_OVERHEAD + DATA_BYTES;
+
+  size_t build(uint32_t address, uint32_t length) {
+    bslPutLE32(&bytes_[ADDRESS_OFFSET], address);
+    bslPutLE32(&bytes_[LENGTH_OFFSET], length);
+    return bslSealFrame(bytes_, Cmd, DATA_BYTES);
+  }
+
+  const uint8_t* data() const { return bytes_; }
+
+ private:
+  uint8_t bytes_[SIZE] = {};
+};
+
+using BslReadBackFrame = BslRangeFrame<CMD_MEMORY_READ_BACK>;
+using BslVerifyFrame = BslRangeFrame<CMD_STANDALONE_VERIFICATION>;
@@ -0,0 +1,120 @@
+// Prathik Narsetty
+// MSPM0 BSL protocol core, shared by the gateway and the Linux programmer
+//
+// BslLink sends the command frames from bsl_frames.h over a BslTransport and
+// parses the replies by their length field: the one-byte UART ACK, then for
+// commands with a core response the 0x08 packet, whose CRC is checked. Each
+// call returns as soon as the reply is complete, there are no fixed waits.
+// Retry policy, logging and timing stay with the caller.
+//
+// The transport is Serial2, SPI or I2C on the gateway (src/main.cpp,
+// include/spi_transport.h, include/i2c_transport.h) and a termios tty on
+// Linux (tools/bslprog), so all of them run exactly this code.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bsl_frames.h"
+
+// Largest Program Data payload: whole flash words in a BSL_MAX_FRAME_BYTES
+// frame. The BSL's buffer size from Get Device Info can lower it further.
+#define BSL_MAX_PROGRAM_BYTES 240
+
+// Waits for the first byte of a reply. Mass erase and CRC verification run on
+// the target before it answers, so they get longer ones.
+#define BSL_REPLY_TIMEOUT_MS 500
+#define BSL_ERASE_TIMEOUT_MS 2000
+#define BSL_VERIFY_TIMEOUT_MS 2000
+
+// After a failed command the target may still be answering the bad frame
+// (one NAK per stray byte); recover() waits for this much silence
+#define BSL_RECOVER_QUIET_MS 2
+
+// Smallest range the BSL's stand-alone verification accepts
+#define BSL_VERIFY_MIN_BYTES 1024
+
+class BslTransport {
+ public:
+  virtual ~BslTransport() {}
+  virtual bool write(const uint8_t* data, size_t len) = 0;
+  // Read up to len bytes, waiting at most about timeoutMs for them.
+  // Returns the number of bytes read.
+  virtual size_t read(uint8_t* buf, size_t len, uint32_t timeoutMs) = 0;
+  // Like read(), for the first bytes of a reply or of the response packet.
+  // A UART delivers the reply as it is sent; a polled link (SPI) has to
+  // clock the target until it stops sending fill bytes.
+  virtual size_t readStart(uint8_t* buf, size_t len, uint32_t timeoutMs) {
+    return read(buf, len, timeoutMs);
+  }
+  virtual void discardInput() = 0;
+  // Drop input until none has arrived for quietMs. Only a UART can have
+  // bytes in flight; a polled link receives nothing unless it asks.
+  virtual void drainInput(uint32_t quietMs) {
+    (void)quietMs;
+    discardInput();
+  }
+  virtual bool setBaudRate(uint32_t baud) = 0;
+  virtual uint32_t millis() = 0;
+  virtual void delayMs(uint32_t ms) = 0;
+};
+
+// Get Device Info reply (24 bytes, little-endian)
+struct __attribute__((packed)) BslDeviceInfo {
+  uint16_t commandInterpreterVersion;
+  uint16_t buildId;
+  uint32_t applicationVersion;
+  uint16_t pluginVersion;
+  uint16_t maxBufferSize;
+  uint32_t bufferStart;
+  uint32_t bcrConfigId;
+  uint32_t bslConfigId;
+};
+static_assert(sizeof(BslDeviceInfo) == 24, "device info is 24 bytes");
+
+// BSL baud rate code for a UART speed, 0 if the BSL does not support it
+uint8_t bslBaudCode(uint32_t baud);
+
+class BslLink {
+ public:
+  explicit BslLink(BslTransport& io) : io_(io) {}
+
+  // Send Connection until the BSL ACKs it, backing off from backoffMinMs to
+  // backoffMaxMs between attempts. Right after reset the bootcode drops what
+  // it receives, so this doubles as the readiness check.
+  BSL_error_t connect(uint32_t timeoutMs, uint32_t backoffMinMs, uint32_t backoffMaxMs,
+                      uint16_t& attempts);
+  BSL_error_t getDeviceInfo(BslDeviceInfo& info);
+  // Ask the BSL to switch speed, then follow with the local UART
+  BSL_error_t changeBaudRate(uint32_t baud);
+  BSL_error_t unlock(const uint8_t* password);
+  BSL_error_t massErase();
+  // One Program Data frame, at most BSL_MAX_PROGRAM_BYTES. The payload is
+  // sent in place, so it can point into a memory-mapped image.
+  BSL_error_t programData(uint32_t address, const uint8_t* data, size_t len);
+  // Memory Read Back of at most maxReadBytes() into out
+  BSL_error_t readMemory(uint32_t address, uint8_t* out, size_t len);
+  // Stand-alone verification: the BSL's CRC32 over at least
+  // BSL_VERIFY_MIN_BYTES of target memory
+  BSL_error_t verifyCrc(uint32_t address, uint32_t len, uint32_t& crc);
+  BSL_error_t startApp();
+  // Resynchronize after a failed command, before the next one
+  void recover() { io_.drainInput(BSL_RECOVER_QUIET_MS); }
+
+  static constexpr size_t maxReadBytes() { return sizeof(rx_) - BSL_RSP_OVERHEAD; }
+
+  // Raw reply of the last command: ACK byte, then the response packet
+  const uint8_t* reply() const { return rx_; }
+  size_t replyLength() const { return rxLength_; }
+
+ private:
+  BSL_error_t send(const uint8_t* frame, size_t len, bool expectPacket,
+                   uint32_t timeoutMs = BSL_REPLY_TIMEOUT_MS);
+  BSL_error_t receive(bool expectPacket, uint32_t timeoutMs);
+  BSL_error_t expectType(BSL_error_t result, uint8_t type, size_t dataLen);
+
+  BslTransport& io_;
+  BslProgramDataFrame<BSL_MAX_PROGRAM_BYTES> programFrame_;
+  BslReadBackFrame readBackFrame_;
+  uint8_t rx_[BSL_MAX_FRAME_BYTES + 1];
+  size_t rxLength_ = 0;
+};
@@ -0,0 +1,95 @@
+// Prathik Narsetty
+// Persistent binary event trace for post-mortem timing analysis
+//
+// Events are 12-byte records (timestamp in us since boot, event id, a 16-bit
+// and a 32-bit argument) kept in a ring buffer in RTC slow memory, so they
+// survive light sleep, deep sleep and soft resets (not power loss). Recording
+// an event is a critical section around one record store.
+//
+// Binary export layout (little-endian), decoded by tools/trace_decode.py:
+//   u32 magic, u16 version, u16 capacity, u32 head, u32 bootCount,
+//   then `capacity` records of { u32 timeUs, u16 event, u16 arg0, u32 arg1 }.
+// `head` counts every record ever written; the oldest valid record sits at
+// head % capacity once head >= capacity.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TRACE_MAGIC 0x45435254  // "TRCE"
+#define TRACE_VERSION 1
+
+#ifndef TRACE_CAPACITY
+#define TRACE_CAPACITY 128
+#endif
+
+// Keep in sync with EVENT_NAMES in tools/trace_decode.py
+enum TraceEventId : uint16_t {
+  TRACE_BOOT = 1,          // arg0 = reset reason, arg1 = boot count
+  TRACE_SLEEP = 2,         // arg1 = requested sleep in ms
+  TRACE_WAKE = 3,          // arg0 = wake cause
+  TRACE_SESSION_BEGIN = 4, // arg1 = image size
+  TRACE_SESSION_END = 5,   // arg0 = 1 on success, 2 if the target already ran the image,
+                           // 3 if cancelled
+  TRACE_PHASE_BEGIN = 6,   // arg0 = TracePhase
+  TRACE_PHASE_END = 7,     // arg0 = TracePhase, arg1 = BSL result
+  TRACE_RETRY = 8,         // arg0 = attempt, arg1 = target address
+  TRACE_NAK = 9,           // arg0 = response code, arg1 = target address
+  TRACE_MISMATCH = 10,     // arg0 = offset in block, arg1 = target address
+  TRACE_CRITICAL = 11,     // arg1 = target address
+  TRACE_TRIGGER = 12,      // arg0 = trigger source
+  TRACE_BSL_READY = 13,    // arg0 = Connection attempts, arg1 = ms since reset
+  TRACE_FLOW_CONTROL = 14, // arg0 = 1 if RTS/CTS is on for the session
+  TRACE_LINK_ERRORS = 15,  // arg0 = RX FIFO overruns, arg1 = RX buffer overflows
+                           // | framing errors << 16, during the session
+  TRACE_CHUNK_SIZE = 16,   // arg0 = Program Data payload after a failed frame,
+                           // arg1 = target address
+  TRACE_PROGRAM_STATS = 17, // arg0 = failed Program Data frames, arg1 = goodput in B/s
+  TRACE_DIGEST = 18,       // arg0 = 1 if the programmed bytes match the stored SHA-256,
+                           // 0 if not, 2 if the image has none yet; arg1 = first digest word
+  TRACE_SIGNATURE = 19,    // arg0 = SignatureResult (1 valid, 0 invalid, 2 missing),
+                           // arg1 = verification time in us, spent beside the session
+};
+
+enum TracePhase : uint16_t {
+  PHASE_ENTER_BSL = 1,
+  PHASE_CONNECT = 2,
+  PHASE_GET_ID = 3,
+  PHASE_BAUD = 4,
+  PHASE_PASSWORD = 5,
+  PHASE_ERASE = 6,
+  PHASE_PROGRAM = 7,
+  PHASE_VERIFY = 8,
+  PHASE_START_APP = 9,
+  PHASE_CHECK_APP = 10,
+  PHASE_SIGNATURE = 11,    // waiting for the signature check before Start App
+};
+
+struct TraceRecord {
+  uint32_t timeUs;
+  uint16_t event;
+  uint16_t arg0;
+  uint32_t arg1;
+};
+static_assert(sizeof(TraceRecord) == 12, "trace record must stay 12 bytes");
+
+struct TraceHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t capacity;
+  uint32_t head;
+  uint32_t bootCount;
+};
+static_assert(sizeof(TraceHeader) == 16, "trace header must stay 16 bytes");
+
+class Print;
+
+void traceBegin();
+void trace(uint16_t event, uint16_t arg0 = 0, uint32_t arg1 = 0);
+void traceClear();
+size_t traceExportSize();
+size_t traceExport(uint8_t* out, size_t outSize);
+void traceDump(Print& out);
+
+// Short name of a TracePhase, as in PHASE_NAMES in tools/trace_decode.py
+const char* tracePhaseName(uint16_t phase);
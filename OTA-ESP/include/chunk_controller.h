@@ -0,0 +1,52 @@
+// Prathik Narsetty
+// Program Data payload size that adapts to the link, AIMD style
+//
+// On a clean link large frames amortize the per-frame cost (header, CRC, ACK
+// and response, the turnaround); on a noisy one a bad frame wastes all of its
+// bytes and the larger the frame the more likely it is hit. The controller
+// adds `step` bytes after every acknowledged frame until it reaches the
+// limit negotiated with the BSL, and cuts the size to 3/4 on a NAK, a bad
+// response or a timeout. Sizes stay whole flash words. Goodput (payload
+// bytes acknowledged per second of link time, failed frames included) is
+// tracked so the effect shows up in the session log.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class ChunkController {
+ public:
+  ChunkController(uint16_t minBytes, uint16_t startBytes, uint16_t step, uint16_t granule)
+      : min_(minBytes), start_(startBytes), step_(step), granule_(granule) {}
+
+  // New session, growing up to limitBytes (rounded down to whole granules)
+  void begin(uint16_t limitBytes);
+
+  // Payload size for the next frame
+  uint16_t size() const { return size_; }
+  uint16_t limit() const { return limit_; }
+
+  // A frame of `bytes` payload was acknowledged after elapsedUs
+  void onAck(size_t bytes, uint32_t elapsedUs);
+  // A frame failed after elapsedUs; returns true if the size went down
+  bool onFailure(uint32_t elapsedUs);
+
+  uint32_t frames() const { return frames_; }
+  uint32_t failures() const { return failures_; }
+  // Payload bytes per second over the session, 0 before the first frame
+  uint32_t goodput() const;
+
+ private:
+  uint16_t roundDown(uint32_t bytes) const;
+
+  uint16_t min_;
+  uint16_t start_;
+  uint16_t step_;
+  uint16_t granule_;
+  uint16_t limit_ = 0;
+  uint16_t size_ = 0;
+  uint32_t frames_ = 0;
+  uint32_t failures_ = 0;
+  uint64_t bytes_ = 0;
+  uint64_t linkUs_ = 0;
+};
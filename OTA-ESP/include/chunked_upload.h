@@ -0,0 +1,90 @@
+// Prathik Narsetty
+// Resumable, offset-addressed image upload with a persistent journal
+//
+// The image is split into fixed-size chunks. Each chunk carries its own CRC32
+// and is written in place into a preallocated part file; a journal records a
+// bitmap of the chunks received so far. After a dropped connection or a
+// reboot the client asks for the missing ranges and only sends those.
+//
+// CRCs are the standard (zlib) CRC32, i.e. the BSL CRC with a final inversion.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <FS.h>
+
+#define UPLOAD_PART_PATH    "/upload.part"
+#define UPLOAD_JOURNAL_PATH "/upload.jnl"
+
+#define UPLOAD_CHUNK_MIN   64
+#define UPLOAD_CHUNK_MAX   4096
+#define UPLOAD_MAX_CHUNKS  1024
+
+#define UPLOAD_JOURNAL_MAGIC   0x4C4E4A55  // "UJNL"
+#define UPLOAD_JOURNAL_VERSION 1
+
+// Journal file layout: this header followed by the received-chunk bitmap
+struct __attribute__((packed)) UploadJournalHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t chunkSize;
+  uint32_t totalSize;
+  uint32_t imageCrc;
+};
+
+enum ChunkResult {
+  CHUNK_OK = 0,
+  CHUNK_DUPLICATE,       // already received, ignored
+  CHUNK_NO_SESSION,
+  CHUNK_BAD_OFFSET,      // not chunk aligned or past the end
+  CHUNK_BAD_LENGTH,      // not the chunk size (or the tail size for the last)
+  CHUNK_BAD_CRC,
+  CHUNK_WRITE_FAILED
+};
+
+class ChunkedUpload {
+ public:
+  explicit ChunkedUpload(fs::FS& fs) : fs_(fs) {}
+
+  // Reload an interrupted session from the journal (call once at boot)
+  bool restore();
+
+  // Start a session, or resume the journaled one if it describes the same
+  // image (same size, chunk size and image CRC)
+  bool begin(uint32_t totalSize, uint16_t chunkSize, uint32_t imageCrc);
+
+  ChunkResult writeChunk(uint32_t offset, const uint8_t* data, size_t len, uint32_t crc);
+
+  // Missing byte ranges as [start, end) pairs, coalesced across chunks.
+  // Calls fn for each range; stops early if fn returns false.
+  void forEachMissing(bool (*fn)(uint32_t start, uint32_t end, void* ctx), void* ctx) const;
+
+  // Check the whole-image CRC and move the part file to `path`
+  bool commit(const char* path);
+
+  // Drop the session and its files
+  void cancel();
+
+  bool active() const { return active_; }
+  bool complete() const { return active_ && received_ == chunkCount(); }
+  uint32_t totalSize() const { return header_.totalSize; }
+  uint16_t chunkSize() const { return header_.chunkSize; }
+  uint32_t bytesReceived() const;
+
+ private:
+  uint32_t chunkCount() const {
+    return (header_.totalSize + header_.chunkSize - 1) / header_.chunkSize;
+  }
+  bool hasChunk(uint32_t index) const { return bitmap_[index / 8] & (1 << (index % 8)); }
+  bool createFiles();
+  bool openFiles();
+  void closeFiles();
+
+  fs::FS& fs_;
+  File part_;
+  File journal_;
+  UploadJournalHeader header_ = {};
+  uint8_t bitmap_[UPLOAD_MAX_CHUNKS / 8] = {};
+  uint32_t received_ = 0;
+  bool active_ = false;
+};
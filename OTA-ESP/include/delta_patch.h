@@ -0,0 +1,125 @@
+// Prathik Narsetty
+// Binary delta patches between firmware images, shared by the gateway and tools/delta
+//
+// A patch rebuilds a new image from an old one that the gateway already
+// stores. It follows bsdiff: the new image is a sequence of records, each
+// one "add diffLen bytes to the old image at the current position, then
+// copy extraLen new bytes, then move the old position by seek". When code
+// moves, the added bytes are mostly zero, and they are sent run-length
+// coded, so an incremental release costs roughly its changed bytes.
+//
+//   header   DeltaHeader, little-endian
+//   record   diffLen, extraLen (varint), seek (zigzag varint)
+//            diff body: (zero run, literal count (varints), literals)...
+//                       until diffLen bytes are covered
+//            extraLen bytes copied as they are
+//
+// Records follow each other until newSize bytes have been produced. The
+// patch is applied as it arrives: DeltaPatcher keeps only its parse state
+// and a small output buffer, reads the old image in place and hands the new
+// bytes to a DeltaTarget in order. The old image is named by the CRC32 and
+// size the image index keeps, and the result is checked against newCrc.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DELTA_MAGIC   0x44544C44  // "DLTD"
+#define DELTA_VERSION 1
+
+#define DELTA_OUT_BUFFER 256  // new image bytes collected per DeltaTarget::write()
+
+struct __attribute__((packed)) DeltaHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+  uint32_t oldSize;
+  uint32_t oldCrc;   // standard (zlib) CRC32, as in the image index
+  uint32_t newSize;
+  uint32_t newCrc;
+};
+
+enum DeltaStatus : uint8_t {
+  DELTA_OK = 0,
+  DELTA_BAD_HEADER,     // wrong magic or version
+  DELTA_NO_BASE,        // the old image is not stored here
+  DELTA_BAD_RECORD,     // a record reaches outside the old or new image
+  DELTA_WRITE_FAILED,
+  DELTA_TRUNCATED,      // the patch ended before the new image was complete
+  DELTA_BAD_CRC         // the rebuilt image does not match newCrc
+};
+
+const char* deltaStatusName(DeltaStatus status);
+
+// Where the patch comes from and where the new image goes
+class DeltaTarget {
+ public:
+  virtual ~DeltaTarget() {}
+
+  // The old image with this size and CRC32, addressable for the whole
+  // patch, or nullptr if it is not available
+  virtual const uint8_t* base(uint32_t size, uint32_t crc) = 0;
+
+  // The next bytes of the new image
+  virtual bool write(const uint8_t* data, size_t len) = 0;
+};
+
+class DeltaPatcher {
+ public:
+  explicit DeltaPatcher(DeltaTarget& target) : target_(target) {}
+
+  void begin();
+
+  // Apply the next patch bytes, in any split. Returns the first error,
+  // which sticks for the rest of the patch.
+  DeltaStatus feed(const uint8_t* data, size_t len);
+
+  // The patch is complete: flush and check the new image
+  DeltaStatus finish();
+
+  bool headerDone() const { return state_ > STATE_HEADER; }
+  const DeltaHeader& header() const { return header_; }
+  uint32_t produced() const { return produced_; }
+
+ private:
+  enum State : uint8_t {
+    STATE_HEADER,
+    STATE_DIFF_LEN,
+    STATE_EXTRA_LEN,
+    STATE_SEEK,
+    STATE_ZERO_RUN,
+    STATE_LITERAL_COUNT,
+    STATE_LITERALS,
+    STATE_EXTRA,
+    STATE_DONE
+  };
+
+  void headerByte(uint8_t byte);
+  bool varint(uint8_t byte);
+  void startRecord();
+  void diffProgress();
+  void endRecord();
+  void emit(uint8_t byte);
+  void flush();
+  void fail(DeltaStatus status);
+
+  DeltaTarget& target_;
+  State state_ = STATE_HEADER;
+  DeltaStatus status_ = DELTA_OK;
+  DeltaHeader header_;
+  size_t headerFill_ = 0;
+  const uint8_t* old_ = nullptr;
+
+  uint32_t value_ = 0;       // varint being parsed
+  uint8_t valueShift_ = 0;
+  uint32_t diffLeft_ = 0;    // of the current record
+  uint32_t extraLeft_ = 0;
+  int32_t seek_ = 0;
+  uint32_t runLeft_ = 0;     // zero run or literals of the current diff token
+  uint32_t oldPos_ = 0;
+  uint32_t produced_ = 0;
+  uint32_t crc_ = 0xFFFFFFFF;
+
+  uint8_t out_[DELTA_OUT_BUFFER];
+  size_t outFill_ = 0;
+};
@@ -0,0 +1,43 @@
+// Prathik Narsetty
+// BslTransport wrapper that injects bit errors, for evaluating the link code
+//
+// Every bit written to or read from the wrapped transport is inverted with
+// probability `ber` while the wrapper is armed. The errors come from a seeded
+// generator, so a run with the same seed and the same traffic hits the same
+// bits. The native build wraps Serial2 in one (--ber, see native_main.cpp);
+// the gateway arms it only for the program phase, where the chunk controller
+// reacts to failed frames, since the other phases have no retries.
+#pragma once
+
+#include "bsl_link.h"
+
+#define FAULT_WRITE_CHUNK 64  // bytes corrupted and written per step
+
+class FaultTransport : public BslTransport {
+ public:
+  explicit FaultTransport(BslTransport& io) : io_(io) {}
+
+  void configure(double ber, uint32_t seed);
+  void arm(bool armed) { armed_ = armed; }
+  // Bytes that had at least one bit flipped, both directions
+  uint32_t corruptedBytes() const { return corrupted_; }
+
+  bool write(const uint8_t* data, size_t len) override;
+  size_t read(uint8_t* buf, size_t len, uint32_t timeoutMs) override;
+  size_t readStart(uint8_t* buf, size_t len, uint32_t timeoutMs) override;
+  void discardInput() override { io_.discardInput(); }
+  void drainInput(uint32_t quietMs) override { io_.drainInput(quietMs); }
+  bool setBaudRate(uint32_t baud) override { return io_.setBaudRate(baud); }
+  uint32_t millis() override { return io_.millis(); }
+  void delayMs(uint32_t ms) override { io_.delayMs(ms); }
+
+ private:
+  void corrupt(uint8_t* data, size_t len);
+  uint32_t random();
+
+  BslTransport& io_;
+  uint32_t threshold_ = 0;  // ber scaled to the generator's range
+  uint32_t state_ = 1;
+  bool armed_ = false;
+  uint32_t corrupted_ = 0;
+};
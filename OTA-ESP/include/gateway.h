@@ -0,0 +1,66 @@
+// Prathik Narsetty
+// Gateway state and entry points shared between main.cpp and its modules
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bsl_frames.h"
+
+class StreamImageSource;
+
+// What started a programming session (recorded in the trace)
+enum TriggerSource : uint16_t {
+    TRIGGER_BUTTON = 1,
+    TRIGGER_WAKE = 2,
+    TRIGGER_NEW_FIRMWARE = 3,
+    TRIGGER_UPLOAD = 4,
+    TRIGGER_STREAM = 5,
+    TRIGGER_ACTIVATE = 6,
+    TRIGGER_ROLLBACK = 7   // the image was refused after programming
+};
+
+// Outcome of the most recent session, reported by /status
+enum SessionResult : int8_t {
+    SESSION_NONE = 0,
+    SESSION_OK = 1,
+    SESSION_SKIPPED = 2,   // the target already ran the active image
+    SESSION_FAILED = -1,
+    SESSION_CANCELLED = -2
+};
+
+// Where the running session is, reported by /status and the console
+struct SessionProgress {
+    uint16_t phase;   // TracePhase, 0 between sessions
+    uint32_t done;    // bytes programmed or verified so far
+    uint32_t total;   // bytes in the phase, 0 for phases without data
+};
+
+// Drop location for images delivered by `pio run -t uploadfs`; they are
+// moved into the image store (include/image_store.h) when found
+extern const char* FIRMWARE_PATH;
+extern volatile bool programmingInProgress;
+extern volatile bool programmingRequested;
+extern volatile SessionResult lastSessionResult;
+
+void requestProgramming(TriggerSource source);
+
+SessionProgress sessionProgress();
+
+// Ask the running session to stop after the frame in flight. The target is
+// left in the BSL with a partly programmed image, and the image is not
+// marked bad. Returns false if no session is running.
+bool cancelSession();
+
+// Start a cut-through session fed by an upload in progress. Returns false if
+// a session is already running or queued.
+bool requestStreamingSession(StreamImageSource* source);
+
+// Move a complete image file at `path` into the image store. With programNow
+// it becomes the active image and a session is queued. Returns the slot, or
+// -1 if it could not be stored.
+int firmwareStored(const char* path, bool programNow);
+
+// Make `slot` the active image. With programNow the switch happens in the
+// programming task just before the session, otherwise it is refused while a
+// session is running.
+bool requestActivation(int slot, bool programNow);
@@ -0,0 +1,53 @@
+// Prathik Narsetty
+// I2C link to the MSPM0 BSL, as a BslTransport
+//
+// The gateway is the I2C controller and the BSL a target at BSL_I2C_ADDRESS.
+// Every frame goes out as one write transaction: write() only collects the
+// bytes (BslLink sends a Program Data frame in three pieces) and the first
+// read after it sends them. A reply is read in as many read transactions as
+// BslLink asks for; the BSL continues its reply where the last one stopped.
+// While it is still working on a command it either holds SCL low or does not
+// acknowledge its address. A stretch shorter than I2C_STRETCH_MS just
+// finishes the transaction; anything else fails it, and the read is retried
+// every I2C_POLL_GAP_US until the command's timeout.
+//
+// Selected with -DBSL_TRANSPORT_I2C ([env:arduino_nano_esp32_i2c]). The BSL's
+// I2C plugin has no Change Baud Rate; the bus runs at BSL_I2C_HZ from the
+// start (Fast-mode Plus, which needs pull-ups sized for 1 MHz).
+#pragma once
+
+#include <Wire.h>
+#include "bsl_link.h"
+
+#ifndef BSL_I2C_HZ
+#define BSL_I2C_HZ 1000000
+#endif
+
+#define BSL_I2C_ADDRESS 0x48  // the BSL's default target address
+#define I2C_STRETCH_MS 20     // longest clock stretch a transaction rides out
+#define I2C_POLL_GAP_US 50    // between read attempts while the BSL is busy
+
+class I2cTransport : public BslTransport {
+ public:
+  I2cTransport(TwoWire& wire, int8_t sda, int8_t scl, uint8_t address, uint32_t hz)
+      : wire_(wire), sda_(sda), scl_(scl), address_(address), hz_(hz) {}
+
+  void begin();
+
+  bool write(const uint8_t* data, size_t len) override;
+  size_t read(uint8_t* buf, size_t len, uint32_t timeoutMs) override;
+  void discardInput() override {}  // nothing arrives unless the gateway reads it
+  bool setBaudRate(uint32_t baud) override;
+  uint32_t millis() override { return ::millis(); }
+  void delayMs(uint32_t ms) override { delay(ms); }
+
+ private:
+  bool flush(uint32_t start, uint32_t timeoutMs);
+
+  TwoWire& wire_;
+  int8_t sda_, scl_;
+  uint8_t address_;
+  uint32_t hz_;
+  uint8_t pending_[BSL_MAX_FRAME_BYTES];
+  size_t pendingLen_ = 0;
+};
@@ -0,0 +1,71 @@
+// Prathik Narsetty
+// PSRAM copies of stored images, shared by programming, verification and retries
+//
+// Without the cache every session reads its image from the filesystem at
+// least twice (programming and verification, plus the header probe), and
+// again for every retry or further target. The cache loads an image into
+// PSRAM once and hands out the copy, so those passes read RAM and the BSL
+// frames are sent in place like a memory-mapped image.
+//
+// Entries are keyed by content: the SHA-256 the image index keeps for each
+// slot, or its CRC32 and size for slots that predate digests. Re-uploading
+// the same image into another slot hits the same entry, and a slot
+// overwritten with a new image can never return stale bytes. The loaded
+// bytes are checked against the index CRC32, so a bad filesystem read is
+// caught before anything is sent to the target.
+//
+// The cache holds up to IMAGE_CACHE_ENTRIES images in IMAGE_CACHE_BYTES.
+// To make room the least recently used entry that no reader holds is freed.
+// An image larger than the cache, or one that cannot be made room for, is
+// streamed from the store as before.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "image_source.h"
+#include "image_store.h"
+
+#ifndef IMAGE_CACHE_BYTES
+#define IMAGE_CACHE_BYTES (4 * 1024 * 1024)  // of the Nano ESP32's 8 MB PSRAM
+#endif
+#ifndef IMAGE_CACHE_ENTRIES
+#define IMAGE_CACHE_ENTRIES 4
+#endif
+
+struct ImageCacheStats {
+  uint32_t hits;
+  uint32_t misses;     // loads, successful or not
+  uint32_t evictions;
+  uint32_t bypasses;   // images streamed because they did not fit
+  uint32_t bytes;      // currently held
+  uint8_t entries;
+};
+
+// Image bytes of `slot`, loaded into PSRAM on first use, or nullptr if the
+// image has to be streamed. Every non-null result holds the entry until it
+// is given back with imageCacheRelease().
+const uint8_t* imageCacheAcquire(int slot);
+void imageCacheRelease(const uint8_t* data);
+
+ImageCacheStats imageCacheStats();
+
+// A stored image read from the cache when it is there or can be loaded,
+// otherwise from the store
+class CachedImage : public ImageSource {
+ public:
+  ~CachedImage() override { close(); }
+
+  bool open(int slot);
+  void close();
+
+  int read(uint8_t* buf, size_t len) override;
+  size_t size() const override;
+  const uint8_t* mapped() const override;
+  const uint8_t* digest() const override { return digest_; }
+
+ private:
+  const uint8_t* cached_ = nullptr;
+  const uint8_t* digest_ = nullptr;
+  MappedImageSource memory_;
+  StoredImage stored_;
+};
@@ -0,0 +1,66 @@
+// Prathik Narsetty
+// Signed image container and the signature check that runs beside a session
+//
+// A signed image is the plain image followed by a SignedImageTrailer. Its
+// signature is ECDSA P-256 over the image's SHA-256, the same digest the
+// store records for every slot (include/image_store.h) and that Program
+// Data recomputes from the frames the target acknowledges. Putting the
+// signature last keeps the image at offset 0, so stores, the cache, the
+// header probe and delta bases all see the bytes the target gets.
+//
+//   python3 tools/sign_image.py sign key.pem build/app.bin app.signed
+//
+// With IMAGE_SIGNING_KEY set at build time (the hex public key printed by
+// `tools/sign_image.py key key.pem`) the gateway only takes signed images:
+// the store rejects anything else, and every session checks the signature
+// in a background task while the target is erased and programmed. The
+// result is collected before Start App, so it costs no session time, and a
+// bad signature means the target is erased instead of started.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "p256.h"
+#include "sha256.h"
+
+#define IMAGE_SIGN_MAGIC   0x4E474953  // "SIGN"
+#define IMAGE_SIGN_VERSION 1
+
+struct __attribute__((packed)) SignedImageTrailer {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+  uint32_t imageSize;  // bytes before the trailer
+  uint8_t signature[P256_SIGNATURE_BYTES];
+};
+static_assert(sizeof(SignedImageTrailer) == 76, "signature trailer must stay 76 bytes");
+
+// True if `trailer`, read from the end of a file of `fileSize` bytes, marks
+// the file as a signed image
+bool signatureTrailerValid(const SignedImageTrailer& trailer, size_t fileSize);
+
+// Built with IMAGE_SIGNING_KEY: unsigned images are refused
+bool imageSigningRequired();
+
+// Parse the key and start the check task; call once from setup()
+void signatureBegin();
+
+// Synchronous check against the build's key; false without a valid key
+bool signatureVerify(const uint8_t digest[SHA256_BYTES],
+                     const uint8_t signature[P256_SIGNATURE_BYTES]);
+
+enum SignatureResult : uint8_t {
+  SIGNATURE_INVALID = 0,
+  SIGNATURE_VALID = 1,
+  SIGNATURE_MISSING = 2   // no check was started for the session
+};
+
+// Check `signature` over `digest` in the background. Both are copied; a
+// result nobody collected is dropped.
+void signatureCheckStart(const uint8_t digest[SHA256_BYTES],
+                         const uint8_t signature[P256_SIGNATURE_BYTES]);
+
+// Result of the check started last, waiting for it if it is still running,
+// with the time the verification took. Each start gives one result; without
+// a start the result is SIGNATURE_MISSING.
+SignatureResult signatureCheckWait(uint32_t& verifyUs);
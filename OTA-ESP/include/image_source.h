@@ -0,0 +1,109 @@
+// Prathik Narsetty
+// Sources of firmware image bytes for the BSL programmer
+//
+// bslProgramData() pulls the image through this interface, so the same
+// programming loop runs from a stored file, a memory-mapped flash region or
+// directly from an upload that is still arriving over the network.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/stream_buffer.h>
+
+class ImageSource {
+ public:
+  virtual ~ImageSource() {}
+
+  // Fill up to len bytes. Returns the byte count (short only at the end of
+  // the image), 0 at the end, or -1 if the image became unavailable.
+  virtual int read(uint8_t* buf, size_t len) = 0;
+
+  // Total image size in bytes, 0 if not known up front
+  virtual size_t size() const = 0;
+
+  // The whole image if it is directly addressable (memory mapped), so
+  // callers can use it in place instead of copying it out with read()
+  virtual const uint8_t* mapped() const { return nullptr; }
+
+  // SHA-256 the image is expected to have (SHA256_BYTES), nullptr if unknown
+  virtual const uint8_t* digest() const { return nullptr; }
+};
+
+// Image already in the address space, e.g. a flash region mapped through
+// the cache
+class MappedImageSource : public ImageSource {
+ public:
+  void attach(const uint8_t* base, size_t size);
+
+  int read(uint8_t* buf, size_t len) override;
+  size_t size() const override { return size_; }
+  const uint8_t* mapped() const override { return base_; }
+
+ private:
+  const uint8_t* base_ = nullptr;
+  size_t size_ = 0;
+  size_t pos_ = 0;
+};
+
+// Bytes fetched from the filesystem per read. Without read-ahead, every
+// 128-byte BSL block goes through VFS and the filesystem lookup on its own.
+#ifndef IMAGE_READ_AHEAD
+#define IMAGE_READ_AHEAD 4096
+#endif
+
+class FileImageSource : public ImageSource {
+ public:
+  explicit FileImageSource(File& file);
+  ~FileImageSource() override;
+
+  // Read only the first `length` bytes of the newly opened file, the image
+  // part of a signed image. Also drops read-ahead from a previous file.
+  void setLength(size_t length);
+
+  int read(uint8_t* buf, size_t len) override;
+  size_t size() const override { return length_ < file_.size() ? length_ : file_.size(); }
+
+ private:
+  File& file_;
+  uint8_t* cache_;      // heap, to stay off the programming task's stack
+  size_t cacheFill_ = 0;
+  size_t cachePos_ = 0;
+  size_t length_ = SIZE_MAX;
+  size_t delivered_ = 0;
+};
+
+// Single-producer/single-consumer pipe between an upload handler and the
+// programming task. push() blocks while the buffer is full, which stops the
+// producer from reading its socket and lets TCP flow control slow the sender
+// down to the programming rate.
+class StreamImageSource : public ImageSource {
+ public:
+  ~StreamImageSource() override;
+
+  bool begin(size_t bufferBytes, size_t expectedSize);
+  void end();
+
+  // Producer side (upload handler)
+  size_t push(const uint8_t* data, size_t len);
+  void finish();  // all bytes pushed
+  void abort();   // upload failed, consumer should give up
+
+  // Consumer side (programming task)
+  int read(uint8_t* buf, size_t len) override;
+  size_t size() const override { return expectedSize_; }
+  void detach();  // stop consuming; further pushes are discarded
+
+  bool finished() const { return finished_; }
+  bool aborted() const { return aborted_; }
+  size_t bytesPushed() const { return bytesPushed_; }
+
+ private:
+  StreamBufferHandle_t buffer_ = nullptr;
+  size_t expectedSize_ = 0;
+  size_t bytesPushed_ = 0;
+  volatile bool finished_ = false;
+  volatile bool aborted_ = false;
+  volatile bool detached_ = false;
+};
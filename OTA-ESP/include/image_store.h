@@ -0,0 +1,154 @@
+// Prathik Narsetty
+// Multi-slot firmware image store with a persistent index
+//
+// Images live in fixed slot files. A small index records each slot's size,
+// CRC32, age and state, plus which slot is active (the one sessions program).
+// New images are added to an inactive slot, so the active image stays
+// programmable while another one is uploaded. Rollback only moves the active
+// pointer back to the previous image, with no transfer.
+//
+// The index is written to a temp file and then renamed into place; if power
+// is lost between the two steps, the temp copy is picked up at boot. Changes
+// to the index are serialized by a mutex, since uploads and sessions run in
+// different tasks.
+//
+// With IMAGE_STORE_RAW_PARTITION, slots are regions of a raw flash partition
+// and the index lives in the partition header (include/raw_partition.h).
+// Uploads still arrive as files and are copied into a region when added.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <FS.h>
+#include "image_source.h"
+#include "p256.h"
+#include "sha256.h"
+
+#ifndef IMAGE_SLOT_COUNT
+#define IMAGE_SLOT_COUNT 2
+#endif
+
+#define IMAGE_INDEX_PATH     "/images.idx"
+#define IMAGE_INDEX_TMP_PATH "/images.idx.tmp"
+
+#define IMAGE_INDEX_MAGIC   0x58474D49  // "IMGX"
+#define IMAGE_INDEX_VERSION 2           // 1 had no SHA-256, upgraded on load
+
+enum ImageSlotState : uint8_t {
+  SLOT_EMPTY = 0,
+  SLOT_STAGED = 1,   // stored, never programmed
+  SLOT_GOOD = 2,     // last programming session from this slot succeeded
+  SLOT_FAILED = 3    // last programming session from this slot failed
+};
+
+#define SLOT_HAS_DIGEST 0x01  // ImageSlotInfo::flags, sha256 is valid
+#define SLOT_SIGNED     0x02  // a SignedImageTrailer follows the image in the slot
+
+struct __attribute__((packed)) ImageSlotInfo {
+  uint8_t state;
+  uint8_t flags;
+  uint8_t reserved[2];
+  uint32_t size;       // of the image, without a signature trailer
+  uint32_t crc;        // standard (zlib) CRC32 of the image
+  uint32_t sequence;   // increases with every image added; 0 when empty
+  uint8_t sha256[SHA256_BYTES];
+};
+
+struct __attribute__((packed)) ImageIndex {
+  uint32_t magic;
+  uint16_t version;
+  int8_t active;       // active slot, -1 if none
+  uint8_t slotCount;
+  uint32_t nextSequence;
+  ImageSlotInfo slots[IMAGE_SLOT_COUNT];
+};
+
+// Version 1 layout, read once and upgraded; its slots have no digest
+struct __attribute__((packed)) ImageSlotInfoV1 {
+  uint8_t state;
+  uint8_t reserved[3];
+  uint32_t size;
+  uint32_t crc;
+  uint32_t sequence;
+};
+
+struct __attribute__((packed)) ImageIndexV1 {
+  uint32_t magic;
+  uint16_t version;
+  int8_t active;
+  uint8_t slotCount;
+  uint32_t nextSequence;
+  ImageSlotInfoV1 slots[IMAGE_SLOT_COUNT];
+};
+
+void imageIndexUpgrade(const ImageIndexV1& old, ImageIndex& out);
+
+// Load the index, dropping slots whose file is missing or the wrong size.
+// `fs` holds the slot files, or only incoming uploads with the raw partition.
+bool imageStoreBegin(fs::FS& fs);
+
+#define IMAGE_STORE_REJECTED -2  // imageStoreAdd(): not signed with IMAGE_SIGNING_KEY
+
+// Move a complete image file into an inactive slot (the empty or oldest one).
+// A signed image (include/image_signature.h) keeps its trailer in the slot;
+// a rejected one is deleted. Returns the slot, -1 on failure or
+// IMAGE_STORE_REJECTED. The active slot and pinned slots are never
+// overwritten.
+int imageStoreAdd(const char* srcPath);
+
+// Pin a slot a session programs or is queued to program, so imageStoreAdd()
+// leaves it alone until it is unpinned. Pins nest.
+void imageStorePin(int slot);
+void imageStoreUnpin(int slot);
+
+bool imageStoreActivate(int slot);
+
+// Slot that rollback would activate: the newest other slot, preferring ones
+// that programmed successfully. -1 if there is none.
+int imageStoreRollbackSlot();
+
+// Record the outcome of a programming session from `slot`
+void imageStoreMarkResult(int slot, bool success);
+
+// Slot holding the image with this size and CRC32, -1 if none does
+int imageStoreFind(uint32_t size, uint32_t crc);
+
+// SHA-256 of the slot's image, nullptr if the slot predates digests and no
+// session has recorded one yet
+const uint8_t* imageStoreDigest(int slot);
+// Record the digest of a slot that has none, from a session's programming pass
+void imageStoreSetDigest(int slot, const uint8_t digest[SHA256_BYTES]);
+
+// Signature from the slot's trailer; false if the image is not signed
+bool imageStoreSignature(int slot, uint8_t signature[P256_SIGNATURE_BYTES]);
+
+int imageStoreActiveSlot();           // -1 if no active image
+const ImageSlotInfo& imageStoreSlot(int slot);
+const char* imageSlotStateName(uint8_t state);
+
+// Reader for a stored image. With the raw partition the image is memory
+// mapped and mapped() gives direct access; otherwise it is read from the
+// slot file with read-ahead.
+class StoredImage : public ImageSource {
+ public:
+  ~StoredImage() override { close(); }
+
+  bool open(int slot);
+  void close();
+
+  int read(uint8_t* buf, size_t len) override { return reader_.read(buf, len); }
+  size_t size() const override { return reader_.size(); }
+  const uint8_t* mapped() const override { return reader_.mapped(); }
+  const uint8_t* digest() const override { return digest_; }
+
+ private:
+  const uint8_t* digest_ = nullptr;
+#if defined(IMAGE_STORE_RAW_PARTITION)
+  MappedImageSource reader_;
+  uint32_t mapHandle_ = 0;
+  bool isMapped_ = false;
+#else
+  File file_;
+  FileImageSource reader_{file_};
+#endif
+};
@@ -0,0 +1,19 @@
+// Prathik Narsetty
+// ECDSA P-256 signature verification for signed firmware images
+//
+// On the ESP32 this is mbedTLS, whose big-number arithmetic ESP-IDF runs on
+// the MPI accelerator. The native build uses a portable implementation with
+// the same interface. The gateway only verifies, so nothing here handles
+// secret data and nothing needs to run in constant time.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define P256_KEY_BYTES       65  // uncompressed public key, 0x04 || X || Y
+#define P256_SIGNATURE_BYTES 64  // r || s, big-endian
+#define P256_HASH_BYTES      32
+
+// True if `signature` is a valid signature of `hash` by `key`
+bool p256Verify(const uint8_t key[P256_KEY_BYTES], const uint8_t hash[P256_HASH_BYTES],
+                const uint8_t signature[P256_SIGNATURE_BYTES]);
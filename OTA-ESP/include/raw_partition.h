@@ -0,0 +1,94 @@
+// Prathik Narsetty
+// Firmware image slots in a dedicated raw flash partition
+//
+// Used by the image store when built with IMAGE_STORE_RAW_PARTITION. The
+// partition (label "images", data subtype 0x40, see partitions_images.csv) is
+// laid out in 4 KiB sectors:
+//
+//   sector 0, 1   two copies of RawPartitionHeader. Updates alternate between
+//                 them and the valid copy with the higher sequence wins, so a
+//                 power loss during an update leaves the previous header.
+//   sector 2...   one equally sized region per image slot
+//
+// The header holds the region table and the image store index. Images are
+// read back through esp_partition_mmap, so the programmer builds BSL packets
+// and CRCs straight from the mapped cache view, without filesystem reads or
+// intermediate copies.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <FS.h>
+#include "image_store.h"
+
+#define RAW_PARTITION_LABEL   "images"
+#define RAW_PARTITION_SUBTYPE 0x40
+#define RAW_SECTOR_SIZE       4096
+#define RAW_HEADER_SECTORS    2
+
+#define RAW_PARTITION_MAGIC   0x50574152  // "RAWP"
+#define RAW_PARTITION_VERSION 2  // 1 held a version 1 image index
+
+struct __attribute__((packed)) RawRegion {
+  uint32_t offset;     // from the start of the partition, sector aligned
+  uint32_t capacity;
+};
+
+struct __attribute__((packed)) RawPartitionHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t regionCount;
+  uint32_t sequence;   // incremented on every header write
+  RawRegion regions[IMAGE_SLOT_COUNT];
+  ImageIndex index;
+  uint32_t crc;        // BSL CRC32 of everything above
+};
+static_assert(sizeof(RawPartitionHeader) <= RAW_SECTOR_SIZE, "header must fit a sector");
+
+// Version 1 header, upgraded when read
+struct __attribute__((packed)) RawPartitionHeaderV1 {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t regionCount;
+  uint32_t sequence;
+  RawRegion regions[IMAGE_SLOT_COUNT];
+  ImageIndexV1 index;
+  uint32_t crc;
+};
+
+// Flash underneath the partition: the real partition on the ESP32, a file
+// on a Linux host (raw_flash_file.cpp)
+class RawFlash {
+ public:
+  virtual ~RawFlash() {}
+  virtual size_t size() const = 0;
+  virtual bool read(uint32_t offset, void* out, size_t len) = 0;
+  // NOR semantics: writes only clear bits, erase sets a range back to 0xFF
+  virtual bool write(uint32_t offset, const void* data, size_t len) = 0;
+  virtual bool erase(uint32_t offset, size_t len) = 0;
+  // Read-only view of [offset, offset + len); release it with unmap()
+  virtual const uint8_t* map(uint32_t offset, size_t len, uint32_t& handle) = 0;
+  virtual void unmap(uint32_t handle) = 0;
+};
+
+// Platform backing for the partition, nullptr if it does not exist
+RawFlash* rawFlashOpen();
+
+// Find the partition and load the newest valid header. Returns false if the
+// partition is missing or too small for IMAGE_SLOT_COUNT regions.
+bool rawPartitionBegin(RawFlash* flash);
+
+// Index from the header, false if the partition holds no valid header yet
+bool rawPartitionLoadIndex(ImageIndex& index);
+bool rawPartitionSaveIndex(const ImageIndex& index);
+
+size_t rawPartitionCapacity(int slot);
+
+// Copy a complete image file into a slot's region and check it through the
+// mapped view. Returns the CRC32 (zlib) and SHA-256 of the first imageSize
+// bytes, the image without a signature trailer, on success.
+bool rawPartitionWriteRegion(int slot, File& src, uint32_t imageSize, uint32_t& crc,
+                             uint8_t* sha256);
+
+const uint8_t* rawPartitionMap(int slot, size_t len, uint32_t& handle);
+void rawPartitionUnmap(uint32_t handle);
@@ -0,0 +1,44 @@
+// Prathik Narsetty
+// Incremental SHA-256 of firmware images
+//
+// On the ESP32 this is mbedTLS, which ESP-IDF runs on the SHA accelerator,
+// so hashing an image as it passes through costs next to nothing. The
+// native build uses a portable implementation with the same interface.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#if defined(ESP_PLATFORM)
+#include <mbedtls/sha256.h>
+#endif
+
+#define SHA256_BYTES 32
+
+// Word i of a digest, big-endian, for printing it in pieces
+inline uint32_t sha256Word(const uint8_t* digest, int i) {
+  return (uint32_t)digest[4 * i] << 24 | digest[4 * i + 1] << 16 | digest[4 * i + 2] << 8 |
+         digest[4 * i + 3];
+}
+
+class Sha256 {
+ public:
+  Sha256() { begin(); }
+  ~Sha256();
+
+  void begin();
+  void update(const uint8_t* data, size_t len);
+  void finish(uint8_t digest[SHA256_BYTES]);
+
+ private:
+#if defined(ESP_PLATFORM)
+  mbedtls_sha256_context ctx_;
+  bool started_ = false;
+#else
+  void block(const uint8_t* data);
+
+  uint32_t state_[8];
+  uint64_t length_;
+  uint8_t buffer_[64];
+  size_t fill_;
+#endif
+};
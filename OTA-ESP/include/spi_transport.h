@@ -0,0 +1,47 @@
+// Prathik Narsetty
+// SPI link to the MSPM0 BSL, as a BslTransport
+//
+// The gateway is the SPI controller and the BSL a peripheral, so the target
+// can only answer while the gateway clocks. Frames are the same as on the
+// UART. A write shifts the frame out and ignores what comes back; a reply is
+// read by clocking SPI_FILL_BYTE until the BSL stops returning it, which is
+// all it sends while it is still working on the command. The ACK (0x00 or an
+// error code) and the 0x08 packet header are never 0xFF, so the first other
+// byte starts the reply. Inside a packet every byte counts, 0xFF included.
+//
+// Selected with -DBSL_TRANSPORT_SPI ([env:arduino_nano_esp32_spi]). The BSL's
+// SPI plugin has no Change Baud Rate; the clock is simply set higher.
+#pragma once
+
+#include <SPI.h>
+#include "bsl_link.h"
+
+#ifndef BSL_SPI_HZ
+#define BSL_SPI_HZ 4000000
+#endif
+
+#define SPI_FILL_BYTE 0xFF
+#define SPI_POLL_GAP_US 20  // between fill bytes while the BSL is busy
+
+class SpiTransport : public BslTransport {
+ public:
+  SpiTransport(int8_t sck, int8_t poci, int8_t pico, int8_t cs, uint32_t hz)
+      : sck_(sck), poci_(poci), pico_(pico), cs_(cs), settings_(hz, MSBFIRST, SPI_MODE0) {}
+
+  void begin();
+
+  bool write(const uint8_t* data, size_t len) override;
+  size_t read(uint8_t* buf, size_t len, uint32_t timeoutMs) override;
+  size_t readStart(uint8_t* buf, size_t len, uint32_t timeoutMs) override;
+  void discardInput() override {}  // nothing arrives unless the gateway clocks it
+  bool setBaudRate(uint32_t baud) override;
+  uint32_t millis() override { return ::millis(); }
+  void delayMs(uint32_t ms) override { delay(ms); }
+
+ private:
+  void select();
+  void deselect();
+
+  int8_t sck_, poci_, pico_, cs_;
+  SPISettings settings_;
+};
@@ -0,0 +1,34 @@
+// Prathik Narsetty
+// Filesystem backend for firmware images, selected per build
+//
+// Image slots, the upload journal and the index all go through storageFs().
+// SPIFFS is the default. Build with -DSTORAGE_LITTLEFS (see
+// [env:arduino_nano_esp32_littlefs]) to use LittleFS instead: its open and
+// exists() costs stay flat as the partition fills, and sequential reads are
+// faster. board_build.filesystem must match, so `pio run -t uploadfs` builds
+// the same kind of image.
+#pragma once
+
+#include <stddef.h>
+#include <FS.h>
+
+#if defined(STORAGE_LITTLEFS)
+#include <LittleFS.h>
+#define STORAGE_FS   LittleFS
+#define STORAGE_NAME "LittleFS"
+#else
+#include <SPIFFS.h>
+#define STORAGE_FS   SPIFFS
+#define STORAGE_NAME "SPIFFS"
+#endif
+
+// Mount the partition, formatting it if it has never been used
+bool storageBegin();
+
+inline fs::FS& storageFs() { return STORAGE_FS; }
+size_t storageTotalBytes();
+size_t storageUsedBytes();
+
+// Measure write and sequential read throughput, open latency and exists()
+// cost on the mounted filesystem. Runs from the console ("bench fs").
+void storageBenchmark(Print& out);
@@ -0,0 +1,38 @@
+// Prathik Narsetty
+// HTTP endpoints for firmware upload, status and trace export
+//
+//   POST /upload[?program=0]        store the request body as a new image in
+//                                   an inactive slot, then activate and
+//                                   program it (or only stage it)
+//   POST /upload?mode=cut-through   program the target while the body is
+//                                   still arriving; the image is stored in
+//                                   parallel for verification and retry
+//                                   (not with IMAGE_SIGNING_KEY)
+//   POST /upload/delta[?program=0] rebuild a new image from the request
+//                                   body, a delta patch (include/delta_patch.h)
+//                                   against a stored image, then store and
+//                                   program it like /upload
+//   POST /upload/begin?size=&chunk=&crc=
+//                                   start or resume a chunked upload
+//   PUT  /upload/chunk?offset=&crc= one chunk at a chunk-aligned offset
+//   GET  /upload/missing            byte ranges still to be sent
+//   POST /upload/commit[?program=0] check the image CRC, store and program
+//   POST /upload/cancel             drop the chunked upload
+//   POST /images/activate?slot=N[&program=0]
+//                                   switch the active image
+//   POST /images/rollback[?program=0]
+//                                   switch back to the previous image
+//   GET  /status                    JSON session state, progress and image slots
+//   POST /cancel                    stop the running session after the
+//                                   frame in flight
+//   GET  /trace                     binary trace export (tools/trace_decode.py)
+//
+// Uploads end in 403 when the gateway requires signed images
+// (include/image_signature.h) and the image is not signed with its key.
+//
+// Only active when WIFI_SSID is defined at build time.
+#pragma once
+
+bool setupUploadServer();
+void handleUploadServer();
+bool uploadServerActive();
@@ -0,0 +1,133 @@
+// Prathik Narsetty
+// Arduino core subset for [env:native], see native_hal.h
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "native_hal.h"
+#include "WString.h"
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define DEC 10
+#define HEX 16
+
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+#define RTC_DATA_ATTR
+
+#define SERIAL_8N1 0x800001c
+
+// Arduino Nano ESP32 pin names
+enum { D0, D1, D2, D3, D4, D5, D6, D7, D8, D9, D10, D11, D12, D13, A4, A5, LED_BUILTIN, NATIVE_PIN_COUNT };
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+// PSRAM is ordinary heap on the host
+inline bool psramFound() { return true; }
+inline void* ps_malloc(size_t size) { return malloc(size); }
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+inline int digitalPinToInterrupt(int pin) { return pin; }
+inline int digitalPinToGPIONumber(int pin) { return pin; }
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  size_t write(const char* str) { return write((const uint8_t*)str, strlen(str)); }
+  virtual void flush() {}
+
+  size_t print(const char* str) { return write(str); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  template <typename T>
+  size_t println(T value) { return print(value) + println(); }
+  size_t println() { return write("\r\n"); }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  void setTimeout(unsigned long timeoutMs) { timeoutMs_ = timeoutMs; }
+  unsigned long getTimeout() const { return timeoutMs_; }
+
+ protected:
+  unsigned long timeoutMs_ = 1000;
+};
+
+// Receive errors passed to HardwareSerial::onReceiveError(), as in the ESP32 core
+enum hardwareSerial_error_t {
+  UART_NO_ERROR,
+  UART_BREAK_ERROR,
+  UART_BUFFER_FULL_ERROR,
+  UART_FIFO_OVF_ERROR,
+  UART_FRAME_ERROR,
+  UART_PARITY_ERROR,
+};
+typedef void (*OnReceiveErrorCb)(hardwareSerial_error_t error);
+
+// UART 0 is the console on stdin/stdout, the others use nativeUartAttach()
+class HardwareSerial : public Stream {
+ public:
+  explicit HardwareSerial(int uart) : uart_(uart) {}
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1,
+             int8_t txPin = -1, bool invert = false, unsigned long timeoutMs = 20000UL);
+  void end();
+  // CTS/RTS only; RX and TX stay on the tty
+  bool setPins(int8_t rxPin, int8_t txPin, int8_t ctsPin = -1, int8_t rtsPin = -1);
+  // CRTSCTS on the tty, honoured by real serial adapters and ignored by a pty
+  bool setHwFlowCtrlMode(uint8_t mode, uint8_t threshold = 64);
+  // Kept but never called: a tty read by the fake has no FIFO to overrun
+  void onReceiveError(OnReceiveErrorCb function) { onReceiveError_ = function; }
+  int available() override;
+  int read() override;
+  int peek() override;
+  // Waits up to the stream timeout for len bytes
+  size_t readBytes(uint8_t* buffer, size_t len);
+  size_t readBytes(char* buffer, size_t len) { return readBytes((uint8_t*)buffer, len); }
+  using Print::write;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override;
+  void flush() override;
+  operator bool() const { return true; }
+
+ private:
+  int fd() const;
+  void chargeWireTime(size_t bytes);
+
+  int uart_;
+  unsigned long baud_ = 0;
+  int peeked_ = -1;
+  OnReceiveErrorCb onReceiveError_ = nullptr;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
@@ -0,0 +1,160 @@
+// Prathik Narsetty
+// ArduinoJson 6 subset for [env:native]: building and serializing documents
+//
+// Enough for the upload server's replies: objects and arrays built with
+// operator[], add() and createNested*(), then serializeJson() into a String.
+// The capacity of StaticJsonDocument is not enforced.
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "WString.h"
+
+struct NativeJsonNode {
+  enum Kind { SCALAR, ARRAY, OBJECT };
+  Kind kind = SCALAR;
+  std::string scalar = "null";  // serialized value of a SCALAR
+  std::vector<std::pair<std::string, std::unique_ptr<NativeJsonNode>>> children;
+
+  NativeJsonNode* child(const char* key) {
+    for (auto& entry : children) {
+      if (entry.first == key) {
+        return entry.second.get();
+      }
+    }
+    children.emplace_back(key, std::unique_ptr<NativeJsonNode>(new NativeJsonNode()));
+    return children.back().second.get();
+  }
+  NativeJsonNode* append(Kind childKind) {
+    children.emplace_back("", std::unique_ptr<NativeJsonNode>(new NativeJsonNode()));
+    children.back().second->kind = childKind;
+    return children.back().second.get();
+  }
+  void set(std::string text) {
+    kind = SCALAR;
+    scalar = std::move(text);
+    children.clear();
+  }
+  void serialize(std::string& out) const;
+};
+
+inline std::string nativeJsonQuote(const char* text) {
+  std::string out = "\"";
+  for (; *text; ++text) {
+    char c = *text;
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if ((unsigned char)c < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out += escaped;
+    } else {
+      out += c;
+    }
+  }
+  return out + "\"";
+}
+
+inline void NativeJsonNode::serialize(std::string& out) const {
+  if (kind == SCALAR) {
+    out += scalar;
+    return;
+  }
+  out += kind == ARRAY ? '[' : '{';
+  for (size_t i = 0; i < children.size(); ++i) {
+    if (i > 0) {
+      out += ',';
+    }
+    if (kind == OBJECT) {
+      out += nativeJsonQuote(children[i].first.c_str()) + ":";
+    }
+    children[i].second->serialize(out);
+  }
+  out += kind == ARRAY ? ']' : '}';
+}
+
+// One member or element; assigning sets its value
+class JsonVariant {
+ public:
+  explicit JsonVariant(NativeJsonNode* node) : node_(node) {}
+
+  JsonVariant& operator=(bool value) {
+    node_->set(value ? "true" : "false");
+    return *this;
+  }
+  template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+  JsonVariant& operator=(T value) {
+    node_->set(std::to_string(value));
+    return *this;
+  }
+  JsonVariant& operator=(const char* value) {
+    node_->set(value != nullptr ? nativeJsonQuote(value) : "null");
+    return *this;
+  }
+  JsonVariant& operator=(const String& value) { return *this = value.c_str(); }
+
+ private:
+  NativeJsonNode* node_;
+};
+
+class JsonObject;
+
+class JsonArray {
+ public:
+  explicit JsonArray(NativeJsonNode* node) : node_(node) {}
+
+  template <typename T>
+  bool add(T value) {
+    JsonVariant(node_->append(NativeJsonNode::SCALAR)) = value;
+    return true;
+  }
+  JsonArray createNestedArray() { return JsonArray(node_->append(NativeJsonNode::ARRAY)); }
+  JsonObject createNestedObject();
+  size_t size() const { return node_->children.size(); }
+
+ private:
+  NativeJsonNode* node_;
+};
+
+class JsonObject {
+ public:
+  explicit JsonObject(NativeJsonNode* node) : node_(node) {}
+
+  JsonVariant operator[](const char* key) { return JsonVariant(node_->child(key)); }
+  JsonArray createNestedArray(const char* key) {
+    NativeJsonNode* child = node_->child(key);
+    child->set("");
+    child->kind = NativeJsonNode::ARRAY;
+    return JsonArray(child);
+  }
+  void serializeTo(std::string& out) const { node_->serialize(out); }
+
+ protected:
+  NativeJsonNode* node_;
+};
+
+inline JsonObject JsonArray::createNestedObject() {
+  return JsonObject(node_->append(NativeJsonNode::OBJECT));
+}
+
+template <size_t Capacity>
+class StaticJsonDocument : public JsonObject {
+ public:
+  StaticJsonDocument() : JsonObject(&root_) { root_.kind = NativeJsonNode::OBJECT; }
+
+ private:
+  NativeJsonNode root_;
+};
+
+template <size_t Capacity>
+size_t serializeJson(const StaticJsonDocument<Capacity>& doc, String& out) {
+  std::string text;
+  doc.serializeTo(text);
+  out = String(text);
+  return text.size();
+}
@@ -0,0 +1,77 @@
+// Prathik Narsetty
+// Arduino FS subset for [env:native]: files in a host directory
+#pragma once
+
+#include <memory>
+#include <string>
+#include "Arduino.h"
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct NativeFile;
+
+class File : public Stream {
+ public:
+  File() {}
+  explicit File(std::shared_ptr<NativeFile> file) : file_(file) {}
+
+  using Print::write;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override;
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t read(uint8_t* buffer, size_t size);
+  size_t readBytes(char* buffer, size_t size) { return read((uint8_t*)buffer, size); }
+  void flush() override;
+  bool seek(uint32_t pos, SeekMode mode = SeekSet);
+  size_t position() const;
+  size_t size() const;
+  void close();
+  const char* path() const;
+  const char* name() const;
+  bool isDirectory() const { return false; }
+  operator bool() const;
+
+ private:
+  std::shared_ptr<NativeFile> file_;
+};
+
+class FS {
+ public:
+  File open(const char* path, const char* mode = FILE_READ, bool create = false);
+  bool exists(const char* path);
+  bool remove(const char* path);
+  bool rename(const char* from, const char* to);
+  bool mkdir(const char* path);
+
+ protected:
+  std::string hostPath(const char* path) const;
+};
+
+// SPIFFS and LittleFS: the same directory with a partition size for
+// totalBytes() and usedBytes()
+class NativeFS : public FS {
+ public:
+  bool begin(bool formatOnFail = false, const char* basePath = "/spiffs", uint8_t maxOpenFiles = 10,
+             const char* partitionLabel = nullptr);
+  void end() {}
+  bool format();
+  size_t totalBytes();
+  size_t usedBytes();
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekMode;
+using fs::SeekSet;
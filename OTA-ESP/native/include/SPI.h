@@ -0,0 +1,45 @@
+// Prathik Narsetty
+// SPI controller for [env:native], see native_hal.h
+//
+// Each byte exchange is one byte written to the attached tty and the one byte
+// the other end answers with, so a peripheral on the far side (bsl_sim
+// --spi) sees the same full-duplex exchange as on the wire.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MSBFIRST 1
+#define SPI_MODE0 0x00
+
+class SPISettings {
+ public:
+  SPISettings(uint32_t clock = 1000000, uint8_t bitOrder = MSBFIRST, uint8_t dataMode = SPI_MODE0)
+      : clock_(clock) {
+    (void)bitOrder;
+    (void)dataMode;
+  }
+  uint32_t clock() const { return clock_; }
+
+ private:
+  uint32_t clock_;
+};
+
+class SPIClass {
+ public:
+  void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1);
+  void end() {}
+  void beginTransaction(const SPISettings& settings) { clock_ = settings.clock(); }
+  void endTransaction() {}
+
+  uint8_t transfer(uint8_t data);
+  void transfer(void* data, uint32_t size);  // in place
+  void writeBytes(const uint8_t* data, uint32_t size);
+
+ private:
+  void exchange(const uint8_t* out, uint8_t* in, uint32_t size);
+
+  uint32_t clock_ = 1000000;
+};
+
+extern SPIClass SPI;
@@ -0,0 +1,7 @@
+// Prathik Narsetty
+// SPIFFS for [env:native], see FS.h
+#pragma once
+
+#include "FS.h"
+
+extern fs::NativeFS SPIFFS;
@@ -0,0 +1,32 @@
+// Prathik Narsetty
+// Arduino String subset for [env:native], backed by std::string
+#pragma once
+
+#include <stdlib.h>
+#include <string>
+
+class String {
+ public:
+  String() {}
+  String(const char* text) : text_(text != nullptr ? text : "") {}
+  String(const std::string& text) : text_(text) {}
+
+  const char* c_str() const { return text_.c_str(); }
+  unsigned int length() const { return text_.size(); }
+  long toInt() const { return strtol(text_.c_str(), nullptr, 10); }
+
+  String& operator+=(const String& other) {
+    text_ += other.text_;
+    return *this;
+  }
+  String& operator+=(char c) {
+    text_ += c;
+    return *this;
+  }
+  bool operator==(const char* other) const { return text_ == other; }
+  bool operator!=(const char* other) const { return text_ != other; }
+  bool operator==(const String& other) const { return text_ == other.text_; }
+
+ private:
+  std::string text_;
+};
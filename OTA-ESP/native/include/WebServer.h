@@ -0,0 +1,77 @@
+// Prathik Narsetty
+// ESP32 WebServer subset for [env:native]: HTTP/1.1 on a loopback socket
+//
+// One request per connection, handled within handleClient(). A body sent to
+// a route with an upload handler is passed to it in HTTP_RAW_BUFLEN pieces
+// (RAW_START, RAW_WRITE..., RAW_END, or RAW_ABORTED if the client goes away)
+// before the route's handler runs, as the ESP32 core does for raw bodies.
+// The port given to the constructor is replaced by the one passed to
+// nativeHttpListen(); without one, begin() does not listen.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "WString.h"
+
+#define HTTP_RAW_BUFLEN 1436
+
+typedef enum { HTTP_ANY, HTTP_GET, HTTP_POST, HTTP_PUT, HTTP_DELETE } HTTPMethod;
+
+enum HTTPRawStatus { RAW_START, RAW_WRITE, RAW_END, RAW_ABORTED };
+
+typedef struct {
+  HTTPRawStatus status;
+  size_t totalSize;    // bytes received so far
+  size_t currentSize;  // bytes in buf
+  uint8_t buf[HTTP_RAW_BUFLEN];
+  void* data;
+} HTTPRaw;
+
+class WebServer {
+ public:
+  typedef std::function<void(void)> THandlerFunction;
+
+  explicit WebServer(int port = 80) : port_(port) {}
+
+  void on(const char* uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn = nullptr) {
+    routes_.push_back({uri, method, fn, ufn});
+  }
+  void begin();
+  void handleClient();
+
+  String arg(const char* name) const;
+  bool hasArg(const char* name) const;
+  HTTPRaw& raw() { return raw_; }
+  size_t clientContentLength() const { return contentLength_; }
+
+  void setContentLength(size_t len) { responseLength_ = len; }
+  void send(int code, const char* contentType, const String& content);
+  void sendContent(const char* data, size_t len);
+
+ private:
+  struct Route {
+    std::string uri;
+    HTTPMethod method;
+    THandlerFunction fn;
+    THandlerFunction ufn;
+  };
+
+  bool readRequest(std::string& method, std::string& path);
+  bool readBody(const Route* route);
+  void writeAll(const char* data, size_t len);
+
+  int port_;
+  int listenFd_ = -1;
+  int clientFd_ = -1;
+  std::vector<Route> routes_;
+  std::vector<std::pair<std::string, std::string>> args_;
+  std::string pending_;  // body bytes read along with the headers
+  size_t contentLength_ = 0;
+  size_t responseLength_ = (size_t)-1;
+  bool responded_ = false;
+  HTTPRaw raw_ = {};
+};
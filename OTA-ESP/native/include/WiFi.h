@@ -0,0 +1,45 @@
+// Prathik Narsetty
+// WiFi subset for [env:native]: the host's network is always up
+//
+// The upload server listens on the loopback port given with --http
+// (native_main.cpp); the address reported is 127.0.0.1.
+#pragma once
+
+#include <stdint.h>
+
+#define WIFI_STA 1
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_CONNECTED = 3,
+} wl_status_t;
+
+class IPAddress {
+ public:
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes_{a, b, c, d} {}
+  uint8_t operator[](int index) const { return bytes_[index]; }
+
+ private:
+  uint8_t bytes_[4];
+};
+
+class WiFiClass {
+ public:
+  bool mode(int mode) {
+    (void)mode;
+    return true;
+  }
+  wl_status_t begin(const char* ssid, const char* password) {
+    (void)ssid;
+    (void)password;
+    return WL_CONNECTED;
+  }
+  wl_status_t status() { return WL_CONNECTED; }
+  bool setSleep(bool enabled) {
+    (void)enabled;
+    return true;
+  }
+  IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+};
+
+inline WiFiClass WiFi;
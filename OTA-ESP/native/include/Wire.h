@@ -0,0 +1,48 @@
+// Prathik Narsetty
+// I2C controller for [env:native], see native_hal.h
+//
+// Each transaction goes to the attached tty as a record, 'W' or 'R', the
+// 7-bit address and a little-endian byte count, followed by the data for a
+// write. The target on the far side (bsl_sim --i2c) answers with I2C_ACK or
+// I2C_NACK for the address, and for an acknowledged read with the bytes.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define I2C_RECORD_WRITE 'W'
+#define I2C_RECORD_READ 'R'
+#define I2C_ACK 0x00
+#define I2C_NACK 0x02  // endTransmission()'s "address not acknowledged"
+
+class TwoWire {
+ public:
+  size_t setBufferSize(size_t size);
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+  void setClock(uint32_t frequency) { clock_ = frequency; }
+  void setTimeOut(uint16_t timeoutMs) { (void)timeoutMs; }
+
+  void beginTransmission(uint16_t address);
+  size_t write(uint8_t data) { return write(&data, 1); }
+  size_t write(const uint8_t* data, size_t size);
+  uint8_t endTransmission(bool sendStop = true);
+
+  size_t requestFrom(uint16_t address, size_t size, bool sendStop = true);
+  int available() { return (int)(rxLength_ - rxIndex_); }
+  int read() { return rxIndex_ < rxLength_ ? rxBuffer_[rxIndex_++] : -1; }
+  size_t readBytes(uint8_t* buffer, size_t length);
+
+ private:
+  void chargeBusTime(size_t bytes);
+
+  uint32_t clock_ = 100000;
+  uint16_t address_ = 0;
+  uint8_t txBuffer_[1024];
+  size_t txLength_ = 0;
+  size_t bufferSize_ = 128;
+  uint8_t rxBuffer_[1024];
+  size_t rxLength_ = 0;
+  size_t rxIndex_ = 0;
+};
+
+extern TwoWire Wire;
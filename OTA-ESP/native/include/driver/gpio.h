@@ -0,0 +1,14 @@
+// Prathik Narsetty
+// ESP-IDF GPIO wakeup for [env:native]
+#pragma once
+
+#include "esp_system.h"
+
+typedef int gpio_num_t;
+typedef enum {
+  GPIO_INTR_LOW_LEVEL = 4,
+  GPIO_INTR_HIGH_LEVEL = 5,
+} gpio_int_type_t;
+
+esp_err_t gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type);
+esp_err_t gpio_wakeup_disable(gpio_num_t pin);
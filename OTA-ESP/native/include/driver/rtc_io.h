@@ -0,0 +1,3 @@
+// Prathik Narsetty
+// ESP-IDF RTC IO for [env:native]: nothing is used from it
+#pragma once
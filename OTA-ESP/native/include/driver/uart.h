@@ -0,0 +1,19 @@
+// Prathik Narsetty
+// ESP-IDF UART driver subset for [env:native]
+#pragma once
+
+#include "esp_system.h"
+
+enum { UART_NUM_0, UART_NUM_1, UART_NUM_2 };
+enum {
+  UART_HW_FLOWCTRL_DISABLE,
+  UART_HW_FLOWCTRL_RTS,
+  UART_HW_FLOWCTRL_CTS,
+  UART_HW_FLOWCTRL_CTS_RTS,
+};
+
+inline esp_err_t uart_set_wakeup_threshold(int uart, int edges) {
+  (void)uart;
+  (void)edges;
+  return ESP_OK;
+}
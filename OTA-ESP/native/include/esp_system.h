@@ -0,0 +1,15 @@
+// Prathik Narsetty
+// ESP-IDF system subset for [env:native]
+#pragma once
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef enum {
+  ESP_RST_UNKNOWN = 0,
+  ESP_RST_POWERON = 1,
+} esp_reset_reason_t;
+
+// Every native run is a power-on
+inline esp_reset_reason_t esp_reset_reason() { return ESP_RST_POWERON; }
@@ -0,0 +1,8 @@
+// Prathik Narsetty
+// ESP-IDF timer for [env:native]: the calling task's virtual time
+#pragma once
+
+#include <stdint.h>
+#include "native_hal.h"
+
+inline int64_t esp_timer_get_time() { return (int64_t)nativeClockUs(); }
@@ -0,0 +1,35 @@
+// Prathik Narsetty
+// FreeRTOS subset for [env:native]; one tick is one millisecond
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "native_hal.h"
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskIDLE_PRIORITY 0
+#define portYIELD_FROM_ISR(woken) (void)(woken)
+
+typedef struct NativeTask* TaskHandle_t;
+typedef struct NativeStreamBuffer* StreamBufferHandle_t;
+
+typedef struct {
+  int unused;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void)(mux), nativeEnterCritical())
+#define portEXIT_CRITICAL(mux) ((void)(mux), nativeExitCritical())
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux), nativeEnterCritical())
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux), nativeExitCritical())
+#define portENTER_CRITICAL_SAFE(mux) ((void)(mux), nativeEnterCritical())
+#define portEXIT_CRITICAL_SAFE(mux) ((void)(mux), nativeExitCritical())
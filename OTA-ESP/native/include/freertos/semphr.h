@@ -0,0 +1,11 @@
+// Prathik Narsetty
+// FreeRTOS mutexes for [env:native]
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef struct NativeMutex* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticksToWait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex);
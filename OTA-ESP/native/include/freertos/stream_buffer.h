@@ -0,0 +1,14 @@
+// Prathik Narsetty
+// FreeRTOS stream buffers for [env:native]
+#pragma once
+
+#include "FreeRTOS.h"
+
+StreamBufferHandle_t xStreamBufferCreate(size_t bufferBytes, size_t triggerLevelBytes);
+void vStreamBufferDelete(StreamBufferHandle_t buffer);
+size_t xStreamBufferSend(StreamBufferHandle_t buffer, const void* data, size_t len,
+                         TickType_t ticksToWait);
+size_t xStreamBufferReceive(StreamBufferHandle_t buffer, void* data, size_t len,
+                            TickType_t ticksToWait);
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t buffer);
+BaseType_t xStreamBufferReset(StreamBufferHandle_t buffer);
@@ -0,0 +1,16 @@
+// Prathik Narsetty
+// FreeRTOS tasks for [env:native]: a thread each, see native_hal.h
+#pragma once
+
+#include "FreeRTOS.h"
+
+BaseType_t xTaskCreate(void (*entry)(void*), const char* name, uint32_t stackDepth, void* param,
+                       UBaseType_t priority, TaskHandle_t* handle);
+// Sleeps for real without advancing the virtual clock, for background tasks
+// that only poll
+void vTaskDelay(TickType_t ticks);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+
+void xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityWoken);
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait);
@@ -0,0 +1,65 @@
+// Prathik Narsetty
+// Control surface of the Linux fakes behind [env:native]
+//
+// The gateway sources build unchanged against the Arduino, ESP-IDF and
+// FreeRTOS headers in native/include. Their implementations in native/src
+// replace the hardware with host resources:
+//
+//   clock    virtual and shared by all tasks, advanced only by UART, SPI and
+//            I2C bytes on the wire at the configured rate, by delay() and by
+//            timeouts that expire, so a session's timing depends on what the
+//            session does and not on the host's load. A delay() ends when
+//            other tasks have moved the clock past it, or jumps the clock
+//            there after as much real time.
+//   Serial   stdin/stdout (console commands, log output)
+//   Serial2  a tty, normally the pty of tools/bslprog/bsl_sim
+//   SPI      a tty carrying one answer byte per byte sent (bsl_sim --spi)
+//   Wire     a tty carrying I2C transactions and their ACK/NACK (bsl_sim --i2c)
+//   GPIO     pin levels in memory; the harness can drive inputs
+//   FS       SPIFFS/LittleFS as a directory on the host
+//   WiFi     always connected; the upload server listens on a loopback port
+//   sleep    light sleep waits for console input, a trigger level or the
+//            timer, advancing the clock by the real time spent asleep
+//   tasks    std::thread per FreeRTOS task
+#pragma once
+
+#include <stdint.h>
+
+// Virtual time, the same for every task
+uint64_t nativeClockUs();
+void nativeClockAdvanceUs(uint64_t us);
+// Move the clock forward to `us` (never back)
+void nativeClockSync(uint64_t us);
+
+// Connect a UART to a tty before setup() runs (Serial2 is UART 2). An
+// unconnected UART drops what is written and never receives anything.
+bool nativeUartAttach(int uart, const char* path);
+// Connect the SPI controller to a tty, for builds with BSL_TRANSPORT_SPI
+bool nativeSpiAttach(const char* path);
+// Connect the I2C controller to a tty, for builds with BSL_TRANSPORT_I2C
+bool nativeI2cAttach(const char* path);
+
+// Level of a pin as last written or driven
+int nativePinLevel(uint8_t pin);
+// Drive an input pin from outside, firing attached interrupts on edges
+void nativePinDrive(uint8_t pin, int level);
+
+// Port of the upload server on 127.0.0.1, before setup(); builds with
+// WIFI_SSID only ([env:native_http])
+void nativeHttpListen(int port);
+
+// Root directory of the fake filesystems, before storageBegin()
+void nativeFsSetRoot(const char* dir);
+
+// True once the console's input has reached end of file
+bool nativeConsoleClosed();
+// Hold console input back while busy() returns true, so a scripted console
+// waits for each session to finish like a person would
+void nativeConsoleHoldWhile(bool (*busy)());
+
+// True while `task` is blocked waiting for a notification
+bool nativeTaskWaiting(struct NativeTask* task);
+
+// Critical sections of portENTER_CRITICAL and friends
+void nativeEnterCritical();
+void nativeExitCritical();
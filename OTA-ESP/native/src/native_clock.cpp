@@ -0,0 +1,70 @@
+// Prathik Narsetty
+// Virtual clock and critical sections for [env:native]
+#include <Arduino.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+// One time line for all tasks, so timestamps from different tasks compare
+static std::mutex clockLock;
+static std::condition_variable clockMoved;
+static uint64_t clockUs = 0;
+
+static std::recursive_mutex criticalLock;
+
+uint64_t nativeClockUs() {
+  std::lock_guard<std::mutex> guard(clockLock);
+  return clockUs;
+}
+
+void nativeClockAdvanceUs(uint64_t us) {
+  std::lock_guard<std::mutex> guard(clockLock);
+  clockUs += us;
+  clockMoved.notify_all();
+}
+
+void nativeClockSync(uint64_t us) {
+  std::lock_guard<std::mutex> guard(clockLock);
+  if (us > clockUs) {
+    clockUs = us;
+    clockMoved.notify_all();
+  }
+}
+
+unsigned long millis() {
+  return (unsigned long)(nativeClockUs() / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)nativeClockUs();
+}
+
+// Wait until other tasks' work has moved the clock past the deadline. If
+// they are idle for as long in real time, the clock jumps there instead, so
+// a task waiting in a loop neither races the clock ahead of a busy one nor
+// waits longer than the time it asked for.
+static void waitFor(uint64_t us) {
+  std::unique_lock<std::mutex> lock(clockLock);
+  uint64_t deadlineUs = clockUs + us;
+  if (!clockMoved.wait_for(lock, std::chrono::microseconds(us),
+                           [deadlineUs] { return clockUs >= deadlineUs; })) {
+    clockUs = deadlineUs;
+    clockMoved.notify_all();
+  }
+}
+
+void delay(uint32_t ms) {
+  waitFor((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us) {
+  waitFor(us);
+}
+
+void nativeEnterCritical() {
+  criticalLock.lock();
+}
+
+void nativeExitCritical() {
+  criticalLock.unlock();
+}
@@ -0,0 +1,179 @@
+// Prathik Narsetty
+// FreeRTOS tasks, notifications and stream buffers for [env:native]
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/stream_buffer.h>
+#include <freertos/task.h>
+
+struct NativeTask {
+  std::mutex lock;
+  std::condition_variable wake;
+  uint32_t notifications = 0;
+  bool waiting = false;
+};
+
+struct NativeMutex {
+  std::timed_mutex lock;
+};
+
+struct NativeStreamBuffer {
+  std::mutex lock;
+  std::condition_variable changed;
+  std::deque<uint8_t> bytes;
+  size_t capacity;
+};
+
+// The thread running setup() and loop() gets its task on first use
+static thread_local NativeTask* currentTask = nullptr;
+
+// Wait for `ready` under `lock`, for ticks real milliseconds. An expired
+// wait moves the virtual clock to at least the end of the timeout.
+template <typename Ready>
+static bool waitFor(std::unique_lock<std::mutex>& lock, std::condition_variable& cv,
+                    TickType_t ticks, Ready ready) {
+  if (ticks == portMAX_DELAY) {
+    cv.wait(lock, ready);
+    return true;
+  }
+  uint64_t deadlineUs = nativeClockUs() + (uint64_t)ticks * 1000;
+  if (cv.wait_for(lock, std::chrono::milliseconds(ticks), ready)) {
+    return true;
+  }
+  nativeClockSync(deadlineUs);
+  return false;
+}
+
+BaseType_t xTaskCreate(void (*entry)(void*), const char* name, uint32_t stackDepth, void* param,
+                       UBaseType_t priority, TaskHandle_t* handle) {
+  (void)name;
+  (void)stackDepth;
+  (void)priority;
+  NativeTask* task = new NativeTask();
+  if (handle != nullptr) {
+    *handle = task;
+  }
+  std::thread([=]() {
+    currentTask = task;
+    entry(param);
+  }).detach();
+  return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  if (currentTask == nullptr) {
+    currentTask = new NativeTask();
+  }
+  return currentTask;
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+  std::lock_guard<std::mutex> guard(task->lock);
+  task->notifications++;
+  task->wake.notify_one();
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityWoken) {
+  xTaskNotifyGive(task);
+  if (higherPriorityWoken != nullptr) {
+    *higherPriorityWoken = pdTRUE;
+  }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+  NativeTask* task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(task->lock);
+  if (task->notifications == 0 && ticksToWait > 0) {
+    task->waiting = true;
+    bool notified = waitFor(lock, task->wake, ticksToWait, [task] { return task->notifications > 0; });
+    task->waiting = false;
+    if (!notified) {
+      return 0;
+    }
+  }
+  uint32_t count = task->notifications;
+  if (count > 0) {
+    task->notifications = clearOnExit ? 0 : count - 1;
+  }
+  return count;
+}
+
+bool nativeTaskWaiting(NativeTask* task) {
+  std::lock_guard<std::mutex> guard(task->lock);
+  return task->waiting;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return new NativeMutex();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticksToWait) {
+  if (ticksToWait == portMAX_DELAY) {
+    mutex->lock.lock();
+    return pdTRUE;
+  }
+  return mutex->lock.try_lock_for(std::chrono::milliseconds(ticksToWait)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+  mutex->lock.unlock();
+  return pdTRUE;
+}
+
+StreamBufferHandle_t xStreamBufferCreate(size_t bufferBytes, size_t triggerLevelBytes) {
+  (void)triggerLevelBytes;
+  NativeStreamBuffer* buffer = new NativeStreamBuffer();
+  buffer->capacity = bufferBytes;
+  return buffer;
+}
+
+void vStreamBufferDelete(StreamBufferHandle_t buffer) {
+  delete buffer;
+}
+
+size_t xStreamBufferSend(StreamBufferHandle_t buffer, const void* data, size_t len,
+                         TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> lock(buffer->lock);
+  waitFor(lock, buffer->changed, ticksToWait,
+          [buffer] { return buffer->bytes.size() < buffer->capacity; });
+  size_t room = buffer->capacity - buffer->bytes.size();
+  size_t n = len < room ? len : room;
+  const uint8_t* src = (const uint8_t*)data;
+  buffer->bytes.insert(buffer->bytes.end(), src, src + n);
+  buffer->changed.notify_all();
+  return n;
+}
+
+size_t xStreamBufferReceive(StreamBufferHandle_t buffer, void* data, size_t len,
+                            TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> lock(buffer->lock);
+  waitFor(lock, buffer->changed, ticksToWait, [buffer] { return !buffer->bytes.empty(); });
+  size_t n = len < buffer->bytes.size() ? len : buffer->bytes.size();
+  uint8_t* dst = (uint8_t*)data;
+  for (size_t i = 0; i < n; i++) {
+    dst[i] = buffer->bytes.front();
+    buffer->bytes.pop_front();
+  }
+  buffer->changed.notify_all();
+  return n;
+}
+
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t buffer) {
+  std::lock_guard<std::mutex> guard(buffer->lock);
+  return buffer->bytes.size();
+}
+
+BaseType_t xStreamBufferReset(StreamBufferHandle_t buffer) {
+  std::lock_guard<std::mutex> guard(buffer->lock);
+  buffer->bytes.clear();
+  buffer->changed.notify_all();
+  return pdPASS;
+}
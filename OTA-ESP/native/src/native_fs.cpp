@@ -0,0 +1,191 @@
+// Prathik Narsetty
+// SPIFFS and LittleFS as a host directory for [env:native]
+#include <FS.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Partition size reported by totalBytes(), as the gateway's SPIFFS partition
+#ifndef NATIVE_FS_BYTES
+#define NATIVE_FS_BYTES (1536 * 1024)
+#endif
+
+fs::NativeFS SPIFFS;
+fs::NativeFS LittleFS;
+
+static std::string fsRoot = "native_fs";
+
+void nativeFsSetRoot(const char* dir) {
+  fsRoot = dir;
+}
+
+namespace fs {
+
+struct NativeFile {
+  FILE* fp = nullptr;
+  std::string path;
+
+  ~NativeFile() {
+    if (fp != nullptr) {
+      fclose(fp);
+    }
+  }
+};
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+  return *this ? fwrite(buffer, 1, size, file_->fp) : 0;
+}
+
+int File::available() {
+  return *this ? (int)(size() - position()) : 0;
+}
+
+int File::read() {
+  return *this ? fgetc(file_->fp) : -1;
+}
+
+int File::peek() {
+  if (!*this) {
+    return -1;
+  }
+  int c = fgetc(file_->fp);
+  if (c != EOF) {
+    ungetc(c, file_->fp);
+  }
+  return c;
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+  return *this ? fread(buffer, 1, size, file_->fp) : 0;
+}
+
+void File::flush() {
+  if (*this) {
+    fflush(file_->fp);
+  }
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  static const int whence[] = {SEEK_SET, SEEK_CUR, SEEK_END};
+  return *this && fseek(file_->fp, pos, whence[mode]) == 0;
+}
+
+size_t File::position() const {
+  return *this ? (size_t)ftell(file_->fp) : 0;
+}
+
+size_t File::size() const {
+  struct stat st;
+  if (!*this) {
+    return 0;
+  }
+  fflush(file_->fp);
+  return fstat(fileno(file_->fp), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+void File::close() {
+  if (*this) {
+    fclose(file_->fp);
+    file_->fp = nullptr;
+  }
+  file_.reset();
+}
+
+const char* File::path() const {
+  return file_ ? file_->path.c_str() : "";
+}
+
+const char* File::name() const {
+  const char* p = path();
+  const char* slash = strrchr(p, '/');
+  return slash != nullptr ? slash + 1 : p;
+}
+
+File::operator bool() const {
+  return file_ && file_->fp != nullptr;
+}
+
+std::string FS::hostPath(const char* path) const {
+  return fsRoot + (path[0] == '/' ? "" : "/") + path;
+}
+
+File FS::open(const char* path, const char* mode, bool create) {
+  (void)create;
+  std::string stdioMode = mode;
+  stdioMode += "b";
+  FILE* fp = fopen(hostPath(path).c_str(), stdioMode.c_str());
+  if (fp == nullptr) {
+    return File();
+  }
+  std::shared_ptr<NativeFile> file = std::make_shared<NativeFile>();
+  file->fp = fp;
+  file->path = path;
+  return File(file);
+}
+
+bool FS::exists(const char* path) {
+  struct stat st;
+  return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path) {
+  return unlink(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char* from, const char* to) {
+  return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+  return ::mkdir(hostPath(path).c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+// A missing directory is an unformatted partition
+bool NativeFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles,
+                     const char* partitionLabel) {
+  (void)basePath;
+  (void)maxOpenFiles;
+  (void)partitionLabel;
+  struct stat st;
+  if (stat(fsRoot.c_str(), &st) == 0) {
+    return S_ISDIR(st.st_mode);
+  }
+  return formatOnFail && format();
+}
+
+bool NativeFS::format() {
+  DIR* dir = opendir(fsRoot.c_str());
+  if (dir == nullptr) {
+    return ::mkdir(fsRoot.c_str(), 0755) == 0;
+  }
+  while (struct dirent* entry = readdir(dir)) {
+    if (entry->d_name[0] != '.') {
+      unlink((fsRoot + "/" + entry->d_name).c_str());
+    }
+  }
+  closedir(dir);
+  return true;
+}
+
+size_t NativeFS::totalBytes() {
+  return NATIVE_FS_BYTES;
+}
+
+size_t NativeFS::usedBytes() {
+  size_t used = 0;
+  DIR* dir = opendir(fsRoot.c_str());
+  if (dir == nullptr) {
+    return 0;
+  }
+  while (struct dirent* entry = readdir(dir)) {
+    struct stat st;
+    if (stat((fsRoot + "/" + entry->d_name).c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+      used += st.st_size;
+    }
+  }
+  closedir(dir);
+  return used;
+}
+
+}  // namespace fs
@@ -0,0 +1,138 @@
+// Prathik Narsetty
+// GPIO, pin interrupts and light sleep for [env:native]
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+
+// Real time per check for a wake source while asleep
+#define SLEEP_POLL_MS 10
+
+// Console input, from native_serial.cpp: true once input is pending or
+// ended and not held back, waiting at most timeoutMs
+bool nativeConsoleWait(uint32_t timeoutMs);
+
+struct PinInterrupt {
+  void (*handler)(void);
+  int mode;
+};
+
+static std::atomic<int> pinLevels[NATIVE_PIN_COUNT];
+static std::atomic<bool> pinDriven[NATIVE_PIN_COUNT];  // by nativePinDrive()
+static PinInterrupt pinInterrupts[NATIVE_PIN_COUNT];
+
+static int wakePin = -1;
+static int wakeLevel = LOW;
+static uint64_t wakeTimerUs = 0;
+static esp_sleep_wakeup_cause_t wakeCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+
+static bool validPin(uint8_t pin) {
+  return pin < NATIVE_PIN_COUNT;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  // A pin driven from outside keeps its level against the pull-up
+  if (validPin(pin) && mode == INPUT_PULLUP && !pinDriven[pin]) {
+    pinLevels[pin] = HIGH;
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  if (validPin(pin)) {
+    pinLevels[pin] = level ? HIGH : LOW;
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  return validPin(pin) ? pinLevels[pin].load() : LOW;
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {
+  if (validPin(pin)) {
+    nativeEnterCritical();
+    pinInterrupts[pin] = {handler, mode};
+    nativeExitCritical();
+  }
+}
+
+void detachInterrupt(uint8_t pin) {
+  attachInterrupt(pin, nullptr, 0);
+}
+
+int nativePinLevel(uint8_t pin) {
+  return digitalRead(pin);
+}
+
+void nativePinDrive(uint8_t pin, int level) {
+  if (!validPin(pin)) {
+    return;
+  }
+  pinDriven[pin] = true;
+  int previous = pinLevels[pin].exchange(level ? HIGH : LOW);
+  nativeEnterCritical();
+  PinInterrupt irq = pinInterrupts[pin];
+  nativeExitCritical();
+  bool falling = previous == HIGH && level == LOW;
+  bool rising = previous == LOW && level == HIGH;
+  if (irq.handler != nullptr && ((falling && (irq.mode & FALLING)) || (rising && (irq.mode & RISING)))) {
+    irq.handler();
+  }
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type) {
+  wakePin = pin;
+  wakeLevel = type == GPIO_INTR_LOW_LEVEL ? LOW : HIGH;
+  return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_disable(gpio_num_t pin) {
+  if (wakePin == pin) {
+    wakePin = -1;
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup() {
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_uart_wakeup(int uart) {
+  (void)uart;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t us) {
+  wakeTimerUs = us;
+  return ESP_OK;
+}
+
+// Wakes on the GPIO level, the timer, or console input, which stands in for
+// the UART wake so commands can be typed at a sleeping gateway
+esp_err_t esp_light_sleep_start() {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point start = Clock::now();
+  uint64_t sleptUs = 0;
+  for (;;) {
+    if (wakePin >= 0 && digitalRead(wakePin) == wakeLevel) {
+      wakeCause = ESP_SLEEP_WAKEUP_GPIO;
+      break;
+    }
+    if (wakeTimerUs != 0 && sleptUs >= wakeTimerUs) {
+      sleptUs = wakeTimerUs;
+      wakeCause = ESP_SLEEP_WAKEUP_TIMER;
+      break;
+    }
+    if (nativeConsoleWait(SLEEP_POLL_MS)) {
+      wakeCause = ESP_SLEEP_WAKEUP_UART;
+      break;
+    }
+    sleptUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+  }
+  nativeClockAdvanceUs(sleptUs);
+  return ESP_OK;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+  return wakeCause;
+}
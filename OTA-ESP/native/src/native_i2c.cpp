@@ -0,0 +1,145 @@
+// Prathik Narsetty
+// I2C controller on a host tty for [env:native]
+#include <Arduino.h>
+#include <Wire.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+// A target that has gone away acknowledges nothing
+#define I2C_ANSWER_TIMEOUT_MS 1000
+#define I2C_RECORD_HEADER_BYTES 4
+#define I2C_START_STOP_BITS 2
+#define I2C_BITS_PER_BYTE 9  // 8 data bits and the acknowledge
+
+TwoWire Wire;
+
+static int i2cFd = -1;
+
+bool nativeI2cAttach(const char* path) {
+  int fd = open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+  struct termios tio;
+  if (fd < 0 || tcgetattr(fd, &tio) != 0) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    return false;
+  }
+  cfmakeraw(&tio);
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  tcsetattr(fd, TCSANOW, &tio);
+  i2cFd = fd;
+  return true;
+}
+
+static bool sendAll(const uint8_t* data, size_t len) {
+  while (len > 0) {
+    ssize_t n = ::write(i2cFd, data, len);
+    if (n < 0 && errno != EINTR && errno != EAGAIN) {
+      return false;
+    }
+    if (n > 0) {
+      data += n;
+      len -= n;
+    }
+  }
+  return true;
+}
+
+static bool receiveAll(uint8_t* data, size_t len) {
+  while (len > 0) {
+    struct pollfd pfd = {i2cFd, POLLIN, 0};
+    if (poll(&pfd, 1, I2C_ANSWER_TIMEOUT_MS) <= 0) {
+      return false;
+    }
+    ssize_t n = ::read(i2cFd, data, len);
+    if (n > 0) {
+      data += n;
+      len -= n;
+    }
+  }
+  return true;
+}
+
+// Send a record header (and write data); true if the target acknowledged
+static bool transaction(uint8_t kind, uint16_t address, const uint8_t* data, size_t len) {
+  if (i2cFd < 0) {
+    return false;
+  }
+  uint8_t header[I2C_RECORD_HEADER_BYTES] = {kind, (uint8_t)address, (uint8_t)(len & 0xFF),
+                                             (uint8_t)(len >> 8)};
+  uint8_t answer;
+  return sendAll(header, sizeof(header)) && (data == nullptr || sendAll(data, len)) &&
+         receiveAll(&answer, 1) && answer == I2C_ACK;
+}
+
+size_t TwoWire::setBufferSize(size_t size) {
+  bufferSize_ = size < sizeof(txBuffer_) ? size : sizeof(txBuffer_);
+  return bufferSize_;
+}
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+  (void)sda;
+  (void)scl;
+  if (frequency != 0) {
+    clock_ = frequency;
+  }
+  return true;
+}
+
+// Address byte and data bytes, each with its acknowledge bit
+void TwoWire::chargeBusTime(size_t bytes) {
+  uint64_t bits = (uint64_t)(1 + bytes) * I2C_BITS_PER_BYTE + I2C_START_STOP_BITS;
+  nativeClockAdvanceUs(bits * 1000000 / clock_);
+}
+
+void TwoWire::beginTransmission(uint16_t address) {
+  address_ = address;
+  txLength_ = 0;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t size) {
+  size_t room = bufferSize_ - txLength_;
+  size_t n = size < room ? size : room;
+  memcpy(&txBuffer_[txLength_], data, n);
+  txLength_ += n;
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  (void)sendStop;
+  bool acked = transaction(I2C_RECORD_WRITE, address_, txBuffer_, txLength_);
+  chargeBusTime(acked ? txLength_ : 0);
+  txLength_ = 0;
+  return acked ? I2C_ACK : I2C_NACK;
+}
+
+size_t TwoWire::requestFrom(uint16_t address, size_t size, bool sendStop) {
+  (void)sendStop;
+  rxIndex_ = 0;
+  rxLength_ = 0;
+  if (size > sizeof(rxBuffer_)) {
+    size = sizeof(rxBuffer_);
+  }
+  if (!transaction(I2C_RECORD_READ, address, nullptr, size)) {
+    chargeBusTime(0);
+    return 0;
+  }
+  if (!receiveAll(rxBuffer_, size)) {
+    return 0;
+  }
+  chargeBusTime(size);
+  rxLength_ = size;
+  return size;
+}
+
+size_t TwoWire::readBytes(uint8_t* buffer, size_t length) {
+  size_t n = 0;
+  while (n < length && rxIndex_ < rxLength_) {
+    buffer[n++] = rxBuffer_[rxIndex_++];
+  }
+  return n;
+}
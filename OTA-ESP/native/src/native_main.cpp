@@ -0,0 +1,129 @@
+// Prathik Narsetty
+// Host entry point for [env:native]
+//
+// Runs the gateway's setup() and loop() against the fakes in native/src with
+// Serial2 on a tty, normally the pty of the BSL simulator. Console commands
+// are read from stdin like from the USB serial port; when stdin ends and no
+// session is queued or running, the gateway stops and the exit status tells
+// whether the last session failed. Timestamps in the log and the trace are
+// virtual (see native_hal.h), so the same session always reports the same
+// phase times:
+//
+//   ./bsl_sim &                                  # prints e.g. /dev/pts/5
+//   mkdir -p native_fs && cp app.bin native_fs/mspm0_firmware.bin
+//   printf 'trace\n' | .pio/build/native/program --port /dev/pts/5 --fs native_fs
+//   printf 'program force\ntrace\n' | .pio/build/native/program --port /dev/pts/5
+//
+// --trigger pulls the trigger pin low once the gateway is up, like a button.
+// --ber RATE[,SEED] flips bits on the BSL link at that bit error rate during
+// the program phase (fault_transport.h), to see how the chunk size adapts.
+// --cts holds the CTS pin low as a target asserting its RTS would, so builds
+// with BSL_FLOW_CONTROL=FLOW_AUTO ([env:native_rtscts]) turn flow control on.
+// Builds with BSL_TRANSPORT_SPI ([env:native_spi]) talk to `bsl_sim --spi`
+// through --spi instead of --port, BSL_TRANSPORT_I2C ([env:native_i2c]) to
+// `bsl_sim --i2c` through --i2c.
+// --http PORT serves the upload endpoints (upload_server.h) on 127.0.0.1 in
+// builds with WIFI_SSID ([env:native_http]), e.g. for tools/chunked_upload.py.
+#include <Arduino.h>
+#include <getopt.h>
+#include "async_log.h"
+#include "fault_transport.h"
+#include "gateway.h"
+
+void setup();
+void loop();
+
+extern TaskHandle_t programmingTaskHandle;
+#ifdef BSL_FAULT_INJECTION
+extern FaultTransport bslFaults;
+#endif
+
+#define PIN_TRIGGER D10  // as in main.cpp
+#define PIN_UART_CTS D3
+
+// Queued, running, or the programming task has not gone back to waiting
+static bool sessionPending() {
+  return programmingInProgress || programmingRequested ||
+         (programmingTaskHandle != nullptr && !nativeTaskWaiting(programmingTaskHandle));
+}
+
+static void usage() {
+  fprintf(stderr, "usage: program [--port TTY] [--spi TTY] [--i2c TTY] [--fs DIR] [--trigger] [--cts]\n"
+          "               [--ber RATE[,SEED]] [--http PORT]\n");
+}
+
+int main(int argc, char** argv) {
+  static const struct option longOptions[] = {
+      {"port", required_argument, nullptr, 'p'},
+      {"spi", required_argument, nullptr, 's'},
+      {"i2c", required_argument, nullptr, 'i'},
+      {"fs", required_argument, nullptr, 'f'},
+      {"trigger", no_argument, nullptr, 't'},
+      {"cts", no_argument, nullptr, 'c'},
+      {"ber", required_argument, nullptr, 'b'},
+      {"http", required_argument, nullptr, 'h'},
+      {nullptr, 0, nullptr, 0},
+  };
+  bool trigger = false;
+  int c;
+  while ((c = getopt_long(argc, argv, "p:s:i:f:tcb:h:", longOptions, nullptr)) != -1) {
+    switch (c) {
+      case 'p':
+        if (!nativeUartAttach(2, optarg)) {
+          perror(optarg);
+          return 2;
+        }
+        break;
+      case 's':
+        if (!nativeSpiAttach(optarg)) {
+          perror(optarg);
+          return 2;
+        }
+        break;
+      case 'i':
+        if (!nativeI2cAttach(optarg)) {
+          perror(optarg);
+          return 2;
+        }
+        break;
+      case 'f':
+        nativeFsSetRoot(optarg);
+        break;
+      case 't':
+        trigger = true;
+        break;
+      case 'c':
+        nativePinDrive(PIN_UART_CTS, LOW);
+        break;
+      case 'h':
+        nativeHttpListen(atoi(optarg));
+        break;
+#ifdef BSL_FAULT_INJECTION
+      case 'b': {
+        char* seed;
+        double ber = strtod(optarg, &seed);
+        bslFaults.configure(ber, *seed == ',' ? strtoul(seed + 1, nullptr, 0) : 1);
+        break;
+      }
+#endif
+      default:
+        usage();
+        return 2;
+    }
+  }
+
+  nativeConsoleHoldWhile(sessionPending);
+  setup();
+  if (trigger) {
+    nativePinDrive(PIN_TRIGGER, LOW);
+    nativePinDrive(PIN_TRIGGER, HIGH);
+  }
+  for (;;) {
+    loop();
+    if (nativeConsoleClosed() && !sessionPending()) {
+      break;
+    }
+  }
+  logFlush();
+  return lastSessionResult == SESSION_FAILED ? 1 : 0;
+}
@@ -0,0 +1,276 @@
+// Prathik Narsetty
+// Print, the console and UARTs on host ttys for [env:native]
+#include <Arduino.h>
+#include <driver/uart.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define UART_COUNT 3
+#define CONSOLE_UART 0
+#define UART_BITS_PER_BYTE 10  // start, 8 data, stop
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+
+static int uartFds[UART_COUNT] = {-1, -1, -1};
+static bool consoleClosed = false;
+static bool (*consoleBusy)() = nullptr;
+
+static speed_t ttySpeed(unsigned long baud) {
+  switch (baud) {
+    case 9600:    return B9600;
+    case 19200:   return B19200;
+    case 38400:   return B38400;
+    case 57600:   return B57600;
+    case 115200:  return B115200;
+    case 1000000: return B1000000;
+    case 2000000: return B2000000;
+    case 3000000: return B3000000;
+    default:      return 0;
+  }
+}
+
+// Wait up to timeoutMs for fd to become readable
+static bool waitReadable(int fd, uint32_t timeoutMs) {
+  struct pollfd pfd = {fd, POLLIN, 0};
+  int ready;
+  do {
+    ready = poll(&pfd, 1, timeoutMs);
+  } while (ready < 0 && errno == EINTR);
+  return ready > 0;
+}
+
+static int pendingBytes(int fd) {
+  int count = 0;
+  if (!waitReadable(fd, 0) || ioctl(fd, FIONREAD, &count) != 0) {
+    return 0;
+  }
+  return count;
+}
+
+bool nativeUartAttach(int uart, const char* path) {
+  if (uart <= CONSOLE_UART || uart >= UART_COUNT) {
+    return false;
+  }
+  int fd = open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+  struct termios tio;
+  if (fd < 0 || tcgetattr(fd, &tio) != 0) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    return false;
+  }
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  tcsetattr(fd, TCSANOW, &tio);
+  uartFds[uart] = fd;
+  return true;
+}
+
+bool nativeConsoleClosed() {
+  return consoleClosed;
+}
+
+void nativeConsoleHoldWhile(bool (*busy)()) {
+  consoleBusy = busy;
+}
+
+bool nativeConsoleWait(uint32_t timeoutMs) {
+  // Held input is not there yet as far as the gateway can tell
+  if (consoleBusy != nullptr && consoleBusy()) {
+    usleep(timeoutMs * 1000);
+    return false;
+  }
+  if (consoleClosed) {
+    return true;
+  }
+  if (!waitReadable(STDIN_FILENO, timeoutMs)) {
+    return false;
+  }
+  int count = 0;
+  if (ioctl(STDIN_FILENO, FIONREAD, &count) == 0 && count == 0) {
+    consoleClosed = true;  // readable with nothing to read: end of file
+  }
+  return true;
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (n < size && write(buffer[n])) {
+    n++;
+  }
+  return n;
+}
+
+size_t Print::print(long n, int base) {
+  char text[24];
+  snprintf(text, sizeof(text), base == HEX ? "%lx" : "%ld", n);
+  return write(text);
+}
+
+size_t Print::print(unsigned long n, int base) {
+  char text[24];
+  snprintf(text, sizeof(text), base == HEX ? "%lx" : "%lu", n);
+  return write(text);
+}
+
+size_t Print::printf(const char* format, ...) {
+  char text[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  if (len < 0) {
+    return 0;
+  }
+  return write((const uint8_t*)text, (size_t)len < sizeof(text) ? len : sizeof(text) - 1);
+}
+
+int HardwareSerial::fd() const {
+  return uart_ == CONSOLE_UART ? STDIN_FILENO : uartFds[uart_];
+}
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin,
+                           bool invert, unsigned long timeoutMs) {
+  (void)config;
+  (void)rxPin;
+  (void)txPin;
+  (void)invert;
+  (void)timeoutMs;
+  baud_ = baud;
+  struct termios tio;
+  speed_t speed = ttySpeed(baud);
+  if (uart_ != CONSOLE_UART && fd() >= 0 && speed != 0 && tcgetattr(fd(), &tio) == 0) {
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    tcsetattr(fd(), TCSADRAIN, &tio);
+  }
+}
+
+// Like the ESP32 core, end() drops the error callback and flow control
+void HardwareSerial::end() {
+  baud_ = 0;
+  onReceiveError_ = nullptr;
+  setHwFlowCtrlMode(UART_HW_FLOWCTRL_DISABLE);
+}
+
+bool HardwareSerial::setPins(int8_t rxPin, int8_t txPin, int8_t ctsPin, int8_t rtsPin) {
+  (void)rxPin;
+  (void)txPin;
+  (void)ctsPin;
+  (void)rtsPin;
+  return true;
+}
+
+bool HardwareSerial::setHwFlowCtrlMode(uint8_t mode, uint8_t threshold) {
+  (void)threshold;
+  struct termios tio;
+  if (uart_ == CONSOLE_UART || fd() < 0 || tcgetattr(fd(), &tio) != 0) {
+    return false;
+  }
+  if (mode == UART_HW_FLOWCTRL_CTS_RTS) {
+    tio.c_cflag |= CRTSCTS;
+  } else {
+    tio.c_cflag &= ~CRTSCTS;
+  }
+  return tcsetattr(fd(), TCSADRAIN, &tio) == 0;
+}
+
+// Bytes take 10 bit times on the wire; the console is not timed
+void HardwareSerial::chargeWireTime(size_t bytes) {
+  if (uart_ != CONSOLE_UART && baud_ != 0) {
+    nativeClockAdvanceUs((uint64_t)bytes * UART_BITS_PER_BYTE * 1000000 / baud_);
+  }
+}
+
+int HardwareSerial::available() {
+  if (fd() < 0 || (uart_ == CONSOLE_UART && consoleBusy != nullptr && consoleBusy())) {
+    return 0;
+  }
+  int count = pendingBytes(fd());
+  if (uart_ == CONSOLE_UART && count == 0) {
+    nativeConsoleWait(0);
+  }
+  return count + (peeked_ >= 0 ? 1 : 0);
+}
+
+int HardwareSerial::peek() {
+  if (peeked_ < 0) {
+    peeked_ = read();
+  }
+  return peeked_;
+}
+
+int HardwareSerial::read() {
+  if (peeked_ >= 0) {
+    int c = peeked_;
+    peeked_ = -1;
+    return c;
+  }
+  uint8_t c;
+  if (fd() < 0 || pendingBytes(fd()) == 0 || ::read(fd(), &c, 1) != 1) {
+    return -1;
+  }
+  chargeWireTime(1);
+  return c;
+}
+
+size_t HardwareSerial::readBytes(uint8_t* buffer, size_t len) {
+  size_t got = 0;
+  if (peeked_ >= 0 && len > 0) {
+    buffer[got++] = (uint8_t)peeked_;
+    peeked_ = -1;
+  }
+  // Wait in real time, but charge the virtual clock only for what a UART
+  // would have taken: the bytes' wire time, or the timeout if they never came
+  uint64_t deadline = nativeClockUs() + (uint64_t)timeoutMs_ * 1000;
+  uint64_t waitedMs = 0;
+  while (got < len && fd() >= 0 && waitedMs < timeoutMs_) {
+    if (!waitReadable(fd(), 1)) {
+      waitedMs++;
+      continue;
+    }
+    ssize_t n = ::read(fd(), buffer + got, len - got);
+    if (n > 0) {
+      got += n;
+    }
+  }
+  if (got < len) {
+    nativeClockSync(deadline);
+  } else {
+    chargeWireTime(got);
+  }
+  return got;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  int out = uart_ == CONSOLE_UART ? STDOUT_FILENO : uartFds[uart_];
+  if (out < 0) {
+    return size;  // nothing attached, the bytes are lost like on an open line
+  }
+  size_t sent = 0;
+  while (sent < size) {
+    ssize_t n = ::write(out, buffer + sent, size - sent);
+    if (n < 0 && errno != EINTR && errno != EAGAIN) {
+      break;
+    }
+    if (n > 0) {
+      sent += n;
+    }
+  }
+  chargeWireTime(sent);
+  return sent;
+}
+
+void HardwareSerial::flush() {
+  if (uart_ != CONSOLE_UART && fd() >= 0) {
+    tcdrain(fd());
+  }
+}
@@ -0,0 +1,93 @@
+// Prathik Narsetty
+// SPI controller on a host tty for [env:native]
+#include <Arduino.h>
+#include <SPI.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+// A peripheral that has gone away answers nothing; the line then reads high
+#define SPI_ANSWER_TIMEOUT_MS 1000
+#define SPI_IDLE_LEVEL 0xFF
+
+SPIClass SPI;
+
+static int spiFd = -1;
+
+bool nativeSpiAttach(const char* path) {
+  int fd = open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+  struct termios tio;
+  if (fd < 0 || tcgetattr(fd, &tio) != 0) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    return false;
+  }
+  cfmakeraw(&tio);
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  tcsetattr(fd, TCSANOW, &tio);
+  spiFd = fd;
+  return true;
+}
+
+void SPIClass::begin(int8_t sck, int8_t miso, int8_t mosi, int8_t ss) {
+  (void)sck;
+  (void)miso;
+  (void)mosi;
+  (void)ss;
+}
+
+// Write all bytes, then collect one answer per byte. The peripheral decides
+// each answer before it sees the byte it is exchanged for, so sending ahead
+// does not change what comes back.
+void SPIClass::exchange(const uint8_t* out, uint8_t* in, uint32_t size) {
+  nativeClockAdvanceUs((uint64_t)size * 8 * 1000000 / clock_);
+  if (spiFd < 0) {
+    if (in != nullptr) {
+      memset(in, SPI_IDLE_LEVEL, size);
+    }
+    return;
+  }
+  for (uint32_t sent = 0; sent < size;) {
+    ssize_t n = ::write(spiFd, out + sent, size - sent);
+    if (n < 0 && errno != EINTR && errno != EAGAIN) {
+      return;
+    }
+    if (n > 0) {
+      sent += n;
+    }
+  }
+  uint8_t sink[64];
+  for (uint32_t got = 0; got < size;) {
+    struct pollfd pfd = {spiFd, POLLIN, 0};
+    if (poll(&pfd, 1, SPI_ANSWER_TIMEOUT_MS) <= 0) {
+      if (in != nullptr) {
+        memset(in + got, SPI_IDLE_LEVEL, size - got);
+      }
+      return;
+    }
+    uint8_t* dst = in != nullptr ? in + got : sink;
+    size_t room = in != nullptr ? size - got : (size - got < sizeof(sink) ? size - got : sizeof(sink));
+    ssize_t n = ::read(spiFd, dst, room);
+    if (n > 0) {
+      got += n;
+    }
+  }
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  uint8_t answer;
+  exchange(&data, &answer, 1);
+  return answer;
+}
+
+void SPIClass::transfer(void* data, uint32_t size) {
+  exchange((const uint8_t*)data, (uint8_t*)data, size);
+}
+
+void SPIClass::writeBytes(const uint8_t* data, uint32_t size) {
+  exchange(data, nullptr, size);
+}
@@ -0,0 +1,269 @@
+// Prathik Narsetty
+// HTTP server of [env:native] on a loopback socket, see WebServer.h
+#include <Arduino.h>
+#include <WebServer.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define HTTP_HEADER_MAX 8192
+#define HTTP_CLIENT_TIMEOUT_S 5
+
+static int httpPort = 0;
+
+void nativeHttpListen(int port) {
+  httpPort = port;
+}
+
+static const char* reasonPhrase(int code) {
+  switch (code) {
+    case 200: return "OK";
+    case 202: return "Accepted";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 409: return "Conflict";
+    case 422: return "Unprocessable Entity";
+    case 507: return "Insufficient Storage";
+    default: return "Error";
+  }
+}
+
+static int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static std::string urlDecode(const std::string& text) {
+  std::string out;
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (text[i] == '+') {
+      out += ' ';
+    } else if (text[i] == '%' && i + 2 < text.size() && hexDigit(text[i + 1]) >= 0 &&
+               hexDigit(text[i + 2]) >= 0) {
+      out += (char)(hexDigit(text[i + 1]) * 16 + hexDigit(text[i + 2]));
+      i += 2;
+    } else {
+      out += text[i];
+    }
+  }
+  return out;
+}
+
+void WebServer::begin() {
+  port_ = httpPort;
+  if (port_ == 0) {
+    return;
+  }
+  listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+  int on = 1;
+  setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port_);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(listenFd_, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listenFd_, 4) != 0) {
+    perror("http");
+    close(listenFd_);
+    listenFd_ = -1;
+    return;
+  }
+  fcntl(listenFd_, F_SETFL, O_NONBLOCK);
+}
+
+String WebServer::arg(const char* name) const {
+  for (const auto& entry : args_) {
+    if (entry.first == name) {
+      return String(entry.second);
+    }
+  }
+  return String();
+}
+
+bool WebServer::hasArg(const char* name) const {
+  for (const auto& entry : args_) {
+    if (entry.first == name) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Request line, query arguments and Content-Length
+bool WebServer::readRequest(std::string& method, std::string& path) {
+  std::string head;
+  char buffer[1024];
+  size_t end;
+  while ((end = head.find("\r\n\r\n")) == std::string::npos) {
+    ssize_t n = recv(clientFd_, buffer, sizeof(buffer), 0);
+    if (n <= 0 || head.size() > HTTP_HEADER_MAX) {
+      return false;
+    }
+    head.append(buffer, n);
+  }
+  pending_ = head.substr(end + 4);
+  head.resize(end);
+
+  size_t lineEnd = head.find("\r\n");
+  std::string requestLine = head.substr(0, lineEnd);
+  size_t space = requestLine.find(' ');
+  size_t space2 = requestLine.find(' ', space + 1);
+  if (space == std::string::npos || space2 == std::string::npos) {
+    return false;
+  }
+  method = requestLine.substr(0, space);
+  std::string target = requestLine.substr(space + 1, space2 - space - 1);
+  size_t question = target.find('?');
+  path = target.substr(0, question);
+  args_.clear();
+  if (question != std::string::npos) {
+    std::string query = target.substr(question + 1);
+    size_t start = 0;
+    while (start <= query.size()) {
+      size_t amp = query.find('&', start);
+      std::string pair = query.substr(start, amp == std::string::npos ? std::string::npos : amp - start);
+      if (!pair.empty()) {
+        size_t equals = pair.find('=');
+        args_.push_back({urlDecode(pair.substr(0, equals)),
+                         equals == std::string::npos ? "" : urlDecode(pair.substr(equals + 1))});
+      }
+      if (amp == std::string::npos) {
+        break;
+      }
+      start = amp + 1;
+    }
+  }
+
+  contentLength_ = 0;
+  for (size_t pos = lineEnd; pos != std::string::npos && pos < head.size();) {
+    size_t next = head.find("\r\n", pos + 2);
+    std::string line = head.substr(pos + 2, next == std::string::npos ? std::string::npos : next - pos - 2);
+    if (strncasecmp(line.c_str(), "Content-Length:", 15) == 0) {
+      contentLength_ = strtoul(line.c_str() + 15, nullptr, 10);
+    }
+    pos = next;
+  }
+  return true;
+}
+
+// Hand the body to the route's upload handler, or drop it. False if the
+// client went away before sending all of it.
+bool WebServer::readBody(const Route* route) {
+  bool raw = route != nullptr && route->ufn;
+  raw_.totalSize = 0;
+  raw_.currentSize = 0;
+  if (raw) {
+    raw_.status = RAW_START;
+    route->ufn();
+  }
+  size_t remaining = contentLength_;
+  while (remaining > 0) {
+    size_t n;
+    if (!pending_.empty()) {
+      n = pending_.size() < sizeof(raw_.buf) ? pending_.size() : sizeof(raw_.buf);
+      n = n < remaining ? n : remaining;
+      memcpy(raw_.buf, pending_.data(), n);
+      pending_.erase(0, n);
+    } else {
+      ssize_t got = recv(clientFd_, raw_.buf, remaining < sizeof(raw_.buf) ? remaining : sizeof(raw_.buf), 0);
+      if (got <= 0) {
+        if (raw) {
+          raw_.status = RAW_ABORTED;
+          raw_.currentSize = 0;
+          route->ufn();
+        }
+        return false;
+      }
+      n = got;
+    }
+    remaining -= n;
+    raw_.currentSize = n;
+    raw_.totalSize += n;
+    if (raw) {
+      raw_.status = RAW_WRITE;
+      route->ufn();
+    }
+  }
+  if (raw) {
+    raw_.status = RAW_END;
+    raw_.currentSize = 0;
+    route->ufn();
+  }
+  return true;
+}
+
+void WebServer::handleClient() {
+  if (listenFd_ < 0) {
+    return;
+  }
+  clientFd_ = accept(listenFd_, nullptr, nullptr);
+  if (clientFd_ < 0) {
+    return;
+  }
+  struct timeval timeout = {HTTP_CLIENT_TIMEOUT_S, 0};
+  setsockopt(clientFd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  std::string method;
+  std::string path;
+  if (readRequest(method, path)) {
+    HTTPMethod verb = method == "GET" ? HTTP_GET : method == "POST" ? HTTP_POST
+                    : method == "PUT" ? HTTP_PUT : method == "DELETE" ? HTTP_DELETE : HTTP_ANY;
+    const Route* route = nullptr;
+    for (const Route& candidate : routes_) {
+      if (candidate.uri == path && (candidate.method == HTTP_ANY || candidate.method == verb)) {
+        route = &candidate;
+        break;
+      }
+    }
+    responded_ = false;
+    responseLength_ = (size_t)-1;
+    if (readBody(route)) {
+      if (route == nullptr) {
+        send(404, "text/plain", "not found\n");
+      } else {
+        route->fn();
+      }
+    }
+  }
+  close(clientFd_);
+  clientFd_ = -1;
+}
+
+void WebServer::writeAll(const char* data, size_t len) {
+  while (len > 0) {
+    ssize_t n = ::send(clientFd_, data, len, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return;
+    }
+    data += n;
+    len -= n;
+  }
+}
+
+void WebServer::send(int code, const char* contentType, const String& content) {
+  if (responded_ || clientFd_ < 0) {
+    return;
+  }
+  responded_ = true;
+  size_t length = responseLength_ != (size_t)-1 ? responseLength_ : content.length();
+  char header[256];
+  int n = snprintf(header, sizeof(header),
+                   "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                   code, reasonPhrase(code), contentType, length);
+  writeAll(header, n);
+  writeAll(content.c_str(), content.length());
+}
+
+void WebServer::sendContent(const char* data, size_t len) {
+  writeAll(data, len);
+}
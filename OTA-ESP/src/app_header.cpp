@@ -0,0 +1,49 @@
+// Prathik Narsetty
+// Application header convention for MSPM0 target images
+#include <string.h>
+#include "app_header.h"
+#include "bsl_frames.h"
+#include "image_source.h"
+
+#define HEADER_BLOCK 256
+
+bool appHeaderFromImage(ImageSource& image, AppHeader& out, uint32_t& imageCrc) {
+  uint8_t block[HEADER_BLOCK];
+  uint8_t* header = (uint8_t*)&out;
+  uint32_t crc = 0xFFFFFFFF;
+  imageCrc = 0xFFFFFFFF;
+  size_t position = 0;
+  int n;
+
+  memset(&out, 0, sizeof(out));
+  while ((n = image.read(block, sizeof(block))) > 0) {
+    size_t end = position + n;
+
+    // Pick up the header bytes that fall into this block
+    size_t from = position > APP_HEADER_OFFSET ? position : APP_HEADER_OFFSET;
+    size_t to = end < APP_HEADER_OFFSET + sizeof(out) ? end : APP_HEADER_OFFSET + sizeof(out);
+    if (from < to) {
+      memcpy(header + (from - APP_HEADER_OFFSET), block + (from - position), to - from);
+    }
+
+    imageCrc = bslCrc32(block, n, imageCrc);
+
+    // CRC everything except the crc field
+    size_t skipFrom = APP_HEADER_CRC_OFFSET;
+    size_t skipTo = skipFrom + sizeof(out.crc);
+    if (end <= skipFrom || position >= skipTo) {
+      crc = bslCrc32(block, n, crc);
+    } else {
+      if (position < skipFrom) {
+        crc = bslCrc32(block, skipFrom - position, crc);
+      }
+      if (end > skipTo) {
+        crc = bslCrc32(block + (skipTo - position), end - skipTo, crc);
+      }
+    }
+    position = end;
+  }
+
+  return n == 0 && out.magic == APP_HEADER_MAGIC && out.length == position &&
+         out.crc == crc;
+}
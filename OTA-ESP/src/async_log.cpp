@@ -0,0 +1,298 @@
+// Prathik Narsetty
+// Asynchronous, rate-limited logging for the OTA gateway
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <atomic>
+#include "async_log.h"
+
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of two");
+
+#define LOG_LINE_MAX 160
+#define LOG_DRAIN_IDLE_MS 20
+
+struct LogRecord {
+  uint32_t timestampMs;
+  const char* fmt;
+  uintptr_t args[LOG_MAX_ARGS];
+  uint16_t suppressed;
+  uint8_t level;
+  uint8_t argCount;
+};
+
+// Bounded multi-producer/multi-consumer ring: each cell carries a sequence
+// number so producers (tasks or ISRs) and the drain never take a lock
+struct LogCell {
+  std::atomic<uint32_t> seq;
+  LogRecord record;
+};
+
+static struct LogRing {
+  LogCell cells[LOG_RING_SIZE];
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+  std::atomic<uint32_t> dropped;
+
+  LogRing() : head(0), tail(0), dropped(0) {
+    for (uint32_t i = 0; i < LOG_RING_SIZE; i++) {
+      cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+} logRing;
+
+// Held by whoever drains, the drain task or logFlush(), so whole lines go
+// out one after another. Also guards lastReportedDrops.
+static SemaphoreHandle_t drainLock = nullptr;
+static uint32_t lastReportedDrops = 0;
+
+static bool ringPush(const LogRecord& record) {
+  uint32_t pos = logRing.head.load(std::memory_order_relaxed);
+  LogCell* cell;
+  for (;;) {
+    cell = &logRing.cells[pos & (LOG_RING_SIZE - 1)];
+    int32_t diff = (int32_t)(cell->seq.load(std::memory_order_acquire) - pos);
+    if (diff == 0) {
+      if (logRing.head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return false; // full
+    } else {
+      pos = logRing.head.load(std::memory_order_relaxed);
+    }
+  }
+  cell->record = record;
+  cell->seq.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+static bool ringPop(LogRecord& record) {
+  uint32_t pos = logRing.tail.load(std::memory_order_relaxed);
+  LogCell* cell;
+  for (;;) {
+    cell = &logRing.cells[pos & (LOG_RING_SIZE - 1)];
+    int32_t diff = (int32_t)(cell->seq.load(std::memory_order_acquire) - (pos + 1));
+    if (diff == 0) {
+      if (logRing.tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return false; // empty
+    } else {
+      pos = logRing.tail.load(std::memory_order_relaxed);
+    }
+  }
+  record = cell->record;
+  cell->seq.store(pos + LOG_RING_SIZE, std::memory_order_release);
+  return true;
+}
+
+bool logEmit(LogSite* site, const uintptr_t* args, uint8_t argCount) {
+  uint32_t now = millis();
+
+  // Per-site rate limit over a one second window. The site state is shared
+  // between callers without a lock; a lost update only skews the count by one.
+  if (site->maxPerSecond != 0) {
+    if (now - site->windowStartMs >= 1000) {
+      site->windowStartMs = now;
+      site->windowCount = 0;
+    }
+    if (site->windowCount >= site->maxPerSecond) {
+      site->suppressed++;
+      return false;
+    }
+    site->windowCount++;
+  }
+
+  LogRecord record;
+  record.timestampMs = now;
+  record.fmt = site->fmt;
+  record.level = site->level;
+  record.argCount = argCount;
+  record.suppressed = site->suppressed;
+  for (uint8_t i = 0; i < LOG_MAX_ARGS; i++) {
+    record.args[i] = i < argCount ? args[i] : 0;
+  }
+
+  if (!ringPush(record)) {
+    logRing.dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  site->suppressed = 0;
+  return true;
+}
+
+uint32_t logDroppedCount() {
+  return logRing.dropped.load(std::memory_order_relaxed);
+}
+
+// Minimal printf subset working on captured pointer-sized arguments
+size_t logFormat(char* out, size_t outSize, const char* fmt,
+                 const uintptr_t* args, uint8_t argCount) {
+  size_t len = 0;
+  uint8_t argIndex = 0;
+  if (outSize == 0) {
+    return 0;
+  }
+
+  auto put = [&](char c) {
+    if (len + 1 < outSize) {
+      out[len++] = c;
+    }
+  };
+
+  while (*fmt) {
+    if (*fmt != '%') {
+      put(*fmt++);
+      continue;
+    }
+    fmt++;
+    if (*fmt == '%') {
+      put(*fmt++);
+      continue;
+    }
+
+    char pad = ' ';
+    if (*fmt == '0') {
+      pad = '0';
+      fmt++;
+    }
+    uint8_t width = 0;
+    while (*fmt >= '0' && *fmt <= '9') {
+      width = width * 10 + (*fmt++ - '0');
+    }
+    while (*fmt == 'l' || *fmt == 'h' || *fmt == 'z') {
+      fmt++;
+    }
+
+    char conv = *fmt;
+    if (conv == '\0') {
+      break;
+    }
+    fmt++;
+    uintptr_t arg = argIndex < argCount ? args[argIndex] : 0;
+    argIndex++;
+
+    if (conv == 's') {
+      const char* s = arg ? reinterpret_cast<const char*>(arg) : "(null)";
+      while (*s) {
+        put(*s++);
+      }
+      continue;
+    }
+    if (conv == 'c') {
+      put((char)arg);
+      continue;
+    }
+
+    char digits[12];
+    uint8_t n = 0;
+    bool negative = false;
+    uint32_t value = (uint32_t)arg;
+    uint32_t base = (conv == 'x' || conv == 'X') ? 16 : 10;
+    const char* alphabet = conv == 'X' ? "0123456789ABCDEF" : "0123456789abcdef";
+
+    if (conv == 'd' || conv == 'i') {
+      int32_t signedValue = (int32_t)(intptr_t)arg;
+      if (signedValue < 0) {
+        negative = true;
+        value = (uint32_t)(-(int64_t)signedValue);
+      }
+    }
+    do {
+      digits[n++] = alphabet[value % base];
+      value /= base;
+    } while (value != 0 && n < sizeof(digits));
+
+    uint8_t total = n + (negative ? 1 : 0);
+    if (negative && pad == '0') {
+      put('-');
+    }
+    while (width > total) {
+      put(pad);
+      width--;
+    }
+    if (negative && pad != '0') {
+      put('-');
+    }
+    while (n > 0) {
+      put(digits[--n]);
+    }
+  }
+
+  out[len] = '\0';
+  return len;
+}
+
+static void writeRecord(const LogRecord& record) {
+  static const char levelChar[] = { '-', 'E', 'W', 'I', 'D' };
+  char line[LOG_LINE_MAX];
+  int len = snprintf(line, sizeof(line), "[%7lu] %c ",
+                     (unsigned long)record.timestampMs,
+                     levelChar[record.level <= LOG_LEVEL_DEBUG ? record.level : 0]);
+  if (len < 0) {
+    return;
+  }
+  len += logFormat(line + len, sizeof(line) - len, record.fmt, record.args, record.argCount);
+  if (record.suppressed != 0 && (size_t)len < sizeof(line)) {
+    len += snprintf(line + len, sizeof(line) - len, " (+%u suppressed)", (unsigned)record.suppressed);
+    if ((size_t)len >= sizeof(line)) {
+      len = sizeof(line) - 1;
+    }
+  }
+  Serial.write((const uint8_t*)line, len);
+  Serial.write((const uint8_t*)"\r\n", 2);
+}
+
+// Callers hold drainLock once logBegin() has created it
+static bool drainOnce() {
+  LogRecord record;
+  if (!ringPop(record)) {
+    return false;
+  }
+  writeRecord(record);
+
+  uint32_t drops = logDroppedCount();
+  if (drops != lastReportedDrops) {
+    Serial.print("[log] ");
+    Serial.print(drops - lastReportedDrops);
+    Serial.println(" records dropped (ring full)");
+    lastReportedDrops = drops;
+  }
+  return true;
+}
+
+static void logDrainTask(void* param) {
+  (void)param;
+  for (;;) {
+    xSemaphoreTake(drainLock, portMAX_DELAY);
+    bool drained = drainOnce();
+    xSemaphoreGive(drainLock);
+    if (!drained) {
+      vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_IDLE_MS));
+    }
+  }
+}
+
+void logBegin() {
+  static bool started = false;
+  if (started) {
+    return;
+  }
+  started = true;
+  drainLock = xSemaphoreCreateMutex();
+  // Lowest priority above idle: the drain only runs when nothing else wants the CPU
+  xTaskCreate(logDrainTask, "logDrain", 3072, nullptr, tskIDLE_PRIORITY + 1, nullptr);
+}
+
+void logFlush() {
+  if (drainLock != nullptr) {
+    xSemaphoreTake(drainLock, portMAX_DELAY);
+  }
+  while (drainOnce()) {
+  }
+  Serial.flush();
+  if (drainLock != nullptr) {
+    xSemaphoreGive(drainLock);
+  }
+}
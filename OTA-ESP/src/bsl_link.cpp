@@ -0,0 +1,192 @@
+// Prathik Narsetty
+// MSPM0 BSL protocol core, shared by the gateway and the Linux programmer
+#include <string.h>
+#include "bsl_link.h"
+
+// Constant command frames, CRCs computed at compile time and stored in flash
+constexpr auto FRAME_CONNECTION = bslCommandFrame(CMD_CONNECTION);
+constexpr auto FRAME_GET_ID = bslCommandFrame(CMD_GET_ID);
+constexpr auto FRAME_MASS_ERASE = bslCommandFrame(CMD_MASS_ERASE);
+constexpr auto FRAME_START_APP = bslCommandFrame(CMD_START_APP);
+
+// Reference vector from the MSPM0 BSL user's guide
+static_assert(FRAME_CONNECTION.bytes[4] == 0x3A && FRAME_CONNECTION.bytes[5] == 0x61 &&
+              FRAME_CONNECTION.bytes[6] == 0x44 && FRAME_CONNECTION.bytes[7] == 0xDE,
+              "BSL CRC mismatch");
+
+// Wait per Connection attempt; the frame alone takes ~8 ms at 9600 baud
+#define CONNECT_ACK_TIMEOUT_MS 20
+
+// Packet header: 0x08, length (2 bytes)
+#define RSP_PREFIX_BYTES 3
+
+uint8_t bslBaudCode(uint32_t baud) {
+  switch (baud) {
+    case 4800:    return BSL_BAUD_4800;
+    case 9600:    return BSL_BAUD_9600;
+    case 19200:   return BSL_BAUD_19200;
+    case 38400:   return BSL_BAUD_38400;
+    case 57600:   return BSL_BAUD_57600;
+    case 115200:  return BSL_BAUD_115200;
+    case 1000000: return BSL_BAUD_1000000;
+    case 2000000: return BSL_BAUD_2000000;
+    case 3000000: return BSL_BAUD_3000000;
+    default:      return 0;
+  }
+}
+
+BSL_error_t BslLink::connect(uint32_t timeoutMs, uint32_t backoffMinMs, uint32_t backoffMaxMs,
+                             uint16_t& attempts) {
+  uint32_t start = io_.millis();
+  uint32_t backoff = backoffMinMs;
+  attempts = 0;
+  while (io_.millis() - start < timeoutMs) {
+    // Boot noise or a late NAK from the previous attempt
+    io_.discardInput();
+    attempts++;
+    if (send(FRAME_CONNECTION.bytes, FRAME_CONNECTION.size, false, CONNECT_ACK_TIMEOUT_MS) ==
+        eBSL_success) {
+      return eBSL_success;
+    }
+    io_.delayMs(backoff);
+    backoff = backoff * 2 > backoffMaxMs ? backoffMaxMs : backoff * 2;
+  }
+  return eBSL_timeout;
+}
+
+BSL_error_t BslLink::getDeviceInfo(BslDeviceInfo& info) {
+  BSL_error_t result = expectType(send(FRAME_GET_ID.bytes, FRAME_GET_ID.size, true),
+                                  RSP_DEVICE_INFO, sizeof(info));
+  if (result == eBSL_success) {
+    memcpy(&info, &rx_[BSL_RSP_DATA_OFFSET], sizeof(info));
+  }
+  return result;
+}
+
+BSL_error_t BslLink::changeBaudRate(uint32_t baud) {
+  uint8_t code = bslBaudCode(baud);
+  if (code == 0) {
+    return eBSL_unknownError;
+  }
+  uint8_t frame[BSL_FRAME_OVERHEAD + 1];
+  frame[BSL_CMD_DATA_OFFSET] = code;
+  size_t len = bslSealFrame(frame, CMD_CHANGE_BAUD_RATE, 1);
+
+  // The BSL answers with the ACK at the old speed, then switches
+  BSL_error_t result = send(frame, len, false);
+  if (result != eBSL_success) {
+    return result;
+  }
+  return io_.setBaudRate(baud) ? eBSL_success : eBSL_unknownError;
+}
+
+BSL_error_t BslLink::unlock(const uint8_t* password) {
+  uint8_t frame[BSL_FRAME_OVERHEAD + BSL_PASSWORD_BYTES];
+  memcpy(&frame[BSL_CMD_DATA_OFFSET], password, BSL_PASSWORD_BYTES);
+  size_t len = bslSealFrame(frame, CMD_RX_PASSWORD, BSL_PASSWORD_BYTES);
+  return send(frame, len, true);
+}
+
+BSL_error_t BslLink::massErase() {
+  return send(FRAME_MASS_ERASE.bytes, FRAME_MASS_ERASE.size, true, BSL_ERASE_TIMEOUT_MS);
+}
+
+BSL_error_t BslLink::programData(uint32_t address, const uint8_t* data, size_t len) {
+  if (programFrame_.sealExternal(address, data, len) == 0) {
+    return eBSL_unknownError;
+  }
+  // Header, payload in place, CRC
+  if (!io_.write(programFrame_.data(), programFrame_.HEADER_BYTES) ||
+      !io_.write(data, len) ||
+      !io_.write(programFrame_.crc(), BSL_CRC_BYTES)) {
+    return eBSL_unknownError;
+  }
+  return receive(true, BSL_REPLY_TIMEOUT_MS);
+}
+
+BSL_error_t BslLink::readMemory(uint32_t address, uint8_t* out, size_t len) {
+  if (len > maxReadBytes()) {
+    return eBSL_unknownError;
+  }
+  readBackFrame_.build(address, len);
+  BSL_error_t result = expectType(send(readBackFrame_.data(), BslReadBackFrame::SIZE, true),
+                                  RSP_MEMORY_READ_BACK, len);
+  if (result == eBSL_success) {
+    memcpy(out, &rx_[BSL_RSP_DATA_OFFSET], len);
+  }
+  return result;
+}
+
+BSL_error_t BslLink::verifyCrc(uint32_t address, uint32_t len, uint32_t& crc) {
+  BslVerifyFrame frame;
+  frame.build(address, len);
+  BSL_error_t result = expectType(
+      send(frame.data(), BslVerifyFrame::SIZE, true, BSL_VERIFY_TIMEOUT_MS),
+      RSP_STANDALONE_VERIFICATION, sizeof(crc));
+  if (result == eBSL_success) {
+    crc = bslGetLE32(&rx_[BSL_RSP_DATA_OFFSET]);
+  }
+  return result;
+}
+
+BSL_error_t BslLink::startApp() {
+  // The BSL ACKs and resets into the application
+  return send(FRAME_START_APP.bytes, FRAME_START_APP.size, false);
+}
+
+BSL_error_t BslLink::send(const uint8_t* frame, size_t len, bool expectPacket,
+                          uint32_t timeoutMs) {
+  if (!io_.write(frame, len)) {
+    return eBSL_unknownError;
+  }
+  return receive(expectPacket, timeoutMs);
+}
+
+// Read the ACK and, if the command has one, the response packet. Message
+// packets carry the command status, which becomes the result.
+BSL_error_t BslLink::receive(bool expectPacket, uint32_t timeoutMs) {
+  rxLength_ = io_.readStart(rx_, 1, timeoutMs);
+  if (rxLength_ == 0) {
+    return eBSL_timeout;
+  }
+  if (rx_[BSL_RSP_ACK_OFFSET] != eBSL_success || !expectPacket) {
+    return rx_[BSL_RSP_ACK_OFFSET];
+  }
+
+  rxLength_ += io_.readStart(&rx_[BSL_RSP_HEADER_OFFSET], RSP_PREFIX_BYTES, BSL_REPLY_TIMEOUT_MS);
+  if (rxLength_ < BSL_RSP_TYPE_OFFSET) {
+    return eBSL_timeout;
+  }
+  size_t packetLen = rx_[BSL_RSP_HEADER_OFFSET + 1] | (rx_[BSL_RSP_HEADER_OFFSET + 2] << 8);
+  if (rx_[BSL_RSP_HEADER_OFFSET] != RSP_HEADER || packetLen == 0 ||
+      BSL_RSP_TYPE_OFFSET + packetLen + BSL_CRC_BYTES > sizeof(rx_)) {
+    io_.discardInput();
+    return eBSL_badResponse;
+  }
+
+  size_t rest = packetLen + BSL_CRC_BYTES;
+  rxLength_ += io_.read(&rx_[BSL_RSP_TYPE_OFFSET], rest, BSL_REPLY_TIMEOUT_MS);
+  if (rxLength_ < BSL_RSP_TYPE_OFFSET + rest) {
+    return eBSL_timeout;
+  }
+  if (bslGetLE32(&rx_[BSL_RSP_TYPE_OFFSET + packetLen]) !=
+      bslCrc32(&rx_[BSL_RSP_TYPE_OFFSET], packetLen)) {
+    return eBSL_badResponse;
+  }
+  if (rx_[BSL_RSP_TYPE_OFFSET] == RSP_MESSAGE) {
+    return packetLen > 1 ? rx_[BSL_RSP_DATA_OFFSET] : (BSL_error_t)eBSL_badResponse;
+  }
+  return eBSL_success;
+}
+
+// Check that a successful reply is a packet of `type` with dataLen bytes
+BSL_error_t BslLink::expectType(BSL_error_t result, uint8_t type, size_t dataLen) {
+  if (result != eBSL_success) {
+    return result;
+  }
+  size_t packetLen = rx_[BSL_RSP_HEADER_OFFSET + 1] | (rx_[BSL_RSP_HEADER_OFFSET + 2] << 8);
+  if (rx_[BSL_RSP_TYPE_OFFSET] != type || packetLen != 1 + dataLen) {
+    return eBSL_badResponse;
+  }
+  return eBSL_success;
+}
@@ -0,0 +1,97 @@
+// Prathik Narsetty
+// Persistent binary event trace for post-mortem timing analysis
+#include <Arduino.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include "bsl_trace.h"
+
+struct TraceBuffer {
+  TraceHeader header;
+  TraceRecord records[TRACE_CAPACITY];
+};
+
+// RTC slow memory, left untouched by the startup code on soft resets and
+// wake from deep sleep. Atomics are not usable there, so writers serialize
+// through a spinlock that lives in regular DRAM.
+RTC_NOINIT_ATTR static TraceBuffer traceBuffer;
+static portMUX_TYPE traceLock = portMUX_INITIALIZER_UNLOCKED;
+
+static void traceReset() {
+  traceBuffer.header.magic = TRACE_MAGIC;
+  traceBuffer.header.version = TRACE_VERSION;
+  traceBuffer.header.capacity = TRACE_CAPACITY;
+  traceBuffer.header.head = 0;
+  traceBuffer.header.bootCount = 0;
+  memset(traceBuffer.records, 0, sizeof(traceBuffer.records));
+}
+
+void traceBegin() {
+  // Anything but a matching header means power-on or a layout change
+  if (traceBuffer.header.magic != TRACE_MAGIC ||
+      traceBuffer.header.version != TRACE_VERSION ||
+      traceBuffer.header.capacity != TRACE_CAPACITY) {
+    traceReset();
+  }
+  traceBuffer.header.bootCount++;
+  trace(TRACE_BOOT, (uint16_t)esp_reset_reason(), traceBuffer.header.bootCount);
+}
+
+void IRAM_ATTR trace(uint16_t event, uint16_t arg0, uint32_t arg1) {
+  uint32_t now = (uint32_t)esp_timer_get_time();
+  portENTER_CRITICAL_SAFE(&traceLock);
+  TraceRecord& record = traceBuffer.records[traceBuffer.header.head % TRACE_CAPACITY];
+  record.timeUs = now;
+  record.event = event;
+  record.arg0 = arg0;
+  record.arg1 = arg1;
+  traceBuffer.header.head++;
+  portEXIT_CRITICAL_SAFE(&traceLock);
+}
+
+void traceClear() {
+  portENTER_CRITICAL(&traceLock);
+  uint32_t bootCount = traceBuffer.header.bootCount;
+  traceReset();
+  traceBuffer.header.bootCount = bootCount;
+  portEXIT_CRITICAL(&traceLock);
+}
+
+size_t traceExportSize() {
+  return sizeof(TraceBuffer);
+}
+
+size_t traceExport(uint8_t* out, size_t outSize) {
+  if (outSize < sizeof(TraceBuffer)) {
+    return 0;
+  }
+  portENTER_CRITICAL(&traceLock);
+  memcpy(out, &traceBuffer, sizeof(TraceBuffer));
+  portEXIT_CRITICAL(&traceLock);
+  return sizeof(TraceBuffer);
+}
+
+// Hex dump framed by markers so tools/trace_decode.py can pick it out of a
+// captured serial log
+void traceDump(Print& out) {
+  static uint8_t snapshot[sizeof(TraceBuffer)];
+  size_t len = traceExport(snapshot, sizeof(snapshot));
+
+  out.println("=== TRACE BEGIN ===");
+  char line[2 * 32 + 1];
+  for (size_t offset = 0; offset < len; offset += 32) {
+    size_t n = len - offset < 32 ? len - offset : 32;
+    for (size_t i = 0; i < n; i++) {
+      snprintf(&line[2 * i], 3, "%02x", snapshot[offset + i]);
+    }
+    out.println(line);
+  }
+  out.println("=== TRACE END ===");
+}
+
+const char* tracePhaseName(uint16_t phase) {
+  static const char* const names[] = {
+      "idle", "enter_bsl", "connect", "get_id", "baud", "password",
+      "erase", "program", "verify", "start_app", "check_app", "signature",
+  };
+  return phase < sizeof(names) / sizeof(names[0]) ? names[phase] : "unknown";
+}
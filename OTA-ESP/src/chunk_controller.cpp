@@ -0,0 +1,42 @@
+// Prathik Narsetty
+// Program Data payload size that adapts to the link, AIMD style
+#include "chunk_controller.h"
+
+uint16_t ChunkController::roundDown(uint32_t bytes) const {
+  uint32_t rounded = bytes - bytes % granule_;
+  return rounded < min_ ? min_ : rounded > 0xFFFF ? 0xFFFF - 0xFFFF % granule_ : rounded;
+}
+
+void ChunkController::begin(uint16_t limitBytes) {
+  limit_ = roundDown(limitBytes);
+  size_ = start_ < limit_ ? roundDown(start_) : limit_;
+  frames_ = 0;
+  failures_ = 0;
+  bytes_ = 0;
+  linkUs_ = 0;
+}
+
+void ChunkController::onAck(size_t bytes, uint32_t elapsedUs) {
+  frames_++;
+  bytes_ += bytes;
+  linkUs_ += elapsedUs;
+  // Additive increase
+  uint32_t next = (uint32_t)size_ + step_;
+  size_ = next > limit_ ? limit_ : roundDown(next);
+}
+
+bool ChunkController::onFailure(uint32_t elapsedUs) {
+  frames_++;
+  failures_++;
+  linkUs_ += elapsedUs;
+  // Multiplicative decrease. Halving overshoots: with a checksum NAK every
+  // few frames it pins the size at the floor, where the per-frame cost and
+  // the odd timeout eat more than the shorter frames save.
+  uint16_t previous = size_;
+  size_ = roundDown((uint32_t)size_ * 3 / 4);
+  return size_ < previous;
+}
+
+uint32_t ChunkController::goodput() const {
+  return linkUs_ == 0 ? 0 : (uint32_t)(bytes_ * 1000000 / linkUs_);
+}
@@ -0,0 +1,246 @@
+// Prathik Narsetty
+// Resumable, offset-addressed image upload with a persistent journal
+#include <Arduino.h>
+#include "chunked_upload.h"
+#include "bsl_frames.h"
+#include "async_log.h"
+
+#define PREALLOC_BLOCK 256
+
+static uint32_t imageCrc32(const uint8_t* data, size_t len) {
+  return ~bslCrc32(data, len);
+}
+
+bool ChunkedUpload::restore() {
+  closeFiles();
+  active_ = false;
+
+  File journal = fs_.open(UPLOAD_JOURNAL_PATH, FILE_READ);
+  if (!journal) {
+    return false;
+  }
+  UploadJournalHeader header;
+  bool ok = journal.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+            header.magic == UPLOAD_JOURNAL_MAGIC &&
+            header.version == UPLOAD_JOURNAL_VERSION &&
+            header.chunkSize >= UPLOAD_CHUNK_MIN && header.chunkSize <= UPLOAD_CHUNK_MAX &&
+            header.totalSize > 0;
+  if (ok) {
+    header_ = header;
+    ok = chunkCount() <= UPLOAD_MAX_CHUNKS;
+  }
+  size_t bitmapBytes = ok ? (chunkCount() + 7) / 8 : 0;
+  memset(bitmap_, 0, sizeof(bitmap_));
+  ok = ok && journal.read(bitmap_, bitmapBytes) == bitmapBytes;
+  journal.close();
+
+  if (!ok || !openFiles() || part_.size() != header_.totalSize) {
+    LOGW("Discarding unusable upload journal");
+    cancel();
+    return false;
+  }
+
+  received_ = 0;
+  for (uint32_t i = 0; i < chunkCount(); ++i) {
+    received_ += hasChunk(i) ? 1 : 0;
+  }
+  active_ = true;
+  LOGI("Resumed upload: %u of %u chunks present", received_, chunkCount());
+  return true;
+}
+
+bool ChunkedUpload::begin(uint32_t totalSize, uint16_t chunkSize, uint32_t imageCrc) {
+  if (active_ && header_.totalSize == totalSize && header_.chunkSize == chunkSize &&
+      header_.imageCrc == imageCrc) {
+    return true;  // same image, keep what we have
+  }
+
+  cancel();
+  if (totalSize == 0 || chunkSize < UPLOAD_CHUNK_MIN || chunkSize > UPLOAD_CHUNK_MAX ||
+      (totalSize + chunkSize - 1) / chunkSize > UPLOAD_MAX_CHUNKS) {
+    return false;
+  }
+
+  header_.magic = UPLOAD_JOURNAL_MAGIC;
+  header_.version = UPLOAD_JOURNAL_VERSION;
+  header_.chunkSize = chunkSize;
+  header_.totalSize = totalSize;
+  header_.imageCrc = imageCrc;
+  memset(bitmap_, 0, sizeof(bitmap_));
+  received_ = 0;
+
+  if (!createFiles() || !openFiles()) {
+    LOGE("Failed to create upload files (storage full?)");
+    cancel();
+    return false;
+  }
+  active_ = true;
+  LOGI("Upload session: %u bytes in %u chunks", totalSize, chunkCount());
+  return true;
+}
+
+bool ChunkedUpload::createFiles() {
+  // Preallocate the part file so chunks can be written at any offset
+  File part = fs_.open(UPLOAD_PART_PATH, FILE_WRITE);
+  if (!part) {
+    return false;
+  }
+  uint8_t zeros[PREALLOC_BLOCK] = {};
+  uint32_t remaining = header_.totalSize;
+  while (remaining > 0) {
+    size_t n = remaining < sizeof(zeros) ? remaining : sizeof(zeros);
+    if (part.write(zeros, n) != n) {
+      part.close();
+      return false;
+    }
+    remaining -= n;
+  }
+  part.close();
+
+  File journal = fs_.open(UPLOAD_JOURNAL_PATH, FILE_WRITE);
+  if (!journal) {
+    return false;
+  }
+  size_t bitmapBytes = (chunkCount() + 7) / 8;
+  bool ok = journal.write((const uint8_t*)&header_, sizeof(header_)) == sizeof(header_) &&
+            journal.write(bitmap_, bitmapBytes) == bitmapBytes;
+  journal.close();
+  return ok;
+}
+
+bool ChunkedUpload::openFiles() {
+  part_ = fs_.open(UPLOAD_PART_PATH, "r+");
+  journal_ = fs_.open(UPLOAD_JOURNAL_PATH, "r+");
+  return part_ && journal_;
+}
+
+void ChunkedUpload::closeFiles() {
+  if (part_) {
+    part_.close();
+  }
+  if (journal_) {
+    journal_.close();
+  }
+}
+
+ChunkResult ChunkedUpload::writeChunk(uint32_t offset, const uint8_t* data, size_t len,
+                                      uint32_t crc) {
+  if (!active_) {
+    return CHUNK_NO_SESSION;
+  }
+  if (offset % header_.chunkSize != 0 || offset >= header_.totalSize) {
+    return CHUNK_BAD_OFFSET;
+  }
+  uint32_t index = offset / header_.chunkSize;
+  uint32_t expected = header_.totalSize - offset;
+  if (expected > header_.chunkSize) {
+    expected = header_.chunkSize;
+  }
+  if (len != expected) {
+    return CHUNK_BAD_LENGTH;
+  }
+  if (imageCrc32(data, len) != crc) {
+    LOGW("Chunk at %u failed CRC", offset);
+    return CHUNK_BAD_CRC;
+  }
+  if (hasChunk(index)) {
+    return CHUNK_DUPLICATE;
+  }
+
+  // Data must be on flash before the journal claims it
+  if (!part_.seek(offset) || part_.write(data, len) != len) {
+    return CHUNK_WRITE_FAILED;
+  }
+  part_.flush();
+
+  bitmap_[index / 8] |= 1 << (index % 8);
+  if (!journal_.seek(sizeof(header_) + index / 8) || journal_.write(bitmap_[index / 8]) != 1) {
+    bitmap_[index / 8] &= ~(1 << (index % 8));
+    return CHUNK_WRITE_FAILED;
+  }
+  journal_.flush();
+
+  received_++;
+  LOGD_RATE(2, "Chunk %u stored (%u/%u)", index, received_, chunkCount());
+  return CHUNK_OK;
+}
+
+void ChunkedUpload::forEachMissing(bool (*fn)(uint32_t start, uint32_t end, void* ctx),
+                                   void* ctx) const {
+  if (!active_) {
+    return;
+  }
+  uint32_t count = chunkCount();
+  uint32_t i = 0;
+  while (i < count) {
+    if (hasChunk(i)) {
+      i++;
+      continue;
+    }
+    uint32_t first = i;
+    while (i < count && !hasChunk(i)) {
+      i++;
+    }
+    uint32_t end = i * header_.chunkSize;
+    if (end > header_.totalSize) {
+      end = header_.totalSize;
+    }
+    if (!fn(first * header_.chunkSize, end, ctx)) {
+      return;
+    }
+  }
+}
+
+uint32_t ChunkedUpload::bytesReceived() const {
+  if (!active_) {
+    return 0;
+  }
+  uint32_t bytes = received_ * header_.chunkSize;
+  // The tail chunk may be short
+  uint32_t last = chunkCount() - 1;
+  if (hasChunk(last)) {
+    bytes -= (uint32_t)header_.chunkSize * chunkCount() - header_.totalSize;
+  }
+  return bytes;
+}
+
+bool ChunkedUpload::commit(const char* path) {
+  if (!complete()) {
+    return false;
+  }
+
+  // Re-read the assembled image; per-chunk CRCs do not catch a client that
+  // mixed chunks from two builds
+  uint8_t block[PREALLOC_BLOCK];
+  uint32_t crc = 0xFFFFFFFF;
+  part_.seek(0);
+  size_t n;
+  while ((n = part_.read(block, sizeof(block))) > 0) {
+    crc = bslCrc32(block, n, crc);
+  }
+  if (~crc != header_.imageCrc) {
+    LOGE("Assembled image CRC mismatch, restarting upload");
+    cancel();
+    return false;
+  }
+
+  closeFiles();
+  fs_.remove(path);
+  if (!fs_.rename(UPLOAD_PART_PATH, path)) {
+    LOGE("Failed to move upload into place");
+    cancel();
+    return false;
+  }
+  fs_.remove(UPLOAD_JOURNAL_PATH);
+  active_ = false;
+  LOGI("Upload committed: %u bytes", header_.totalSize);
+  return true;
+}
+
+void ChunkedUpload::cancel() {
+  closeFiles();
+  fs_.remove(UPLOAD_PART_PATH);
+  fs_.remove(UPLOAD_JOURNAL_PATH);
+  active_ = false;
+  received_ = 0;
+}
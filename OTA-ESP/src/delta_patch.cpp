@@ -0,0 +1,206 @@
+// Prathik Narsetty
+// Binary delta patches between firmware images, shared by the gateway and tools/delta
+#include <string.h>
+#include "delta_patch.h"
+#include "bsl_frames.h"
+
+#define VARINT_MAX_SHIFT 28  // five bytes hold a uint32_t
+
+const char* deltaStatusName(DeltaStatus status) {
+  switch (status) {
+    case DELTA_OK:           return "ok";
+    case DELTA_BAD_HEADER:   return "bad-header";
+    case DELTA_NO_BASE:      return "no-base-image";
+    case DELTA_BAD_RECORD:   return "bad-record";
+    case DELTA_WRITE_FAILED: return "write-failed";
+    case DELTA_TRUNCATED:    return "truncated";
+    case DELTA_BAD_CRC:      return "image-crc-mismatch";
+    default:                 return "unknown";
+  }
+}
+
+void DeltaPatcher::begin() {
+  state_ = STATE_HEADER;
+  status_ = DELTA_OK;
+  headerFill_ = 0;
+  old_ = nullptr;
+  value_ = 0;
+  valueShift_ = 0;
+  oldPos_ = 0;
+  produced_ = 0;
+  crc_ = 0xFFFFFFFF;
+  outFill_ = 0;
+}
+
+void DeltaPatcher::fail(DeltaStatus status) {
+  if (status_ == DELTA_OK) {
+    status_ = status;
+  }
+}
+
+void DeltaPatcher::flush() {
+  if (outFill_ == 0) {
+    return;
+  }
+  crc_ = bslCrc32(out_, outFill_, crc_);
+  if (!target_.write(out_, outFill_)) {
+    fail(DELTA_WRITE_FAILED);
+  }
+  outFill_ = 0;
+}
+
+void DeltaPatcher::emit(uint8_t byte) {
+  out_[outFill_++] = byte;
+  produced_++;
+  if (outFill_ == sizeof(out_)) {
+    flush();
+  }
+}
+
+void DeltaPatcher::headerByte(uint8_t byte) {
+  ((uint8_t*)&header_)[headerFill_++] = byte;
+  if (headerFill_ < sizeof(header_)) {
+    return;
+  }
+  if (header_.magic != DELTA_MAGIC || header_.version != DELTA_VERSION) {
+    fail(DELTA_BAD_HEADER);
+    return;
+  }
+  old_ = target_.base(header_.oldSize, header_.oldCrc);
+  if (old_ == nullptr) {
+    fail(DELTA_NO_BASE);
+    return;
+  }
+  state_ = header_.newSize == 0 ? STATE_DONE : STATE_DIFF_LEN;
+}
+
+// LEB128; true once the value is complete
+bool DeltaPatcher::varint(uint8_t byte) {
+  if (valueShift_ > VARINT_MAX_SHIFT) {
+    fail(DELTA_BAD_RECORD);
+    return false;
+  }
+  value_ |= (uint32_t)(byte & 0x7F) << valueShift_;
+  valueShift_ += 7;
+  return (byte & 0x80) == 0;
+}
+
+// Control triple parsed; the record must stay inside both images
+void DeltaPatcher::startRecord() {
+  if ((uint64_t)produced_ + diffLeft_ + extraLeft_ > header_.newSize ||
+      (uint64_t)oldPos_ + diffLeft_ > header_.oldSize) {
+    fail(DELTA_BAD_RECORD);
+    return;
+  }
+  diffProgress();
+}
+
+// After a diff token: the next token, the extra bytes or the next record
+void DeltaPatcher::diffProgress() {
+  if (diffLeft_ > 0) {
+    state_ = STATE_ZERO_RUN;
+  } else if (extraLeft_ > 0) {
+    state_ = STATE_EXTRA;
+  } else {
+    endRecord();
+  }
+}
+
+void DeltaPatcher::endRecord() {
+  int64_t pos = (int64_t)oldPos_ + seek_;
+  if (pos < 0 || pos > header_.oldSize) {
+    fail(DELTA_BAD_RECORD);
+    return;
+  }
+  oldPos_ = (uint32_t)pos;
+  state_ = produced_ == header_.newSize ? STATE_DONE : STATE_DIFF_LEN;
+}
+
+DeltaStatus DeltaPatcher::feed(const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len && status_ == DELTA_OK; i++) {
+    uint8_t byte = data[i];
+    if (state_ >= STATE_DIFF_LEN && state_ <= STATE_LITERAL_COUNT) {
+      if (!varint(byte)) {
+        continue;
+      }
+    }
+    uint32_t value = value_;
+    value_ = 0;
+    valueShift_ = 0;
+
+    switch (state_) {
+      case STATE_HEADER:
+        headerByte(byte);
+        break;
+      case STATE_DIFF_LEN:
+        diffLeft_ = value;
+        state_ = STATE_EXTRA_LEN;
+        break;
+      case STATE_EXTRA_LEN:
+        extraLeft_ = value;
+        state_ = STATE_SEEK;
+        break;
+      case STATE_SEEK:
+        seek_ = (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+        startRecord();
+        break;
+      case STATE_ZERO_RUN:
+        if (value > diffLeft_) {
+          fail(DELTA_BAD_RECORD);
+          break;
+        }
+        diffLeft_ -= value;
+        while (value-- > 0) {
+          emit(old_[oldPos_++]);
+        }
+        if (diffLeft_ > 0) {
+          state_ = STATE_LITERAL_COUNT;
+        } else {
+          diffProgress();
+        }
+        break;
+      case STATE_LITERAL_COUNT:
+        if (value > diffLeft_) {
+          fail(DELTA_BAD_RECORD);
+          break;
+        }
+        runLeft_ = value;
+        if (runLeft_ > 0) {
+          state_ = STATE_LITERALS;
+        } else {
+          diffProgress();
+        }
+        break;
+      case STATE_LITERALS:
+        emit(old_[oldPos_++] + byte);
+        diffLeft_--;
+        if (--runLeft_ == 0) {
+          diffProgress();
+        }
+        break;
+      case STATE_EXTRA:
+        emit(byte);
+        if (--extraLeft_ == 0) {
+          endRecord();
+        }
+        break;
+      case STATE_DONE:
+        fail(DELTA_BAD_RECORD);  // bytes after the last record
+        break;
+    }
+  }
+  return status_;
+}
+
+DeltaStatus DeltaPatcher::finish() {
+  if (status_ == DELTA_OK && state_ != STATE_DONE) {
+    fail(state_ == STATE_HEADER ? DELTA_BAD_HEADER : DELTA_TRUNCATED);
+  }
+  if (status_ == DELTA_OK) {
+    flush();
+  }
+  if (status_ == DELTA_OK && ~crc_ != header_.newCrc) {
+    fail(DELTA_BAD_CRC);
+  }
+  return status_;
+}
@@ -0,0 +1,67 @@
+// Prathik Narsetty
+// BslTransport wrapper that injects bit errors, for evaluating the link code
+#include "fault_transport.h"
+
+#include <string.h>
+
+void FaultTransport::configure(double ber, uint32_t seed) {
+  threshold_ = ber <= 0 ? 0 : ber >= 1 ? 0xFFFFFFFF : (uint32_t)(ber * 4294967296.0);
+  state_ = seed != 0 ? seed : 1;  // xorshift never leaves 0
+  corrupted_ = 0;
+}
+
+// xorshift32
+uint32_t FaultTransport::random() {
+  state_ ^= state_ << 13;
+  state_ ^= state_ >> 17;
+  state_ ^= state_ << 5;
+  return state_;
+}
+
+void FaultTransport::corrupt(uint8_t* data, size_t len) {
+  if (!armed_ || threshold_ == 0) {
+    return;
+  }
+  for (size_t i = 0; i < len; i++) {
+    uint8_t flips = 0;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      if (random() < threshold_) {
+        flips |= 1 << bit;
+      }
+    }
+    if (flips != 0) {
+      data[i] ^= flips;
+      corrupted_++;
+    }
+  }
+}
+
+bool FaultTransport::write(const uint8_t* data, size_t len) {
+  if (!armed_ || threshold_ == 0) {
+    return io_.write(data, len);
+  }
+  uint8_t chunk[FAULT_WRITE_CHUNK];
+  while (len > 0) {
+    size_t n = len < sizeof(chunk) ? len : sizeof(chunk);
+    memcpy(chunk, data, n);
+    corrupt(chunk, n);
+    if (!io_.write(chunk, n)) {
+      return false;
+    }
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+size_t FaultTransport::read(uint8_t* buf, size_t len, uint32_t timeoutMs) {
+  size_t got = io_.read(buf, len, timeoutMs);
+  corrupt(buf, got);
+  return got;
+}
+
+size_t FaultTransport::readStart(uint8_t* buf, size_t len, uint32_t timeoutMs) {
+  size_t got = io_.readStart(buf, len, timeoutMs);
+  corrupt(buf, got);
+  return got;
+}
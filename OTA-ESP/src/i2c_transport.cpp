@@ -0,0 +1,67 @@
+// Prathik Narsetty
+// I2C link to the MSPM0 BSL, as a BslTransport
+#include <Arduino.h>
+#include <string.h>
+#include "i2c_transport.h"
+
+void I2cTransport::begin() {
+  // A whole frame has to fit in one transaction
+  wire_.setBufferSize(BSL_MAX_FRAME_BYTES);
+  wire_.begin(sda_, scl_, hz_);
+  wire_.setTimeOut(I2C_STRETCH_MS);
+}
+
+bool I2cTransport::write(const uint8_t* data, size_t len) {
+  if (pendingLen_ + len > sizeof(pending_)) {
+    pendingLen_ = 0;
+    return false;
+  }
+  memcpy(&pending_[pendingLen_], data, len);
+  pendingLen_ += len;
+  return true;
+}
+
+// Send the collected frame, retrying while the BSL does not acknowledge
+bool I2cTransport::flush(uint32_t start, uint32_t timeoutMs) {
+  if (pendingLen_ == 0) {
+    return true;
+  }
+  for (;;) {
+    wire_.beginTransmission(address_);
+    wire_.write(pending_, pendingLen_);
+    if (wire_.endTransmission(true) == 0) {
+      pendingLen_ = 0;
+      return true;
+    }
+    if (::millis() - start >= timeoutMs) {
+      pendingLen_ = 0;
+      return false;
+    }
+    delayMicroseconds(I2C_POLL_GAP_US);
+  }
+}
+
+size_t I2cTransport::read(uint8_t* buf, size_t len, uint32_t timeoutMs) {
+  uint32_t start = ::millis();
+  if (!flush(start, timeoutMs) || len == 0) {
+    return 0;
+  }
+  for (;;) {
+    // A transaction cut short mid-reply cannot be repeated, the BSL has
+    // moved on; the caller sees the short count
+    size_t got = wire_.requestFrom(address_, len, true);
+    if (got > 0) {
+      return wire_.readBytes(buf, got);
+    }
+    if (::millis() - start >= timeoutMs) {
+      return 0;
+    }
+    delayMicroseconds(I2C_POLL_GAP_US);
+  }
+}
+
+// Only the default clock is used; the BSL has no speed change over I2C
+bool I2cTransport::setBaudRate(uint32_t baud) {
+  (void)baud;
+  return false;
+}
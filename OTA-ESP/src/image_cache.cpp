@@ -0,0 +1,194 @@
+// Prathik Narsetty
+// PSRAM copies of stored images, shared by programming, verification and retries
+#include <Arduino.h>
+#include "image_cache.h"
+#include "bsl_frames.h"
+#include "async_log.h"
+
+#if !defined(IMAGE_STORE_RAW_PARTITION)
+
+struct CacheEntry {
+  uint8_t* data;       // nullptr if the entry is free
+  uint32_t size;
+  uint32_t crc;
+  bool hasDigest;      // sha256 is the key; without it crc and size are
+  uint8_t sha256[SHA256_BYTES];
+  uint16_t users;      // readers holding the entry, which is never evicted
+  uint32_t lastUse;    // useClock at the last acquire
+};
+
+static CacheEntry entries[IMAGE_CACHE_ENTRIES];
+static ImageCacheStats stats;
+static uint32_t useClock = 0;
+
+static void freeEntry(CacheEntry& entry) {
+  free(entry.data);
+  stats.bytes -= entry.size;
+  stats.entries--;
+  entry = CacheEntry();
+}
+
+// Free least recently used entries until `size` more bytes and one more
+// entry fit. Returns the free entry to use, or nullptr if held entries
+// leave no room.
+static CacheEntry* makeRoom(uint32_t size) {
+  for (;;) {
+    CacheEntry* freeSlot = nullptr;
+    CacheEntry* victim = nullptr;
+    for (CacheEntry& entry : entries) {
+      if (entry.data == nullptr) {
+        freeSlot = &entry;
+      } else if (entry.users == 0 && (victim == nullptr || entry.lastUse < victim->lastUse)) {
+        victim = &entry;
+      }
+    }
+    if (freeSlot != nullptr && stats.bytes + size <= IMAGE_CACHE_BYTES) {
+      return freeSlot;
+    }
+    if (victim == nullptr) {
+      return nullptr;
+    }
+    LOGI("Evicting cached image crc %08X (%u bytes)", victim->crc, victim->size);
+    freeEntry(*victim);
+    stats.evictions++;
+  }
+}
+
+// Read the slot into PSRAM and check it against the index CRC32
+static CacheEntry* load(int slot, const ImageSlotInfo& info) {
+  CacheEntry* entry = makeRoom(info.size);
+  uint8_t* data = entry != nullptr ? (uint8_t*)ps_malloc(info.size) : nullptr;
+  if (data == nullptr) {
+    LOGW("No room in the image cache for image #%u (%u bytes), streaming it", info.sequence,
+         info.size);
+    stats.bypasses++;
+    return nullptr;
+  }
+
+  uint32_t start = millis();
+  StoredImage image;
+  int got = image.open(slot) ? image.read(data, info.size) : -1;
+  if (got != (int)info.size || ~bslCrc32(data, info.size) != info.crc) {
+    LOGE("Image #%u does not match its index entry, not caching it", info.sequence);
+    free(data);
+    return nullptr;
+  }
+  *entry = CacheEntry();
+  entry->data = data;
+  entry->size = info.size;
+  entry->crc = info.crc;
+  const uint8_t* digest = imageStoreDigest(slot);
+  if (digest != nullptr) {
+    entry->hasDigest = true;
+    memcpy(entry->sha256, digest, SHA256_BYTES);
+  }
+  stats.bytes += info.size;
+  stats.entries++;
+  LOGI("Image #%u cached in PSRAM (%u bytes, %u ms)", info.sequence, info.size,
+       (uint32_t)(millis() - start));
+  return entry;
+}
+
+// Entry holding the image of `slot`: the same SHA-256 when the slot has
+// one, otherwise the same CRC32 and size
+static CacheEntry* find(int slot, const ImageSlotInfo& info) {
+  const uint8_t* digest = imageStoreDigest(slot);
+  for (CacheEntry& entry : entries) {
+    if (entry.data == nullptr || entry.size != info.size) {
+      continue;
+    }
+    if (digest != nullptr ? entry.hasDigest && memcmp(entry.sha256, digest, SHA256_BYTES) == 0
+                          : entry.crc == info.crc) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+const uint8_t* imageCacheAcquire(int slot) {
+  const ImageSlotInfo& info = imageStoreSlot(slot);
+  if (info.state == SLOT_EMPTY || info.size == 0) {
+    return nullptr;
+  }
+  if (info.size > IMAGE_CACHE_BYTES || !psramFound()) {
+    stats.bypasses++;
+    return nullptr;
+  }
+
+  CacheEntry* entry = find(slot, info);
+  if (entry != nullptr) {
+    stats.hits++;
+  } else {
+    stats.misses++;
+    entry = load(slot, info);
+    if (entry == nullptr) {
+      return nullptr;
+    }
+  }
+  entry->users++;
+  entry->lastUse = ++useClock;
+  return entry->data;
+}
+
+void imageCacheRelease(const uint8_t* data) {
+  for (CacheEntry& entry : entries) {
+    if (entry.data != nullptr && entry.data == data && entry.users > 0) {
+      entry.users--;
+      return;
+    }
+  }
+}
+
+#else
+
+// Slots are already mapped from flash, a copy would gain nothing
+static ImageCacheStats stats;
+
+const uint8_t* imageCacheAcquire(int slot) {
+  (void)slot;
+  return nullptr;
+}
+
+void imageCacheRelease(const uint8_t* data) {
+  (void)data;
+}
+
+#endif  // IMAGE_STORE_RAW_PARTITION
+
+ImageCacheStats imageCacheStats() {
+  return stats;
+}
+
+bool CachedImage::open(int slot) {
+  close();
+  cached_ = imageCacheAcquire(slot);
+  if (cached_ != nullptr) {
+    memory_.attach(cached_, imageStoreSlot(slot).size);
+  } else if (!stored_.open(slot)) {
+    return false;
+  }
+  digest_ = imageStoreDigest(slot);
+  return true;
+}
+
+void CachedImage::close() {
+  if (cached_ != nullptr) {
+    memory_.attach(nullptr, 0);
+    imageCacheRelease(cached_);
+    cached_ = nullptr;
+  }
+  stored_.close();
+  digest_ = nullptr;
+}
+
+int CachedImage::read(uint8_t* buf, size_t len) {
+  return cached_ != nullptr ? memory_.read(buf, len) : stored_.read(buf, len);
+}
+
+size_t CachedImage::size() const {
+  return cached_ != nullptr ? memory_.size() : stored_.size();
+}
+
+const uint8_t* CachedImage::mapped() const {
+  return cached_ != nullptr ? memory_.mapped() : stored_.mapped();
+}
@@ -0,0 +1,135 @@
+// Prathik Narsetty
+// Signed image container and the signature check that runs beside a session
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "image_signature.h"
+#include "async_log.h"
+
+#define SIGNATURE_POLL_MS 1
+
+enum CheckState : uint8_t {
+  CHECK_IDLE,
+  CHECK_RUNNING,
+  CHECK_DONE
+};
+
+static uint8_t signingKey[P256_KEY_BYTES];
+static bool signingKeyValid = false;
+
+static TaskHandle_t checkTask = nullptr;
+static uint8_t checkDigest[SHA256_BYTES];
+static uint8_t checkSignature[P256_SIGNATURE_BYTES];
+static CheckState checkState = CHECK_IDLE;
+static SignatureResult checkResult = SIGNATURE_MISSING;
+static uint32_t checkUs = 0;
+static portMUX_TYPE checkLock = portMUX_INITIALIZER_UNLOCKED;
+
+bool signatureTrailerValid(const SignedImageTrailer& trailer, size_t fileSize) {
+  return trailer.magic == IMAGE_SIGN_MAGIC && trailer.version == IMAGE_SIGN_VERSION &&
+         fileSize > sizeof(trailer) && trailer.imageSize == fileSize - sizeof(trailer);
+}
+
+bool imageSigningRequired() {
+#if defined(IMAGE_SIGNING_KEY)
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool signatureVerify(const uint8_t digest[SHA256_BYTES],
+                     const uint8_t signature[P256_SIGNATURE_BYTES]) {
+  return signingKeyValid && p256Verify(signingKey, digest, signature);
+}
+
+#if defined(IMAGE_SIGNING_KEY)
+static int hexDigit(char c) {
+  return c >= '0' && c <= '9' ? c - '0'
+       : c >= 'a' && c <= 'f' ? c - 'a' + 10
+       : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+}
+
+static bool parseKey(const char* hex) {
+  if (strlen(hex) != 2 * P256_KEY_BYTES) {
+    return false;
+  }
+  for (int i = 0; i < P256_KEY_BYTES; i++) {
+    int high = hexDigit(hex[2 * i]);
+    int low = hexDigit(hex[2 * i + 1]);
+    if (high < 0 || low < 0) {
+      return false;
+    }
+    signingKey[i] = (uint8_t)(high << 4 | low);
+  }
+  return signingKey[0] == 0x04;
+}
+
+// Below the programming task, so it only takes the CPU while the session
+// waits on the target
+static void signatureCheckTask(void* param) {
+  (void)param;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    uint32_t started = micros();
+    bool valid = signatureVerify(checkDigest, checkSignature);
+    uint32_t elapsed = micros() - started;
+    portENTER_CRITICAL(&checkLock);
+    checkResult = valid ? SIGNATURE_VALID : SIGNATURE_INVALID;
+    checkUs = elapsed;
+    checkState = CHECK_DONE;
+    portEXIT_CRITICAL(&checkLock);
+  }
+}
+#endif
+
+void signatureBegin() {
+#if defined(IMAGE_SIGNING_KEY)
+  signingKeyValid = parseKey(IMAGE_SIGNING_KEY);
+  if (signingKeyValid) {
+    LOGI("Image signing: only images signed with key %02X%02X%02X%02X... are taken",
+         signingKey[1], signingKey[2], signingKey[3], signingKey[4]);
+  } else {
+    LOGE("IMAGE_SIGNING_KEY is not an uncompressed P-256 key, every image will be refused");
+  }
+  if (checkTask == nullptr) {
+    xTaskCreate(signatureCheckTask, "sigCheck", 6144, nullptr, tskIDLE_PRIORITY + 1, &checkTask);
+  }
+#endif
+}
+
+void signatureCheckStart(const uint8_t digest[SHA256_BYTES],
+                         const uint8_t signature[P256_SIGNATURE_BYTES]) {
+  if (checkTask == nullptr) {
+    return;
+  }
+  // A session that failed early leaves its check behind; the task must be
+  // idle before its inputs change
+  uint32_t unused;
+  signatureCheckWait(unused);
+  memcpy(checkDigest, digest, SHA256_BYTES);
+  memcpy(checkSignature, signature, P256_SIGNATURE_BYTES);
+  portENTER_CRITICAL(&checkLock);
+  checkState = CHECK_RUNNING;
+  portEXIT_CRITICAL(&checkLock);
+  xTaskNotifyGive(checkTask);
+}
+
+// The check normally finished long before programming does, so this
+// returns on the first look
+SignatureResult signatureCheckWait(uint32_t& verifyUs) {
+  for (;;) {
+    portENTER_CRITICAL(&checkLock);
+    CheckState state = checkState;
+    SignatureResult result = state == CHECK_DONE ? checkResult : SIGNATURE_MISSING;
+    verifyUs = state == CHECK_DONE ? checkUs : 0;
+    if (state != CHECK_RUNNING) {
+      checkState = CHECK_IDLE;
+    }
+    portEXIT_CRITICAL(&checkLock);
+    if (state != CHECK_RUNNING) {
+      return result;
+    }
+    vTaskDelay(pdMS_TO_TICKS(SIGNATURE_POLL_MS));
+  }
+}
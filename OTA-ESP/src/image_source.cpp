@@ -0,0 +1,126 @@
+// Prathik Narsetty
+// Sources of firmware image bytes for the BSL programmer
+#include <Arduino.h>
+#include "image_source.h"
+
+#define STREAM_POLL_MS 100
+
+FileImageSource::FileImageSource(File& file)
+    : file_(file), cache_((uint8_t*)malloc(IMAGE_READ_AHEAD)) {}
+
+FileImageSource::~FileImageSource() {
+  free(cache_);
+}
+
+void FileImageSource::setLength(size_t length) {
+  length_ = length;
+  delivered_ = 0;
+  cacheFill_ = 0;
+  cachePos_ = 0;
+}
+
+int FileImageSource::read(uint8_t* buf, size_t len) {
+  if (len > length_ - delivered_) {
+    len = length_ - delivered_;
+  }
+  if (cache_ == nullptr) {
+    // No memory for read-ahead, read directly
+    int got = file_.available() && len > 0 ? file_.read(buf, len) : 0;
+    delivered_ += got > 0 ? got : 0;
+    return got;
+  }
+
+  size_t got = 0;
+  while (got < len) {
+    if (cachePos_ == cacheFill_) {
+      cacheFill_ = file_.read(cache_, IMAGE_READ_AHEAD);
+      cachePos_ = 0;
+      if (cacheFill_ == 0) {
+        break;
+      }
+    }
+    size_t n = cacheFill_ - cachePos_;
+    if (n > len - got) {
+      n = len - got;
+    }
+    memcpy(buf + got, cache_ + cachePos_, n);
+    cachePos_ += n;
+    got += n;
+  }
+  delivered_ += got;
+  return (int)got;
+}
+
+void MappedImageSource::attach(const uint8_t* base, size_t size) {
+  base_ = base;
+  size_ = base != nullptr ? size : 0;
+  pos_ = 0;
+}
+
+int MappedImageSource::read(uint8_t* buf, size_t len) {
+  size_t n = size_ - pos_;
+  if (n > len) {
+    n = len;
+  }
+  memcpy(buf, base_ + pos_, n);
+  pos_ += n;
+  return (int)n;
+}
+
+StreamImageSource::~StreamImageSource() {
+  end();
+}
+
+bool StreamImageSource::begin(size_t bufferBytes, size_t expectedSize) {
+  end();
+  buffer_ = xStreamBufferCreate(bufferBytes, 1);
+  expectedSize_ = expectedSize;
+  bytesPushed_ = 0;
+  finished_ = false;
+  aborted_ = false;
+  detached_ = false;
+  return buffer_ != nullptr;
+}
+
+void StreamImageSource::end() {
+  if (buffer_ != nullptr) {
+    vStreamBufferDelete(buffer_);
+    buffer_ = nullptr;
+  }
+}
+
+size_t StreamImageSource::push(const uint8_t* data, size_t len) {
+  size_t sent = 0;
+  while (sent < len && !detached_) {
+    sent += xStreamBufferSend(buffer_, data + sent, len - sent, pdMS_TO_TICKS(STREAM_POLL_MS));
+  }
+  bytesPushed_ += len;
+  return sent;
+}
+
+void StreamImageSource::finish() {
+  finished_ = true;
+}
+
+void StreamImageSource::abort() {
+  aborted_ = true;
+}
+
+void StreamImageSource::detach() {
+  detached_ = true;
+}
+
+int StreamImageSource::read(uint8_t* buf, size_t len) {
+  size_t got = 0;
+  while (got < len) {
+    if (aborted_) {
+      return -1;
+    }
+    got += xStreamBufferReceive(buffer_, buf + got, len - got, pdMS_TO_TICKS(STREAM_POLL_MS));
+    // The producer sets finished_ only after its last push returned
+    if (finished_ && xStreamBufferBytesAvailable(buffer_) == 0) {
+      break;
+    }
+  }
+  return (int)got;
+}
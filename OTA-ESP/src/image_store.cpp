@@ -0,0 +1,490 @@
+// Prathik Narsetty
+// Multi-slot firmware image store with a persistent index
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "image_store.h"
+#include "bsl_frames.h"
+#include "async_log.h"
+#include "image_signature.h"
+#if defined(IMAGE_STORE_RAW_PARTITION)
+#include "raw_partition.h"
+#endif
+
+#define CRC_BLOCK 256
+
+static fs::FS* storeFs = nullptr;
+static ImageIndex storeIndex;
+
+// Uploads (loop() and the HTTP handlers) and sessions (the programming task)
+// both change the index; every change, and the write that follows, holds it
+static SemaphoreHandle_t indexLock = nullptr;
+
+class IndexLock {
+ public:
+  IndexLock() { xSemaphoreTake(indexLock, portMAX_DELAY); }
+  ~IndexLock() { xSemaphoreGive(indexLock); }
+};
+
+// Sessions running from or queued for a slot, see imageStorePin()
+static uint8_t slotPins[IMAGE_SLOT_COUNT];
+
+static bool validSlot(int slot) {
+  return slot >= 0 && slot < IMAGE_SLOT_COUNT;
+}
+
+// Image bytes in a stored file: all of them, or those before a signature trailer
+static uint32_t imageBytes(File& file, bool& isSigned) {
+  SignedImageTrailer trailer;
+  size_t size = file.size();
+  isSigned = size > sizeof(trailer) && file.seek(size - sizeof(trailer)) &&
+             file.read((uint8_t*)&trailer, sizeof(trailer)) == sizeof(trailer) &&
+             signatureTrailerValid(trailer, size);
+  file.seek(0);
+  return isSigned ? trailer.imageSize : size;
+}
+
+static uint32_t trailerBytes(int slot) {
+  return storeIndex.slots[slot].flags & SLOT_SIGNED ? sizeof(SignedImageTrailer) : 0;
+}
+
+#if defined(IMAGE_STORE_RAW_PARTITION)
+
+static bool loadIndex(ImageIndex& out) {
+  return rawPartitionLoadIndex(out) && out.magic == IMAGE_INDEX_MAGIC &&
+         out.version == IMAGE_INDEX_VERSION && out.slotCount == IMAGE_SLOT_COUNT;
+}
+
+static bool writeIndex() {
+  return rawPartitionSaveIndex(storeIndex);
+}
+
+static bool slotMatches(int slot) {
+  return storeIndex.slots[slot].size + trailerBytes(slot) <= rawPartitionCapacity(slot);
+}
+
+// Copy the upload into the slot's region; the upload file is not needed after
+static bool storeSlot(int slot, const char* srcPath, uint32_t& size, uint32_t& crc,
+                      uint8_t* sha256, bool& isSigned) {
+  File src = storeFs->open(srcPath, FILE_READ);
+  bool ok = false;
+  if (src) {
+    size = imageBytes(src, isSigned);
+    ok = rawPartitionWriteRegion(slot, src, size, crc, sha256);
+    src.close();
+  }
+  storeFs->remove(srcPath);
+  return ok;
+}
+
+// The region is simply rewritten by the next image stored there
+static void discardSlot(int slot) {
+  (void)slot;
+}
+
+static bool readTrailer(int slot, SignedImageTrailer& trailer) {
+  uint32_t size = storeIndex.slots[slot].size;
+  uint32_t handle;
+  const uint8_t* view = rawPartitionMap(slot, size + sizeof(trailer), handle);
+  if (view == nullptr) {
+    return false;
+  }
+  memcpy(&trailer, view + size, sizeof(trailer));
+  rawPartitionUnmap(handle);
+  return true;
+}
+
+bool StoredImage::open(int slot) {
+  close();
+  if (!validSlot(slot) || storeIndex.slots[slot].state == SLOT_EMPTY) {
+    return false;
+  }
+  size_t size = storeIndex.slots[slot].size;
+  const uint8_t* view = rawPartitionMap(slot, size, mapHandle_);
+  isMapped_ = view != nullptr;
+  reader_.attach(view, size);
+  digest_ = isMapped_ ? imageStoreDigest(slot) : nullptr;
+  return isMapped_;
+}
+
+void StoredImage::close() {
+  if (isMapped_) {
+    rawPartitionUnmap(mapHandle_);
+    isMapped_ = false;
+  }
+  reader_.attach(nullptr, 0);
+  digest_ = nullptr;
+}
+
+#else
+
+static const char* const SLOT_PATHS[] = { "/slot0.bin", "/slot1.bin", "/slot2.bin", "/slot3.bin" };
+static_assert(IMAGE_SLOT_COUNT <= sizeof(SLOT_PATHS) / sizeof(SLOT_PATHS[0]),
+              "add slot paths for IMAGE_SLOT_COUNT");
+
+static bool readIndex(const char* path, ImageIndex& out) {
+  File file = storeFs->open(path, FILE_READ);
+  if (!file) {
+    return false;
+  }
+  // Either layout; the file length tells them apart
+  union {
+    ImageIndex current;
+    ImageIndexV1 v1;
+  } index;
+  size_t n = file.read((uint8_t*)&index, sizeof(index));
+  file.close();
+  if (n == sizeof(ImageIndexV1) && index.v1.version == 1) {
+    imageIndexUpgrade(index.v1, out);
+  } else if (n == sizeof(ImageIndex)) {
+    out = index.current;
+  } else {
+    return false;
+  }
+  return out.magic == IMAGE_INDEX_MAGIC && out.version == IMAGE_INDEX_VERSION &&
+         out.slotCount == IMAGE_SLOT_COUNT;
+}
+
+static bool writeIndex() {
+  File file = storeFs->open(IMAGE_INDEX_TMP_PATH, FILE_WRITE);
+  if (!file) {
+    LOGE("Failed to write image index");
+    return false;
+  }
+  bool ok = file.write((const uint8_t*)&storeIndex, sizeof(storeIndex)) == sizeof(storeIndex);
+  file.close();
+  if (!ok) {
+    storeFs->remove(IMAGE_INDEX_TMP_PATH);
+    LOGE("Failed to write image index");
+    return false;
+  }
+  // SPIFFS cannot rename over an existing file
+  storeFs->remove(IMAGE_INDEX_PATH);
+  return storeFs->rename(IMAGE_INDEX_TMP_PATH, IMAGE_INDEX_PATH);
+}
+
+static bool loadIndex(ImageIndex& out) {
+  return readIndex(IMAGE_INDEX_PATH, out) || readIndex(IMAGE_INDEX_TMP_PATH, out);
+}
+
+static bool slotMatches(int slot) {
+  File file = storeFs->open(SLOT_PATHS[slot], FILE_READ);
+  bool ok = file && file.size() == storeIndex.slots[slot].size + trailerBytes(slot);
+  if (file) {
+    file.close();
+  }
+  return ok;
+}
+
+// CRC32 and SHA-256 of the first `size` bytes, in one pass
+static uint32_t fileDigest(File& file, uint32_t size, uint8_t* sha256) {
+  uint8_t block[CRC_BLOCK];
+  uint32_t crc = 0xFFFFFFFF;
+  Sha256 sha;
+  uint32_t done = 0;
+  size_t n;
+  while (done < size &&
+         (n = file.read(block, size - done < sizeof(block) ? size - done : sizeof(block))) > 0) {
+    crc = bslCrc32(block, n, crc);
+    sha.update(block, n);
+    done += n;
+  }
+  sha.finish(sha256);
+  return ~crc;
+}
+
+static bool storeSlot(int slot, const char* srcPath, uint32_t& size, uint32_t& crc,
+                      uint8_t* sha256, bool& isSigned) {
+  storeFs->remove(SLOT_PATHS[slot]);
+  if (!storeFs->rename(srcPath, SLOT_PATHS[slot])) {
+    return false;
+  }
+  File file = storeFs->open(SLOT_PATHS[slot], FILE_READ);
+  if (!file) {
+    return false;
+  }
+  size = imageBytes(file, isSigned);
+  crc = fileDigest(file, size, sha256);
+  file.close();
+  return size > 0;
+}
+
+static void discardSlot(int slot) {
+  storeFs->remove(SLOT_PATHS[slot]);
+}
+
+static bool readTrailer(int slot, SignedImageTrailer& trailer) {
+  File file = storeFs->open(SLOT_PATHS[slot], FILE_READ);
+  bool ok = file && file.seek(storeIndex.slots[slot].size) &&
+            file.read((uint8_t*)&trailer, sizeof(trailer)) == sizeof(trailer);
+  if (file) {
+    file.close();
+  }
+  return ok;
+}
+
+bool StoredImage::open(int slot) {
+  close();
+  if (!validSlot(slot) || storeIndex.slots[slot].state == SLOT_EMPTY) {
+    return false;
+  }
+  file_ = storeFs->open(SLOT_PATHS[slot], FILE_READ);
+  reader_.setLength(storeIndex.slots[slot].size);
+  digest_ = file_ ? imageStoreDigest(slot) : nullptr;
+  return (bool)file_;
+}
+
+void StoredImage::close() {
+  if (file_) {
+    file_.close();
+  }
+  digest_ = nullptr;
+}
+
+#endif
+
+bool imageStoreBegin(fs::FS& fs) {
+  if (indexLock == nullptr) {
+    indexLock = xSemaphoreCreateMutex();
+  }
+  IndexLock lock;
+  storeFs = &fs;
+#if defined(IMAGE_STORE_RAW_PARTITION)
+  if (!rawPartitionBegin(rawFlashOpen())) {
+    return false;
+  }
+#endif
+
+  if (!loadIndex(storeIndex)) {
+    memset(&storeIndex, 0, sizeof(storeIndex));
+    storeIndex.magic = IMAGE_INDEX_MAGIC;
+    storeIndex.version = IMAGE_INDEX_VERSION;
+    storeIndex.active = -1;
+    storeIndex.slotCount = IMAGE_SLOT_COUNT;
+    storeIndex.nextSequence = 1;
+    LOGI("Creating empty image index");
+    return writeIndex();
+  }
+
+  // The slot storage is the source of truth; forget slots that no longer match
+  bool changed = false;
+  for (int i = 0; i < IMAGE_SLOT_COUNT; ++i) {
+    ImageSlotInfo& slot = storeIndex.slots[i];
+    if (slot.state != SLOT_EMPTY && !slotMatches(i)) {
+      LOGW("Image slot %d missing or truncated, dropping it", i);
+      memset(&slot, 0, sizeof(slot));
+      changed = true;
+    }
+  }
+  if (validSlot(storeIndex.active) && storeIndex.slots[storeIndex.active].state == SLOT_EMPTY) {
+    storeIndex.active = -1;
+    changed = true;
+  }
+
+  LOGI("Image store: active slot %d", storeIndex.active);
+  return changed ? writeIndex() : true;
+}
+
+int imageStoreAdd(const char* srcPath) {
+  IndexLock lock;
+
+  // Prefer an empty slot, otherwise replace the oldest inactive one that no
+  // session needs
+  int target = -1;
+  for (int i = 0; i < IMAGE_SLOT_COUNT; ++i) {
+    if (i == storeIndex.active || slotPins[i] > 0) {
+      continue;
+    }
+    if (storeIndex.slots[i].state == SLOT_EMPTY) {
+      target = i;
+      break;
+    }
+    if (target < 0 || storeIndex.slots[i].sequence < storeIndex.slots[target].sequence) {
+      target = i;
+    }
+  }
+  if (target < 0) {
+    LOGE("No slot free for a new image while a session uses the others");
+    return -1;
+  }
+
+  // Invalidate the slot before touching its contents
+  memset(&storeIndex.slots[target], 0, sizeof(ImageSlotInfo));
+  writeIndex();
+
+  uint32_t size;
+  uint32_t crc;
+  uint8_t sha256[SHA256_BYTES];
+  bool isSigned = false;
+  if (!storeSlot(target, srcPath, size, crc, sha256, isSigned)) {
+    LOGE("Failed to move image into slot %d", target);
+    return -1;
+  }
+
+  ImageSlotInfo& slot = storeIndex.slots[target];
+  slot.size = size;
+  slot.crc = crc;
+  memcpy(slot.sha256, sha256, SHA256_BYTES);
+  slot.flags = SLOT_HAS_DIGEST | (isSigned ? SLOT_SIGNED : 0);
+  slot.state = SLOT_STAGED;
+
+  // Refused here so a bad image never costs a session; sessions still check
+  // the signature before they start the target
+  uint8_t signature[P256_SIGNATURE_BYTES];
+  if (imageSigningRequired() &&
+      !(imageStoreSignature(target, signature) && signatureVerify(sha256, signature))) {
+    LOGE("Image refused: %s", isSigned ? "signature does not match the key" : "not signed");
+    memset(&slot, 0, sizeof(slot));
+    discardSlot(target);
+    return IMAGE_STORE_REJECTED;
+  }
+
+  slot.sequence = storeIndex.nextSequence++;
+  if (!writeIndex()) {
+    memset(&slot, 0, sizeof(slot));
+    return -1;
+  }
+
+  LOGI("Image #%u stored in slot %d (%u bytes, crc %08X)",
+       slot.sequence, target, slot.size, slot.crc);
+  LOGI("  sha256 %08X%08X...%s", sha256Word(slot.sha256, 0), sha256Word(slot.sha256, 1),
+       isSigned ? ", signed" : "");
+  return target;
+}
+
+bool imageStoreActivate(int slot) {
+  IndexLock lock;
+  if (!validSlot(slot) || storeIndex.slots[slot].state == SLOT_EMPTY) {
+    return false;
+  }
+  if (storeIndex.active == slot) {
+    return true;
+  }
+  storeIndex.active = slot;
+  LOGI("Active image: slot %d (#%u)", slot, storeIndex.slots[slot].sequence);
+  return writeIndex();
+}
+
+int imageStoreRollbackSlot() {
+  int best = -1;
+  for (int i = 0; i < IMAGE_SLOT_COUNT; ++i) {
+    const ImageSlotInfo& slot = storeIndex.slots[i];
+    if (i == storeIndex.active || slot.state == SLOT_EMPTY) {
+      continue;
+    }
+    if (best < 0) {
+      best = i;
+      continue;
+    }
+    const ImageSlotInfo& current = storeIndex.slots[best];
+    bool good = slot.state == SLOT_GOOD;
+    bool currentGood = current.state == SLOT_GOOD;
+    if (good != currentGood ? good : slot.sequence > current.sequence) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+void imageStoreMarkResult(int slot, bool success) {
+  IndexLock lock;
+  if (!validSlot(slot) || storeIndex.slots[slot].state == SLOT_EMPTY) {
+    return;
+  }
+  uint8_t state = success ? SLOT_GOOD : SLOT_FAILED;
+  if (storeIndex.slots[slot].state != state) {
+    storeIndex.slots[slot].state = state;
+    writeIndex();
+  }
+}
+
+int imageStoreFind(uint32_t size, uint32_t crc) {
+  for (int i = 0; i < IMAGE_SLOT_COUNT; ++i) {
+    const ImageSlotInfo& slot = storeIndex.slots[i];
+    if (slot.state != SLOT_EMPTY && slot.size == size && slot.crc == crc) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+const uint8_t* imageStoreDigest(int slot) {
+  if (!validSlot(slot) || storeIndex.slots[slot].state == SLOT_EMPTY ||
+      !(storeIndex.slots[slot].flags & SLOT_HAS_DIGEST)) {
+    return nullptr;
+  }
+  return storeIndex.slots[slot].sha256;
+}
+
+void imageStoreSetDigest(int slot, const uint8_t digest[SHA256_BYTES]) {
+  IndexLock lock;
+  if (!validSlot(slot) || storeIndex.slots[slot].state == SLOT_EMPTY ||
+      (storeIndex.slots[slot].flags & SLOT_HAS_DIGEST)) {
+    return;
+  }
+  ImageSlotInfo& info = storeIndex.slots[slot];
+  memcpy(info.sha256, digest, SHA256_BYTES);
+  info.flags |= SLOT_HAS_DIGEST;
+  writeIndex();
+  LOGI("Recorded SHA-256 of image #%u", info.sequence);
+}
+
+bool imageStoreSignature(int slot, uint8_t signature[P256_SIGNATURE_BYTES]) {
+  if (!validSlot(slot) || storeIndex.slots[slot].state == SLOT_EMPTY ||
+      !(storeIndex.slots[slot].flags & SLOT_SIGNED)) {
+    return false;
+  }
+  SignedImageTrailer trailer;
+  if (!readTrailer(slot, trailer) ||
+      !signatureTrailerValid(trailer, storeIndex.slots[slot].size + sizeof(trailer))) {
+    return false;
+  }
+  memcpy(signature, trailer.signature, P256_SIGNATURE_BYTES);
+  return true;
+}
+
+void imageIndexUpgrade(const ImageIndexV1& old, ImageIndex& out) {
+  memset(&out, 0, sizeof(out));
+  out.magic = old.magic;
+  out.version = IMAGE_INDEX_VERSION;
+  out.active = old.active;
+  out.slotCount = old.slotCount;
+  out.nextSequence = old.nextSequence;
+  for (int i = 0; i < IMAGE_SLOT_COUNT; ++i) {
+    out.slots[i].state = old.slots[i].state;
+    out.slots[i].size = old.slots[i].size;
+    out.slots[i].crc = old.slots[i].crc;
+    out.slots[i].sequence = old.slots[i].sequence;
+  }
+}
+
+void imageStorePin(int slot) {
+  IndexLock lock;
+  if (validSlot(slot)) {
+    slotPins[slot]++;
+  }
+}
+
+void imageStoreUnpin(int slot) {
+  IndexLock lock;
+  if (validSlot(slot) && slotPins[slot] > 0) {
+    slotPins[slot]--;
+  }
+}
+
+int imageStoreActiveSlot() {
+  return storeIndex.active;
+}
+
+const ImageSlotInfo& imageStoreSlot(int slot) {
+  return storeIndex.slots[slot];
+}
+
+const char* imageSlotStateName(uint8_t state) {
+  switch (state) {
+    case SLOT_STAGED: return "staged";
+    case SLOT_GOOD:   return "good";
+    case SLOT_FAILED: return "failed";
+    default:          return "empty";
+  }
+}
@@ -1,118 +1,348 @@
 // Prathik Narsetty
 // ESP32 OTA Gateway for MSPM0 Programming - PlatformIO OTA SPIFFS
 #include <Arduino.h>
-#include <SPIFFS.h>
 #include <stdint.h>
 #include <esp_sleep.h>
 #include <driver/rtc_io.h>
+#include <driver/gpio.h>
+#include <driver/uart.h>
+#include "app_header.h"
+#include "async_log.h"
+#include "bsl_frames.h"
+#include "bsl_link.h"
+#include "bsl_trace.h"
+#include "chunk_controller.h"
+#include "gateway.h"
+#include "image_cache.h"
+#include "image_signature.h"
+#include "image_source.h"
+#include "upload_server.h"
+#include "image_store.h"
+#include "sha256.h"
+#include "storage.h"
+#if defined(BSL_TRANSPORT_SPI)
+#include "spi_transport.h"
+#elif defined(BSL_TRANSPORT_I2C)
+#include "i2c_transport.h"
+#else
+#define BSL_TRANSPORT_UART
+#endif
+#ifdef BSL_FAULT_INJECTION
+#include "fault_transport.h"
+#endif
 
 // GPIO Configuration
 #define PIN_PA18 D12      // BSL invoke pin
 #define PIN_NRST D11      // Reset pin
 #define PIN_TRIGGER D10   // OTA trigger pin (external signal)
 #define PIN_LED LED_BUILTIN
+#ifdef BSL_TRANSPORT_SPI
+// D10..D13 are taken above, so the BSL SPI goes through the GPIO matrix
+#define PIN_SPI_SCK D2
+#define PIN_SPI_POCI D3
+#define PIN_SPI_PICO D4
+#define PIN_SPI_CS D5
+#endif
+#ifdef BSL_TRANSPORT_I2C
+// The Nano ESP32 header I2C pins
+#define PIN_I2C_SDA A4
+#define PIN_I2C_SCL A5
+#endif
 
-// BSL Protocol Constants
-#define PACKET_HEADER (0x80)
-#define CMD_CONNECTION (0x12)
-#define CMD_GET_ID (0x19)
-#define CMD_RX_PASSWORD (0x21)
-#define CMD_MASS_ERASE (0x15)
-#define CMD_PROGRAMDATA (0x20)
-#define CMD_TX_DATA_BLOCK (0x06)  // Read back programmed data
-#define CMD_START_APP (0x40)
-#define CMD_CHANGE_BAUD_RATE (0x52)  // Change baud rate command
+// Optional RTS/CTS on Serial2. FLOW_AUTO turns it on for a session once the
+// BSL answers and the target holds CTS asserted (low); FLOW_ON skips that
+// check. Set with -DBSL_FLOW_CONTROL=FLOW_AUTO (arduino_nano_esp32_rtscts).
+#define FLOW_OFF 0
+#define FLOW_AUTO 1
+#define FLOW_ON 2
+#ifndef BSL_FLOW_CONTROL
+#define BSL_FLOW_CONTROL FLOW_OFF
+#endif
+#if defined(BSL_TRANSPORT_UART) && BSL_FLOW_CONTROL != FLOW_OFF
+#define PIN_UART_RTS D2  // gateway ready to receive, to the target's CTS
+#define PIN_UART_CTS D3  // target ready to receive, from the target's RTS
+#define UART_RTS_THRESHOLD 96  // RX FIFO bytes (of 128) before RTS is released
+#endif
+
+// Power Management
+#define HOUSEKEEPING_INTERVAL_MS 60000  // Timer wake, only for periodic firmware checks
+#define TRIGGER_DEBOUNCE_MS 50
+#define RESULT_LED_HOLD_MS 5000  // LED shows a successful session this long
+// Optional UART RX wake; only UART0/UART1 can wake the chip from light sleep
+// #define UART_WAKE_NUM UART_NUM_1
+#define UART_WAKE_THRESHOLD 3           // RX edges needed to wake
+
+#define BSL_BLOCK_SIZE 128  // Readback block, and the first Program Data payload
+static_assert(BSL_BLOCK_SIZE <= BSL_MAX_PROGRAM_BYTES, "block exceeds a Program Data frame");
+// Program Data payloads adapt to the link (chunk_controller.h): from
+// BSL_BLOCK_SIZE they grow by BSL_CHUNK_STEP per acknowledged frame up to
+// what the BSL accepts and shrink to 3/4 on a failed one, in whole flash words
+#define BSL_CHUNK_MIN 32
+#define BSL_CHUNK_STEP 16
+#define BSL_FLASH_WORD 8
+#define BSL_BOOT_BAUD 9600     // the BSL always starts at this speed
+#define BSL_FAST_BAUD 115200
+#define BSL_FLOW_BAUD 1000000  // with RTS/CTS the FIFOs cannot overrun
+#define BSL_BAUD_SETTLE_MS 10  // after reopening Serial2 at the new speed
+
+// BSL entry: after reset, Connection is retried until the bootloader ACKs it
+#define BSL_INVOKE_SETUP_MS 1      // PA18 high before NRST is pulsed
+#define BSL_RESET_PULSE_MS 2       // NRST low time; the MSPM0 needs >100 us
+#define BSL_ENTRY_TIMEOUT_MS 2000  // give up if the BSL has not answered by then
+#define BSL_POLL_BACKOFF_MIN_MS 2
+#define BSL_POLL_BACKOFF_MAX_MS 50
 
 // BSL Password (all 0xFF for unlocked device)
-const uint8_t BSL_PW_RESET[32] = {
+constexpr uint8_t BSL_PW_RESET[BSL_PASSWORD_BYTES] = {
     0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
     0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
     0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
     0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
 };
 
-// Global Variables
-uint8_t BSL_TX_buffer[256];
-uint8_t BSL_RX_buffer[256];
-bool programmingInProgress = false;
-const char* FIRMWARE_PATH = "/mspm0_firmware.bin";
-size_t lastFirmwareSize = 0;
+#ifdef BSL_TRANSPORT_UART
+// Serial2 receive errors since boot, counted from the UART event task
+struct UartErrorCounts {
+  uint32_t fifoOverflow;  // RX FIFO overrun, bytes were lost in hardware
+  uint32_t bufferFull;    // RX ring buffer full, bytes were dropped by the driver
+  uint32_t framing;       // framing or parity errors
+};
+static volatile UartErrorCounts uartErrors;
+
+static UartErrorCounts uartErrorsNow() {
+  return {uartErrors.fifoOverflow, uartErrors.bufferFull, uartErrors.framing};
+}
+
+void onSerial2Error(hardwareSerial_error_t error) {
+  switch (error) {
+    case UART_FIFO_OVF_ERROR:
+      uartErrors.fifoOverflow++;
+      break;
+    case UART_BUFFER_FULL_ERROR:
+      uartErrors.bufferFull++;
+      break;
+    case UART_FRAME_ERROR:
+    case UART_PARITY_ERROR:
+      uartErrors.framing++;
+      break;
+    default:
+      break;
+  }
+}
+
+// Serial2 under the shared BSL protocol core
+class Serial2Transport : public BslTransport {
+ public:
+  // Open Serial2, with RTS/CTS if enableFlowControl() turned it on
+  void begin(uint32_t baud) {
+    Serial2.begin(baud, SERIAL_8N1, D0, D1);
+    // end() drops the callback, so it is set again on every begin()
+    Serial2.onReceiveError(onSerial2Error);
+#ifdef PIN_UART_RTS
+    if (flowControl_) {
+      Serial2.setPins(-1, -1, PIN_UART_CTS, PIN_UART_RTS);
+      Serial2.setHwFlowCtrlMode(UART_HW_FLOWCTRL_CTS_RTS, UART_RTS_THRESHOLD);
+    } else {
+      // Keep RTS asserted, so a target that honours CTS can always answer
+      pinMode(PIN_UART_RTS, OUTPUT);
+      digitalWrite(PIN_UART_RTS, LOW);
+    }
+#endif
+  }
+  // Use RTS/CTS from the next begin() on. Unless forced, only if the target
+  // drives the CTS line; an unconnected line reads high through the pull-up
+  // and would stall every transmission. Returns whether it is on.
+  bool enableFlowControl(bool force) {
+#ifdef PIN_UART_RTS
+    pinMode(PIN_UART_CTS, INPUT_PULLUP);
+    flowControl_ = force || digitalRead(PIN_UART_CTS) == LOW;
+#else
+    (void)force;
+#endif
+    return flowControl_;
+  }
+  void disableFlowControl() { flowControl_ = false; }
+  bool flowControl() const { return flowControl_; }
 
-// BSL Error Codes
-enum {
-    eBSL_success = 0,
-    eBSL_unknownError = 7,
-    eBSL_criticalFailure = 8
+  bool write(const uint8_t* data, size_t len) override {
+    return Serial2.write(data, len) == len;
+  }
+  size_t read(uint8_t* buf, size_t len, uint32_t timeoutMs) override {
+    Serial2.setTimeout(timeoutMs);
+    return Serial2.readBytes(buf, len);
+  }
+  void discardInput() override {
+    while (Serial2.available()) {
+      Serial2.read();
+    }
+  }
+  void drainInput(uint32_t quietMs) override {
+    uint8_t byte;
+    Serial2.setTimeout(quietMs);
+    while (Serial2.readBytes(&byte, 1) == 1) {
+    }
+  }
+  bool setBaudRate(uint32_t baud) override {
+    Serial2.end();
+    begin(baud);
+    delay(BSL_BAUD_SETTLE_MS);
+    return true;
+  }
+  uint32_t millis() override { return ::millis(); }
+  void delayMs(uint32_t ms) override { delay(ms); }
+
+ private:
+  bool flowControl_ = false;
 };
-typedef uint8_t BSL_error_t;
+#endif
+
+// Global Variables
+#if defined(BSL_TRANSPORT_SPI)
+SpiTransport bslSpi(PIN_SPI_SCK, PIN_SPI_POCI, PIN_SPI_PICO, PIN_SPI_CS, BSL_SPI_HZ);
+BslTransport& bslIo = bslSpi;
+#elif defined(BSL_TRANSPORT_I2C)
+I2cTransport bslI2c(Wire, PIN_I2C_SDA, PIN_I2C_SCL, BSL_I2C_ADDRESS, BSL_I2C_HZ);
+BslTransport& bslIo = bslI2c;
+#else
+Serial2Transport bslSerial;
+BslTransport& bslIo = bslSerial;
+#endif
+#ifdef BSL_FAULT_INJECTION
+// Bit errors on the link during the program phase, for evaluation runs
+FaultTransport bslFaults(bslIo);
+BslLink bsl(bslFaults);
+#else
+BslLink bsl(bslIo);
+#endif
+// SHA-256 of the bytes the last Program Data phase sent
+uint8_t programDigest[SHA256_BYTES];
+ChunkController chunker(BSL_CHUNK_MIN, BSL_BLOCK_SIZE, BSL_CHUNK_STEP, BSL_FLASH_WORD);
+static uint16_t bslPayloadLimit = BSL_MAX_PROGRAM_BYTES;  // from Get Device Info
+volatile bool programmingInProgress = false;
+volatile bool programmingRequested = false;
+volatile SessionResult lastSessionResult = SESSION_NONE;
+StreamImageSource* volatile pendingStream = nullptr;
+#ifdef BSL_TRANSPORT_UART
+static UartErrorCounts sessionUartErrors;  // uartErrors when the session began
+#endif
+volatile int pendingSlot = -1;  // image to activate before the next session, pinned
+static portMUX_TYPE pendingSlotLock = portMUX_INITIALIZER_UNLOCKED;
+volatile bool forceNextSession = false;  // program even if the target runs the image
+// A session failed or was cancelled since the last good one, so the target
+// may hold a partly programmed image; the next session programs in full
+static bool targetUncertain = false;
+bool sessionSkipped = false;  // last performBSLProgramming() found the image installed
+volatile bool cancelRequested = false;  // set by cancelSession(), polled between frames
+bool sessionCancelled = false;  // last performBSLProgramming() stopped on a cancel
+bool sessionRejected = false;  // last performBSLProgramming() erased an image with a bad signature
+static SessionProgress progress;
+static portMUX_TYPE progressLock = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t programmingTaskHandle = nullptr;
+const char* FIRMWARE_PATH = "/mspm0_firmware.bin";
 
 // Function declarations
-uint32_t crc32_iso(const uint8_t *data, size_t len);
 void enterBSL();
-bool performBSLProgramming();
+// What the target must already hold for a session to skip programming
+struct InstalledImage {
+  AppHeader header;
+  uint32_t crc;  // BSL CRC32 of [0, header.length)
+};
+
+bool performBSLProgramming(ImageSource& image, const InstalledImage* skipIfInstalled = nullptr);
 BSL_error_t bslConnection();
 BSL_error_t bslGetID();
 BSL_error_t bslChangeBaudRate();
+void bslEnableFlowControl();
+void reportLinkErrors();
 BSL_error_t bslLoadPassword();
 BSL_error_t bslMassErase();
-BSL_error_t bslProgramData();
+BSL_error_t bslProgramData(ImageSource& image);
 BSL_error_t bslVerifyData();
 BSL_error_t bslStartApp();
-BSL_error_t bslGetResponse();
+BSL_error_t bslCheckSignature();
+bool signatureAccepted();
+bool targetRunsImage(const InstalledImage& image);
 void handleCriticalFailure(const char* errorMsg);
+BSL_error_t tracedPhase(TracePhase phase, BSL_error_t (*step)());
+void phaseBegin(TracePhase phase);
+void phaseProgress(uint32_t done, uint32_t total);
+bool stopForCancel();
+void handleConsole();
 void enterLightSleep();
 void setupGPIO();
-void setupSPIFFS();
+void setupStorage();
 void checkForNewFirmware();
 void triggerProgramming();
+bool programStoredImage(bool rollbackOnReject = true);
+void runStreamingSession(StreamImageSource& stream);
+void programmingTask(void* param);
+void IRAM_ATTR onTriggerEdge();
 
 void setup() {
   Serial.begin(115200);
+  logBegin();
+  traceBegin();
   delay(1000);
-  Serial.println("ESP32 OTA Gateway - PlatformIO OTA SPIFFS");
+  LOGI("ESP32 OTA Gateway - PlatformIO OTA %s", STORAGE_NAME);
   
-  // Setup GPIO and SPIFFS
+  // Setup GPIO and image storage
   setupGPIO();
-  setupSPIFFS();
-  
-  // Initialize UART for MSPM0 communication
-  Serial2.begin(9600, SERIAL_8N1, D0, D1);
+  setupStorage();
+  signatureBegin();
+  
+  // Initialize the link to the MSPM0
+#if defined(BSL_TRANSPORT_SPI)
+  bslSpi.begin();
+#elif defined(BSL_TRANSPORT_I2C)
+  bslI2c.begin();
+#else
+  bslSerial.begin(BSL_BOOT_BAUD);
+#endif
+
+  // Sessions run in their own task, started by the trigger ISR, a GPIO wake
+  // or new firmware; loop() only does housekeeping and sleeps
+  xTaskCreate(programmingTask, "bslProgram", 8192, nullptr, 2, &programmingTaskHandle);
+  attachInterrupt(digitalPinToInterrupt(PIN_TRIGGER), onTriggerEdge, FALLING);
+
+  // HTTP upload endpoints (only with WIFI_SSID configured)
+  setupUploadServer();
   
-  Serial.println("Setup complete. Waiting for firmware updates...");
-  Serial.println("Upload firmware to SPIFFS with: pio run -t uploadfs --upload-port <ESP_IP>");
+  LOGI("Setup complete. Waiting for firmware updates...");
+  LOGI("Upload firmware to %s with: pio run -t uploadfs --upload-port <ESP_IP>", STORAGE_NAME);
   
   // Check initial firmware status
   checkForNewFirmware();
   
-  // Enter light sleep mode
-  enterLightSleep();
+  // Enter light sleep mode, unless the upload server needs WiFi (see loop())
+  if (!uploadServerActive()) {
+    enterLightSleep();
+  }
 }
 
 void loop() {
-  // Check for external trigger
-  static bool lastButtonState = HIGH;
-  bool currentButtonState = digitalRead(PIN_TRIGGER);
-  
-  if (lastButtonState == HIGH && currentButtonState == LOW && !programmingInProgress) {
-    Serial.println("External trigger detected!");
-    triggerProgramming();
-  }
-  
-  lastButtonState = currentButtonState;
-  
+  // Serial console commands (trace dump)
+  handleConsole();
+
+  // HTTP requests; cut-through uploads block here while the target catches up
+  handleUploadServer();
+
   // Check for new firmware periodically
   static unsigned long lastCheck = 0;
-  if (millis() - lastCheck > 5000) { // Check every 5 seconds
+  if (millis() - lastCheck >= HOUSEKEEPING_INTERVAL_MS) {
     checkForNewFirmware();
     lastCheck = millis();
   }
   
-  // If not programming, enter light sleep periodically
-  if (!programmingInProgress) {
+  // If not programming, sleep until the trigger pin, UART or housekeeping timer.
+  // Forced light sleep suspends WiFi, so with the upload server running the
+  // gateway relies on modem sleep and stays responsive instead.
+  if (uploadServerActive()) {
+    delay(2);
+  } else if (!programmingInProgress && !programmingRequested) {
     enterLightSleep();
+  } else {
+    delay(100);
   }
-  
-  delay(100);
 }
 
 void setupGPIO() {
@@ -125,595 +355,976 @@ void setupGPIO() {
   digitalWrite(PIN_LED, LOW);   // LED off initially
 }
 
-void setupSPIFFS() {
-  if (!SPIFFS.begin(true)) {
-    Serial.println("SPIFFS Mount Failed");
+void setupStorage() {
+  if (!storageBegin()) {
+    LOGE("%s Mount Failed", STORAGE_NAME);
     return;
   }
-  Serial.println("SPIFFS mounted successfully");
+  LOGI("%s mounted successfully", STORAGE_NAME);
+  imageStoreBegin(storageFs());
 }
 
 void checkForNewFirmware() {
-  if (SPIFFS.exists(FIRMWARE_PATH)) {
-    File file = SPIFFS.open(FIRMWARE_PATH, "r");
-    if (file) {
-      size_t currentSize = file.size();
-      file.close();
-      
-      // Check if firmware size has changed (indicating new firmware)
-      if (currentSize != lastFirmwareSize && currentSize > 0) {
-        Serial.print("New firmware detected! Size: ");
-        Serial.print(currentSize);
-        Serial.println(" bytes");
-        
-        lastFirmwareSize = currentSize;
-        
-        // Automatically trigger programming
-        if (!programmingInProgress) {
-          Serial.println("Auto-triggering programming...");
-          triggerProgramming();
-        }
-      }
+  // An image dropped by uploadfs is moved into the store, so finding the
+  // file at all means it is new
+  if (storageFs().exists(FIRMWARE_PATH)) {
+    LOGI("New firmware detected!");
+    if (firmwareStored(FIRMWARE_PATH, true) >= 0) {
+      LOGI("Auto-triggering programming...");
     }
-  } else {
-    lastFirmwareSize = 0;
   }
 }
 
 void enterLightSleep() {
-  Serial.println("Entering light sleep mode...");
-  Serial.println("ESP32 will wake to check for new firmware");
+  // The trigger wakes on low level; sleeping while it is held would wake at once
+  if (digitalRead(PIN_TRIGGER) == LOW) {
+    delay(TRIGGER_DEBOUNCE_MS);
+    return;
+  }
+
+  LOGI("Entering light sleep mode...");
+  LOGI("ESP32 will wake on trigger or to check for new firmware");
   
   // Turn off LED to indicate sleep
   digitalWrite(PIN_LED, LOW);
   
-  // Configure light sleep with timer wake
-  esp_sleep_enable_timer_wakeup(5000000); // 5 seconds
+  // Drain pending log records; the drain task cannot run while asleep
+  logFlush();
+
+  // Wake sources: trigger pin (level), optional UART RX, housekeeping timer
+  // The edge handler comes off first so the level wake-up interrupt cannot
+  // fire it while the pin is held low
+  gpio_num_t triggerGpio = (gpio_num_t)digitalPinToGPIONumber(PIN_TRIGGER);
+  detachInterrupt(digitalPinToInterrupt(PIN_TRIGGER));
+  gpio_wakeup_enable(triggerGpio, GPIO_INTR_LOW_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+#ifdef UART_WAKE_NUM
+  uart_set_wakeup_threshold(UART_WAKE_NUM, UART_WAKE_THRESHOLD);
+  esp_sleep_enable_uart_wakeup(UART_WAKE_NUM);
+#endif
+  esp_sleep_enable_timer_wakeup((uint64_t)HOUSEKEEPING_INTERVAL_MS * 1000);
   
   // Enter light sleep
+  trace(TRACE_SLEEP, 0, HOUSEKEEPING_INTERVAL_MS);
   esp_light_sleep_start();
+  esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+  trace(TRACE_WAKE, (uint16_t)cause);
+
+  // Back to the edge interrupt for presses while awake
+  gpio_wakeup_disable(triggerGpio);
+  attachInterrupt(digitalPinToInterrupt(PIN_TRIGGER), onTriggerEdge, FALLING);
   
   // Wake up and continue
-  Serial.println("Waking from light sleep...");
+  if (cause == ESP_SLEEP_WAKEUP_GPIO) {
+    LOGI("External trigger detected!");
+    requestProgramming(TRIGGER_WAKE);
+  } else {
+    LOGI("Waking from light sleep...");
+  }
+}
+
+// Falling edge on the trigger pin while awake
+void IRAM_ATTR onTriggerEdge() {
+  static uint32_t lastEdgeMs = 0;
+  uint32_t now = millis();
+  if (now - lastEdgeMs < TRIGGER_DEBOUNCE_MS || programmingTaskHandle == nullptr) {
+    return;
+  }
+  lastEdgeMs = now;
+
+  programmingRequested = true;
+  trace(TRACE_TRIGGER, TRIGGER_BUTTON);
+  BaseType_t higherPriorityWoken = pdFALSE;
+  vTaskNotifyGiveFromISR(programmingTaskHandle, &higherPriorityWoken);
+  portYIELD_FROM_ISR(higherPriorityWoken);
+}
+
+void requestProgramming(TriggerSource source) {
+  programmingRequested = true;
+  trace(TRACE_TRIGGER, source);
+  xTaskNotifyGive(programmingTaskHandle);
+}
+
+bool requestStreamingSession(StreamImageSource* source) {
+  // A streamed image has no signature until its last byte has been sent
+  if (programmingInProgress || programmingRequested || imageSigningRequired()) {
+    return false;
+  }
+  pendingStream = source;
+  requestProgramming(TRIGGER_STREAM);
+  return true;
+}
+
+// Queue slot for the next session. It stays pinned in the image store until
+// that session has made it the active image.
+static void queueSlot(int slot) {
+  imageStorePin(slot);
+  portENTER_CRITICAL(&pendingSlotLock);
+  int previous = pendingSlot;
+  pendingSlot = slot;
+  portEXIT_CRITICAL(&pendingSlotLock);
+  imageStoreUnpin(previous);
+}
+
+static int takeQueuedSlot() {
+  portENTER_CRITICAL(&pendingSlotLock);
+  int slot = pendingSlot;
+  pendingSlot = -1;
+  portEXIT_CRITICAL(&pendingSlotLock);
+  return slot;
+}
+
+int firmwareStored(const char* path, bool programNow) {
+  int slot = imageStoreAdd(path);
+  if (slot < 0) {
+    LOGE("Failed to store new image");
+    storageFs().remove(path);
+    return slot;
+  }
+  if (programNow) {
+    queueSlot(slot);
+    requestProgramming(TRIGGER_UPLOAD);
+  }
+  return slot;
+}
+
+bool requestActivation(int slot, bool programNow) {
+  if (slot < 0 || slot >= IMAGE_SLOT_COUNT || imageStoreSlot(slot).state == SLOT_EMPTY) {
+    return false;
+  }
+  if (programNow) {
+    queueSlot(slot);
+    requestProgramming(TRIGGER_ACTIVATE);
+    return true;
+  }
+  if (programmingInProgress || programmingRequested) {
+    return false;
+  }
+  return imageStoreActivate(slot);
+}
+
+void programmingTask(void* param) {
+  (void)param;
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  for (;;) {
+    StreamImageSource* stream = pendingStream;
+    pendingStream = nullptr;
+    if (stream != nullptr) {
+      runStreamingSession(*stream);
+    } else {
+      triggerProgramming();
+    }
+    // Drop requests that piled up while the session was running
+    ulTaskNotifyTake(pdTRUE, 0);
+    programmingRequested = false;
+
+    // Leave the result on the LED for a while; a new request starts at once
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(RESULT_LED_HOLD_MS)) == 0) {
+      digitalWrite(PIN_LED, LOW);
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+  }
+}
+
+SessionProgress sessionProgress() {
+  SessionProgress snapshot = {0, 0, 0};
+  portENTER_CRITICAL(&progressLock);
+  if (programmingInProgress) {
+    snapshot = progress;
+  }
+  portEXIT_CRITICAL(&progressLock);
+  return snapshot;
+}
+
+bool cancelSession() {
+  if (!programmingInProgress) {
+    return false;
+  }
+  cancelRequested = true;
+  return true;
+}
+
+void handleConsole() {
+  static char line[32];
+  static uint8_t length = 0;
+
+  while (Serial.available()) {
+    char c = Serial.read();
+    if (c != '\r' && c != '\n') {
+      if (length < sizeof(line) - 1) {
+        line[length++] = c;
+      }
+      continue;
+    }
+    if (length == 0) {
+      continue;
+    }
+    line[length] = '\0';
+    length = 0;
+
+    if (strcmp(line, "trace") == 0) {
+      logFlush();
+      traceDump(Serial);
+    } else if (strcmp(line, "trace clear") == 0) {
+      traceClear();
+      LOGI("Trace cleared");
+    } else if (strcmp(line, "bench fs") == 0) {
+      logFlush();
+      storageBenchmark(Serial);
+    } else if (strcmp(line, "images") == 0) {
+      for (int i = 0; i < IMAGE_SLOT_COUNT; ++i) {
+        const ImageSlotInfo& slot = imageStoreSlot(i);
+        LOGI("slot %d%c #%u %s", i, i == imageStoreActiveSlot() ? '*' : ' ',
+             slot.sequence, imageSlotStateName(slot.state));
+        LOGI("  %u bytes, crc %08X%s", slot.size, slot.crc,
+             slot.flags & SLOT_SIGNED ? ", signed" : "");
+        const uint8_t* digest = imageStoreDigest(i);
+        if (digest != nullptr) {
+          LOGI("  sha256 %08X%08X...", sha256Word(digest, 0), sha256Word(digest, 1));
+        }
+      }
+    } else if (strcmp(line, "program") == 0 || strcmp(line, "program force") == 0) {
+      forceNextSession = line[7] != '\0';
+      requestProgramming(TRIGGER_BUTTON);
+    } else if (strcmp(line, "status") == 0) {
+      SessionProgress now = sessionProgress();
+      if (now.phase == 0) {
+        LOGI("No session running");
+      } else {
+        LOGI("Session in %s, %u/%u bytes", tracePhaseName(now.phase), now.done, now.total);
+      }
+#ifdef BSL_TRANSPORT_UART
+      UartErrorCounts errors = uartErrorsNow();
+      LOGI("Serial2: RTS/CTS %s, %u FIFO overruns, %u buffer overflows, %u framing errors",
+           bslSerial.flowControl() ? "on" : "off", errors.fifoOverflow, errors.bufferFull,
+           errors.framing);
+#endif
+      ImageCacheStats cache = imageCacheStats();
+      LOGI("Image cache: %u images, %u bytes", cache.entries, cache.bytes);
+      LOGI("  %u hits, %u loads, %u evicted, %u streamed", cache.hits, cache.misses,
+           cache.evictions, cache.bypasses);
+    } else if (strcmp(line, "cancel") == 0) {
+      if (cancelSession()) {
+        LOGI("Cancelling session...");
+      } else {
+        LOGW("No session running");
+      }
+    } else if (strcmp(line, "rollback") == 0) {
+      int slot = imageStoreRollbackSlot();
+      if (slot < 0 || !requestActivation(slot, true)) {
+        LOGW("No previous image to roll back to");
+      } else {
+        LOGI("Rolling back to slot %d", slot);
+      }
+    } else {
+      LOGW("Unknown command: use 'trace', 'trace clear', 'images', 'program [force]', 'status', 'cancel', 'rollback' or 'bench fs'");
+    }
+  }
 }
 
 void triggerProgramming() {
   if (programmingInProgress) {
-    Serial.println("Programming already in progress!");
+    LOGI("Programming already in progress!");
     return;
   }
   
+  cancelRequested = false;
   programmingInProgress = true;
-  Serial.println("=== TRIGGERING OTA PROGRAMMING ===");
+  programmingRequested = false;
+  LOGI("=== TRIGGERING OTA PROGRAMMING ===");
   
   // Turn on LED to indicate activity
   digitalWrite(PIN_LED, HIGH);
-  delay(1000);
+
+  // Switch images between sessions, never during one
+  int slot = takeQueuedSlot();
+  if (slot >= 0) {
+    imageStoreActivate(slot);
+    imageStoreUnpin(slot);
+  }
   
-  // Check if firmware file exists
-  if (!SPIFFS.exists(FIRMWARE_PATH)) {
-    Serial.println("ERROR: No firmware file found!");
-    Serial.println("Please upload firmware with: pio run -t uploadfs --upload-port <ESP_IP>");
+  // Check if there is an image to program
+  if (imageStoreActiveSlot() < 0) {
+    LOGE("ERROR: No firmware file found!");
+    LOGI("Please upload firmware with: pio run -t uploadfs --upload-port <ESP_IP>");
     digitalWrite(PIN_LED, LOW);
     programmingInProgress = false;
     return;
   }
   
   // Perform BSL programming
-  if (performBSLProgramming()) {
-    Serial.println("OTA Programming completed successfully!");
+  bool success = programStoredImage();
+  lastSessionResult = sessionCancelled ? SESSION_CANCELLED : !success ? SESSION_FAILED
+                    : sessionSkipped ? SESSION_SKIPPED : SESSION_OK;
+  if (success) {
+    LOGI("OTA Programming completed successfully!");
     digitalWrite(PIN_LED, HIGH); // Keep LED on to indicate success
+  } else if (sessionCancelled) {
+    LOGW("OTA Programming cancelled, target left in BSL mode");
+    digitalWrite(PIN_LED, LOW);
   } else {
-    Serial.println("OTA Programming failed!");
+    LOGE("OTA Programming failed!");
     digitalWrite(PIN_LED, LOW);
   }
   
+  // programmingTask() turns the LED off again after RESULT_LED_HOLD_MS
   programmingInProgress = false;
-  
-  // Wait a bit then return to normal operation
-  delay(5000);
-  digitalWrite(PIN_LED, LOW);
 }
 
-uint32_t crc32_iso(const uint8_t *data, size_t len) {
-  uint32_t crc = 0xFFFFFFFF;
-  while (len--) {
-    crc ^= *data++;
-    for (uint8_t i = 0; i < 8; ++i)
-      crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+bool programStoredImage(bool rollbackOnReject) {
+  int slot = imageStoreActiveSlot();
+  CachedImage image;
+  if (!image.open(slot)) {
+    LOGE("Failed to open firmware file");
+    return false;
+  }
+  // Uploads during the session must not replace it, even once it is no
+  // longer the active image
+  imageStorePin(slot);
+
+  // The signature covers the digest the store recorded, which Program Data
+  // checks the sent bytes against, so it can be verified while the session
+  // runs; performBSLProgramming() collects the result before Start App
+  if (imageSigningRequired()) {
+    uint8_t signature[P256_SIGNATURE_BYTES];
+    if (image.digest() == nullptr || !imageStoreSignature(slot, signature)) {
+      LOGE("Image #%u is not signed, not programming it", imageStoreSlot(slot).sequence);
+      imageStoreUnpin(slot);
+      return false;
+    }
+    signatureCheckStart(image.digest(), signature);
+  }
+
+  // With a valid application header, the header readback and the BSL's CRC
+  // of the whole image tell whether the target already runs this image; the
+  // header is checked against the image first
+  InstalledImage installed;
+  bool hasHeader = false;
+  bool force = forceNextSession || targetUncertain;
+  if (targetUncertain && !forceNextSession) {
+    LOGI("Last session did not complete, programming in full");
+  }
+  forceNextSession = false;
+  if (!force) {
+    CachedImage probe;
+    hasHeader = probe.open(slot) && appHeaderFromImage(probe, installed.header, installed.crc);
+  }
+
+  LOGI("Programming image #%u from slot %d", imageStoreSlot(slot).sequence, slot);
+  trace(TRACE_SESSION_BEGIN, 0, image.size());
+  bool success = performBSLProgramming(image, hasHeader ? &installed : nullptr);
+  trace(TRACE_SESSION_END, sessionCancelled ? 3 : !success ? 0 : sessionSkipped ? 2 : 1);
+  reportLinkErrors();
+  targetUncertain = !success || sessionCancelled;
+
+  image.close();
+  // A cancelled session says nothing about the image
+  if (!sessionCancelled) {
+    imageStoreMarkResult(slot, success);
+  }
+  imageStoreUnpin(slot);
+  // An image stored before digests existed gets one from its first good session
+  if (success && !sessionSkipped) {
+    imageStoreSetDigest(slot, programDigest);
+  }
+
+  // The target was erased instead of started; put the previous image back
+  if (sessionRejected && rollbackOnReject) {
+    int previous = imageStoreRollbackSlot();
+    if (previous >= 0 && imageStoreActivate(previous)) {
+      LOGW("Rolling back to image #%u in slot %d", imageStoreSlot(previous).sequence, previous);
+      trace(TRACE_TRIGGER, TRIGGER_ROLLBACK);
+      programStoredImage(false);
+    } else {
+      LOGE("No previous image to roll back to, target left erased");
+    }
+  }
+  return success;
+}
+
+// Program from an upload that is still arriving. Programming consumes the
+// stream as it comes in; the upload handler stores the same bytes and makes
+// them the active image, which verification reads once the upload is complete.
+void runStreamingSession(StreamImageSource& stream) {
+  cancelRequested = false;
+  programmingInProgress = true;
+  programmingRequested = false;
+  LOGI("=== CUT-THROUGH OTA PROGRAMMING ===");
+  digitalWrite(PIN_LED, HIGH);
+
+  trace(TRACE_SESSION_BEGIN, 1, stream.size());
+  bool success = performBSLProgramming(stream);
+  trace(TRACE_SESSION_END, sessionCancelled ? 3 : success ? 1 : 0);
+  reportLinkErrors();
+  targetUncertain = !success || sessionCancelled;
+
+  if (sessionCancelled) {
+    // The upload still completes and stores the image
+    stream.detach();
+  } else if (!success) {
+    // Stop throttling the upload and let it finish storing the image
+    stream.detach();
+    while (!stream.finished() && !stream.aborted()) {
+      delay(100);
+    }
+    if (stream.finished()) {
+      LOGW("Cut-through session failed, retrying from stored image");
+      success = programStoredImage();
+    }
+  } else {
+    imageStoreMarkResult(imageStoreActiveSlot(), true);
   }
-  return ~crc;
+
+  lastSessionResult = sessionCancelled ? SESSION_CANCELLED : success ? SESSION_OK : SESSION_FAILED;
+  if (success) {
+    LOGI("OTA Programming completed successfully!");
+  } else if (sessionCancelled) {
+    LOGW("OTA Programming cancelled, target left in BSL mode");
+  } else {
+    LOGE("OTA Programming failed!");
+  }
+  digitalWrite(PIN_LED, success ? HIGH : LOW);
+  programmingInProgress = false;
 }
 
 void enterBSL() {
-  Serial.println("Entering BSL mode...");
+  LOGI("Entering BSL mode...");
   
   // Step 0: Assert BSL_invoke (PA18) high first
   digitalWrite(PIN_PA18, HIGH);   // PA18 = BSL_invoke, active high
-  delay(500);     // hold it for 500ms
+  delay(BSL_INVOKE_SETUP_MS);
 
   // Step 1: Pulse NRST low to trigger BOOTRST
   digitalWrite(PIN_NRST, LOW);     // NRST low (reset)
-  delay(2);                   // hold reset low; 100µs+ is more than enough (2ms here is safe)
+  delay(BSL_RESET_PULSE_MS);
 
   // Step 2: Release NRST
   digitalWrite(PIN_NRST, HIGH);    // NRST high — device boots, sees BSL_invoke high
 
-  // Step 3: Keep BSL_invoke high briefly while bootloader starts
-  delay(500); // give some time for bootcode to sample and enter BSL
+#ifdef BSL_TRANSPORT_UART
+  // The previous session left Serial2 at the fast rate; the BSL restarts at
+  // 9600 and without flow control
+  bslSerial.disableFlowControl();
+  bslSerial.setBaudRate(BSL_BOOT_BAUD);
+  sessionUartErrors = uartErrorsNow();
+#endif
+
+  // PA18 stays high; bslConnection() polls until the bootcode has started the BSL
 }
 
-bool performBSLProgramming() {
-  Serial.println("=== Starting BSL Programming ===");
+bool performBSLProgramming(ImageSource& image, const InstalledImage* skipIfInstalled) {
+  LOGI("=== Starting BSL Programming ===");
+  sessionSkipped = false;
+  sessionCancelled = false;
+  sessionRejected = false;
   
   // Step 1: Enter BSL mode
+  phaseBegin(PHASE_ENTER_BSL);
   enterBSL();
-  delay(1000);
+  trace(TRACE_PHASE_END, PHASE_ENTER_BSL, eBSL_success);
   
-  // Step 2: Establish BSL connection
-  if (bslConnection() != eBSL_success) {
-    Serial.println("BSL connection failed");
+  // Step 2: Establish BSL connection (doubles as the readiness check)
+  if (tracedPhase(PHASE_CONNECT, bslConnection) != eBSL_success) {
+    LOGE("BSL connection failed");
     return false;
   }
   
   // Step 3: Get device ID
-  if (bslGetID() != eBSL_success) {
-    Serial.println("Failed to get device ID");
+  if (tracedPhase(PHASE_GET_ID, bslGetID) != eBSL_success) {
+    LOGE("Failed to get device ID");
     return false;
   }
   
-  // Step 4: Change baud rate for faster transfer
-  if (bslChangeBaudRate() != eBSL_success) {
-    Serial.println("Baud rate change failed, continuing at 9600 baud");
+#if defined(BSL_TRANSPORT_UART) && BSL_FLOW_CONTROL != FLOW_OFF
+  // Step 4a: RTS/CTS for the rest of the session, if the link has it wired
+  bslEnableFlowControl();
+#endif
+
+#ifdef BSL_TRANSPORT_UART
+  // Step 4: Change baud rate for faster transfer (UART only, SPI and I2C
+  // run at BSL_SPI_HZ / BSL_I2C_HZ from the start)
+  if (tracedPhase(PHASE_BAUD, bslChangeBaudRate) != eBSL_success) {
+    LOGW("Baud rate change failed, continuing at 9600 baud");
     // Continue anyway - some devices might not support baud rate change
   }
+#endif
   
   // Step 5: Load password
-  if (bslLoadPassword() != eBSL_success) {
-    Serial.println("Failed to load password");
+  if (tracedPhase(PHASE_PASSWORD, bslLoadPassword) != eBSL_success) {
+    LOGE("Failed to load password");
     return false;
   }
   
+  // Step 5b: Leave the target alone if it already runs this image
+  if (skipIfInstalled != nullptr) {
+    phaseBegin(PHASE_CHECK_APP);
+    bool installed = targetRunsImage(*skipIfInstalled);
+    trace(TRACE_PHASE_END, PHASE_CHECK_APP, installed ? eBSL_success : eBSL_unknownError);
+    if (installed) {
+      LOGI("Target already runs version %u (crc %08X), skipping programming",
+           skipIfInstalled->header.version, skipIfInstalled->header.crc);
+      sessionSkipped = true;
+      return signatureAccepted() && tracedPhase(PHASE_START_APP, bslStartApp) == eBSL_success;
+    }
+  }
+
+  // Nothing on the target has changed yet, so a cancel costs nothing here
+  if (stopForCancel()) {
+    return false;
+  }
+
   // Step 6: Mass erase
-  if (bslMassErase() != eBSL_success) {
-    Serial.println("Mass erase failed");
+  if (tracedPhase(PHASE_ERASE, bslMassErase) != eBSL_success) {
+    LOGE("Mass erase failed");
     return false;
   }
   
-  // Step 7: Program firmware from SPIFFS
-  BSL_error_t programResult = bslProgramData();
+  // Step 7: Program firmware from the image source
+  phaseBegin(PHASE_PROGRAM);
+#ifdef BSL_FAULT_INJECTION
+  bslFaults.arm(true);
+#endif
+  BSL_error_t programResult = bslProgramData(image);
+#ifdef BSL_FAULT_INJECTION
+  bslFaults.arm(false);
+#endif
+  trace(TRACE_PHASE_END, PHASE_PROGRAM, programResult);
   if (programResult != eBSL_success) {
-    if (programResult == eBSL_criticalFailure) {
-      Serial.println("CRITICAL: Programming failed - device has been reset");
+    if (programResult == eBSL_cancelled) {
+      stopForCancel();
+      return false;
+    } else if (programResult == eBSL_criticalFailure) {
+      LOGE("CRITICAL: Programming failed - device has been reset");
       return false;
     } else {
-      Serial.println("Firmware programming failed");
+      LOGE("Firmware programming failed");
       return false;
     }
   }
   
   // Step 7: Verify programmed data
-  Serial.println("=== Starting Data Verification ===");
-  BSL_error_t verifyResult = bslVerifyData();
+  LOGI("=== Starting Data Verification ===");
+  BSL_error_t verifyResult = tracedPhase(PHASE_VERIFY, bslVerifyData);
   if (verifyResult != eBSL_success) {
-    if (verifyResult == eBSL_criticalFailure) {
-      Serial.println("CRITICAL: Verification failed - device has been reset");
+    if (verifyResult == eBSL_cancelled) {
+      stopForCancel();
+      return false;
+    } else if (verifyResult == eBSL_criticalFailure) {
+      LOGE("CRITICAL: Verification failed - device has been reset");
       return false;
     } else {
-      Serial.println("Data verification failed!");
+      LOGE("Data verification failed!");
       return false;
     }
   }
-  Serial.println("=== Data Verification Passed ===");
+  LOGI("=== Data Verification Passed ===");
+
+  // Step 8: The signature check has been running since the session began
+  if (!signatureAccepted()) {
+    return false;
+  }
   
   // Step 9: Start application
-  if (bslStartApp() != eBSL_success) {
-    Serial.println("Failed to start application");
+  if (tracedPhase(PHASE_START_APP, bslStartApp) != eBSL_success) {
+    LOGE("Failed to start application");
     return false;
   }
   
-  Serial.println("=== BSL Programming Completed Successfully ===");
+  LOGI("=== BSL Programming Completed Successfully ===");
+  return true;
+}
+
+BSL_error_t tracedPhase(TracePhase phase, BSL_error_t (*step)()) {
+  phaseBegin(phase);
+  BSL_error_t result = step();
+  trace(TRACE_PHASE_END, phase, result);
+  return result;
+}
+
+void phaseBegin(TracePhase phase) {
+  trace(TRACE_PHASE_BEGIN, phase);
+  portENTER_CRITICAL(&progressLock);
+  progress = {phase, 0, 0};
+  portEXIT_CRITICAL(&progressLock);
+}
+
+void phaseProgress(uint32_t done, uint32_t total) {
+  portENTER_CRITICAL(&progressLock);
+  progress.done = done;
+  progress.total = total;
+  portEXIT_CRITICAL(&progressLock);
+}
+
+// Serial2 receive errors during the session that just ended, if any
+void reportLinkErrors() {
+#ifdef BSL_TRANSPORT_UART
+  UartErrorCounts now = uartErrorsNow();
+  uint32_t fifo = now.fifoOverflow - sessionUartErrors.fifoOverflow;
+  uint32_t full = now.bufferFull - sessionUartErrors.bufferFull;
+  uint32_t framing = now.framing - sessionUartErrors.framing;
+  if (fifo + full + framing == 0) {
+    return;
+  }
+  trace(TRACE_LINK_ERRORS, fifo > 0xFFFF ? 0xFFFF : fifo,
+        (full > 0xFFFF ? 0xFFFF : full) | (framing > 0xFFFF ? 0xFFFF : framing) << 16);
+  LOGW("Serial2: %u FIFO overruns, %u buffer overflows, %u framing errors%s",
+       fifo, full, framing, bslSerial.flowControl() ? "" : " (no flow control)");
+#endif
+}
+
+// Checked between frames; true (and logged once) if the session should stop
+bool stopForCancel() {
+  if (!cancelRequested) {
+    return false;
+  }
+  if (!sessionCancelled) {
+    sessionCancelled = true;
+    LOGW("=== BSL Programming Cancelled ===");
+  }
   return true;
 }
 
 BSL_error_t bslConnection() {
-  Serial.println("Sending BSL connection packet...");
-  
-  BSL_TX_buffer[0] = PACKET_HEADER;
-  BSL_TX_buffer[1] = 0x01; // Length LSB
-  BSL_TX_buffer[2] = 0x00; // Length MSB
-  BSL_TX_buffer[3] = CMD_CONNECTION;
-  
-  uint32_t crc = crc32_iso(&BSL_TX_buffer[3], 1);
-  BSL_TX_buffer[4] = (crc >> 0) & 0xFF;
-  BSL_TX_buffer[5] = (crc >> 8) & 0xFF;
-  BSL_TX_buffer[6] = (crc >> 16) & 0xFF;
-  BSL_TX_buffer[7] = (crc >> 24) & 0xFF;
-  
-  Serial2.write(BSL_TX_buffer, 8);
-  
-  return bslGetResponse();
+  LOGI("Sending BSL connection packets...");
+
+  uint16_t attempts;
+  uint32_t start = millis();
+  BSL_error_t result = bsl.connect(BSL_ENTRY_TIMEOUT_MS, BSL_POLL_BACKOFF_MIN_MS,
+                                   BSL_POLL_BACKOFF_MAX_MS, attempts);
+  uint32_t elapsed = millis() - start;
+  if (result != eBSL_success) {
+    LOGE("No BSL response within %u ms (%u attempts)", elapsed, attempts);
+    return result;
+  }
+  trace(TRACE_BSL_READY, attempts, elapsed);
+  LOGI("BSL ready after %u ms (%u attempts)", elapsed, attempts);
+  return eBSL_success;
 }
 
 BSL_error_t bslGetID() {
-  Serial.println("Sending Get ID packet...");
-  
-  BSL_TX_buffer[0] = PACKET_HEADER;
-  BSL_TX_buffer[1] = 0x01; // Length LSB
-  BSL_TX_buffer[2] = 0x00; // Length MSB
-  BSL_TX_buffer[3] = CMD_GET_ID;
-  
-  uint32_t crc = crc32_iso(&BSL_TX_buffer[3], 1);
-  BSL_TX_buffer[4] = (crc >> 0) & 0xFF;
-  BSL_TX_buffer[5] = (crc >> 8) & 0xFF;
-  BSL_TX_buffer[6] = (crc >> 16) & 0xFF;
-  BSL_TX_buffer[7] = (crc >> 24) & 0xFF;
-  
-  Serial2.write(BSL_TX_buffer, 8);
-  
-  // Read response (device ID)
-  delay(100);
-  int bytesRead = 0;
-  while (Serial2.available() && bytesRead < 32) {
-    BSL_RX_buffer[bytesRead] = Serial2.read();
-    bytesRead++;
+  LOGI("Sending Get ID packet...");
+
+  BslDeviceInfo info;
+  BSL_error_t result = bsl.getDeviceInfo(info);
+  if (result == eBSL_success) {
+    LOGI("BSL v%04X, buffer %u bytes", info.commandInterpreterVersion, info.maxBufferSize);
+    // The buffer holds the command and address along with the payload
+    uint32_t fits = info.maxBufferSize > BSL_FRAME_OVERHEAD + BSL_ADDRESS_BYTES
+                        ? info.maxBufferSize - BSL_FRAME_OVERHEAD - BSL_ADDRESS_BYTES
+                        : 0;
+    bslPayloadLimit = fits < BSL_MAX_PROGRAM_BYTES ? fits : BSL_MAX_PROGRAM_BYTES;
+  }
+  return result;
+}
+
+#ifdef BSL_TRANSPORT_UART
+void bslEnableFlowControl() {
+  bool on = bslSerial.enableFlowControl(BSL_FLOW_CONTROL == FLOW_ON);
+  trace(TRACE_FLOW_CONTROL, on);
+  if (on) {
+    LOGI("RTS/CTS flow control on");
+  } else {
+    LOGW("CTS not asserted by the target, continuing without flow control");
   }
-  
-  Serial.print("Device ID received: ");
-  Serial.print(bytesRead);
-  Serial.println(" bytes");
-  
-  return eBSL_success;
 }
 
 BSL_error_t bslChangeBaudRate() {
-  Serial.println("Changing baud rate to 115200 for faster data transfer...");
-  
-  BSL_TX_buffer[0] = PACKET_HEADER;
-  BSL_TX_buffer[1] = 0x01; // Length LSB
-  BSL_TX_buffer[2] = 0x00; // Length MSB
-  BSL_TX_buffer[3] = CMD_CHANGE_BAUD_RATE;
-  
-  // Baud rate value (115200 = 0x0001C200)
-  BSL_TX_buffer[4] = 0x00; // LSB
-  BSL_TX_buffer[5] = 0xC2; // 
-  BSL_TX_buffer[6] = 0x01; // 
-  BSL_TX_buffer[7] = 0x00; // MSB
-  
-  uint32_t crc = crc32_iso(&BSL_TX_buffer[3], 5);
-  BSL_TX_buffer[8] = (crc >> 0) & 0xFF;
-  BSL_TX_buffer[9] = (crc >> 8) & 0xFF;
-  BSL_TX_buffer[10] = (crc >> 16) & 0xFF;
-  BSL_TX_buffer[11] = (crc >> 24) & 0xFF;
-  
-  Serial2.write(BSL_TX_buffer, 12);
-  
-  // Wait for response
-  BSL_error_t response = bslGetResponse();
-  
+  // Without flow control, fast rates are bounded by what the FIFOs absorb
+  uint32_t baud = bslSerial.flowControl() ? BSL_FLOW_BAUD : BSL_FAST_BAUD;
+  LOGI("Changing baud rate to %u for faster data transfer...", baud);
+
+  BSL_error_t response = bsl.changeBaudRate(baud);
   if (response == eBSL_success) {
-    Serial.println("Baud rate change successful, switching UART to 115200...");
-    
-    // Change ESP32 UART baud rate
-    Serial2.end();
-    delay(100);
-    Serial2.begin(115200, SERIAL_8N1, D0, D1);
-    delay(100);
-    
-    Serial.println("UART switched to 115200 baud");
+    LOGI("UART switched to %u baud", baud);
   } else {
-    Serial.println("Baud rate change failed, continuing at 9600 baud");
+    LOGW("Baud rate change failed, continuing at 9600 baud");
   }
-  
   return response;
 }
+#endif
 
 BSL_error_t bslLoadPassword() {
-  Serial.println("Sending password packet...");
-  
-  BSL_TX_buffer[0] = PACKET_HEADER;
-  BSL_TX_buffer[1] = 0x21; // Length LSB (32 + 1)
-  BSL_TX_buffer[2] = 0x00; // Length MSB
-  BSL_TX_buffer[3] = CMD_RX_PASSWORD;
-  
-  // Copy password
-  memcpy(&BSL_TX_buffer[4], BSL_PW_RESET, 32);
-  
-  uint32_t crc = crc32_iso(&BSL_TX_buffer[3], 33);
-  BSL_TX_buffer[36] = (crc >> 0) & 0xFF;
-  BSL_TX_buffer[37] = (crc >> 8) & 0xFF;
-  BSL_TX_buffer[38] = (crc >> 16) & 0xFF;
-  BSL_TX_buffer[39] = (crc >> 24) & 0xFF;
-  
-  Serial2.write(BSL_TX_buffer, 40);
-  
-  return bslGetResponse();
+  LOGI("Sending password packet...");
+
+  return bsl.unlock(BSL_PW_RESET);
 }
 
 BSL_error_t bslMassErase() {
-  Serial.println("Sending mass erase packet...");
-  
-  BSL_TX_buffer[0] = PACKET_HEADER;
-  BSL_TX_buffer[1] = 0x01; // Length LSB
-  BSL_TX_buffer[2] = 0x00; // Length MSB
-  BSL_TX_buffer[3] = CMD_MASS_ERASE;
-  
-  uint32_t crc = crc32_iso(&BSL_TX_buffer[3], 1);
-  BSL_TX_buffer[4] = (crc >> 0) & 0xFF;
-  BSL_TX_buffer[5] = (crc >> 8) & 0xFF;
-  BSL_TX_buffer[6] = (crc >> 16) & 0xFF;
-  BSL_TX_buffer[7] = (crc >> 24) & 0xFF;
-  
-  Serial2.write(BSL_TX_buffer, 8);
-  
-  return bslGetResponse();
+  LOGI("Sending mass erase packet...");
+
+  return bsl.massErase();
 }
 
-BSL_error_t bslProgramData() {
-  Serial.println("Programming firmware from SPIFFS...");
-  
-  File file = SPIFFS.open(FIRMWARE_PATH, "r");
-  if (!file) {
-    Serial.println("Failed to open firmware file");
-    return eBSL_unknownError;
-  }
-  
-  const int blockSize = 128; // BSL block size
-  uint8_t buffer[blockSize];
+BSL_error_t bslProgramData(ImageSource& image) {
+  LOGI("Programming firmware...");
+
   uint32_t address = 0x00000000; // Starting address
-  
-  Serial.print("Programming ");
-  Serial.print(file.size());
-  Serial.println(" bytes");
-  
-  while (file.available()) {
-    int bytesRead = file.read(buffer, blockSize);
-    
-    // Prepare data block packet
-    BSL_TX_buffer[0] = PACKET_HEADER;
-    BSL_TX_buffer[1] = (bytesRead + 5) & 0xFF; // Length LSB (data + address + length)
-    BSL_TX_buffer[2] = ((bytesRead + 5) >> 8) & 0xFF; // Length MSB
-    BSL_TX_buffer[3] = CMD_PROGRAMDATA;
-    
-    // Address (4 bytes, little-endian)
-    BSL_TX_buffer[4] = address & 0xFF;
-    BSL_TX_buffer[5] = (address >> 8) & 0xFF;
-    BSL_TX_buffer[6] = (address >> 16) & 0xFF;
-    BSL_TX_buffer[7] = (address >> 24) & 0xFF;
-    
-    // Data length (2 bytes, little-endian)
-    BSL_TX_buffer[8] = bytesRead & 0xFF;
-    BSL_TX_buffer[9] = (bytesRead >> 8) & 0xFF;
-    
-    // Copy data
-    memcpy(&BSL_TX_buffer[10], buffer, bytesRead);
-    
-    // Calculate CRC
-    uint32_t crc = crc32_iso(&BSL_TX_buffer[3], bytesRead + 7);
-    BSL_TX_buffer[10 + bytesRead] = (crc >> 0) & 0xFF;
-    BSL_TX_buffer[10 + bytesRead + 1] = (crc >> 8) & 0xFF;
-    BSL_TX_buffer[10 + bytesRead + 2] = (crc >> 16) & 0xFF;
-    BSL_TX_buffer[10 + bytesRead + 3] = (crc >> 24) & 0xFF;
-    
-    // Send packet
-    Serial2.write(BSL_TX_buffer, 10 + bytesRead + 4);
-    
-         // Wait for response with enhanced retry logic
-     int retryCount = 0;
-     const int maxRetries = 10; // Increased to 10 retries
-     BSL_error_t response;
-     
-     do {
-       response = bslGetResponse();
-       if (response != eBSL_success) {
-         retryCount++;
-         Serial.print("Data block programming failed, retry ");
-         Serial.print(retryCount);
-         Serial.print("/");
-         Serial.println(maxRetries);
-         
-         if (retryCount < maxRetries) {
-           delay(100); // Wait before retry
-           // Resend the same packet
-           Serial2.write(BSL_TX_buffer, 10 + bytesRead + 4);
-         }
-       }
-     } while (response != eBSL_success && retryCount < maxRetries);
-     
-     if (response != eBSL_success) {
-       Serial.println("CRITICAL: Data block programming failed after 10 retries");
-       file.close();
-       handleCriticalFailure("CRC32/Programming failure after 10 retries");
-       return eBSL_criticalFailure;
-     }
-    
-    address += bytesRead;
-    Serial.print("Programmed ");
-    Serial.print(address);
-    Serial.println(" bytes");
+
+  // A memory-mapped image is sent in place; otherwise image bytes are read
+  // into a local buffer first and stay there until a frame carrying them is
+  // acknowledged, since a failed frame is resent smaller
+  const uint8_t* mapped = image.mapped();
+  LOGI("Programming %u bytes (%s)", image.size(), mapped != nullptr ? "mapped" : "buffered");
+
+  uint8_t block[BSL_MAX_PROGRAM_BYTES];
+  size_t buffered = 0;
+  // Hashed as frames are acknowledged, so the check needs no pass of its own
+  Sha256 sha;
+  bool sourceEnded = false;
+  chunker.begin(bslPayloadLimit);
+  int retryCount = 0;
+  const int maxRetries = 10; // consecutive failures before giving up
+  for (;;) {
+    if (cancelRequested) {
+      LOGW("Cancelled after %u bytes", address);
+      return eBSL_cancelled;
+    }
+    size_t chunk = chunker.size();
+    const uint8_t* payload = block;
+    size_t len;
+    if (mapped != nullptr) {
+      payload = mapped + address;
+      size_t remaining = image.size() - address;
+      len = remaining < chunk ? remaining : chunk;
+    } else {
+      while (buffered < chunk && !sourceEnded) {
+        int bytesRead = image.read(block + buffered, chunk - buffered);
+        if (bytesRead < 0) {
+          LOGE("Image source failed after %u bytes", address);
+          return eBSL_unknownError;
+        }
+        sourceEnded = bytesRead == 0;
+        buffered += bytesRead;
+      }
+      len = buffered < chunk ? buffered : chunk;
+    }
+    if (len == 0) {
+      break;
+    }
+
+    uint32_t started = micros();
+    BSL_error_t response = bsl.programData(address, payload, len);
+    uint32_t elapsedUs = micros() - started;
+    if (response != eBSL_success) {
+      retryCount++;
+      trace(TRACE_NAK, response, address);
+      trace(TRACE_RETRY, retryCount, address);
+      if (chunker.onFailure(elapsedUs)) {
+        trace(TRACE_CHUNK_SIZE, chunker.size(), address);
+      }
+      LOGW("Data block programming failed, retry %d/%d with %u bytes", retryCount, maxRetries,
+           chunker.size());
+      if (retryCount >= maxRetries) {
+        LOGE("CRITICAL: Data block programming failed after 10 retries");
+        trace(TRACE_CRITICAL, 0, address);
+#ifdef BSL_FAULT_INJECTION
+        bslFaults.arm(false);
+#endif
+        handleCriticalFailure("CRC32/Programming failure after 10 retries");
+        return eBSL_criticalFailure;
+      }
+      // Drop what is left of the failed reply, then resend right away
+      bsl.recover();
+      continue;
+    }
+    retryCount = 0;
+    chunker.onAck(len, elapsedUs);
+    sha.update(payload, len);
+    if (mapped == nullptr) {
+      buffered -= len;
+      memmove(block, block + len, buffered);
+    }
+
+    address += len;
+    phaseProgress(address, image.size());
+    LOGI_RATE(2, "Programmed %u bytes", address);
+  }
+
+  trace(TRACE_PROGRAM_STATS, chunker.failures(), chunker.goodput());
+  LOGI("%u frames, %u failed, goodput %u B/s", chunker.frames(), chunker.failures(),
+       chunker.goodput());
+  LOGI("Payload ended at %u of %u bytes", chunker.size(), chunker.limit());
+
+  // What was sent must be what was stored; the readback only compares
+  // against the same copy, so a damaged store would otherwise pass
+  sha.finish(programDigest);
+  const uint8_t* expected = image.digest();
+  uint32_t head = sha256Word(programDigest, 0);
+  if (expected == nullptr) {
+    trace(TRACE_DIGEST, 2, head);
+  } else if (memcmp(programDigest, expected, SHA256_BYTES) != 0) {
+    trace(TRACE_DIGEST, 0, head);
+    LOGE("Image SHA-256 %08X%08X... does not match the stored %08X%08X...", head,
+         sha256Word(programDigest, 1), sha256Word(expected, 0), sha256Word(expected, 1));
+    return eBSL_unknownError;
+  } else {
+    trace(TRACE_DIGEST, 1, head);
+    LOGI("Image SHA-256 %08X%08X... matches", head, sha256Word(programDigest, 1));
   }
-  
-  file.close();
   return eBSL_success;
 }
 
 BSL_error_t bslVerifyData() {
-  Serial.println("Starting data verification...");
-  
-  File file = SPIFFS.open(FIRMWARE_PATH, "r");
-  if (!file) {
-    Serial.println("Failed to open firmware file for verification");
+  LOGI("Starting data verification...");
+
+  CachedImage image;
+  if (!image.open(imageStoreActiveSlot())) {
+    LOGE("Failed to open firmware file for verification");
     return eBSL_unknownError;
   }
-  
-  const int blockSize = 128; // BSL block size
+
+  const int blockSize = BSL_BLOCK_SIZE;
   uint8_t originalBuffer[blockSize];
   uint8_t readbackBuffer[blockSize];
   uint32_t address = 0x00000000; // Starting address
-  uint32_t totalBytes = file.size();
+  uint32_t totalBytes = image.size();
   uint32_t bytesVerified = 0;
-  
-  Serial.print("Verifying ");
-  Serial.print(totalBytes);
-  Serial.println(" bytes");
-  
-  while (file.available()) {
-    int bytesRead = file.read(originalBuffer, blockSize);
-    
-    // Send read command to get back the programmed data
-    BSL_TX_buffer[0] = PACKET_HEADER;
-    BSL_TX_buffer[1] = 0x05; // Length LSB (address + length)
-    BSL_TX_buffer[2] = 0x00; // Length MSB
-    BSL_TX_buffer[3] = CMD_TX_DATA_BLOCK;
-    
-    // Address (4 bytes, little-endian)
-    BSL_TX_buffer[4] = address & 0xFF;
-    BSL_TX_buffer[5] = (address >> 8) & 0xFF;
-    BSL_TX_buffer[6] = (address >> 16) & 0xFF;
-    BSL_TX_buffer[7] = (address >> 24) & 0xFF;
-    
-    // Data length (2 bytes, little-endian)
-    BSL_TX_buffer[8] = bytesRead & 0xFF;
-    BSL_TX_buffer[9] = (bytesRead >> 8) & 0xFF;
-    
-    // Calculate CRC
-    uint32_t crc = crc32_iso(&BSL_TX_buffer[3], 7);
-    BSL_TX_buffer[10] = (crc >> 0) & 0xFF;
-    BSL_TX_buffer[11] = (crc >> 8) & 0xFF;
-    BSL_TX_buffer[12] = (crc >> 16) & 0xFF;
-    BSL_TX_buffer[13] = (crc >> 24) & 0xFF;
-    
+  int bytesRead;
+
+  LOGI("Verifying %u bytes", totalBytes);
+
+  while ((bytesRead = image.read(originalBuffer, blockSize)) > 0) {
+    if (cancelRequested) {
+      LOGW("Cancelled after verifying %u bytes", bytesVerified);
+      return eBSL_cancelled;
+    }
+
                // Send read command with enhanced retry logic
       int retryCount = 0;
       const int maxRetries = 10; // Increased to 10 retries
       bool readSuccess = false;
-     
+
      do {
-       Serial2.write(BSL_TX_buffer, 14);
-       
-       // Wait for response and read back data
-       delay(100);
-       int responseBytes = 0;
-       while (Serial2.available() && responseBytes < (bytesRead + 8)) { // +8 for header and CRC
-         BSL_RX_buffer[responseBytes] = Serial2.read();
-         responseBytes++;
-       }
-       
-       if (responseBytes >= (bytesRead + 8)) {
+       if (bsl.readMemory(address, readbackBuffer, bytesRead) == eBSL_success) {
          readSuccess = true;
        } else {
          retryCount++;
-         Serial.print("Insufficient readback data, retry ");
-         Serial.print(retryCount);
-         Serial.print("/");
-         Serial.println(maxRetries);
-         
+         trace(TRACE_RETRY, retryCount, address);
+         LOGW("Insufficient readback data, retry %d/%d", retryCount, maxRetries);
+
          if (retryCount < maxRetries) {
            delay(100); // Wait before retry
          }
        }
-     } while (!readSuccess && retryCount < maxRetries);
-     
+     } while (!readSuccess && retryCount < maxRetries && !cancelRequested);
+
+     if (!readSuccess && cancelRequested) {
+       LOGW("Cancelled after verifying %u bytes", bytesVerified);
+       return eBSL_cancelled;
+     }
+
            if (!readSuccess) {
-        Serial.println("CRITICAL: Insufficient readback data after 10 retries");
-        file.close();
+        LOGE("CRITICAL: Insufficient readback data after 10 retries");
+        trace(TRACE_CRITICAL, 0, address);
         handleCriticalFailure("Verification readback failure after 10 retries");
         return eBSL_criticalFailure;
       }
-    
-    // Extract readback data (skip header and CRC)
-    memcpy(readbackBuffer, &BSL_RX_buffer[4], bytesRead);
-    
+
     // Compare original vs readback
     bool blockMatch = true;
     for (int i = 0; i < bytesRead; i++) {
       if (originalBuffer[i] != readbackBuffer[i]) {
-        Serial.print("Mismatch at address 0x");
-        Serial.print(address + i, HEX);
-        Serial.print(": Original=0x");
-        Serial.print(originalBuffer[i], HEX);
-        Serial.print(" Readback=0x");
-        Serial.println(readbackBuffer[i], HEX);
+        LOGE("Mismatch at address 0x%X: Original=0x%02X Readback=0x%02X",
+             address + i, originalBuffer[i], readbackBuffer[i]);
+        trace(TRACE_MISMATCH, i, address);
         blockMatch = false;
         break;
       }
     }
-    
+
     if (!blockMatch) {
-      Serial.println("Data verification failed - block mismatch");
-      file.close();
+      LOGE("Data verification failed - block mismatch");
       return eBSL_unknownError;
     }
-    
+
     address += bytesRead;
     bytesVerified += bytesRead;
-    Serial.print("Verified ");
-    Serial.print(bytesVerified);
-    Serial.print("/");
-    Serial.print(totalBytes);
-    Serial.println(" bytes");
+    phaseProgress(bytesVerified, totalBytes);
+    LOGI_RATE(2, "Verified %u/%u bytes", bytesVerified, totalBytes);
   }
-  
-  file.close();
-  Serial.println("Data verification completed successfully!");
+
+  LOGI("Data verification completed successfully!");
   return eBSL_success;
 }
 
-BSL_error_t bslStartApp() {
-  Serial.println("Sending start app packet...");
-  
-  BSL_TX_buffer[0] = PACKET_HEADER;
-  BSL_TX_buffer[1] = 0x01; // Length LSB
-  BSL_TX_buffer[2] = 0x00; // Length MSB
-  BSL_TX_buffer[3] = CMD_START_APP;
-  
-  uint32_t crc = crc32_iso(&BSL_TX_buffer[3], 1);
-  BSL_TX_buffer[4] = (crc >> 0) & 0xFF;
-  BSL_TX_buffer[5] = (crc >> 8) & 0xFF;
-  BSL_TX_buffer[6] = (crc >> 16) & 0xFF;
-  BSL_TX_buffer[7] = (crc >> 24) & 0xFF;
-  
-  Serial2.write(BSL_TX_buffer, 8);
-  
-  return eBSL_success;
+// Compare the application header in the target's flash with the image's,
+// then the BSL's CRC32 of the whole image range: the header goes out in the
+// first Program Data frame, so it matches after any session that got that far
+bool targetRunsImage(const InstalledImage& image) {
+  AppHeader installed;
+  if (bsl.readMemory(APP_HEADER_OFFSET, (uint8_t*)&installed, sizeof(installed)) != eBSL_success) {
+    LOGW("Could not read the application header back");
+    return false;
+  }
+  if (installed.magic != APP_HEADER_MAGIC) {
+    LOGI("Target has no application header");
+    return false;
+  }
+  LOGI("Target runs version %u (crc %08X)", installed.version, installed.crc);
+  if (memcmp(&installed, &image.header, sizeof(installed)) != 0) {
+    return false;
+  }
+  if (image.header.length < BSL_VERIFY_MIN_BYTES) {
+    LOGI("Image too short for a CRC check of the target, programming it");
+    return false;
+  }
+  uint32_t crc = 0;
+  if (bsl.verifyCrc(0, image.header.length, crc) != eBSL_success) {
+    LOGW("Could not read the target's image CRC");
+    return false;
+  }
+  if (crc != image.crc) {
+    LOGW("Target image CRC %08X, expected %08X: partly programmed", crc, image.crc);
+    return false;
+  }
+  return true;
 }
 
-BSL_error_t bslGetResponse() {
-  delay(100);
-  
-  int bytesRead = 0;
-  while (Serial2.available() && bytesRead < 16) {
-    BSL_RX_buffer[bytesRead] = Serial2.read();
-    bytesRead++;
+// Only with IMAGE_SIGNING_KEY: collect the check started with the session.
+// A refused image is erased again, so it can never run.
+bool signatureAccepted() {
+  if (!imageSigningRequired() || tracedPhase(PHASE_SIGNATURE, bslCheckSignature) == eBSL_success) {
+    return true;
   }
-  
-  if (bytesRead >= 5) {
-    uint8_t ack = BSL_RX_buffer[4];
-    Serial.print("Response ACK: 0x");
-    Serial.println(ack, HEX);
-    return ack;
-  } else {
-    Serial.println("No response received");
+  sessionRejected = true;
+  LOGE("Erasing the target instead of starting the image");
+  bslMassErase();
+  return false;
+}
+
+BSL_error_t bslCheckSignature() {
+  uint32_t verifyUs;
+  SignatureResult result = signatureCheckWait(verifyUs);
+  trace(TRACE_SIGNATURE, result, verifyUs);
+  if (result != SIGNATURE_VALID) {
+    LOGE("Image signature %s", result == SIGNATURE_MISSING ? "was not checked" : "is invalid");
     return eBSL_unknownError;
   }
+  LOGI("Image signature valid (verified in %u us beside the session)", verifyUs);
+  return eBSL_success;
+}
+
+BSL_error_t bslStartApp() {
+  LOGI("Sending start app packet...");
+
+  return bsl.startApp();
 }
 
 void handleCriticalFailure(const char* errorMsg) {
-  Serial.println("=== CRITICAL FAILURE DETECTED ===");
-  Serial.print("Error: ");
-  Serial.println(errorMsg);
-  Serial.println("Performing emergency mass erase to reset device state...");
+  LOGE("=== CRITICAL FAILURE DETECTED ===");
+  LOGE("Error: %s", errorMsg);
+  LOGI("Performing emergency mass erase to reset device state...");
   
   // Turn on LED to indicate error state
   digitalWrite(PIN_LED, HIGH);
   
   // Attempt mass erase to reset device
   if (bslMassErase() == eBSL_success) {
-    Serial.println("Emergency mass erase completed successfully");
-    Serial.println("Device has been reset to blank state");
+    LOGI("Emergency mass erase completed successfully");
+    LOGI("Device has been reset to blank state");
   } else {
-    Serial.println("WARNING: Emergency mass erase failed!");
-    Serial.println("Device may be in an inconsistent state");
+    LOGE("WARNING: Emergency mass erase failed!");
+    LOGE("Device may be in an inconsistent state");
   }
   
   // Blink LED rapidly to indicate error
@@ -724,6 +1335,6 @@ void handleCriticalFailure(const char* errorMsg) {
     delay(200);
   }
   
-  Serial.println("=== CRITICAL FAILURE HANDLED ===");
-  Serial.println("Please check hardware connections and try again");
+  LOGI("=== CRITICAL FAILURE HANDLED ===");
+  LOGI("Please check hardware connections and try again");
 }
\ No newline at end of file
@@ -0,0 +1,364 @@
+// Prathik Narsetty
+// ECDSA P-256 signature verification for signed firmware images
+#include <string.h>
+#include "p256.h"
+
+#if defined(ESP_PLATFORM)
+#include <mbedtls/ecdsa.h>
+
+bool p256Verify(const uint8_t key[P256_KEY_BYTES], const uint8_t hash[P256_HASH_BYTES],
+                const uint8_t signature[P256_SIGNATURE_BYTES]) {
+  mbedtls_ecp_group group;
+  mbedtls_ecp_point q;
+  mbedtls_mpi r;
+  mbedtls_mpi s;
+  mbedtls_ecp_group_init(&group);
+  mbedtls_ecp_point_init(&q);
+  mbedtls_mpi_init(&r);
+  mbedtls_mpi_init(&s);
+  bool ok = mbedtls_ecp_group_load(&group, MBEDTLS_ECP_DP_SECP256R1) == 0 &&
+            mbedtls_ecp_point_read_binary(&group, &q, key, P256_KEY_BYTES) == 0 &&
+            mbedtls_ecp_check_pubkey(&group, &q) == 0 &&
+            mbedtls_mpi_read_binary(&r, signature, 32) == 0 &&
+            mbedtls_mpi_read_binary(&s, signature + 32, 32) == 0 &&
+            mbedtls_ecdsa_verify(&group, hash, P256_HASH_BYTES, &q, &r, &s) == 0;
+  mbedtls_mpi_free(&s);
+  mbedtls_mpi_free(&r);
+  mbedtls_ecp_point_free(&q);
+  mbedtls_ecp_group_free(&group);
+  return ok;
+}
+
+#else
+
+// 256-bit numbers as eight 32-bit limbs, least significant first. Field and
+// scalar arithmetic both use Montgomery multiplication with R = 2^256.
+typedef uint32_t Num[8];
+
+struct Modulus {
+  Num m;
+  Num r2;        // R^2 mod m
+  uint32_t inv;  // -m^-1 mod 2^32
+};
+
+struct Point {
+  Num x, y, z;   // Jacobian, Montgomery form; z = 0 is the point at infinity
+};
+
+static Modulus fieldP = {
+  {0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000, 0x00000000, 0x00000000, 0x00000001, 0xFFFFFFFF},
+  {}, 0};
+static Modulus orderN = {
+  {0xFC632551, 0xF3B9CAC2, 0xA7179E84, 0xBCE6FAAD, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000, 0xFFFFFFFF},
+  {}, 0};
+static const Num CURVE_B = {
+  0x27D2604B, 0x3BCE3C3E, 0xCC53B0F6, 0x651D06B0, 0x769886BC, 0xB3EBBD55, 0xAA3A93E7, 0x5AC635D8};
+static const Num BASE_X = {
+  0xD898C296, 0xF4A13945, 0x2DEB33A0, 0x77037D81, 0x63A440F2, 0xF8BCE6E5, 0xE12C4247, 0x6B17D1F2};
+static const Num BASE_Y = {
+  0x37BF51F5, 0xCBB64068, 0x6B315ECE, 0x2BCE3357, 0x7C0F9E16, 0x8EE7EB4A, 0xFE1A7F9B, 0x4FE342E2};
+
+static void fromBytes(Num out, const uint8_t* bytes) {
+  for (int i = 0; i < 8; i++) {
+    const uint8_t* b = bytes + 28 - 4 * i;
+    out[i] = (uint32_t)b[0] << 24 | b[1] << 16 | b[2] << 8 | b[3];
+  }
+}
+
+static bool isZero(const Num a) {
+  uint32_t bits = 0;
+  for (int i = 0; i < 8; i++) {
+    bits |= a[i];
+  }
+  return bits == 0;
+}
+
+static int compare(const Num a, const Num b) {
+  for (int i = 7; i >= 0; i--) {
+    if (a[i] != b[i]) {
+      return a[i] < b[i] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+static uint32_t add(Num out, const Num a, const Num b) {
+  uint64_t carry = 0;
+  for (int i = 0; i < 8; i++) {
+    carry += (uint64_t)a[i] + b[i];
+    out[i] = (uint32_t)carry;
+    carry >>= 32;
+  }
+  return (uint32_t)carry;
+}
+
+static uint32_t sub(Num out, const Num a, const Num b) {
+  int64_t borrow = 0;
+  for (int i = 0; i < 8; i++) {
+    borrow += (int64_t)a[i] - b[i];
+    out[i] = (uint32_t)borrow;
+    borrow >>= 32;
+  }
+  return (uint32_t)(borrow & 1);
+}
+
+static void modAdd(Num out, const Num a, const Num b, const Modulus& mod) {
+  if (add(out, a, b) || compare(out, mod.m) >= 0) {
+    sub(out, out, mod.m);
+  }
+}
+
+static void modSub(Num out, const Num a, const Num b, const Modulus& mod) {
+  if (sub(out, a, b)) {
+    add(out, out, mod.m);
+  }
+}
+
+// a * b / R mod m, for a, b < m
+static void montMul(Num out, const Num a, const Num b, const Modulus& mod) {
+  uint32_t t[10] = {0};
+  for (int i = 0; i < 8; i++) {
+    uint64_t carry = 0;
+    for (int j = 0; j < 8; j++) {
+      uint64_t s = (uint64_t)a[j] * b[i] + t[j] + carry;
+      t[j] = (uint32_t)s;
+      carry = s >> 32;
+    }
+    uint64_t s = (uint64_t)t[8] + carry;
+    t[8] = (uint32_t)s;
+    t[9] = (uint32_t)(s >> 32);
+
+    uint32_t q = t[0] * mod.inv;
+    s = (uint64_t)q * mod.m[0] + t[0];
+    carry = s >> 32;
+    for (int j = 1; j < 8; j++) {
+      s = (uint64_t)q * mod.m[j] + t[j] + carry;
+      t[j - 1] = (uint32_t)s;
+      carry = s >> 32;
+    }
+    s = (uint64_t)t[8] + carry;
+    t[7] = (uint32_t)s;
+    t[8] = t[9] + (uint32_t)(s >> 32);
+  }
+  if (t[8] != 0 || compare(t, mod.m) >= 0) {
+    sub(t, t, mod.m);
+  }
+  memcpy(out, t, sizeof(Num));
+}
+
+static void toMont(Num out, const Num a, const Modulus& mod) {
+  montMul(out, a, mod.r2, mod);
+}
+
+static void fromMont(Num out, const Num a, const Modulus& mod) {
+  static const Num ONE = {1};
+  montMul(out, a, ONE, mod);
+}
+
+// a^-1 in Montgomery form, as a^(m-2) (m is prime)
+static void montInverse(Num out, const Num a, const Modulus& mod) {
+  static const Num TWO = {2};
+  Num e;
+  sub(e, mod.m, TWO);
+  Num x;
+  Num zero = {0};
+  sub(x, zero, mod.m);  // R mod m, the Montgomery 1
+  for (int bit = 255; bit >= 0; bit--) {
+    montMul(x, x, x, mod);
+    if ((e[bit / 32] >> (bit % 32)) & 1) {
+      montMul(x, x, a, mod);
+    }
+  }
+  memcpy(out, x, sizeof(Num));
+}
+
+static void setupModulus(Modulus& mod) {
+  uint32_t x = 1;
+  for (int i = 0; i < 5; i++) {
+    x *= 2 - mod.m[0] * x;  // Newton step, doubles the correct low bits
+  }
+  mod.inv = -x;
+  Num zero = {0};
+  sub(mod.r2, zero, mod.m);  // R mod m
+  for (int i = 0; i < 256; i++) {
+    modAdd(mod.r2, mod.r2, mod.r2, mod);
+  }
+}
+
+// Doubling in Jacobian coordinates with a = -3
+static void pointDouble(Point& out, const Point& p) {
+  if (isZero(p.z)) {
+    out = p;
+    return;
+  }
+  const Modulus& f = fieldP;
+  Num delta, gamma, beta, alpha, t1, t2;
+  montMul(delta, p.z, p.z, f);
+  montMul(gamma, p.y, p.y, f);
+  montMul(beta, p.x, gamma, f);
+  modSub(t1, p.x, delta, f);
+  modAdd(t2, p.x, delta, f);
+  montMul(alpha, t1, t2, f);
+  modAdd(t1, alpha, alpha, f);
+  modAdd(alpha, alpha, t1, f);
+
+  Point r;
+  modAdd(t1, p.y, p.z, f);
+  montMul(r.z, t1, t1, f);
+  modSub(r.z, r.z, gamma, f);
+  modSub(r.z, r.z, delta, f);
+
+  modAdd(beta, beta, beta, f);
+  modAdd(beta, beta, beta, f);  // 4 beta
+  montMul(r.x, alpha, alpha, f);
+  modAdd(t1, beta, beta, f);
+  modSub(r.x, r.x, t1, f);
+
+  modSub(t1, beta, r.x, f);
+  montMul(r.y, alpha, t1, f);
+  montMul(t2, gamma, gamma, f);
+  modAdd(t2, t2, t2, f);
+  modAdd(t2, t2, t2, f);
+  modAdd(t2, t2, t2, f);  // 8 gamma^2
+  modSub(r.y, r.y, t2, f);
+  out = r;
+}
+
+static void pointAdd(Point& out, const Point& p, const Point& q) {
+  if (isZero(p.z)) {
+    out = q;
+    return;
+  }
+  if (isZero(q.z)) {
+    out = p;
+    return;
+  }
+  const Modulus& f = fieldP;
+  Num z1z1, z2z2, u1, u2, s1, s2, h, r, t;
+  montMul(z1z1, p.z, p.z, f);
+  montMul(z2z2, q.z, q.z, f);
+  montMul(u1, p.x, z2z2, f);
+  montMul(u2, q.x, z1z1, f);
+  montMul(t, q.z, z2z2, f);
+  montMul(s1, p.y, t, f);
+  montMul(t, p.z, z1z1, f);
+  montMul(s2, q.y, t, f);
+  modSub(h, u2, u1, f);
+  modSub(r, s2, s1, f);
+  if (isZero(h)) {
+    if (isZero(r)) {
+      pointDouble(out, p);
+    } else {
+      memset(&out, 0, sizeof(out));
+    }
+    return;
+  }
+
+  Num hh, hhh, v;
+  montMul(hh, h, h, f);
+  montMul(hhh, hh, h, f);
+  montMul(v, u1, hh, f);
+  Point sum;
+  montMul(sum.x, r, r, f);
+  modSub(sum.x, sum.x, hhh, f);
+  modSub(sum.x, sum.x, v, f);
+  modSub(sum.x, sum.x, v, f);
+  modSub(t, v, sum.x, f);
+  montMul(sum.y, r, t, f);
+  montMul(t, s1, hhh, f);
+  modSub(sum.y, sum.y, t, f);
+  montMul(t, p.z, q.z, f);
+  montMul(sum.z, t, h, f);
+  out = sum;
+}
+
+// Affine (x, y) < p on the curve, into Jacobian Montgomery form
+static bool loadPoint(Point& out, const Num x, const Num y) {
+  const Modulus& f = fieldP;
+  if (compare(x, f.m) >= 0 || compare(y, f.m) >= 0) {
+    return false;
+  }
+  toMont(out.x, x, f);
+  toMont(out.y, y, f);
+  Num zero = {0};
+  sub(out.z, zero, f.m);
+
+  // y^2 = x^3 - 3x + b
+  Num lhs, rhs, t;
+  montMul(lhs, out.y, out.y, f);
+  montMul(rhs, out.x, out.x, f);
+  montMul(rhs, rhs, out.x, f);
+  modAdd(t, out.x, out.x, f);
+  modAdd(t, t, out.x, f);
+  modSub(rhs, rhs, t, f);
+  toMont(t, CURVE_B, f);
+  modAdd(rhs, rhs, t, f);
+  return compare(lhs, rhs) == 0;
+}
+
+bool p256Verify(const uint8_t key[P256_KEY_BYTES], const uint8_t hash[P256_HASH_BYTES],
+                const uint8_t signature[P256_SIGNATURE_BYTES]) {
+  static bool ready = false;
+  if (!ready) {
+    setupModulus(fieldP);
+    setupModulus(orderN);
+    ready = true;
+  }
+  const Modulus& n = orderN;
+
+  Num qx, qy;
+  Point g, q;
+  fromBytes(qx, key + 1);
+  fromBytes(qy, key + 33);
+  if (key[0] != 0x04 || !loadPoint(q, qx, qy) || !loadPoint(g, BASE_X, BASE_Y)) {
+    return false;
+  }
+
+  Num r, s, e;
+  fromBytes(r, signature);
+  fromBytes(s, signature + 32);
+  if (isZero(r) || isZero(s) || compare(r, n.m) >= 0 || compare(s, n.m) >= 0) {
+    return false;
+  }
+  fromBytes(e, hash);
+  if (compare(e, n.m) >= 0) {
+    sub(e, e, n.m);
+  }
+
+  // u1 = e / s, u2 = r / s; multiplying a plain number by a Montgomery
+  // inverse gives a plain result
+  Num w, u1, u2;
+  toMont(w, s, n);
+  montInverse(w, w, n);
+  montMul(u1, e, w, n);
+  montMul(u2, r, w, n);
+
+  // u1 G + u2 Q, both multiplications in one pass
+  Point gq, sum;
+  pointAdd(gq, g, q);
+  memset(&sum, 0, sizeof(sum));
+  for (int bit = 255; bit >= 0; bit--) {
+    pointDouble(sum, sum);
+    bool b1 = (u1[bit / 32] >> (bit % 32)) & 1;
+    bool b2 = (u2[bit / 32] >> (bit % 32)) & 1;
+    if (b1 || b2) {
+      pointAdd(sum, sum, b1 && b2 ? gq : b1 ? g : q);
+    }
+  }
+  if (isZero(sum.z)) {
+    return false;
+  }
+
+  // Affine x = X / Z^2, reduced mod n
+  Num zz, x;
+  montMul(zz, sum.z, sum.z, fieldP);
+  montInverse(zz, zz, fieldP);
+  montMul(x, sum.x, zz, fieldP);
+  fromMont(x, x, fieldP);
+  if (compare(x, n.m) >= 0) {
+    sub(x, x, n.m);
+  }
+  return compare(x, r) == 0;
+}
+
+#endif
@@ -0,0 +1,69 @@
+// Prathik Narsetty
+// Raw image partition backed by the ESP32 flash partition
+#if defined(ESP_PLATFORM)
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <esp_idf_version.h>
+#include "raw_partition.h"
+
+// esp_partition_mmap's handle type and unmap call changed in IDF 5
+#if ESP_IDF_VERSION_MAJOR >= 5
+typedef esp_partition_mmap_handle_t RawMmapHandle;
+#define RAW_MMAP_DATA ESP_PARTITION_MMAP_DATA
+#define rawMunmap(handle) esp_partition_munmap(handle)
+#else
+#include <esp_spi_flash.h>
+typedef spi_flash_mmap_handle_t RawMmapHandle;
+#define RAW_MMAP_DATA SPI_FLASH_MMAP_DATA
+#define rawMunmap(handle) spi_flash_munmap(handle)
+#endif
+
+class PartitionFlash : public RawFlash {
+ public:
+  explicit PartitionFlash(const esp_partition_t* partition) : partition_(partition) {}
+
+  size_t size() const override { return partition_->size; }
+
+  bool read(uint32_t offset, void* out, size_t len) override {
+    return esp_partition_read(partition_, offset, out, len) == ESP_OK;
+  }
+
+  bool write(uint32_t offset, const void* data, size_t len) override {
+    return esp_partition_write(partition_, offset, data, len) == ESP_OK;
+  }
+
+  bool erase(uint32_t offset, size_t len) override {
+    return esp_partition_erase_range(partition_, offset, len) == ESP_OK;
+  }
+
+  const uint8_t* map(uint32_t offset, size_t len, uint32_t& handle) override {
+    const void* view = nullptr;
+    RawMmapHandle mmapHandle;
+    if (esp_partition_mmap(partition_, offset, len, RAW_MMAP_DATA, &view, &mmapHandle) != ESP_OK) {
+      return nullptr;
+    }
+    handle = mmapHandle;
+    return (const uint8_t*)view;
+  }
+
+  void unmap(uint32_t handle) override {
+    rawMunmap(handle);
+  }
+
+ private:
+  const esp_partition_t* partition_;
+};
+
+RawFlash* rawFlashOpen() {
+  static PartitionFlash* flash = nullptr;
+  if (flash == nullptr) {
+    const esp_partition_t* partition = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)RAW_PARTITION_SUBTYPE,
+        RAW_PARTITION_LABEL);
+    if (partition != nullptr) {
+      flash = new PartitionFlash(partition);
+    }
+  }
+  return flash;
+}
+#endif
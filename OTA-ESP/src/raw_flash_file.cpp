@@ -0,0 +1,104 @@
+// Prathik Narsetty
+// Raw image partition backed by a file, for Linux builds and tests
+//
+// The file stands in for the flash partition: it is mapped with mmap(2) so
+// map() hands out real pointers like esp_partition_mmap, and writes follow
+// NOR rules (they only clear bits) so a missing erase shows up as corrupt
+// data here just as it would on the device. Set RAW_FLASH_FILE to choose the
+// file; it is created erased with RAW_FLASH_FILE_SIZE bytes if missing.
+#if !defined(ESP_PLATFORM)
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "raw_partition.h"
+
+#ifndef RAW_FLASH_FILE_SIZE
+#define RAW_FLASH_FILE_SIZE (2 * 1024 * 1024)
+#endif
+
+class FileFlash : public RawFlash {
+ public:
+  bool open(const char* path) {
+    int fd = ::open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    bool fresh = fstat(fd, &st) == 0 && st.st_size == 0;
+    if (fresh && ftruncate(fd, RAW_FLASH_FILE_SIZE) != 0) {
+      ::close(fd);
+      return false;
+    }
+    size_ = fresh ? RAW_FLASH_FILE_SIZE : (size_t)st.st_size;
+    void* mem = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+      return false;
+    }
+    mem_ = (uint8_t*)mem;
+    if (fresh) {
+      memset(mem_, 0xFF, size_);
+    }
+    return true;
+  }
+
+  size_t size() const override { return size_; }
+
+  bool read(uint32_t offset, void* out, size_t len) override {
+    if (!inRange(offset, len)) {
+      return false;
+    }
+    memcpy(out, mem_ + offset, len);
+    return true;
+  }
+
+  bool write(uint32_t offset, const void* data, size_t len) override {
+    if (!inRange(offset, len)) {
+      return false;
+    }
+    const uint8_t* src = (const uint8_t*)data;
+    for (size_t i = 0; i < len; ++i) {
+      mem_[offset + i] &= src[i];
+    }
+    return true;
+  }
+
+  bool erase(uint32_t offset, size_t len) override {
+    if (!inRange(offset, len) || offset % RAW_SECTOR_SIZE != 0 || len % RAW_SECTOR_SIZE != 0) {
+      return false;
+    }
+    memset(mem_ + offset, 0xFF, len);
+    return true;
+  }
+
+  const uint8_t* map(uint32_t offset, size_t len, uint32_t& handle) override {
+    handle = 0;
+    return inRange(offset, len) ? mem_ + offset : nullptr;
+  }
+
+  void unmap(uint32_t handle) override {
+    (void)handle;
+  }
+
+ private:
+  bool inRange(uint32_t offset, size_t len) const {
+    return mem_ != nullptr && offset <= size_ && len <= size_ - offset;
+  }
+
+  uint8_t* mem_ = nullptr;
+  size_t size_ = 0;
+};
+
+RawFlash* rawFlashOpen() {
+  static FileFlash flash;
+  static bool opened = false;
+  if (!opened) {
+    const char* path = getenv("RAW_FLASH_FILE");
+    opened = flash.open(path != nullptr ? path : "raw_images.bin");
+  }
+  return opened ? &flash : nullptr;
+}
+#endif
@@ -0,0 +1,185 @@
+// Prathik Narsetty
+// Firmware image slots in a dedicated raw flash partition
+#include <Arduino.h>
+#include "raw_partition.h"
+#include "bsl_frames.h"
+#include "async_log.h"
+
+#define COPY_BLOCK 1024
+
+static RawFlash* rawFlash = nullptr;
+static RawPartitionHeader header;
+static bool headerValid = false;
+
+static uint32_t headerCrc(const RawPartitionHeader& h) {
+  return bslCrc32((const uint8_t*)&h, offsetof(RawPartitionHeader, crc));
+}
+
+// Region table for this partition size: equal regions after the headers
+static void layoutRegions(RawRegion* regions) {
+  size_t sectors = rawFlash->size() / RAW_SECTOR_SIZE - RAW_HEADER_SECTORS;
+  size_t perRegion = sectors / IMAGE_SLOT_COUNT;
+  for (int i = 0; i < IMAGE_SLOT_COUNT; ++i) {
+    regions[i].offset = (RAW_HEADER_SECTORS + i * perRegion) * RAW_SECTOR_SIZE;
+    regions[i].capacity = perRegion * RAW_SECTOR_SIZE;
+  }
+}
+
+// A version 1 header is converted; the next save writes version 2
+static bool readHeaderV1(int copy, RawPartitionHeader& out) {
+  RawPartitionHeaderV1 old;
+  if (!rawFlash->read(copy * RAW_SECTOR_SIZE, &old, sizeof(old)) || old.version != 1 ||
+      old.crc != bslCrc32((const uint8_t*)&old, offsetof(RawPartitionHeaderV1, crc))) {
+    return false;
+  }
+  out.magic = old.magic;
+  out.version = RAW_PARTITION_VERSION;
+  out.regionCount = old.regionCount;
+  out.sequence = old.sequence;
+  memcpy(out.regions, old.regions, sizeof(out.regions));
+  imageIndexUpgrade(old.index, out.index);
+  out.crc = headerCrc(out);
+  return true;
+}
+
+static bool readHeader(int copy, RawPartitionHeader& out, const RawRegion* layout) {
+  if (!rawFlash->read(copy * RAW_SECTOR_SIZE, &out, sizeof(out))) {
+    return false;
+  }
+  if (out.magic == RAW_PARTITION_MAGIC && out.version == 1 && !readHeaderV1(copy, out)) {
+    return false;
+  }
+  return out.magic == RAW_PARTITION_MAGIC && out.version == RAW_PARTITION_VERSION &&
+         out.regionCount == IMAGE_SLOT_COUNT && out.crc == headerCrc(out) &&
+         memcmp(out.regions, layout, sizeof(out.regions)) == 0;
+}
+
+bool rawPartitionBegin(RawFlash* flash) {
+  rawFlash = flash;
+  headerValid = false;
+  if (rawFlash == nullptr) {
+    LOGE("No '%s' partition for images", RAW_PARTITION_LABEL);
+    return false;
+  }
+  if (rawFlash->size() < (RAW_HEADER_SECTORS + IMAGE_SLOT_COUNT) * RAW_SECTOR_SIZE) {
+    LOGE("Image partition too small");
+    rawFlash = nullptr;
+    return false;
+  }
+
+  RawRegion layout[IMAGE_SLOT_COUNT];
+  layoutRegions(layout);
+
+  // Use the newest valid copy; a region table that no longer matches the
+  // partition size means the partition was resized, so start over
+  RawPartitionHeader copy;
+  for (int i = 0; i < RAW_HEADER_SECTORS; ++i) {
+    if (readHeader(i, copy, layout) && (!headerValid || copy.sequence > header.sequence)) {
+      header = copy;
+      headerValid = true;
+    }
+  }
+
+  if (!headerValid) {
+    memset(&header, 0, sizeof(header));
+    header.magic = RAW_PARTITION_MAGIC;
+    header.version = RAW_PARTITION_VERSION;
+    header.regionCount = IMAGE_SLOT_COUNT;
+    memcpy(header.regions, layout, sizeof(header.regions));
+  }
+  LOGI("Image partition: %u regions of %u bytes", IMAGE_SLOT_COUNT, layout[0].capacity);
+  return true;
+}
+
+bool rawPartitionLoadIndex(ImageIndex& index) {
+  if (rawFlash == nullptr || !headerValid) {
+    return false;
+  }
+  index = header.index;
+  return true;
+}
+
+bool rawPartitionSaveIndex(const ImageIndex& index) {
+  if (rawFlash == nullptr) {
+    return false;
+  }
+  header.index = index;
+  header.sequence++;
+  header.crc = headerCrc(header);
+
+  // Overwrite the older copy; the other one stays valid until this succeeds
+  uint32_t offset = (header.sequence % RAW_HEADER_SECTORS) * RAW_SECTOR_SIZE;
+  if (!rawFlash->erase(offset, RAW_SECTOR_SIZE) ||
+      !rawFlash->write(offset, &header, sizeof(header))) {
+    LOGE("Failed to write image partition header");
+    return false;
+  }
+  headerValid = true;
+  return true;
+}
+
+size_t rawPartitionCapacity(int slot) {
+  return rawFlash != nullptr ? header.regions[slot].capacity : 0;
+}
+
+bool rawPartitionWriteRegion(int slot, File& src, uint32_t imageSize, uint32_t& crc,
+                             uint8_t* sha256) {
+  static uint8_t block[COPY_BLOCK];
+  const RawRegion& region = header.regions[slot];
+  uint32_t size = src.size();
+  if (rawFlash == nullptr || size == 0 || size > region.capacity || imageSize > size) {
+    LOGE("Image of %u bytes does not fit region %d", size, slot);
+    return false;
+  }
+
+  uint32_t eraseLen = (size + RAW_SECTOR_SIZE - 1) / RAW_SECTOR_SIZE * RAW_SECTOR_SIZE;
+  if (!rawFlash->erase(region.offset, eraseLen)) {
+    return false;
+  }
+  uint32_t written = 0;
+  uint32_t srcCrc = 0xFFFFFFFF;
+  size_t n;
+  while (written < size && (n = src.read(block, sizeof(block))) > 0) {
+    if (!rawFlash->write(region.offset + written, block, n)) {
+      return false;
+    }
+    srcCrc = bslCrc32(block, n, srcCrc);
+    written += n;
+  }
+  if (written != size) {
+    return false;
+  }
+
+  // Check what the programmer will actually read against the source; the
+  // image's CRC and digest leave out a signature trailer after it
+  uint32_t handle;
+  const uint8_t* view = rawFlash->map(region.offset, size, handle);
+  if (view == nullptr) {
+    return false;
+  }
+  uint32_t viewCrc = bslCrc32(view, imageSize);
+  crc = ~viewCrc;
+  Sha256 sha;
+  sha.update(view, imageSize);
+  sha.finish(sha256);
+  viewCrc = bslCrc32(view + imageSize, size - imageSize, viewCrc);
+  rawFlash->unmap(handle);
+  if (viewCrc != srcCrc) {
+    LOGE("Region %d read back does not match the written image", slot);
+    return false;
+  }
+  return true;
+}
+
+const uint8_t* rawPartitionMap(int slot, size_t len, uint32_t& handle) {
+  if (rawFlash == nullptr || len > header.regions[slot].capacity) {
+    return nullptr;
+  }
+  return rawFlash->map(header.regions[slot].offset, len, handle);
+}
+
+void rawPartitionUnmap(uint32_t handle) {
+  if (rawFlash != nullptr) {
+    rawFlash->unmap(handle);
+  }
+}
@@ -0,0 +1,140 @@
+// Prathik Narsetty
+// Incremental SHA-256 of firmware images
+#include <string.h>
+#include "sha256.h"
+
+#if defined(ESP_PLATFORM)
+#include <esp_idf_version.h>
+
+// mbedTLS 3 (IDF 5) dropped the _ret suffixes
+#if ESP_IDF_VERSION_MAJOR >= 5
+#define sha256Starts mbedtls_sha256_starts
+#define sha256Update mbedtls_sha256_update
+#define sha256Finish mbedtls_sha256_finish
+#else
+#define sha256Starts mbedtls_sha256_starts_ret
+#define sha256Update mbedtls_sha256_update_ret
+#define sha256Finish mbedtls_sha256_finish_ret
+#endif
+
+Sha256::~Sha256() {
+  if (started_) {
+    mbedtls_sha256_free(&ctx_);
+  }
+}
+
+void Sha256::begin() {
+  if (started_) {
+    mbedtls_sha256_free(&ctx_);
+  }
+  mbedtls_sha256_init(&ctx_);
+  sha256Starts(&ctx_, 0);
+  started_ = true;
+}
+
+void Sha256::update(const uint8_t* data, size_t len) {
+  sha256Update(&ctx_, data, len);
+}
+
+void Sha256::finish(uint8_t digest[SHA256_BYTES]) {
+  sha256Finish(&ctx_, digest);
+}
+
+#else
+
+static const uint32_t K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline uint32_t rotr(uint32_t x, int n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+Sha256::~Sha256() {}
+
+void Sha256::begin() {
+  static const uint32_t H0[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+  };
+  memcpy(state_, H0, sizeof(state_));
+  length_ = 0;
+  fill_ = 0;
+}
+
+void Sha256::block(const uint8_t* data) {
+  uint32_t w[64];
+  for (int i = 0; i < 16; i++) {
+    w[i] = (uint32_t)data[4 * i] << 24 | data[4 * i + 1] << 16 | data[4 * i + 2] << 8 |
+           data[4 * i + 3];
+  }
+  for (int i = 16; i < 64; i++) {
+    uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+  uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+  for (int i = 0; i < 64; i++) {
+    uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+    uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  state_[0] += a;
+  state_[1] += b;
+  state_[2] += c;
+  state_[3] += d;
+  state_[4] += e;
+  state_[5] += f;
+  state_[6] += g;
+  state_[7] += h;
+}
+
+void Sha256::update(const uint8_t* data, size_t len) {
+  length_ += len;
+  while (len > 0) {
+    size_t n = sizeof(buffer_) - fill_;
+    if (n > len) {
+      n = len;
+    }
+    memcpy(buffer_ + fill_, data, n);
+    fill_ += n;
+    data += n;
+    len -= n;
+    if (fill_ == sizeof(buffer_)) {
+      block(buffer_);
+      fill_ = 0;
+    }
+  }
+}
+
+void Sha256::finish(uint8_t digest[SHA256_BYTES]) {
+  uint64_t bits = length_ * 8;
+  uint8_t pad[72] = {0x80};
+  size_t padLen = (fill_ < 56 ? 56 : 120) - fill_;
+  for (int i = 0; i < 8; i++) {
+    pad[padLen + i] = (uint8_t)(bits >> (56 - 8 * i));
+  }
+  update(pad, padLen + 8);
+  for (int i = 0; i < 8; i++) {
+    digest[4 * i] = state_[i] >> 24;
+    digest[4 * i + 1] = state_[i] >> 16;
+    digest[4 * i + 2] = state_[i] >> 8;
+    digest[4 * i + 3] = state_[i];
+  }
+}
+
+#endif
@@ -0,0 +1,68 @@
+// Prathik Narsetty
+// SPI link to the MSPM0 BSL, as a BslTransport
+#include <Arduino.h>
+#include <string.h>
+#include "spi_transport.h"
+
+void SpiTransport::begin() {
+  pinMode(cs_, OUTPUT);
+  digitalWrite(cs_, HIGH);
+  SPI.begin(sck_, poci_, pico_, cs_);
+}
+
+void SpiTransport::select() {
+  SPI.beginTransaction(settings_);
+  digitalWrite(cs_, LOW);
+}
+
+void SpiTransport::deselect() {
+  digitalWrite(cs_, HIGH);
+  SPI.endTransaction();
+}
+
+bool SpiTransport::write(const uint8_t* data, size_t len) {
+  select();
+  SPI.writeBytes(data, len);
+  deselect();
+  return true;
+}
+
+size_t SpiTransport::read(uint8_t* buf, size_t len, uint32_t timeoutMs) {
+  (void)timeoutMs;  // the bytes are there as soon as they are clocked
+  if (len == 0) {
+    return 0;
+  }
+  memset(buf, SPI_FILL_BYTE, len);
+  select();
+  SPI.transfer(buf, len);
+  deselect();
+  return len;
+}
+
+// Poll with single fill bytes until the reply starts, then read the rest
+size_t SpiTransport::readStart(uint8_t* buf, size_t len, uint32_t timeoutMs) {
+  if (len == 0) {
+    return 0;
+  }
+  uint32_t start = ::millis();
+  for (;;) {
+    select();
+    uint8_t first = SPI.transfer(SPI_FILL_BYTE);
+    deselect();
+    if (first != SPI_FILL_BYTE) {
+      buf[0] = first;
+      break;
+    }
+    if (::millis() - start >= timeoutMs) {
+      return 0;
+    }
+    delayMicroseconds(SPI_POLL_GAP_US);
+  }
+  return 1 + read(buf + 1, len - 1, timeoutMs);
+}
+
+// Only the default clock is used; the BSL has no speed change over SPI
+bool SpiTransport::setBaudRate(uint32_t baud) {
+  (void)baud;
+  return false;
+}
@@ -0,0 +1,92 @@
+// Prathik Narsetty
+// Filesystem backend for firmware images, selected per build
+#include <Arduino.h>
+#include "storage.h"
+
+#define BENCH_PATH         "/bench.bin"
+#define BENCH_MISSING_PATH "/bench.missing"
+#define BENCH_FILE_BYTES   (64 * 1024)
+#define BENCH_ITERATIONS   50
+
+bool storageBegin() {
+  return STORAGE_FS.begin(true);
+}
+
+size_t storageTotalBytes() {
+  return STORAGE_FS.totalBytes();
+}
+
+size_t storageUsedBytes() {
+  return STORAGE_FS.usedBytes();
+}
+
+static uint32_t kibPerSecond(uint32_t bytes, uint32_t us) {
+  return us == 0 ? 0 : (uint32_t)((uint64_t)bytes * 1000000 / 1024 / us);
+}
+
+void storageBenchmark(Print& out) {
+  static uint8_t block[4096];
+  fs::FS& fs = storageFs();
+
+  out.printf("=== %s benchmark: %u/%u bytes used ===\n", STORAGE_NAME,
+             (unsigned)storageUsedBytes(), (unsigned)storageTotalBytes());
+
+  // Write the test file
+  for (size_t i = 0; i < sizeof(block); ++i) {
+    block[i] = (uint8_t)i;
+  }
+  unsigned long start = micros();
+  File file = fs.open(BENCH_PATH, FILE_WRITE);
+  if (!file) {
+    out.println("Cannot create benchmark file");
+    return;
+  }
+  size_t written = 0;
+  while (written < BENCH_FILE_BYTES) {
+    size_t n = file.write(block, sizeof(block));
+    if (n == 0) {
+      break;
+    }
+    written += n;
+  }
+  file.close();
+  uint32_t elapsed = micros() - start;
+  out.printf("write          %6u KiB/s (%u bytes)\n", kibPerSecond(written, elapsed),
+             (unsigned)written);
+
+  // Sequential read with the programmer's block size and larger ones
+  static const size_t READ_SIZES[] = { 128, 1024, 4096 };
+  for (size_t size : READ_SIZES) {
+    start = micros();
+    file = fs.open(BENCH_PATH, FILE_READ);
+    size_t total = 0;
+    size_t n;
+    while ((n = file.read(block, size)) > 0) {
+      total += n;
+    }
+    file.close();
+    elapsed = micros() - start;
+    out.printf("read %4u B    %6u KiB/s\n", (unsigned)size, kibPerSecond(total, elapsed));
+  }
+
+  start = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; ++i) {
+    file = fs.open(BENCH_PATH, FILE_READ);
+    file.close();
+  }
+  out.printf("open+close     %6u us\n", (unsigned)((micros() - start) / BENCH_ITERATIONS));
+
+  start = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; ++i) {
+    fs.exists(BENCH_PATH);
+  }
+  out.printf("exists (hit)   %6u us\n", (unsigned)((micros() - start) / BENCH_ITERATIONS));
+
+  start = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; ++i) {
+    fs.exists(BENCH_MISSING_PATH);
+  }
+  out.printf("exists (miss)  %6u us\n", (unsigned)((micros() - start) / BENCH_ITERATIONS));
+
+  fs.remove(BENCH_PATH);
+}
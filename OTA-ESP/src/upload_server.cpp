@@ -0,0 +1,535 @@
+// Prathik Narsetty
+// HTTP endpoints for firmware upload, status and trace export
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WebServer.h>
+#include <ArduinoJson.h>
+#include "upload_server.h"
+#include "gateway.h"
+#include "image_source.h"
+#include "chunked_upload.h"
+#include "delta_patch.h"
+#include "image_signature.h"
+#include "image_store.h"
+#include "storage.h"
+#include "async_log.h"
+#include "bsl_trace.h"
+
+#ifdef WIFI_SSID
+
+#ifndef WIFI_PASSWORD
+#define WIFI_PASSWORD ""
+#endif
+
+#define WIFI_CONNECT_TIMEOUT_MS 10000
+#define UPLOAD_TEMP_PATH "/upload.tmp"
+#define STREAM_BUFFER_BYTES 4096  // Upload bytes buffered ahead of the programmer
+#define MISSING_RANGES_MAX 32      // Ranges listed per missing-ranges report
+
+static WebServer server(80);
+static bool serverActive = false;
+
+// State of the upload in progress
+static File uploadFile;
+static StreamImageSource uploadStream;
+static bool uploadStreaming = false;
+static bool uploadOk = false;
+static size_t uploadBytes = 0;
+static int uploadSlot = -1;
+
+// Delta upload: the new image is rebuilt into UPLOAD_TEMP_PATH while the
+// patch arrives, from the stored image the patch was made against
+class UploadDeltaTarget : public DeltaTarget {
+ public:
+  const uint8_t* base(uint32_t size, uint32_t crc) override;
+  bool write(const uint8_t* data, size_t len) override {
+    return uploadFile && uploadFile.write(data, len) == len;
+  }
+  void release();
+
+ private:
+  StoredImage stored_;
+  uint8_t* copy_ = nullptr;
+};
+
+static UploadDeltaTarget deltaTarget;
+static DeltaPatcher delta(deltaTarget);
+static DeltaStatus deltaStatus = DELTA_OK;
+
+// Resumable chunked upload
+static ChunkedUpload chunked(storageFs());
+static uint8_t chunkBuffer[UPLOAD_CHUNK_MAX];
+static size_t chunkLength = 0;
+static bool chunkOverflow = false;
+
+// firmwareStored() failed: refused for its signature, or out of space
+static void sendStoreFailed(int slot) {
+  if (slot == IMAGE_STORE_REJECTED) {
+    server.send(403, "text/plain", "image is not signed with the gateway's key\n");
+  } else {
+    server.send(507, "text/plain", "failed to store image\n");
+  }
+}
+
+static void handleUploadBody() {
+  HTTPRaw& raw = server.raw();
+
+  switch (raw.status) {
+    case RAW_START: {
+      size_t expected = server.clientContentLength();
+      uploadOk = false;
+      uploadStreaming = false;
+      uploadBytes = 0;
+      uploadSlot = -1;
+      storageFs().remove(UPLOAD_TEMP_PATH);
+      uploadFile = storageFs().open(UPLOAD_TEMP_PATH, FILE_WRITE);
+
+      if (server.arg("mode") == "cut-through") {
+        if (imageSigningRequired()) {
+          // The signature comes last, after a cut-through session sent the image
+          LOGW("Cut-through unavailable with image signing, storing upload only");
+        } else if (!programmingInProgress && !programmingRequested &&
+                   uploadStream.begin(STREAM_BUFFER_BYTES, expected) &&
+                   requestStreamingSession(&uploadStream)) {
+          uploadStreaming = true;
+        } else {
+          LOGW("Cut-through unavailable (session busy), storing upload only");
+        }
+      }
+      LOGI("Upload started: %u bytes, cut-through=%u", expected, uploadStreaming);
+      break;
+    }
+
+    case RAW_WRITE:
+      // Persist first, then hand the same bytes to the programmer. push()
+      // blocks while the programmer is behind, so the socket is not read
+      // and TCP throttles the client.
+      if (uploadFile && uploadFile.write(raw.buf, raw.currentSize) == raw.currentSize) {
+        uploadBytes += raw.currentSize;
+      } else if (uploadFile) {
+        LOGE("Upload write failed (storage full?)");
+        uploadFile.close();
+      }
+      if (uploadStreaming) {
+        uploadStream.push(raw.buf, raw.currentSize);
+      }
+      break;
+
+    case RAW_END:
+      if (uploadFile) {
+        uploadFile.close();
+        uploadOk = uploadBytes > 0 && uploadBytes == raw.totalSize;
+      }
+      LOGI("Upload finished: %u bytes, complete=%u", raw.totalSize, uploadOk);
+      // The cut-through session is programming this image, so it becomes
+      // active right away. finish() only after that, so verification reads it.
+      if (uploadStreaming) {
+        if (uploadOk) {
+          uploadSlot = imageStoreAdd(UPLOAD_TEMP_PATH);
+          uploadOk = uploadSlot >= 0 && imageStoreActivate(uploadSlot);
+        }
+        if (uploadOk) {
+          uploadStream.finish();
+        } else {
+          uploadStream.abort();
+        }
+      }
+      break;
+
+    case RAW_ABORTED:
+      LOGE("Upload aborted after %u bytes", uploadBytes);
+      uploadFile.close();
+      storageFs().remove(UPLOAD_TEMP_PATH);
+      uploadOk = false;
+      if (uploadStreaming) {
+        uploadStream.abort();
+      }
+      break;
+  }
+}
+
+static void handleUploadDone() {
+  if (!uploadOk) {
+    storageFs().remove(UPLOAD_TEMP_PATH);
+    server.send(500, "text/plain", "upload failed\n");
+    return;
+  }
+
+  // A cut-through session is already programming; otherwise store the image
+  // in an inactive slot and, unless staging only, program it now
+  if (!uploadStreaming) {
+    uploadSlot = firmwareStored(UPLOAD_TEMP_PATH, server.arg("program") != "0");
+    if (uploadSlot < 0) {
+      sendStoreFailed(uploadSlot);
+      return;
+    }
+  }
+
+  StaticJsonDocument<128> doc;
+  doc["bytes"] = uploadBytes;
+  doc["slot"] = uploadSlot;
+  doc["mode"] = uploadStreaming ? "cut-through" : "store";
+  String body;
+  serializeJson(doc, body);
+  server.send(202, "application/json", body);
+}
+
+// A mapped slot is used in place; otherwise the image is copied into RAM,
+// since records read the old image at any offset
+const uint8_t* UploadDeltaTarget::base(uint32_t size, uint32_t crc) {
+  int slot = imageStoreFind(size, crc);
+  if (slot < 0 || !stored_.open(slot)) {
+    LOGE("Delta base image (%u bytes, crc %08X) is not stored here", size, crc);
+    return nullptr;
+  }
+  if (stored_.mapped() != nullptr) {
+    return stored_.mapped();
+  }
+  copy_ = (uint8_t*)ps_malloc(size);
+  if (copy_ == nullptr) {
+    copy_ = (uint8_t*)malloc(size);
+  }
+  if (copy_ == nullptr || stored_.read(copy_, size) != (int)size) {
+    LOGE("Cannot load delta base image from slot %d", slot);
+    release();
+    return nullptr;
+  }
+  LOGI("Applying delta to image #%u in slot %d", imageStoreSlot(slot).sequence, slot);
+  return copy_;
+}
+
+void UploadDeltaTarget::release() {
+  free(copy_);
+  copy_ = nullptr;
+  stored_.close();
+}
+
+static void handleDeltaBody() {
+  HTTPRaw& raw = server.raw();
+
+  switch (raw.status) {
+    case RAW_START:
+      uploadOk = false;
+      uploadBytes = 0;
+      storageFs().remove(UPLOAD_TEMP_PATH);
+      uploadFile = storageFs().open(UPLOAD_TEMP_PATH, FILE_WRITE);
+      delta.begin();
+      deltaStatus = uploadFile ? DELTA_OK : DELTA_WRITE_FAILED;
+      LOGI("Delta upload started: %u bytes", server.clientContentLength());
+      break;
+
+    case RAW_WRITE:
+      uploadBytes += raw.currentSize;
+      if (deltaStatus == DELTA_OK) {
+        deltaStatus = delta.feed(raw.buf, raw.currentSize);
+      }
+      break;
+
+    case RAW_END:
+      if (deltaStatus == DELTA_OK) {
+        deltaStatus = delta.finish();
+      }
+      uploadFile.close();
+      deltaTarget.release();
+      uploadOk = deltaStatus == DELTA_OK && uploadBytes == raw.totalSize;
+      LOGI("Delta upload finished: %u-byte patch, %u-byte image, %s", uploadBytes,
+           delta.produced(), deltaStatusName(deltaStatus));
+      break;
+
+    case RAW_ABORTED:
+      LOGE("Delta upload aborted after %u bytes", uploadBytes);
+      uploadFile.close();
+      deltaTarget.release();
+      storageFs().remove(UPLOAD_TEMP_PATH);
+      uploadOk = false;
+      deltaStatus = DELTA_TRUNCATED;
+      break;
+  }
+}
+
+static void handleDeltaDone() {
+  if (!uploadOk) {
+    storageFs().remove(UPLOAD_TEMP_PATH);
+    int code = deltaStatus == DELTA_NO_BASE ? 409 : deltaStatus == DELTA_WRITE_FAILED ? 507 : 422;
+    StaticJsonDocument<64> doc;
+    doc["result"] = deltaStatusName(deltaStatus);
+    String body;
+    serializeJson(doc, body);
+    server.send(code, "application/json", body);
+    return;
+  }
+
+  int slot = firmwareStored(UPLOAD_TEMP_PATH, server.arg("program") != "0");
+  if (slot < 0) {
+    sendStoreFailed(slot);
+    return;
+  }
+  StaticJsonDocument<128> doc;
+  doc["bytes"] = uploadBytes;
+  doc["size"] = delta.produced();
+  doc["slot"] = slot;
+  doc["mode"] = "delta";
+  String body;
+  serializeJson(doc, body);
+  server.send(202, "application/json", body);
+}
+
+static uint32_t argHex(const char* name) {
+  return strtoul(server.arg(name).c_str(), nullptr, 16);
+}
+
+static bool addMissingRange(uint32_t start, uint32_t end, void* ctx) {
+  JsonArray& ranges = *static_cast<JsonArray*>(ctx);
+  JsonArray range = ranges.createNestedArray();
+  range.add(start);
+  range.add(end);
+  return ranges.size() < MISSING_RANGES_MAX;
+}
+
+// Session state plus the byte ranges the client still has to send
+static void sendChunkedState(int code, const char* result) {
+  StaticJsonDocument<1024> doc;
+  doc["result"] = result;
+  doc["active"] = chunked.active();
+  doc["size"] = chunked.totalSize();
+  doc["chunk"] = chunked.chunkSize();
+  doc["received"] = chunked.bytesReceived();
+  doc["complete"] = chunked.complete();
+  JsonArray missing = doc.createNestedArray("missing");
+  chunked.forEachMissing(addMissingRange, &missing);
+  String body;
+  serializeJson(doc, body);
+  server.send(code, "application/json", body);
+}
+
+static void handleChunkedBegin() {
+  uint32_t size = server.arg("size").toInt();
+  uint32_t chunk = server.arg("chunk").toInt();
+  // Chunks are received whole into chunkBuffer; check before the 16-bit begin()
+  if (chunk == 0 || chunk > sizeof(chunkBuffer) || !server.hasArg("crc") ||
+      !chunked.begin(size, (uint16_t)chunk, argHex("crc"))) {
+    server.send(400, "text/plain", "bad size, chunk or crc\n");
+    return;
+  }
+  sendChunkedState(200, "ok");
+}
+
+static void handleChunkBody() {
+  HTTPRaw& raw = server.raw();
+  switch (raw.status) {
+    case RAW_START:
+      chunkLength = 0;
+      chunkOverflow = false;
+      break;
+    case RAW_WRITE:
+      if (chunkLength + raw.currentSize > sizeof(chunkBuffer)) {
+        chunkOverflow = true;
+      } else {
+        memcpy(chunkBuffer + chunkLength, raw.buf, raw.currentSize);
+        chunkLength += raw.currentSize;
+      }
+      break;
+    case RAW_END:
+      break;
+    case RAW_ABORTED:
+      chunkOverflow = true;
+      break;
+  }
+}
+
+static void handleChunk() {
+  if (chunkOverflow || !server.hasArg("offset") || !server.hasArg("crc")) {
+    server.send(400, "text/plain", "bad chunk request\n");
+    return;
+  }
+  ChunkResult result = chunked.writeChunk(server.arg("offset").toInt(), chunkBuffer,
+                                          chunkLength, argHex("crc"));
+  static const char* const RESULT_NAMES[] = {
+    "ok", "duplicate", "no-session", "bad-offset", "bad-length", "bad-crc", "write-failed"
+  };
+  int code = result == CHUNK_OK || result == CHUNK_DUPLICATE ? 200
+           : result == CHUNK_WRITE_FAILED ? 507
+           : result == CHUNK_NO_SESSION ? 409 : 422;
+
+  // Keep the per-chunk reply small; clients fetch /upload/missing when needed
+  StaticJsonDocument<128> doc;
+  doc["result"] = RESULT_NAMES[result];
+  doc["received"] = chunked.bytesReceived();
+  doc["complete"] = chunked.complete();
+  String body;
+  serializeJson(doc, body);
+  server.send(code, "application/json", body);
+}
+
+static void handleChunkedMissing() {
+  sendChunkedState(200, "ok");
+}
+
+static void handleChunkedCommit() {
+  if (programmingInProgress || programmingRequested) {
+    server.send(409, "text/plain", "programming in progress\n");
+    return;
+  }
+  if (!chunked.complete()) {
+    sendChunkedState(409, "incomplete");
+    return;
+  }
+  if (!chunked.commit(UPLOAD_TEMP_PATH)) {
+    sendChunkedState(422, "image-crc-mismatch");
+    return;
+  }
+  int slot = firmwareStored(UPLOAD_TEMP_PATH, server.arg("program") != "0");
+  if (slot < 0) {
+    sendStoreFailed(slot);
+    return;
+  }
+  StaticJsonDocument<64> doc;
+  doc["result"] = "committed";
+  doc["slot"] = slot;
+  String body;
+  serializeJson(doc, body);
+  server.send(202, "application/json", body);
+}
+
+static void handleChunkedCancel() {
+  chunked.cancel();
+  server.send(200, "application/json", "{\"result\":\"cancelled\"}");
+}
+
+static void handleActivate(int slot) {
+  bool program = server.arg("program") != "0";
+  if (slot < 0 || !requestActivation(slot, program)) {
+    server.send(409, "text/plain", "no such image, or programming in progress\n");
+    return;
+  }
+  StaticJsonDocument<64> doc;
+  doc["activating"] = slot;
+  doc["program"] = program;
+  String body;
+  serializeJson(doc, body);
+  server.send(202, "application/json", body);
+}
+
+static void handleImagesActivate() {
+  handleActivate(server.hasArg("slot") ? server.arg("slot").toInt() : -1);
+}
+
+static void handleImagesRollback() {
+  handleActivate(imageStoreRollbackSlot());
+}
+
+static void handleStatus() {
+  StaticJsonDocument<1024> doc;
+  doc["programming"] = (bool)programmingInProgress;
+  doc["queued"] = (bool)programmingRequested;
+  SessionProgress progress = sessionProgress();
+  if (progress.phase != 0) {
+    doc["phase"] = tracePhaseName(progress.phase);
+    doc["done"] = progress.done;
+    doc["total"] = progress.total;
+  }
+  doc["activeSlot"] = imageStoreActiveSlot();
+  JsonArray slots = doc.createNestedArray("slots");
+  for (int i = 0; i < IMAGE_SLOT_COUNT; ++i) {
+    const ImageSlotInfo& info = imageStoreSlot(i);
+    JsonObject slot = slots.createNestedObject();
+    slot["state"] = imageSlotStateName(info.state);
+    slot["sequence"] = info.sequence;
+    slot["size"] = info.size;
+    slot["crc"] = info.crc;
+    slot["signed"] = (info.flags & SLOT_SIGNED) != 0;
+    const uint8_t* digest = imageStoreDigest(i);
+    if (digest != nullptr) {
+      char hex[2 * SHA256_BYTES + 1];
+      for (int b = 0; b < SHA256_BYTES; ++b) {
+        snprintf(&hex[2 * b], 3, "%02x", digest[b]);
+      }
+      slot["sha256"] = String(hex);
+    }
+  }
+  doc["lastResult"] = lastSessionResult == SESSION_OK ? "ok"
+                    : lastSessionResult == SESSION_SKIPPED ? "skipped"
+                    : lastSessionResult == SESSION_FAILED ? "failed"
+                    : lastSessionResult == SESSION_CANCELLED ? "cancelled" : "none";
+  String body;
+  serializeJson(doc, body);
+  server.send(200, "application/json", body);
+}
+
+static void handleCancel() {
+  if (!cancelSession()) {
+    server.send(409, "text/plain", "no session running\n");
+    return;
+  }
+  server.send(202, "application/json", "{\"result\":\"cancelling\"}");
+}
+
+static void handleTrace() {
+  static uint8_t snapshot[sizeof(TraceHeader) + TRACE_CAPACITY * sizeof(TraceRecord)];
+  size_t len = traceExport(snapshot, sizeof(snapshot));
+  server.setContentLength(len);
+  server.send(200, "application/octet-stream", "");
+  server.sendContent((const char*)snapshot, len);
+}
+
+bool setupUploadServer() {
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+  unsigned long start = millis();
+  while (WiFi.status() != WL_CONNECTED && millis() - start < WIFI_CONNECT_TIMEOUT_MS) {
+    delay(100);
+  }
+  if (WiFi.status() != WL_CONNECTED) {
+    LOGE("WiFi connection failed, upload server disabled");
+    return false;
+  }
+  // Modem sleep keeps the association while idle
+  WiFi.setSleep(true);
+
+  // Pick up an upload interrupted by a reset
+  chunked.restore();
+
+  IPAddress ip = WiFi.localIP();
+  LOGI("Upload server at http://%u.%u.%u.%u/", ip[0], ip[1], ip[2], ip[3]);
+
+  server.on("/upload", HTTP_POST, handleUploadDone, handleUploadBody);
+  server.on("/upload/delta", HTTP_POST, handleDeltaDone, handleDeltaBody);
+  server.on("/upload/begin", HTTP_POST, handleChunkedBegin);
+  server.on("/upload/chunk", HTTP_PUT, handleChunk, handleChunkBody);
+  server.on("/upload/missing", HTTP_GET, handleChunkedMissing);
+  server.on("/upload/commit", HTTP_POST, handleChunkedCommit);
+  server.on("/upload/cancel", HTTP_POST, handleChunkedCancel);
+  server.on("/images/activate", HTTP_POST, handleImagesActivate);
+  server.on("/images/rollback", HTTP_POST, handleImagesRollback);
+  server.on("/status", HTTP_GET, handleStatus);
+  server.on("/cancel", HTTP_POST, handleCancel);
+  server.on("/trace", HTTP_GET, handleTrace);
+  server.begin();
+  serverActive = true;
+  return true;
+}
+
+void handleUploadServer() {
+  if (serverActive) {
+    server.handleClient();
+  }
+}
+
+bool uploadServerActive() {
+  return serverActive;
+}
+
+#else  // no WiFi credentials: the server stays off
+
+bool setupUploadServer() {
+  return false;
+}
+
+void handleUploadServer() {
+}
+
+bool uploadServerActive() {
+  return false;
+}
+
+#endif
@@ -0,0 +1,39 @@
+// Prathik Narsetty
+// Assertions for the host unit tests
+//
+// CHECK() and CHECK_EQ() report a failed condition with its location and
+// carry on, so one run lists every failure; main() ends with
+// `return checkResult("name");`, which fails the test if any check did.
+#pragma once
+
+#include <stdio.h>
+
+static int checkFailures = 0;
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      checkFailures++;                                                         \
+    }                                                                          \
+  } while (0)
+
+#define CHECK_EQ(actual, expected)                                             \
+  do {                                                                         \
+    long long actualValue = (long long)(actual);                               \
+    long long expectedValue = (long long)(expected);                           \
+    if (actualValue != expectedValue) {                                        \
+      fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, \
+              #actual, actualValue, expectedValue);                            \
+      checkFailures++;                                                         \
+    }                                                                          \
+  } while (0)
+
+static inline int checkResult(const char* name) {
+  if (checkFailures > 0) {
+    fprintf(stderr, "%s: %d checks failed\n", name, checkFailures);
+    return 1;
+  }
+  printf("%s: all checks passed\n", name);
+  return 0;
+}
@@ -0,0 +1,74 @@
+// Prathik Narsetty
+// Async log: logFlush() racing the drain task keeps every line whole
+//
+// Console output goes to the file given as argv[1] for the run and is read
+// back. Every record must come out as one line of its own, none twice.
+#include <Arduino.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <fstream>
+#include <regex>
+#include <set>
+#include <string>
+#include <thread>
+#include "async_log.h"
+#include "check.h"
+
+#define WRITERS 2
+#define RECORDS_PER_WRITER 10000
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: test_async_log FILE\n");
+    return 2;
+  }
+  int console = dup(STDOUT_FILENO);
+  int out = open(argv[1], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  CHECK(console >= 0 && out >= 0);
+  dup2(out, STDOUT_FILENO);
+
+  logBegin();
+  std::atomic<int> running(WRITERS);
+  std::thread writers[WRITERS];
+  for (int w = 0; w < WRITERS; ++w) {
+    writers[w] = std::thread([w, &running] {
+      for (int i = 0; i < RECORDS_PER_WRITER; ++i) {
+        LOGI("writer %d record %d of a line long enough to be split", w, i);
+        if (i % 8 == 0) {
+          std::this_thread::yield();
+        }
+      }
+      running--;
+    });
+  }
+  // Flushes as around light sleep, while the drain task is busy
+  while (running > 0) {
+    logFlush();
+  }
+  for (std::thread& writer : writers) {
+    writer.join();
+  }
+  logFlush();
+  dup2(console, STDOUT_FILENO);
+
+  std::ifstream log(argv[1]);
+  std::regex recordLine("\\[ *\\d+\\] I writer (\\d) record (\\d+) of a line long enough to be split\r");
+  std::regex dropLine("\\[log\\] \\d+ records dropped \\(ring full\\)\r?");
+  std::set<std::string> seen;
+  std::string line;
+  int bad = 0;
+  while (std::getline(log, line)) {
+    std::smatch match;
+    if (std::regex_match(line, match, recordLine)) {
+      CHECK(seen.insert(match[1].str() + "/" + match[2].str()).second);
+    } else if (!std::regex_match(line, dropLine)) {
+      if (bad++ < 5) {
+        fprintf(stderr, "broken line: %s\n", line.c_str());
+      }
+    }
+  }
+  CHECK_EQ(bad, 0);
+  CHECK_EQ(seen.size() + logDroppedCount(), WRITERS * RECORDS_PER_WRITER);
+  return checkResult("test_async_log");
+}
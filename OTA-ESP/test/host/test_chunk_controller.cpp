@@ -0,0 +1,134 @@
+// Prathik Narsetty
+// Chunk controller: growth, cut-back and goodput; bit errors from
+// FaultTransport
+#include <string.h>
+#include "check.h"
+#include "chunk_controller.h"
+#include "fault_transport.h"
+
+#define GRANULE 8
+
+// Keeps the bytes written last and answers reads with a fixed pattern
+class MemoryTransport : public BslTransport {
+ public:
+  bool write(const uint8_t* data, size_t len) override {
+    memcpy(written + writtenLength, data, len);
+    writtenLength += len;
+    return true;
+  }
+  size_t read(uint8_t* buf, size_t len, uint32_t timeoutMs) override {
+    (void)timeoutMs;
+    memset(buf, 0x5A, len);
+    return len;
+  }
+  void discardInput() override {}
+  bool setBaudRate(uint32_t baud) override {
+    (void)baud;
+    return true;
+  }
+  uint32_t millis() override { return 0; }
+  void delayMs(uint32_t ms) override { (void)ms; }
+
+  uint8_t written[4096];
+  size_t writtenLength = 0;
+};
+
+static void testController() {
+  ChunkController chunker(64, 128, 32, GRANULE);
+
+  // The limit is cut to whole flash words, the start size to the limit
+  chunker.begin(1000 + 5);
+  CHECK_EQ(chunker.limit(), 1000);
+  CHECK_EQ(chunker.size(), 128);
+  chunker.begin(100);
+  CHECK_EQ(chunker.size(), 96);
+
+  // Additive increase up to the limit
+  chunker.begin(256);
+  for (int frame = 0; frame < 3; ++frame) {
+    chunker.onAck(chunker.size(), 1000);
+  }
+  CHECK_EQ(chunker.size(), 224);
+  chunker.onAck(chunker.size(), 1000);
+  chunker.onAck(chunker.size(), 1000);
+  CHECK_EQ(chunker.size(), 256);
+
+  // Cut to 3/4 in whole words, never below the floor
+  CHECK(chunker.onFailure(1000));
+  CHECK_EQ(chunker.size(), 192);
+  CHECK(chunker.onFailure(1000));
+  CHECK_EQ(chunker.size(), 144);
+  CHECK(chunker.onFailure(1000));
+  CHECK_EQ(chunker.size(), 104);
+  CHECK(chunker.onFailure(1000));
+  CHECK_EQ(chunker.size(), 72);
+  CHECK(chunker.onFailure(1000));
+  CHECK_EQ(chunker.size(), 64);
+  CHECK(!chunker.onFailure(1000));
+  CHECK_EQ(chunker.size(), 64);
+  CHECK_EQ(chunker.size() % GRANULE, 0);
+
+  // Goodput counts failed frames' time but not their bytes
+  CHECK_EQ(chunker.frames(), 11);
+  CHECK_EQ(chunker.failures(), 6);
+  CHECK_EQ(chunker.goodput(), (128 + 160 + 192 + 224 + 256) * 1000000ULL / 11000);
+
+  // A new session starts over
+  chunker.begin(256);
+  CHECK_EQ(chunker.frames(), 0);
+  CHECK_EQ(chunker.goodput(), 0);
+  CHECK_EQ(chunker.size(), 128);
+}
+
+// Bit errors: none unarmed, the same bits for the same seed, and close to
+// the configured rate
+static void testFaults() {
+  static uint8_t data[2048];
+  for (size_t i = 0; i < sizeof(data); ++i) {
+    data[i] = (uint8_t)(i * 29 + 3);
+  }
+
+  MemoryTransport clean;
+  FaultTransport faults(clean);
+  faults.configure(0.01, 7);
+  CHECK(faults.write(data, sizeof(data)));
+  CHECK(memcmp(clean.written, data, sizeof(data)) == 0);
+  CHECK_EQ(faults.corruptedBytes(), 0);
+
+  MemoryTransport first;
+  FaultTransport firstFaults(first);
+  firstFaults.configure(0.01, 7);
+  firstFaults.arm(true);
+  CHECK(firstFaults.write(data, sizeof(data)));
+  MemoryTransport second;
+  FaultTransport secondFaults(second);
+  secondFaults.configure(0.01, 7);
+  secondFaults.arm(true);
+  CHECK(secondFaults.write(data, sizeof(data)));
+  CHECK_EQ(first.writtenLength, sizeof(data));
+  CHECK(memcmp(first.written, second.written, sizeof(data)) == 0);
+  CHECK(memcmp(first.written, data, sizeof(data)) != 0);
+
+  uint32_t flippedBits = 0;
+  for (size_t i = 0; i < sizeof(data); ++i) {
+    flippedBits += __builtin_popcount(first.written[i] ^ data[i]);
+  }
+  // 16384 bits at 1 %: 164 expected
+  CHECK(flippedBits > 100 && flippedBits < 240);
+  CHECK(firstFaults.corruptedBytes() > 0 && firstFaults.corruptedBytes() <= flippedBits);
+
+  // Reads are corrupted too
+  uint8_t reply[1024];
+  CHECK_EQ(firstFaults.read(reply, sizeof(reply), 10), sizeof(reply));
+  size_t changed = 0;
+  for (uint8_t byte : reply) {
+    changed += byte != 0x5A ? 1 : 0;
+  }
+  CHECK(changed > 0);
+}
+
+int main() {
+  testController();
+  testFaults();
+  return checkResult("test_chunk_controller");
+}
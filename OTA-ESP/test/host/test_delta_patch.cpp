@@ -0,0 +1,283 @@
+// Prathik Narsetty
+// Delta patches: records written here and applied in any split, and the
+// errors of truncated, misdirected, out-of-range and corrupted patches
+//
+// The patches are built from explicit records, so each case knows where
+// its bytes sit; tools/delta/otadelta's own `make` is run by the
+// session_delta test.
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "bsl_frames.h"
+#include "check.h"
+#include "delta_patch.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Record {
+  uint32_t diffLen;
+  uint32_t extraLen;
+  int32_t seek;
+};
+
+static uint32_t imageCrc32(const Bytes& data) {
+  return ~bslCrc32(data.data(), data.size());
+}
+
+static Bytes makeImage(size_t size, uint8_t seed) {
+  Bytes image(size);
+  for (size_t i = 0; i < size; ++i) {
+    image[i] = (uint8_t)(i * 31 + seed + (i >> 8));
+  }
+  return image;
+}
+
+// The old image, or nothing for any other size and CRC
+class MemoryTarget : public DeltaTarget {
+ public:
+  explicit MemoryTarget(const Bytes& old) : old_(old) {}
+
+  const uint8_t* base(uint32_t size, uint32_t crc) override {
+    return size == old_.size() && crc == imageCrc32(old_) ? old_.data() : nullptr;
+  }
+  bool write(const uint8_t* data, size_t len) override {
+    if (out.size() + len > writeLimit) {
+      return false;
+    }
+    out.insert(out.end(), data, data + len);
+    return true;
+  }
+
+  Bytes out;
+  size_t writeLimit = SIZE_MAX;
+
+ private:
+  const Bytes& old_;
+};
+
+static void putVarint(Bytes& out, uint32_t value) {
+  while (value >= 0x80) {
+    out.push_back((uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((uint8_t)value);
+}
+
+static Bytes makeHeader(const Bytes& old, const Bytes& img) {
+  DeltaHeader header = {DELTA_MAGIC, DELTA_VERSION, 0, (uint32_t)old.size(), imageCrc32(old),
+                        (uint32_t)img.size(), imageCrc32(img)};
+  return Bytes((const uint8_t*)&header, (const uint8_t*)&header + sizeof(header));
+}
+
+// Control triple of a record whose body the caller writes itself
+static void putControl(Bytes& patch, uint32_t diffLen, uint32_t extraLen, int32_t seek) {
+  putVarint(patch, diffLen);
+  putVarint(patch, extraLen);
+  putVarint(patch, ((uint32_t)seek << 1) ^ (uint32_t)(seek >> 31));
+}
+
+// Patch from old to img along the given records, each diff body as
+// (zero run, literal count, literals) tokens
+static Bytes makePatch(const Bytes& old, const Bytes& img, const std::vector<Record>& records) {
+  Bytes patch = makeHeader(old, img);
+  size_t oldPos = 0;
+  size_t newPos = 0;
+  for (const Record& record : records) {
+    putControl(patch, record.diffLen, record.extraLen, record.seek);
+    uint32_t i = 0;
+    while (i < record.diffLen) {
+      uint32_t zeros = 0;
+      while (i + zeros < record.diffLen && img[newPos + i + zeros] == old[oldPos + i + zeros]) {
+        zeros++;
+      }
+      putVarint(patch, zeros);
+      i += zeros;
+      if (i == record.diffLen) {
+        break;
+      }
+      uint32_t literals = 0;
+      while (i + literals < record.diffLen && img[newPos + i + literals] != old[oldPos + i + literals]) {
+        literals++;
+      }
+      putVarint(patch, literals);
+      for (uint32_t k = 0; k < literals; ++k) {
+        patch.push_back((uint8_t)(img[newPos + i + k] - old[oldPos + i + k]));
+      }
+      i += literals;
+    }
+    patch.insert(patch.end(), img.begin() + newPos + record.diffLen,
+                 img.begin() + newPos + record.diffLen + record.extraLen);
+    oldPos += (int64_t)record.diffLen + record.seek;
+    newPos += record.diffLen + record.extraLen;
+  }
+  return patch;
+}
+
+// Feed the patch in pieces of the given sizes, cycled; no sizes feed it whole
+static DeltaStatus apply(MemoryTarget& target, const Bytes& patch, const std::vector<size_t>& pieces = {}) {
+  DeltaPatcher patcher(target);
+  patcher.begin();
+  size_t at = 0;
+  for (size_t i = 0; at < patch.size(); ++i) {
+    size_t n = pieces.empty() ? patch.size() : std::min(pieces[i % pieces.size()], patch.size() - at);
+    patcher.feed(patch.data() + at, n);
+    at += n;
+  }
+  return patcher.finish();
+}
+
+static DeltaStatus applyWhole(const Bytes& old, const Bytes& patch) {
+  MemoryTarget target(old);
+  return apply(target, patch);
+}
+
+static void checkRoundTrip(const Bytes& old, const Bytes& img, const std::vector<Record>& records) {
+  Bytes patch = makePatch(old, img, records);
+  std::mt19937 random(7);
+  std::vector<size_t> randomPieces;
+  for (int i = 0; i < 64; ++i) {
+    randomPieces.push_back(1 + random() % 300);
+  }
+  for (const std::vector<size_t>& pieces : {std::vector<size_t>{}, std::vector<size_t>{1}, randomPieces}) {
+    MemoryTarget target(old);
+    CHECK_EQ(apply(target, patch, pieces), DELTA_OK);
+    CHECK(target.out == img);
+  }
+}
+
+static void testRoundTrips() {
+  Bytes old = makeImage(4000, 1);
+
+  // The same image: one record of zero differences
+  checkRoundTrip(old, old, {{4000, 0, 0}});
+
+  // Changed bytes, an insertion and an appended tail
+  Bytes edited(old.begin(), old.begin() + 1000);
+  edited[10] ^= 0x55;
+  edited[500] += 3;
+  edited[501] += 3;
+  Bytes inserted = makeImage(50, 9);
+  edited.insert(edited.end(), inserted.begin(), inserted.end());
+  edited.insert(edited.end(), old.begin() + 1000, old.end());
+  edited[3000] = 0;
+  Bytes tail = makeImage(20, 10);
+  edited.insert(edited.end(), tail.begin(), tail.end());
+  checkRoundTrip(old, edited, {{1000, 50, 0}, {3000, 20, 0}});
+
+  // Halves swapped: an empty record seeks to the second half, the next
+  // seeks back to the start
+  Bytes swapped(old.begin() + 2000, old.end());
+  swapped.insert(swapped.end(), old.begin(), old.begin() + 2000);
+  checkRoundTrip(old, swapped, {{0, 0, 2000}, {2000, 0, -4000}, {2000, 0, 0}});
+
+  // New bytes only, longer than the output buffer
+  Bytes fresh = makeImage(3 * DELTA_OUT_BUFFER + 5, 11);
+  checkRoundTrip(old, fresh, {{0, (uint32_t)fresh.size(), 0}});
+
+  // An empty new image has no records
+  checkRoundTrip(old, Bytes(), {});
+}
+
+static void testErrors() {
+  Bytes old = makeImage(4000, 1);
+  Bytes img = makeImage(3000, 2);
+  std::vector<Record> records = {{1500, 100, 500}, {1400, 0, 0}};
+  Bytes patch = makePatch(old, img, records);
+  CHECK_EQ(applyWhole(old, patch), DELTA_OK);
+
+  // Truncated in the records, and in the header
+  Bytes truncated(patch.begin(), patch.end() - 1);
+  CHECK_EQ(applyWhole(old, truncated), DELTA_TRUNCATED);
+  truncated.resize(patch.size() / 2);
+  CHECK_EQ(applyWhole(old, truncated), DELTA_TRUNCATED);
+  truncated.resize(sizeof(DeltaHeader) - 1);
+  CHECK_EQ(applyWhole(old, truncated), DELTA_BAD_HEADER);
+
+  // Made against another image
+  Bytes other = old;
+  other[123] ^= 1;
+  CHECK_EQ(applyWhole(other, patch), DELTA_NO_BASE);
+  Bytes shorter(old.begin(), old.end() - 1);
+  CHECK_EQ(applyWhole(shorter, patch), DELTA_NO_BASE);
+
+  Bytes badMagic = patch;
+  badMagic[0] ^= 0xFF;
+  CHECK_EQ(applyWhole(old, badMagic), DELTA_BAD_HEADER);
+
+  // Records reaching past the new image, or seeking before the start or
+  // beyond the end of the old one
+  const Record outside[] = {{3000, 1, 0}, {0, 3001, 0}, {0, 0, -1}, {0, 0, 4001}};
+  for (const Record& record : outside) {
+    Bytes bad = makeHeader(old, img);
+    putControl(bad, record.diffLen, record.extraLen, record.seek);
+    CHECK_EQ(applyWhole(old, bad), DELTA_BAD_RECORD);
+  }
+  // A diff reaching past the old image from where an earlier record left it
+  Bytes late = makeHeader(old, img);
+  putControl(late, 0, 0, 3000);
+  putControl(late, 1001, 0, 0);
+  CHECK_EQ(applyWhole(old, late), DELTA_BAD_RECORD);
+
+  // Diff tokens longer than their record
+  Bytes longRun = makeHeader(old, img);
+  putControl(longRun, 10, 0, 0);
+  putVarint(longRun, 11);
+  CHECK_EQ(applyWhole(old, longRun), DELTA_BAD_RECORD);
+  Bytes longLiterals = makeHeader(old, img);
+  putControl(longLiterals, 10, 0, 0);
+  putVarint(longLiterals, 4);
+  putVarint(longLiterals, 7);
+  CHECK_EQ(applyWhole(old, longLiterals), DELTA_BAD_RECORD);
+
+  // A varint of more than five bytes
+  Bytes overlong = makeHeader(old, img);
+  overlong.insert(overlong.end(), {0x80, 0x80, 0x80, 0x80, 0x80, 0x00});
+  CHECK_EQ(applyWhole(old, overlong), DELTA_BAD_RECORD);
+
+  // Bytes after the last record
+  Bytes trailing = patch;
+  trailing.push_back(0);
+  CHECK_EQ(applyWhole(old, trailing), DELTA_BAD_RECORD);
+
+  // A changed extra byte of the first record still parses but rebuilds
+  // the wrong image
+  Bytes corrupt = patch;
+  size_t extraAt = 0;
+  for (size_t i = sizeof(DeltaHeader); i + 100 <= corrupt.size(); ++i) {
+    if (memcmp(&corrupt[i], &img[1500], 100) == 0) {
+      extraAt = i;
+      break;
+    }
+  }
+  CHECK(extraAt != 0);
+  corrupt[extraAt + 42] ^= 0x10;
+  CHECK_EQ(applyWhole(old, corrupt), DELTA_BAD_CRC);
+
+  // The target refusing a write
+  MemoryTarget full(old);
+  full.writeLimit = DELTA_OUT_BUFFER;
+  CHECK_EQ(apply(full, patch), DELTA_WRITE_FAILED);
+
+  // The first error sticks through further bytes and finish()
+  MemoryTarget target(old);
+  DeltaPatcher patcher(target);
+  patcher.begin();
+  CHECK_EQ(patcher.feed(overlong.data(), overlong.size()), DELTA_BAD_RECORD);
+  CHECK_EQ(patcher.feed(patch.data() + sizeof(DeltaHeader), 10), DELTA_BAD_RECORD);
+  CHECK_EQ(patcher.finish(), DELTA_BAD_RECORD);
+
+  // begin() starts over after an error
+  patcher.begin();
+  target.out.clear();
+  CHECK_EQ(patcher.feed(patch.data(), patch.size()), DELTA_OK);
+  CHECK_EQ(patcher.finish(), DELTA_OK);
+  CHECK_EQ(patcher.produced(), img.size());
+  CHECK(target.out == img);
+}
+
+int main() {
+  testRoundTrips();
+  testErrors();
+  return checkResult("test_delta_patch");
+}
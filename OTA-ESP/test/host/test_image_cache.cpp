@@ -0,0 +1,99 @@
+// Prathik Narsetty
+// Image cache: hits across slots with the same image, and no hit for a
+// different image with the same CRC32 and size
+//
+// Runs against the native SPIFFS fake in the directory given as argv[1].
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <sys/stat.h>
+#include "bsl_frames.h"
+#include "check.h"
+#include "image_cache.h"
+#include "image_store.h"
+
+#define UPLOAD_PATH "/upload.bin"
+#define IMAGE_BYTES 1000
+
+static int addImage(const uint8_t* data, size_t size) {
+  File file = SPIFFS.open(UPLOAD_PATH, FILE_WRITE);
+  file.write(data, size);
+  file.close();
+  return imageStoreAdd(UPLOAD_PATH);
+}
+
+// One byte of the CRC32 in table form
+static uint32_t crcStep(uint8_t index) {
+  uint8_t zero = 0;
+  return bslCrc32(&zero, 1, index);
+}
+
+// Set the last four bytes of data so its CRC32 state after `len` bytes
+// is `target`. The top byte of each table entry is unique, which fixes the
+// table index of every step working back from the target.
+static void forgeCrc(uint8_t* data, size_t len, uint32_t target) {
+  uint8_t indices[4];
+  uint32_t state = target;
+  for (int step = 3; step >= 0; --step) {
+    int index = 0;
+    while ((crcStep(index) >> 24) != (state >> 24)) {
+      index++;
+    }
+    indices[step] = (uint8_t)index;
+    state = (state ^ crcStep(index)) << 8;
+  }
+  state = bslCrc32(data, len - 4);
+  for (int step = 0; step < 4; ++step) {
+    data[len - 4 + step] = (uint8_t)(state ^ indices[step]);
+    state = (state >> 8) ^ crcStep(indices[step]);
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: test_image_cache DIR\n");
+    return 2;
+  }
+  mkdir(argv[1], 0755);
+  nativeFsSetRoot(argv[1]);
+  SPIFFS.remove(IMAGE_INDEX_PATH);
+  SPIFFS.remove(IMAGE_INDEX_TMP_PATH);
+  CHECK(SPIFFS.begin(true));
+  CHECK(imageStoreBegin(SPIFFS));
+
+  static uint8_t first[IMAGE_BYTES];
+  static uint8_t collision[IMAGE_BYTES];
+  for (size_t i = 0; i < IMAGE_BYTES; ++i) {
+    first[i] = (uint8_t)(i * 7 + 1);
+    collision[i] = (uint8_t)(i * 13 + 5);
+  }
+  forgeCrc(collision, IMAGE_BYTES, bslCrc32(first, IMAGE_BYTES));
+  CHECK_EQ(bslCrc32(collision, IMAGE_BYTES), bslCrc32(first, IMAGE_BYTES));
+
+  int slot = addImage(first, IMAGE_BYTES);
+  CHECK_EQ(slot, 0);
+  CHECK(imageStoreActivate(slot));
+  const uint8_t* cached = imageCacheAcquire(slot);
+  CHECK(cached != nullptr && memcmp(cached, first, IMAGE_BYTES) == 0);
+  imageCacheRelease(cached);
+  CHECK_EQ(imageCacheStats().misses, 1);
+
+  // The same image uploaded again shares the entry
+  int again = addImage(first, IMAGE_BYTES);
+  CHECK_EQ(again, 1);
+  const uint8_t* shared = imageCacheAcquire(again);
+  CHECK(shared == cached);
+  imageCacheRelease(shared);
+  CHECK_EQ(imageCacheStats().hits, 1);
+
+  // Same CRC32 and size, different bytes: the digest tells them apart
+  int other = addImage(collision, IMAGE_BYTES);
+  CHECK_EQ(other, 1);
+  CHECK_EQ(imageStoreSlot(other).crc, imageStoreSlot(slot).crc);
+  const uint8_t* loaded = imageCacheAcquire(other);
+  CHECK(loaded != nullptr && loaded != cached);
+  CHECK(loaded != nullptr && memcmp(loaded, collision, IMAGE_BYTES) == 0);
+  imageCacheRelease(loaded);
+  CHECK_EQ(imageCacheStats().misses, 2);
+  CHECK_EQ(imageCacheStats().entries, 2);
+  return checkResult("test_image_cache");
+}
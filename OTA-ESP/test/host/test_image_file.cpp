@@ -0,0 +1,165 @@
+// Prathik Narsetty
+// bslprog image files: binary, Intel HEX and ELF32 loading, word alignment
+// and parse errors
+//
+// The image files are written to the directory given as argv[1].
+#include <string.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "image_file.h"
+
+static std::string dir;
+
+static std::string writeFile(const char* name, const std::string& contents) {
+  std::string path = dir + "/" + name;
+  std::ofstream(path, std::ios::binary) << contents;
+  return path;
+}
+
+static bool load(const std::string& path, std::vector<ImageSegment>& segments, std::string& error,
+                 ImageFormat format = IMAGE_AUTO, uint32_t binAddress = 0) {
+  error.clear();
+  return loadImage(path, format, binAddress, segments, error);
+}
+
+static void putLE16(std::string& s, size_t at, uint16_t v) {
+  s[at] = (char)(v & 0xFF);
+  s[at + 1] = (char)(v >> 8);
+}
+
+static void putLE32(std::string& s, size_t at, uint32_t v) {
+  putLE16(s, at, (uint16_t)v);
+  putLE16(s, at + 2, (uint16_t)(v >> 16));
+}
+
+static void testBin() {
+  std::vector<ImageSegment> segments;
+  std::string error;
+  CHECK(load(writeFile("app.bin", std::string("\x01\x02\x03\x04\x05", 5)), segments, error,
+             IMAGE_AUTO, 0x4000));
+  CHECK_EQ(segments.size(), 1);
+  CHECK_EQ(segments[0].address, 0x4000);
+  CHECK(segments[0].data == std::vector<uint8_t>({1, 2, 3, 4, 5}));
+
+  CHECK(!load(writeFile("empty.bin", ""), segments, error));
+  CHECK(error.find("is empty") != std::string::npos);
+  CHECK(!load(dir + "/missing.bin", segments, error));
+  CHECK(error.find("cannot open") != std::string::npos);
+}
+
+static void testHex() {
+  std::vector<ImageSegment> segments;
+  std::string error;
+  // Two records that run on, a gap, then an extended linear address
+  const std::string hex =
+      ":0400000001020304F2\r\n"
+      ":02000400A0B0AA\r\n"
+      ":020010001122BB\r\n"
+      ":020000040001F9\r\n"
+      ":02000000556643\r\n"
+      ":00000001FF\r\n";
+  CHECK(load(writeFile("app.hex", hex), segments, error));
+  CHECK(error.empty());
+  CHECK_EQ(segments.size(), 3);
+  CHECK_EQ(segments[0].address, 0x0);
+  CHECK(segments[0].data == std::vector<uint8_t>({1, 2, 3, 4, 0xA0, 0xB0}));
+  CHECK_EQ(segments[1].address, 0x10);
+  CHECK(segments[1].data == std::vector<uint8_t>({0x11, 0x22}));
+  CHECK_EQ(segments[2].address, 0x10000);
+  CHECK(segments[2].data == std::vector<uint8_t>({0x55, 0x66}));
+
+  // Forced format for a file whose name says otherwise
+  CHECK(load(writeFile("hex_as.txt", hex), segments, error, IMAGE_HEX));
+  CHECK_EQ(segments.size(), 3);
+
+  std::string badSum = ":0400000001020304F3\n:00000001FF\n";
+  CHECK(!load(writeFile("bad_sum.hex", badSum), segments, error));
+  CHECK(error == "line 1: bad length or checksum");
+  CHECK(!load(writeFile("no_eof.hex", ":0400000001020304F2\n"), segments, error));
+  CHECK(error == "missing end-of-file record");
+  CHECK(!load(writeFile("garbage.hex", "\n:0400000001020304F2\nhello\n"), segments, error, IMAGE_HEX));
+  CHECK(error == "line 3: not an Intel HEX record");
+}
+
+static void testElf() {
+  std::vector<ImageSegment> segments;
+  std::string error;
+  // Header, three program headers (text, .bss, data), then the contents
+  const size_t phoff = 52;
+  const size_t contents = phoff + 3 * 32;
+  std::string elf(contents + 12, '\0');
+  memcpy(&elf[0], "\x7f" "ELF\x01\x01\x01", 7);
+  putLE32(elf, 28, phoff);
+  putLE16(elf, 42, 32);
+  putLE16(elf, 44, 3);
+  const uint32_t phdrs[3][5] = {
+      // type, offset, vaddr, paddr, filesz
+      {1, (uint32_t)contents, 0x20, 0x20, 8},
+      {1, 0, 0x20200000, 0x20200000, 0},
+      {1, (uint32_t)contents + 8, 0x20200100, 0x28, 4},
+  };
+  for (int i = 0; i < 3; ++i) {
+    for (int field = 0; field < 5; ++field) {
+      putLE32(elf, phoff + i * 32 + field * 4, phdrs[i][field]);
+    }
+  }
+  for (size_t i = 0; i < 12; ++i) {
+    elf[contents + i] = (char)(0xC0 + i);
+  }
+  // The name says binary, the magic says ELF
+  CHECK(load(writeFile("app_elf.bin", elf), segments, error));
+  CHECK_EQ(segments.size(), 1);
+  CHECK_EQ(segments[0].address, 0x20);
+  CHECK_EQ(segments[0].data.size(), 12);
+  CHECK_EQ(segments[0].data[0], 0xC0);
+  CHECK_EQ(segments[0].data[11], 0xCB);
+
+  std::string elf64 = elf;
+  elf64[4] = 2;
+  CHECK(!load(writeFile("app64.elf", elf64), segments, error));
+  CHECK(error == "only 32-bit little-endian ELF files are supported");
+
+  std::string bssOnly = elf;
+  putLE16(bssOnly, 44, 0);
+  CHECK(!load(writeFile("nothing.elf", bssOnly), segments, error));
+  CHECK(error == "no loadable segments");
+}
+
+static void testAlign() {
+  // Padding with 0xFF to whole words; segments that then meet are merged
+  std::vector<ImageSegment> segments = {
+      {0x03, {0x11, 0x22}},
+      {0x0A, {0x33}},
+      {0x20, {0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB}},
+  };
+  alignSegments(segments, 8);
+  CHECK_EQ(segments.size(), 2);
+  CHECK_EQ(segments[0].address, 0x00);
+  CHECK(segments[0].data == std::vector<uint8_t>({0xFF, 0xFF, 0xFF, 0x11, 0x22, 0xFF, 0xFF, 0xFF,
+                                                  0xFF, 0xFF, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}));
+  CHECK_EQ(segments[1].address, 0x20);
+  CHECK_EQ(segments[1].data.size(), 8);
+
+  // Two segments sharing a word keep both sets of bytes
+  segments = {{0x01, {0x12}}, {0x06, {0x34}}};
+  alignSegments(segments, 8);
+  CHECK_EQ(segments.size(), 1);
+  CHECK(segments[0].data == std::vector<uint8_t>({0xFF, 0x12, 0xFF, 0xFF, 0xFF, 0xFF, 0x34, 0xFF}));
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: test_image_file DIR\n");
+    return 2;
+  }
+  dir = argv[1];
+  mkdir(dir.c_str(), 0755);
+  testBin();
+  testHex();
+  testElf();
+  testAlign();
+  return checkResult("test_image_file");
+}
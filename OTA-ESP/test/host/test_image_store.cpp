@@ -0,0 +1,97 @@
+// Prathik Narsetty
+// Image store: slot choice, pinned slots and index changes from two tasks
+//
+// Runs against the native SPIFFS fake in the directory given as argv[1].
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include "check.h"
+#include "image_store.h"
+
+#define UPLOAD_PATH "/upload.bin"
+#define ADD_ROUNDS 40
+
+// An upload of `size` bytes, all `fill`
+static void writeUpload(uint32_t size, uint8_t fill) {
+  File file = SPIFFS.open(UPLOAD_PATH, FILE_WRITE);
+  for (uint32_t i = 0; i < size; ++i) {
+    file.write(fill);
+  }
+  file.close();
+}
+
+static int addImage(uint32_t size, uint8_t fill) {
+  writeUpload(size, fill);
+  return imageStoreAdd(UPLOAD_PATH);
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: test_image_store DIR\n");
+    return 2;
+  }
+  mkdir(argv[1], 0755);
+  nativeFsSetRoot(argv[1]);
+  SPIFFS.remove(IMAGE_INDEX_PATH);
+  SPIFFS.remove(IMAGE_INDEX_TMP_PATH);
+  CHECK(SPIFFS.begin(true));
+  CHECK(imageStoreBegin(SPIFFS));
+  CHECK_EQ(imageStoreActiveSlot(), -1);
+
+  // Empty slots first; the upload file is moved into the slot
+  int first = addImage(1000, 0x11);
+  CHECK_EQ(first, 0);
+  CHECK(!SPIFFS.exists(UPLOAD_PATH));
+  CHECK(imageStoreActivate(first));
+  int second = addImage(2000, 0x22);
+  CHECK_EQ(second, 1);
+  CHECK_EQ(imageStoreSlot(second).size, 2000);
+
+  // With the other slot queued for a session, nothing may be replaced
+  imageStorePin(second);
+  imageStorePin(second);
+  CHECK_EQ(addImage(3000, 0x33), -1);
+  CHECK(SPIFFS.exists(UPLOAD_PATH));
+  CHECK_EQ(imageStoreSlot(second).size, 2000);
+  imageStoreUnpin(second);
+  CHECK_EQ(addImage(3000, 0x33), -1);  // pins nest
+  imageStoreUnpin(second);
+  CHECK_EQ(addImage(3000, 0x33), second);
+  CHECK_EQ(imageStoreSlot(second).size, 3000);
+
+  // A session pins the slot it programs even when it stops being active
+  imageStorePin(first);
+  CHECK(imageStoreActivate(second));
+  CHECK_EQ(addImage(4000, 0x44), -1);
+  imageStoreUnpin(first);
+  CHECK_EQ(addImage(4000, 0x44), first);
+  CHECK(imageStoreActivate(first));
+
+  // A session records results while uploads are stored; the index on disk
+  // must come out whole
+  std::atomic<bool> stop(false);
+  std::thread session([&] {
+    bool success = false;
+    while (!stop) {
+      imageStoreMarkResult(imageStoreActiveSlot(), success);
+      success = !success;
+    }
+  });
+  int added = 0;
+  for (int i = 0; i < ADD_ROUNDS; ++i) {
+    added += addImage(500 + i, (uint8_t)i) == second ? 1 : 0;
+  }
+  stop = true;
+  session.join();
+  CHECK_EQ(added, ADD_ROUNDS);
+
+  CHECK(imageStoreBegin(SPIFFS));
+  CHECK_EQ(imageStoreActiveSlot(), first);
+  CHECK_EQ(imageStoreSlot(first).size, 4000);
+  CHECK_EQ(imageStoreSlot(second).size, 500 + ADD_ROUNDS - 1);
+  CHECK(imageStoreSlot(second).state == SLOT_STAGED);
+  return checkResult("test_image_store");
+}
@@ -0,0 +1,153 @@
+// Prathik Narsetty
+// Raw image partition on its file stand-in: header copies across restarts
+// and torn writes, region copies through the mapped view, NOR write rules
+//
+// The flash file and the SPIFFS fake live in the directory given as argv[1].
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <string>
+#include "bsl_frames.h"
+#include "check.h"
+#include "raw_partition.h"
+
+#define UPLOAD_PATH "/upload.bin"
+#define FLASH_FILE_BYTES (2 * 1024 * 1024)
+
+static RawFlash* flash = nullptr;
+
+static ImageIndex makeIndex(uint32_t nextSequence) {
+  ImageIndex index;
+  memset(&index, 0, sizeof(index));
+  index.magic = IMAGE_INDEX_MAGIC;
+  index.version = IMAGE_INDEX_VERSION;
+  index.active = -1;
+  index.slotCount = IMAGE_SLOT_COUNT;
+  index.nextSequence = nextSequence;
+  return index;
+}
+
+// Index after a restart, 0 if there is none
+static uint32_t reloadedSequence() {
+  ImageIndex index;
+  CHECK(rawPartitionBegin(flash));
+  return rawPartitionLoadIndex(index) ? index.nextSequence : 0;
+}
+
+static void testHeaders() {
+  ImageIndex index;
+  CHECK(rawPartitionBegin(flash));
+  CHECK(!rawPartitionLoadIndex(index));
+  const size_t regionSectors = (FLASH_FILE_BYTES / RAW_SECTOR_SIZE - RAW_HEADER_SECTORS) / IMAGE_SLOT_COUNT;
+  CHECK_EQ(rawPartitionCapacity(0), regionSectors * RAW_SECTOR_SIZE);
+
+  // Saves alternate between the two copies; the newest wins on a restart
+  CHECK(rawPartitionSaveIndex(makeIndex(5)));
+  CHECK_EQ(reloadedSequence(), 5);
+  CHECK(rawPartitionSaveIndex(makeIndex(6)));
+  CHECK_EQ(reloadedSequence(), 6);
+
+  // Power lost after the erase of the copy being written: the other stays
+  CHECK(flash->erase(0, RAW_SECTOR_SIZE));
+  CHECK_EQ(reloadedSequence(), 5);
+  CHECK(rawPartitionSaveIndex(makeIndex(7)));
+  CHECK_EQ(reloadedSequence(), 7);
+
+  // A cleared bit in the newest copy fails its CRC
+  uint8_t byte;
+  uint32_t newest = 0;  // the save of 7 followed sequence 1, so it went to sector 0
+  CHECK(flash->read(newest + offsetof(RawPartitionHeader, index) + 8, &byte, 1));
+  byte &= 0xFE;
+  CHECK(flash->write(newest + offsetof(RawPartitionHeader, index) + 8, &byte, 1));
+  CHECK_EQ(reloadedSequence(), 5);
+  CHECK(rawPartitionSaveIndex(makeIndex(8)));
+  CHECK_EQ(reloadedSequence(), 8);
+}
+
+static std::string makeImage(size_t size, uint8_t seed) {
+  std::string image(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    image[i] = (char)(i * 31 + seed + (i >> 8));
+  }
+  return image;
+}
+
+static bool writeRegion(int slot, const std::string& image, uint32_t imageSize, uint32_t& crc,
+                        uint8_t* sha256) {
+  File upload = SPIFFS.open(UPLOAD_PATH, FILE_WRITE);
+  upload.write((const uint8_t*)image.data(), image.size());
+  upload.close();
+  File src = SPIFFS.open(UPLOAD_PATH, FILE_READ);
+  bool ok = rawPartitionWriteRegion(slot, src, imageSize, crc, sha256);
+  src.close();
+  return ok;
+}
+
+static bool mappedEquals(int slot, const std::string& image) {
+  uint32_t handle;
+  const uint8_t* view = rawPartitionMap(slot, image.size(), handle);
+  bool same = view != nullptr && memcmp(view, image.data(), image.size()) == 0;
+  rawPartitionUnmap(handle);
+  return same;
+}
+
+static void testRegions() {
+  uint32_t crc;
+  uint8_t sha[SHA256_BYTES];
+  uint8_t expectedSha[SHA256_BYTES];
+
+  // CRC32 and SHA-256 of the image, the trailer after it left out
+  std::string first = makeImage(10000, 1);
+  CHECK(writeRegion(1, first, 9900, crc, sha));
+  CHECK_EQ(crc, ~bslCrc32((const uint8_t*)first.data(), 9900));
+  Sha256 digest;
+  digest.update((const uint8_t*)first.data(), 9900);
+  digest.finish(expectedSha);
+  CHECK(memcmp(sha, expectedSha, SHA256_BYTES) == 0);
+  CHECK(mappedEquals(1, first));
+
+  // A smaller image over it: the region is erased first, so no bits of the
+  // old one survive
+  std::string second = makeImage(5000, 2);
+  CHECK(writeRegion(1, second, second.size(), crc, sha));
+  CHECK_EQ(crc, ~bslCrc32((const uint8_t*)second.data(), second.size()));
+  CHECK(mappedEquals(1, second));
+
+  // Writes only clear bits, as on NOR flash
+  uint32_t regionOffset = RAW_HEADER_SECTORS * RAW_SECTOR_SIZE + (uint32_t)rawPartitionCapacity(0);
+  uint8_t ones[16];
+  memset(ones, 0xFF, sizeof(ones));
+  CHECK(flash->write(regionOffset, ones, sizeof(ones)));
+  CHECK(mappedEquals(1, second));
+  CHECK(!flash->erase(regionOffset + 1, RAW_SECTOR_SIZE));
+
+  // Images larger than the region, and views past it, are refused
+  std::string tooBig = makeImage(rawPartitionCapacity(0) + 1, 3);
+  CHECK(!writeRegion(0, tooBig, tooBig.size(), crc, sha));
+  uint32_t handle;
+  CHECK(rawPartitionMap(0, rawPartitionCapacity(0) + 1, handle) == nullptr);
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: test_raw_partition DIR\n");
+    return 2;
+  }
+  mkdir(argv[1], 0755);
+  std::string flashPath = std::string(argv[1]) + "/raw_images.bin";
+  remove(flashPath.c_str());
+  setenv("RAW_FLASH_FILE", flashPath.c_str(), 1);
+  nativeFsSetRoot(argv[1]);
+  CHECK(SPIFFS.begin(true));
+
+  flash = rawFlashOpen();
+  CHECK(flash != nullptr);
+  if (flash == nullptr) {
+    return checkResult("test_raw_partition");
+  }
+  CHECK_EQ(flash->size(), FLASH_FILE_BYTES);
+  testHeaders();
+  testRegions();
+  return checkResult("test_raw_partition");
+}
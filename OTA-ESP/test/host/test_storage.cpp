@@ -0,0 +1,126 @@
+// Prathik Narsetty
+// Storage backend: the file image source's read-ahead and image length, and
+// the "bench fs" report on the mounted filesystem
+//
+// Runs against the native filesystem fake in the directory given as argv[1],
+// as SPIFFS or, built with STORAGE_LITTLEFS, as LittleFS.
+#include <Arduino.h>
+#include <sys/stat.h>
+#include <regex>
+#include <string>
+#include "check.h"
+#include "image_source.h"
+#include "storage.h"
+
+#define IMAGE_PATH "/slot0.bin"
+#define OTHER_PATH "/slot1.bin"
+#define IMAGE_BYTES 10000
+
+// Console output of the benchmark, kept for the checks
+class StringPrint : public Print {
+ public:
+  size_t write(uint8_t c) override {
+    text += (char)c;
+    return 1;
+  }
+  std::string text;
+};
+
+static void writeImage(const char* path, uint8_t seed) {
+  File file = storageFs().open(path, FILE_WRITE);
+  for (size_t i = 0; i < IMAGE_BYTES; ++i) {
+    file.write((uint8_t)(i * 7 + seed));
+  }
+  file.close();
+}
+
+// Read the whole source in pieces of `piece` bytes and check every byte
+static bool readsBack(ImageSource& source, size_t piece, size_t expected, uint8_t seed) {
+  static uint8_t buf[IMAGE_READ_AHEAD + 1];
+  size_t total = 0;
+  int n;
+  while ((n = source.read(buf, piece)) > 0) {
+    for (int i = 0; i < n; ++i) {
+      if (buf[i] != (uint8_t)((total + i) * 7 + seed)) {
+        return false;
+      }
+    }
+    total += n;
+  }
+  return n == 0 && total == expected;
+}
+
+static void testFileImageSource() {
+  writeImage(IMAGE_PATH, 1);
+  writeImage(OTHER_PATH, 2);
+  File file;
+  FileImageSource source(file);
+
+  // One filesystem read fetches a whole read-ahead block for a BSL packet
+  file = storageFs().open(IMAGE_PATH, FILE_READ);
+  source.setLength(SIZE_MAX);
+  uint8_t packet[128];
+  CHECK_EQ(source.read(packet, sizeof(packet)), sizeof(packet));
+  CHECK_EQ(file.position(), IMAGE_READ_AHEAD);
+  CHECK_EQ(packet[127], (uint8_t)(127 * 7 + 1));
+  file.close();
+
+  // Pieces smaller than, equal to and across read-ahead blocks
+  static const size_t PIECES[] = {128, 1, 7, IMAGE_READ_AHEAD, IMAGE_READ_AHEAD + 1};
+  for (size_t piece : PIECES) {
+    file = storageFs().open(IMAGE_PATH, FILE_READ);
+    source.setLength(SIZE_MAX);
+    CHECK(readsBack(source, piece, IMAGE_BYTES, 1));
+    file.close();
+  }
+
+  // A signed image stops before its trailer
+  file = storageFs().open(IMAGE_PATH, FILE_READ);
+  source.setLength(IMAGE_BYTES - 100);
+  CHECK_EQ(source.size(), IMAGE_BYTES - 100);
+  CHECK(readsBack(source, 128, IMAGE_BYTES - 100, 1));
+  file.close();
+
+  // setLength() for the next file drops what was read ahead of the last one
+  file = storageFs().open(IMAGE_PATH, FILE_READ);
+  source.setLength(SIZE_MAX);
+  uint8_t some[16];
+  CHECK_EQ(source.read(some, sizeof(some)), sizeof(some));
+  file.close();
+  file = storageFs().open(OTHER_PATH, FILE_READ);
+  source.setLength(SIZE_MAX);
+  CHECK(readsBack(source, 128, IMAGE_BYTES, 2));
+  file.close();
+}
+
+static void testBenchmark() {
+  size_t usedBefore = storageUsedBytes();
+  StringPrint out;
+  storageBenchmark(out);
+  std::regex header("=== " STORAGE_NAME " benchmark: \\d+/\\d+ bytes used ===");
+  CHECK(std::regex_search(out.text, header));
+  CHECK(std::regex_search(out.text, std::regex("write +\\d+ KiB/s \\(65536 bytes\\)")));
+  for (const char* line : {"read  128 B +\\d+ KiB/s", "read 1024 B +\\d+ KiB/s", "read 4096 B +\\d+ KiB/s",
+                           "open\\+close +\\d+ us", "exists \\(hit\\) +\\d+ us", "exists \\(miss\\) +\\d+ us"}) {
+    if (!std::regex_search(out.text, std::regex(line))) {
+      fprintf(stderr, "no line matching %s in:\n%s", line, out.text.c_str());
+      checkFailures++;
+    }
+  }
+  // The benchmark file is removed again
+  CHECK(!storageFs().exists("/bench.bin"));
+  CHECK_EQ(storageUsedBytes(), usedBefore);
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: test_storage DIR\n");
+    return 2;
+  }
+  mkdir(argv[1], 0755);
+  nativeFsSetRoot(argv[1]);
+  CHECK(storageBegin());
+  testFileImageSource();
+  testBenchmark();
+  return checkResult("test_storage");
+}
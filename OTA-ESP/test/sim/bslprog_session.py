@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+# Prathik Narsetty
+# bslprog against the BSL simulator
+#
+# Runs tools/bslprog/bslprog on the pty of tools/bslprog/bsl_sim for a few
+# images and option sets and checks the simulator's whole flash dump against
+# the image applied to erased (0xFF) flash:
+#
+#   - a binary at --address, with a baud change and CRC verification
+#   - a sparse Intel HEX with unaligned records and a run of 0xFF that is
+#     skipped, in 64-byte frames with read-back verification
+#   - --no-start, after which the target must not have been started
+#   - an image that does not parse, which must fail before the port is opened
+#
+# Run by ctest (test/CMakeLists.txt); by hand from OTA-ESP/:
+#   python3 test/sim/bslprog_session.py --bslprog build/bslprog --sim build/bsl_sim \
+#       --work /tmp/bslprog
+
+import argparse
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, HERE)
+from sim_session import SESSION_TIMEOUT_S, fail, make_image, start_simulator, stop  # noqa: E402
+
+FLASH_BYTES = 128 * 1024
+
+
+def hex_record(address, record_type, data):
+    record = bytes([len(data), address >> 8 & 0xFF, address & 0xFF, record_type]) + data
+    return ":%s%02X\n" % (record.hex().upper(), -sum(record) & 0xFF)
+
+
+def write_hex(path, segments):
+    """Intel HEX of {address: bytes}, 16 bytes a record"""
+    lines = []
+    base = None
+    for address, data in sorted(segments.items()):
+        for offset in range(0, len(data), 16):
+            at = address + offset
+            if at >> 16 != base:
+                base = at >> 16
+                lines.append(hex_record(0, 0x04, bytes([base >> 8, base & 0xFF])))
+            lines.append(hex_record(at & 0xFFFF, 0x00, data[offset:offset + 16]))
+    lines.append(hex_record(0, 0x01, b""))
+    with open(path, "w") as f:
+        f.writelines(lines)
+
+
+def expected_flash(segments):
+    flash = bytearray(b"\xff" * FLASH_BYTES)
+    for address, data in segments.items():
+        flash[address:address + len(data)] = data
+    return bytes(flash)
+
+
+def run(args, name, options, image_path, expect_status=0):
+    """bslprog with options on a fresh simulator; returns its output, the dump and the log path."""
+    work = os.path.join(args.work, name)
+    os.makedirs(work)
+    dump = os.path.join(work, "flash.bin")
+    log_path = os.path.join(work, "run.log")
+    simulator, tty = start_simulator(args.sim, dump, "uart", [])
+    try:
+        with open(log_path, "wb") as log:
+            try:
+                status = subprocess.run([args.bslprog, "--port", tty] + options + [image_path],
+                                        stdout=log, stderr=subprocess.STDOUT,
+                                        timeout=SESSION_TIMEOUT_S).returncode
+            except subprocess.TimeoutExpired:
+                fail("%s: no result after %u s" % (name, SESSION_TIMEOUT_S), log_path)
+    finally:
+        stop(simulator)
+    if status != expect_status:
+        fail("%s: exit status %d, expected %d" % (name, status, expect_status), log_path)
+    return open(log_path, "rb").read(), dump, log_path
+
+
+def check_dump(name, dump, segments, log_path):
+    flashed = open(dump, "rb").read() if os.path.exists(dump) else b""
+    expected = expected_flash(segments)
+    if flashed != expected:
+        first = next((i for i in range(min(len(flashed), len(expected))) if flashed[i] != expected[i]),
+                     min(len(flashed), len(expected)))
+        fail("%s: flash differs from the image at 0x%05X" % (name, first), log_path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="bslprog sessions against bsl_sim")
+    parser.add_argument("--bslprog", required=True, help="bslprog executable")
+    parser.add_argument("--sim", required=True, help="bsl_sim executable")
+    parser.add_argument("--work", required=True, help="scratch directory, emptied first")
+    args = parser.parse_args()
+    shutil.rmtree(args.work, ignore_errors=True)
+    os.makedirs(args.work)
+
+    # Binary at an address, 4 KiB, CRC verified
+    binary = {0x4000: make_image(4096 + 5, 11)}
+    image_path = os.path.join(args.work, "app.bin")
+    with open(image_path, "wb") as f:
+        f.write(binary[0x4000])
+    text, dump, log_path = run(args, "bin", ["--address", "0x4000", "--baud", "1000000"], image_path)
+    check_dump("bin", dump, binary, log_path)
+    if not re.search(rb"Verified 4104 bytes", text):
+        fail("bin: no verification", log_path)
+
+    # Sparse HEX: unaligned records in two places, one with 256 erased bytes
+    # inside it
+    sparse = {
+        0x0003: make_image(301, 12),
+        0x10005: make_image(64, 13) + b"\xff" * 256 + make_image(35, 14),
+    }
+    image_path = os.path.join(args.work, "app.hex")
+    write_hex(image_path, sparse)
+    text, dump, log_path = run(args, "hex", ["--chunk", "64", "--verify", "readback"], image_path)
+    check_dump("hex", dump, sparse, log_path)
+    skipped = re.search(rb"skipped (\d+) erased bytes", text)
+    if skipped is None or int(skipped.group(1)) < 192:
+        fail("hex: erased frames were not skipped", log_path)
+
+    # --no-start leaves the target in the BSL
+    _, dump, log_path = run(args, "no_start", ["--no-start"], image_path)
+    if os.path.exists(dump):
+        fail("no_start: the target was started", log_path)
+
+    # A broken image never reaches the port
+    image_path = os.path.join(args.work, "broken.hex")
+    with open(image_path, "w") as f:
+        f.write(":0400000001020304F3\n:00000001FF\n")
+    text, dump, log_path = run(args, "broken", [], image_path, expect_status=1)
+    if b"line 1: bad length or checksum" not in text or b"BSL ready" in text:
+        fail("broken: the bad checksum was not reported before connecting", log_path)
+    print("PASS: bslprog programmed a binary and a sparse HEX image")
+
+
+if __name__ == "__main__":
+    main()
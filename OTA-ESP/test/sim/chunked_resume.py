@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+# Prathik Narsetty
+# Chunked upload over HTTP that drops, resumes after a gateway reset, and
+# programs the simulator
+#
+# Runs the native gateway built with WIFI_SSID ([env:native_http]) against
+# tools/bslprog/bsl_sim with the upload server on a loopback port, then:
+#
+#   1. checks that /upload/begin refuses chunk sizes of 0, above 4096 and
+#      ones that only fit after truncation to 16 bits
+#   2. starts a chunked upload and sends the first half of the chunks
+#   3. kills the gateway, as a reset in the middle of the upload would
+#   4. restarts it and runs tools/chunked_upload.py, which must find the
+#      first half on the gateway, send only the rest, and commit
+#   5. checks the simulator's flash dump once the session has ended
+#
+#   python3 test/sim/chunked_resume.py --program build/gateway_http \
+#       --sim build/bsl_sim --work /tmp/resume
+
+import argparse
+import os
+import re
+import shutil
+import socket
+import subprocess
+import sys
+import time
+import zlib
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(os.path.dirname(HERE))
+sys.path.insert(0, HERE)
+sys.path.insert(0, os.path.join(ROOT, "tools"))
+import chunked_upload  # noqa: E402
+from sim_session import SESSION_TIMEOUT_S, check_flash, check_log_times, fail, make_image, \
+    start_simulator, stop  # noqa: E402
+
+CHUNK = 512
+LISTEN_TIMEOUT_S = 10
+
+
+def free_port():
+    with socket.socket() as probe:
+        probe.bind(("127.0.0.1", 0))
+        return probe.getsockname()[1]
+
+
+def start_gateway(args, tty, fs, port, log_path):
+    log = open(log_path, "wb")
+    gateway = subprocess.Popen([args.program, "--port", tty, "--fs", fs, "--http", str(port)],
+                               stdin=subprocess.PIPE, stdout=log, stderr=subprocess.STDOUT)
+    deadline = time.monotonic() + LISTEN_TIMEOUT_S
+    while time.monotonic() < deadline:
+        try:
+            socket.create_connection(("127.0.0.1", port), timeout=1).close()
+            return gateway
+        except OSError:
+            time.sleep(0.05)
+    stop(gateway)
+    fail("upload server not listening on port %d" % port, log_path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Chunked upload resume against the native gateway")
+    parser.add_argument("--program", required=True, help="native gateway built with WIFI_SSID")
+    parser.add_argument("--sim", required=True, help="bsl_sim executable")
+    parser.add_argument("--work", required=True, help="scratch directory, emptied first")
+    parser.add_argument("--image-bytes", type=int, default=6000)
+    args = parser.parse_args()
+
+    image = make_image(args.image_bytes, 31)
+    crc = zlib.crc32(image)
+    shutil.rmtree(args.work, ignore_errors=True)
+    fs = os.path.join(args.work, "fs")
+    os.makedirs(fs)
+    image_path = os.path.join(args.work, "app.bin")
+    with open(image_path, "wb") as f:
+        f.write(image)
+    dump = os.path.join(args.work, "flash.bin")
+    first_log = os.path.join(args.work, "first.log")
+    second_log = os.path.join(args.work, "second.log")
+    port = free_port()
+    base = "http://127.0.0.1:%d" % port
+
+    simulator, tty = start_simulator(args.sim, dump, "uart", [])
+    gateway = None
+    try:
+        gateway = start_gateway(args, tty, fs, port, first_log)
+
+        for chunk in (0, 4097, 65536 + CHUNK):
+            code, _ = chunked_upload.request(base, "POST", "/upload/begin?size=%d&chunk=%d&crc=%08x" % (
+                len(image), chunk, crc))
+            if code != 400:
+                fail("begin with chunk %d answered %d, expected 400" % (chunk, code), first_log)
+
+        code, state = chunked_upload.request(base, "POST", "/upload/begin?size=%d&chunk=%d&crc=%08x" % (
+            len(image), CHUNK, crc))
+        if code != 200 or state["received"] != 0:
+            fail("begin answered %d %r" % (code, state), first_log)
+        half = (len(image) // CHUNK // 2) * CHUNK
+        for offset in range(0, half, CHUNK):
+            data = image[offset:offset + CHUNK]
+            code, rsp = chunked_upload.request(base, "PUT", "/upload/chunk?offset=%d&crc=%08x" % (
+                offset, zlib.crc32(data)), data)
+            if code != 200 or rsp["result"] != "ok":
+                fail("chunk %d answered %d %r" % (offset, code, rsp), first_log)
+        code, state = chunked_upload.request(base, "GET", "/upload/missing")
+        if state["missing"] != [[half, len(image)]]:
+            fail("missing ranges %r, expected [[%d, %d]]" % (state["missing"], half, len(image)), first_log)
+
+        # Reset in the middle of the upload
+        stop(gateway)
+        gateway = start_gateway(args, tty, fs, port, second_log)
+        client = subprocess.run([sys.executable, os.path.join(ROOT, "tools", "chunked_upload.py"),
+                                 "--chunk", str(CHUNK), "127.0.0.1:%d" % port, image_path],
+                                capture_output=True, text=True, timeout=SESSION_TIMEOUT_S)
+        if client.returncode != 0:
+            fail("chunked_upload.py: %s" % (client.stdout + client.stderr).strip(), second_log)
+        resumed = re.search(r"session: (\d+)/(\d+) bytes already", client.stdout)
+        sent = re.search(r"sent (\d+) bytes", client.stdout)
+        if not resumed or int(resumed.group(1)) != half or not sent or int(sent.group(1)) != len(image) - half:
+            fail("client did not resume at %d: %s" % (half, client.stdout.strip()), second_log)
+
+        # Console input is held until the committed image's session has ended
+        gateway.stdin.write(b"trace\n")
+        gateway.stdin.close()
+        try:
+            status = gateway.wait(SESSION_TIMEOUT_S)
+        except subprocess.TimeoutExpired:
+            fail("no result after %u s" % SESSION_TIMEOUT_S, second_log)
+        gateway = None
+    finally:
+        if gateway is not None:
+            stop(gateway)
+        stop(simulator)
+
+    if status != 0:
+        fail("exit status %d" % status, second_log)
+    if b"Resumed upload" not in open(second_log, "rb").read():
+        fail("the journal was not restored", second_log)
+    check_flash(dump, image, second_log)
+    check_log_times(second_log)
+    print("PASS: %d bytes resumed at %d after a reset and programmed" % (len(image), half))
+
+
+if __name__ == "__main__":
+    main()
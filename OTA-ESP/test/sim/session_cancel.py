@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+# Prathik Narsetty
+# Progress and cancellation of a running session over HTTP
+#
+# Runs the native gateway built with WIFI_SSID ([env:native_http]) against
+# tools/bslprog/bsl_sim with a new image in its filesystem, so a session
+# starts at boot, then:
+#
+#   1. polls /status while the session runs; the server must answer during
+#      the program phase and the bytes done must grow
+#   2. cancels with POST /cancel and waits for lastResult "cancelled", with
+#      the image slot not marked failed
+#   3. queues "program" on the console, which runs once the cancelled
+#      session has ended, and checks the simulator's flash dump afterwards
+#
+# With --app-header the image carries an application header, which the
+# cancelled session already wrote to the target; the next session must
+# program in full all the same. --restart starts a new gateway for it, as
+# after a power loss, so only the target's image CRC can tell.
+#
+#   python3 test/sim/session_cancel.py --program build/gateway_http \
+#       --sim build/bsl_sim --work /tmp/cancel
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(os.path.dirname(HERE))
+sys.path.insert(0, HERE)
+sys.path.insert(0, os.path.join(ROOT, "tools"))
+import chunked_upload  # noqa: E402
+from chunked_resume import free_port, start_gateway  # noqa: E402
+from sim_session import SESSION_TIMEOUT_S, check_flash, check_log_times, fail, make_image, \
+    stamp_app_header, start_simulator, stop  # noqa: E402
+
+POLL_S = 0.02
+
+
+def wait_status(base, log_path, what, done):
+    """Poll /status until done(status) holds; returns that status."""
+    deadline = time.monotonic() + SESSION_TIMEOUT_S
+    while time.monotonic() < deadline:
+        code, status = chunked_upload.request(base, "GET", "/status")
+        if code != 200:
+            fail("/status answered %d" % code, log_path)
+        if done(status):
+            return status
+        time.sleep(POLL_S)
+    fail("no %s after %u s" % (what, SESSION_TIMEOUT_S), log_path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Session progress and cancel against the native gateway")
+    parser.add_argument("--program", required=True, help="native gateway built with WIFI_SSID")
+    parser.add_argument("--sim", required=True, help="bsl_sim executable")
+    parser.add_argument("--work", required=True, help="scratch directory, emptied first")
+    parser.add_argument("--image-bytes", type=int, default=32768)
+    parser.add_argument("--app-header", action="store_true", help="stamp an application header into the image")
+    parser.add_argument("--restart", action="store_true", help="program from a new gateway after the cancel")
+    args = parser.parse_args()
+
+    image = make_image(args.image_bytes, 47)
+    shutil.rmtree(args.work, ignore_errors=True)
+    fs = os.path.join(args.work, "fs")
+    os.makedirs(fs)
+    with open(os.path.join(fs, "mspm0_firmware.bin"), "wb") as f:
+        f.write(image)
+    if args.app_header:
+        image = stamp_app_header(os.path.join(fs, "mspm0_firmware.bin"))
+    dump = os.path.join(args.work, "flash.bin")
+    log_path = os.path.join(args.work, "run.log")
+    port = free_port()
+    base = "http://127.0.0.1:%d" % port
+
+    simulator, tty = start_simulator(args.sim, dump, "uart", [])
+    gateway = None
+    try:
+        gateway = start_gateway(args, tty, fs, port, log_path)
+
+        first = wait_status(base, log_path, "program phase",
+                            lambda s: s.get("phase") == "program" and s["done"] > 0)
+        later = wait_status(base, log_path, "program progress",
+                            lambda s: s.get("phase") != "program" or s["done"] > first["done"])
+        if later.get("phase") != "program" or later["total"] != len(image):
+            fail("session left the program phase before the cancel: %r" % later, log_path)
+
+        code, rsp = chunked_upload.request(base, "POST", "/cancel")
+        if code != 202:
+            fail("/cancel answered %d %r" % (code, rsp), log_path)
+        status = wait_status(base, log_path, "cancelled session",
+                             lambda s: not s["programming"] and s["lastResult"] != "none")
+        if status["lastResult"] != "cancelled":
+            fail("session ended %r after the cancel" % status["lastResult"], log_path)
+        if status["slots"][status["activeSlot"]]["state"] == "failed":
+            fail("a cancel marked the image failed", log_path)
+
+        if args.restart:
+            stop(gateway)
+            gateway = None
+            log_path = os.path.join(args.work, "restart.log")
+            gateway = start_gateway(args, tty, fs, free_port(), log_path)
+        gateway.stdin.write(b"program\ntrace\n")
+        gateway.stdin.close()
+        try:
+            result = gateway.wait(SESSION_TIMEOUT_S)
+        except subprocess.TimeoutExpired:
+            fail("no result after %u s" % SESSION_TIMEOUT_S, log_path)
+        gateway = None
+    finally:
+        if gateway is not None:
+            stop(gateway)
+        stop(simulator)
+
+    if result != 0:
+        fail("exit status %d" % result, log_path)
+    text = open(log_path, "rb").read()
+    if not args.restart and b"OTA Programming cancelled" not in text:
+        fail("no cancel in the log", log_path)
+    if b"skipping programming" in text or b"Data verification completed" not in text:
+        fail("the session after the cancel did not program the image", log_path)
+    if args.app_header:
+        reason = b"partly programmed" if args.restart else b"Last session did not complete"
+        if reason not in text:
+            fail("no %r before the full programming" % reason.decode(), log_path)
+    check_flash(dump, image, log_path)
+    check_log_times(log_path)
+    print("PASS: cancelled at %d/%d bytes, then programmed" % (later["done"], len(image)))
+
+
+if __name__ == "__main__":
+    main()
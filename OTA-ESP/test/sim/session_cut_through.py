@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+# Prathik Narsetty
+# Cut-through upload: the session programs the image while it arrives
+#
+# Runs the native gateway built with WIFI_SSID ([env:native_http]) against
+# tools/bslprog/bsl_sim with an empty filesystem, then posts an image to
+# /upload?mode=cut-through. The upload must answer in cut-through mode, the
+# stored image must be the active slot, marked good, and the simulator's
+# flash dump must hold the image once the session has ended.
+#
+# With --abort the client sends half the image and closes the connection
+# once the session is programming. The session must end failed, no slot may
+# be stored or activated, and the target must never have been started.
+#
+#   python3 test/sim/session_cut_through.py --program build/gateway_http \
+#       --sim build/bsl_sim --work /tmp/cut-through [--abort]
+
+import argparse
+import os
+import shutil
+import socket
+import subprocess
+import sys
+import time
+import zlib
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(os.path.dirname(HERE))
+sys.path.insert(0, HERE)
+sys.path.insert(0, os.path.join(ROOT, "tools"))
+import chunked_upload  # noqa: E402
+from chunked_resume import free_port, start_gateway  # noqa: E402
+from session_cancel import wait_status  # noqa: E402
+from sim_session import SESSION_TIMEOUT_S, check_flash, check_log_times, fail, make_image, \
+    start_simulator, stop  # noqa: E402
+
+UPLOAD_PATH = "/upload?mode=cut-through"
+
+
+def wait_log(log_path, text):
+    deadline = time.monotonic() + SESSION_TIMEOUT_S
+    while time.monotonic() < deadline:
+        if text in open(log_path, "rb").read():
+            return
+        time.sleep(0.02)
+    fail("no %r in the log after %u s" % (text.decode(), SESSION_TIMEOUT_S), log_path)
+
+
+def upload_half(port, image, log_path):
+    """Announce the whole image, send half of it, and drop the connection
+    once the session is programming from it"""
+    client = socket.create_connection(("127.0.0.1", port))
+    client.sendall(b"POST %s HTTP/1.1\r\nHost: 127.0.0.1\r\n"
+                   b"Content-Type: application/octet-stream\r\nContent-Length: %d\r\n\r\n"
+                   % (UPLOAD_PATH.encode(), len(image)))
+    client.sendall(image[:len(image) // 2])
+    wait_log(log_path, b"Programmed ")
+    client.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Cut-through upload against the native gateway")
+    parser.add_argument("--program", required=True, help="native gateway built with WIFI_SSID")
+    parser.add_argument("--sim", required=True, help="bsl_sim executable")
+    parser.add_argument("--work", required=True, help="scratch directory, emptied first")
+    parser.add_argument("--image-bytes", type=int, default=16384)
+    parser.add_argument("--abort", action="store_true", help="drop the upload halfway")
+    args = parser.parse_args()
+
+    image = make_image(args.image_bytes, 61)
+    shutil.rmtree(args.work, ignore_errors=True)
+    fs = os.path.join(args.work, "fs")
+    os.makedirs(fs)
+    dump = os.path.join(args.work, "flash.bin")
+    log_path = os.path.join(args.work, "run.log")
+    port = free_port()
+    base = "http://127.0.0.1:%d" % port
+
+    simulator, tty = start_simulator(args.sim, dump, "uart", [])
+    gateway = None
+    try:
+        gateway = start_gateway(args, tty, fs, port, log_path)
+        if args.abort:
+            upload_half(port, image, log_path)
+        else:
+            code, rsp = chunked_upload.request(base, "POST", UPLOAD_PATH, image, timeout=SESSION_TIMEOUT_S)
+            if code != 202 or rsp["mode"] != "cut-through" or rsp["bytes"] != len(image):
+                fail("cut-through upload answered %d %r" % (code, rsp), log_path)
+
+        status = wait_status(base, log_path, "end of the cut-through session",
+                             lambda s: not s["programming"] and s["lastResult"] != "none")
+        if args.abort:
+            if status["lastResult"] != "failed":
+                fail("aborted upload's session ended %r" % status["lastResult"], log_path)
+            if status["activeSlot"] != -1 or any(slot["state"] != "empty" for slot in status["slots"]):
+                fail("aborted upload left slots %r, active %d" % (status["slots"], status["activeSlot"]),
+                     log_path)
+        else:
+            if status["lastResult"] != "ok":
+                fail("cut-through session ended %r" % status["lastResult"], log_path)
+            active = status["activeSlot"]
+            if active != rsp["slot"]:
+                fail("active slot %d, the upload was stored in %d" % (active, rsp["slot"]), log_path)
+            slot = status["slots"][active]
+            if slot["state"] != "good" or slot["size"] != len(image) or slot["crc"] != zlib.crc32(image):
+                fail("active slot %r does not hold the image" % slot, log_path)
+
+        gateway.stdin.write(b"trace\n")
+        gateway.stdin.close()
+        try:
+            result = gateway.wait(SESSION_TIMEOUT_S)
+        except subprocess.TimeoutExpired:
+            fail("no result after %u s" % SESSION_TIMEOUT_S, log_path)
+        gateway = None
+    finally:
+        if gateway is not None:
+            stop(gateway)
+        stop(simulator)
+
+    # The exit status tells whether the last session failed
+    if result != (1 if args.abort else 0):
+        fail("exit status %d" % result, log_path)
+    text = open(log_path, "rb").read()
+    if b"cut-through=1" not in text or b"=== CUT-THROUGH OTA PROGRAMMING ===" not in text:
+        fail("the upload did not start a cut-through session", log_path)
+    if b"retrying from stored image" in text:
+        fail("the image was programmed from storage, not as it arrived", log_path)
+    if args.abort:
+        if b"Upload aborted after" not in text:
+            fail("the upload was not aborted", log_path)
+        if os.path.exists(dump):
+            fail("the target was started after an aborted upload", log_path)
+        if os.path.exists(os.path.join(fs, "upload.tmp")):
+            fail("the aborted upload was left in the filesystem", log_path)
+        print("PASS: upload dropped at %d/%d bytes, session failed, nothing stored"
+              % (len(image) // 2, len(image)))
+    else:
+        check_flash(dump, image, log_path)
+        print("PASS: %d bytes programmed while they arrived" % len(image))
+    check_log_times(log_path)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+# Prathik Narsetty
+# Delta upload against the image the gateway stores
+#
+# Runs the native gateway built with WIFI_SSID ([env:native_http]) against
+# tools/bslprog/bsl_sim with an old image in its filesystem, so a session
+# stores and programs it at boot, then:
+#
+#   1. makes a patch to a new image with tools/delta/otadelta, and checks
+#      that `otadelta apply` rebuilds the new image from it
+#   2. posts a patch made against another image to /upload/delta, which
+#      must be refused with 409 and leave the slots as they were
+#   3. posts the patch, which must rebuild the new image into a slot of its
+#      own, and checks the simulator's flash dump once its session has ended
+#
+#   python3 test/sim/session_delta.py --program build/gateway_http \
+#       --otadelta build/otadelta --sim build/bsl_sim --work /tmp/delta
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import zlib
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(os.path.dirname(HERE))
+sys.path.insert(0, HERE)
+sys.path.insert(0, os.path.join(ROOT, "tools"))
+import chunked_upload  # noqa: E402
+from chunked_resume import free_port, start_gateway  # noqa: E402
+from session_cancel import wait_status  # noqa: E402
+from sim_session import SESSION_TIMEOUT_S, check_flash, check_log_times, fail, make_image, \
+    start_simulator, stop  # noqa: E402
+
+
+def new_image(old):
+    """The old image with a few bytes changed, a block inserted and a tail
+    appended, as an incremental release would look; whole flash words, as
+    the BSL programs them"""
+    image = bytearray(old)
+    for at in range(100, len(image), 997):
+        image[at] ^= 0x5A
+    third = len(image) // 3
+    return bytes(image[:third]) + make_image(296, 52) + bytes(image[third:]) + make_image(64, 53)
+
+
+def otadelta(args, log_path, *command):
+    result = subprocess.run([args.otadelta] + list(command), capture_output=True, text=True)
+    if result.returncode != 0:
+        fail("otadelta %s: %s" % (command[0], (result.stdout + result.stderr).strip()), log_path)
+    return result.stdout
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Delta upload against the native gateway")
+    parser.add_argument("--program", required=True, help="native gateway built with WIFI_SSID")
+    parser.add_argument("--otadelta", required=True, help="otadelta executable")
+    parser.add_argument("--sim", required=True, help="bsl_sim executable")
+    parser.add_argument("--work", required=True, help="scratch directory, emptied first")
+    parser.add_argument("--image-bytes", type=int, default=12000)
+    args = parser.parse_args()
+
+    old = make_image(args.image_bytes, 51)
+    new = new_image(old)
+    shutil.rmtree(args.work, ignore_errors=True)
+    fs = os.path.join(args.work, "fs")
+    os.makedirs(fs)
+    with open(os.path.join(fs, "mspm0_firmware.bin"), "wb") as f:
+        f.write(old)
+    paths = {name: os.path.join(args.work, name)
+             for name in ("old.bin", "new.bin", "other.bin", "new.delta", "other.delta", "rebuilt.bin")}
+    for name, data in (("old.bin", old), ("new.bin", new), ("other.bin", make_image(args.image_bytes, 54))):
+        with open(paths[name], "wb") as f:
+            f.write(data)
+    dump = os.path.join(args.work, "flash.bin")
+    log_path = os.path.join(args.work, "run.log")
+
+    otadelta(args, log_path, "make", paths["old.bin"], paths["new.bin"], paths["new.delta"])
+    otadelta(args, log_path, "apply", paths["old.bin"], paths["new.delta"], paths["rebuilt.bin"])
+    if open(paths["rebuilt.bin"], "rb").read() != new:
+        fail("otadelta apply did not rebuild the new image", log_path)
+    otadelta(args, log_path, "make", paths["other.bin"], paths["new.bin"], paths["other.delta"])
+    patch = open(paths["new.delta"], "rb").read()
+    if len(patch) * 4 > len(new):
+        fail("%d-byte patch for a %d-byte image" % (len(patch), len(new)), log_path)
+
+    port = free_port()
+    base = "http://127.0.0.1:%d" % port
+    simulator, tty = start_simulator(args.sim, dump, "uart", [])
+    gateway = None
+    try:
+        gateway = start_gateway(args, tty, fs, port, log_path)
+        status = wait_status(base, log_path, "session of the old image",
+                             lambda s: not s["programming"] and not s["queued"] and s["lastResult"] != "none")
+        if status["lastResult"] != "ok":
+            fail("old image session ended %r" % status["lastResult"], log_path)
+        old_slot = status["activeSlot"]
+        if status["slots"][old_slot]["crc"] != zlib.crc32(old):
+            fail("active slot %r is not the old image" % status["slots"][old_slot], log_path)
+
+        code, rsp = chunked_upload.request(base, "POST", "/upload/delta", open(paths["other.delta"], "rb").read())
+        if code != 409 or rsp["result"] != "no-base-image":
+            fail("patch against another image answered %d %r" % (code, rsp), log_path)
+        code, unchanged = chunked_upload.request(base, "GET", "/status")
+        if unchanged["slots"] != status["slots"] or unchanged["activeSlot"] != old_slot:
+            fail("a refused patch changed the slots: %r" % unchanged["slots"], log_path)
+
+        code, rsp = chunked_upload.request(base, "POST", "/upload/delta", patch)
+        if code != 202 or rsp["mode"] != "delta" or rsp["bytes"] != len(patch) or rsp["size"] != len(new):
+            fail("/upload/delta answered %d %r" % (code, rsp), log_path)
+        if rsp["slot"] == old_slot:
+            fail("the new image replaced the old one in slot %d" % old_slot, log_path)
+
+        # Console input is held until the new image's session has ended
+        gateway.stdin.write(b"trace\n")
+        gateway.stdin.close()
+        try:
+            result = gateway.wait(SESSION_TIMEOUT_S)
+        except subprocess.TimeoutExpired:
+            fail("no result after %u s" % SESSION_TIMEOUT_S, log_path)
+        gateway = None
+    finally:
+        if gateway is not None:
+            stop(gateway)
+        stop(simulator)
+
+    if result != 0:
+        fail("exit status %d" % result, log_path)
+    text = open(log_path, "rb").read()
+    if b"Applying delta to image #1 in slot %d" % old_slot not in text:
+        fail("the patch was not applied to the stored image", log_path)
+    check_flash(dump, new, log_path)
+    check_log_times(log_path)
+    print("PASS: %d-byte patch rebuilt and programmed a %d-byte image" % (len(patch), len(new)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+# Prathik Narsetty
+# One programming session of the native gateway against the BSL simulator
+#
+# Puts a generated image where uploadfs would, starts tools/bslprog/bsl_sim
+# and the native gateway on its pty, feeds the console script on stdin and
+# checks the outcome:
+#
+#   - the gateway exits with the expected status
+#   - the simulator's flash dump starts with the image (or, with --no-flash,
+#     that no Start Application happened)
+#   - log timestamps never go backwards, whichever task printed them
+#   - every --expect regular expression matches the log
+#   - every --trace regular expression matches a record of the trace dump,
+#     decoded by tools/trace_decode.py
+#   - no --absent file is left in the gateway's filesystem
+#
+# --sign KEY signs the image with tools/sign_image.py first, for gateways
+# built with IMAGE_SIGNING_KEY. --app-header stamps an application header
+# (include/app_header.h) into it with tools/app_header.py, so sessions can
+# find the image already installed.
+#
+# Run by ctest (test/CMakeLists.txt); by hand from OTA-ESP/:
+#   python3 test/sim/sim_session.py --program build/gateway --sim build/bsl_sim \
+#       --work /tmp/uart --link uart --expect "Image SHA-256 .* matches"
+
+import argparse
+import os
+import random
+import re
+import shutil
+import struct
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+sys.path.insert(0, os.path.join(ROOT, "tools"))
+import trace_decode  # noqa: E402
+
+SESSION_TIMEOUT_S = 120
+
+# Gateway option naming the tty, simulator options for each BSL link
+LINKS = {
+    "uart": ("--port", []),
+    "spi": ("--spi", ["--spi"]),
+    "i2c": ("--i2c", ["--i2c"]),
+}
+
+LOG_TIME = re.compile(rb"^\[\s*(\d+)\] ", re.MULTILINE)
+
+APP_HEADER_OFFSET = 0xC0
+APP_HEADER_MAGIC = 0x48505041
+
+
+def fail(message, log_path):
+    sys.exit("FAIL: %s (log: %s)" % (message, log_path))
+
+
+def make_image(size, seed):
+    generator = random.Random(seed)
+    return bytes(generator.getrandbits(8) for _ in range(size))
+
+
+def stamp_app_header(path):
+    """Put an application header placeholder into the image at path and let
+    tools/app_header.py fill in its length and CRC; returns the new image."""
+    image = bytearray(open(path, "rb").read())
+    struct.pack_into("<IIII", image, APP_HEADER_OFFSET, APP_HEADER_MAGIC, 1, 0xFFFFFFFF, 0xFFFFFFFF)
+    with open(path, "wb") as f:
+        f.write(image)
+    subprocess.run([sys.executable, os.path.join(ROOT, "tools", "app_header.py"), path], check=True,
+                   stdout=subprocess.DEVNULL)
+    return open(path, "rb").read()
+
+
+def start_simulator(sim, dump, link, extra_args):
+    """bsl_sim on a new pty; returns the process and the pty path."""
+    simulator = subprocess.Popen([sim, "--dump", dump] + LINKS[link][1] + extra_args,
+                                 stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, text=True)
+    return simulator, simulator.stdout.readline().strip()
+
+
+def stop(process):
+    process.kill()
+    process.wait()
+
+
+def check_flash(dump, image, log_path):
+    flashed = open(dump, "rb").read(len(image)) if os.path.exists(dump) else b""
+    if flashed != image:
+        fail("flash dump does not start with the image", log_path)
+
+
+def check_log_times(log_path):
+    last = 0
+    for match in LOG_TIME.finditer(open(log_path, "rb").read()):
+        now = int(match.group(1))
+        if now < last:
+            fail("timestamp %d after %d" % (now, last), log_path)
+        last = now
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Native gateway session against bsl_sim")
+    parser.add_argument("--program", required=True, help="native gateway executable")
+    parser.add_argument("--sim", required=True, help="bsl_sim executable")
+    parser.add_argument("--work", required=True, help="scratch directory, emptied first")
+    parser.add_argument("--link", choices=sorted(LINKS), default="uart")
+    parser.add_argument("--gateway-arg", action="append", default=[])
+    parser.add_argument("--sim-arg", action="append", default=[])
+    parser.add_argument("--image-bytes", type=int, default=8192)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--console", action="append", help="console line, default trace")
+    parser.add_argument("--status", type=int, default=0, help="expected exit status")
+    parser.add_argument("--no-flash", action="store_true", help="expect the target not to be started")
+    parser.add_argument("--expect", action="append", default=[], help="regular expression the log must match")
+    parser.add_argument("--trace", action="append", default=[], help="regular expression a trace record must match")
+    parser.add_argument("--absent", action="append", default=[], help="file the gateway must not keep")
+    parser.add_argument("--sign", metavar="KEY", help="sign the image with this PEM key")
+    parser.add_argument("--app-header", action="store_true", help="stamp an application header into the image")
+    args = parser.parse_args()
+
+    image = make_image(args.image_bytes, args.seed)
+    shutil.rmtree(args.work, ignore_errors=True)
+    fs = os.path.join(args.work, "fs")
+    os.makedirs(fs)
+    upload = os.path.join(fs, "mspm0_firmware.bin")
+    with open(upload, "wb") as f:
+        f.write(image)
+    if args.app_header:
+        image = stamp_app_header(upload)
+    if args.sign:
+        subprocess.run([sys.executable, os.path.join(ROOT, "tools", "sign_image.py"), "sign", args.sign,
+                        upload, upload], check=True, stdout=subprocess.DEVNULL)
+    dump = os.path.join(args.work, "flash.bin")
+    log_path = os.path.join(args.work, "run.log")
+
+    simulator, tty = start_simulator(args.sim, dump, args.link, args.sim_arg)
+    try:
+        console = "".join(line + "\n" for line in args.console or ["trace"])
+        with open(log_path, "wb") as log:
+            try:
+                status = subprocess.run([args.program] + args.gateway_arg + [LINKS[args.link][0], tty, "--fs", fs],
+                                        input=console.encode(), stdout=log, stderr=subprocess.STDOUT,
+                                        timeout=SESSION_TIMEOUT_S).returncode
+            except subprocess.TimeoutExpired:
+                fail("no result after %u s" % SESSION_TIMEOUT_S, log_path)
+    finally:
+        stop(simulator)
+
+    if status != args.status:
+        fail("exit status %d, expected %d" % (status, args.status), log_path)
+    if args.no_flash:
+        if os.path.exists(dump):
+            fail("the target was started", log_path)
+    else:
+        check_flash(dump, image, log_path)
+    check_log_times(log_path)
+    text = open(log_path, "rb").read()
+    for pattern in args.expect:
+        if not re.search(pattern.encode(), text):
+            fail("no match for %r" % pattern, log_path)
+    if args.trace:
+        try:
+            records = trace_decode.parse(trace_decode.extract_blob(text))["records"]
+        except ValueError as error:
+            fail("trace dump: %s" % error, log_path)
+        lines = [trace_decode.describe(event, arg0, arg1) for _, event, arg0, arg1 in records]
+        for pattern in args.trace:
+            if not any(re.search(pattern, line) for line in lines):
+                fail("no trace record matching %r" % pattern, log_path)
+    for name in args.absent:
+        if os.path.exists(os.path.join(fs, name)):
+            fail("%s was left in the filesystem" % name, log_path)
+    print("PASS: %s over %s, %d bytes" % (os.path.basename(args.program), args.link, len(image)))
+
+
+if __name__ == "__main__":
+    main()
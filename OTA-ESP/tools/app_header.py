@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+# Prathik Narsetty
+# Fill in the application header of an MSPM0 image (include/app_header.h)
+#
+# The target application reserves the header at 0xC0 with length and crc
+# erased. Run this on the .bin after every build: it pads the image to a
+# multiple of 8 bytes (the flash word size), then writes length and the BSL
+# CRC32 over the image without the crc field. --check only verifies.
+#
+#   python3 tools/app_header.py build/app.bin
+#   python3 tools/app_header.py --version 7 build/app.bin
+#   python3 tools/app_header.py --check data/mspm0_firmware.bin
+
+import argparse
+import struct
+import sys
+import zlib
+
+APP_HEADER_OFFSET = 0xC0
+APP_HEADER_MAGIC = 0x48505041
+HEADER = struct.Struct("<IIII")
+CRC_OFFSET = APP_HEADER_OFFSET + 12
+FLASH_WORD = 8
+
+
+def bsl_crc32(image):
+    """BSL CRC32 (no final xor) over the image without the crc field."""
+    crc = zlib.crc32(image[:CRC_OFFSET])
+    crc = zlib.crc32(image[CRC_OFFSET + 4:], crc)
+    return crc ^ 0xFFFFFFFF
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Fill in or check the MSPM0 application header")
+    parser.add_argument("image", help="raw binary image starting at address 0")
+    parser.add_argument("--version", type=lambda v: int(v, 0),
+                        help="override the version set by the application")
+    parser.add_argument("--check", action="store_true", help="verify only, do not modify")
+    args = parser.parse_args()
+
+    image = bytearray(open(args.image, "rb").read())
+    if len(image) < APP_HEADER_OFFSET + HEADER.size:
+        sys.exit("%s: too short for an application header" % args.image)
+    magic, version, length, crc = HEADER.unpack_from(image, APP_HEADER_OFFSET)
+    if magic != APP_HEADER_MAGIC:
+        sys.exit("%s: no application header at 0x%X" % (args.image, APP_HEADER_OFFSET))
+
+    if args.check:
+        ok = length == len(image) and crc == bsl_crc32(image)
+        print("version %u, %u bytes, crc %08X: %s" % (version, length, crc, "ok" if ok else "MISMATCH"))
+        sys.exit(0 if ok else 1)
+
+    image += b"\xff" * (-len(image) % FLASH_WORD)
+    if args.version is not None:
+        version = args.version
+    HEADER.pack_into(image, APP_HEADER_OFFSET, magic, version, len(image), 0xFFFFFFFF)
+    crc = bsl_crc32(image)
+    HEADER.pack_into(image, APP_HEADER_OFFSET, magic, version, len(image), crc)
+    open(args.image, "wb").write(image)
+    print("version %u, %u bytes, crc %08X" % (version, len(image), crc))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,527 @@
+// Prathik Narsetty
+// MSPM0 UART/SPI/I2C BSL simulator on a pseudo-terminal
+//
+// Opens a pty, prints the path of its slave end and answers BSL frames on it
+// the way the MSPM0 bootloader does: UART ACK, then the core response packet
+// for the commands that have one. Flash is 128 KB of NOR (programming can
+// only clear bits) behind the password lock, so bslprog or any other host
+// can be run end to end without hardware:
+//
+//   g++ -std=c++17 -O2 -Wall -Iinclude tools/bslprog/bsl_sim.cpp -o bsl_sim
+//   ./bsl_sim --dump flash.bin &           # prints e.g. /dev/pts/5
+//   ./bslprog --port /dev/pts/5 app.hex
+//
+// --boot-delay drops everything received for that long after start and after
+// each Start Application, like the bootcode before it hands over to the BSL.
+// --dump writes the flash contents to a file on every Start Application.
+//
+// --spi makes the pty an SPI link instead (the native gateway's SPI fake):
+// the simulator answers every byte it receives with exactly one byte, 0xFF
+// while it has nothing to send. A reply becomes visible only after the host
+// has clocked --spi-busy more fill bytes, like a BSL still working on the
+// command, and 0xFF bytes outside a frame are the host's polling, not noise.
+//
+// --i2c makes it an I2C target at address 0x48 behind the native gateway's
+// Wire fake: the pty carries transaction records (native/include/Wire.h).
+// Written bytes feed the frame parser; a read is not acknowledged while
+// nothing is queued and for --i2c-busy more attempts after a reply is queued,
+// and otherwise returns the next bytes of the reply.
+
+#include <deque>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bsl_frames.h"
+
+#define FLASH_BYTES (128 * 1024)
+#define FLASH_WORD_BYTES 8
+#define SRAM_BUFFER_START 0x20000160
+#define INTERPRETER_VERSION 0x0001
+#define BUILD_ID 0x0100
+#define PLUGIN_VERSION 0x0001
+#define MAX_BUFFER_BYTES 0x06C0
+
+// UART ACK values (the frame itself was bad)
+#define ACK_OK 0x00
+#define ACK_HEADER_INCORRECT 0x51
+#define ACK_CHECKSUM_INCORRECT 0x52
+#define ACK_PACKET_SIZE_ZERO 0x53
+#define ACK_PACKET_SIZE_TOO_BIG 0x54
+#define ACK_UNKNOWN_BAUD 0x56
+
+// Message statuses (the command was understood but refused)
+#define MSG_SUCCESS 0x00
+#define MSG_LOCKED 0x01
+#define MSG_PASSWORD_ERROR 0x02
+#define MSG_UNKNOWN_COMMAND 0x04
+#define MSG_INVALID_ADDRESS 0x05
+
+// Inter-byte timeout inside a frame
+#define FRAME_BYTE_TIMEOUT_MS 100
+
+// SPI mode: what the peripheral shifts out with nothing queued
+#define SPI_FILL_BYTE 0xFF
+
+// I2C mode: target address and the transaction records of the Wire fake
+#define I2C_TARGET_ADDRESS 0x48
+#define I2C_RECORD_WRITE 'W'
+#define I2C_RECORD_READ 'R'
+#define I2C_ACK 0x00
+#define I2C_NACK 0x02
+
+static uint8_t flash[FLASH_BYTES];
+static bool unlocked = false;
+static int ptyFd = -1;
+static uint32_t bootDelayMs = 0;
+static const char* dumpPath = nullptr;
+static bool spiMode = false;
+static uint32_t spiBusyBytes = 8;
+static bool i2cMode = false;
+static uint32_t i2cBusyReads = 2;
+static bool booting = false;
+// Polled modes: the reply waits here until the host fetches it
+static uint32_t busyLeft = 0;
+static std::deque<uint8_t> heldReply;
+static std::deque<uint8_t> i2cWritten;
+
+static const uint8_t DEFAULT_PASSWORD[BSL_PASSWORD_BYTES] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+static uint32_t nowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+// One SPI exchange: the byte shifted out while `byte` was shifted in
+static void spiAnswer() {
+  uint8_t out = SPI_FILL_BYTE;
+  if (busyLeft > 0) {
+    busyLeft--;
+  } else if (!heldReply.empty()) {
+    out = heldReply.front();
+    heldReply.pop_front();
+  }
+  while (write(ptyFd, &out, 1) < 0 && (errno == EINTR || errno == EAGAIN)) {
+  }
+}
+
+static void writeAll(const uint8_t* data, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(ptyFd, data, len);
+    if (n < 0) {
+      if (errno == EINTR || errno == EAGAIN) {
+        continue;
+      }
+      return;
+    }
+    data += n;
+    len -= n;
+  }
+}
+
+// Read one byte off the pty, or return false after timeoutMs (< 0 waits
+// forever)
+static bool readRaw(uint8_t& byte, int timeoutMs) {
+  for (;;) {
+    struct pollfd pfd = {ptyFd, POLLIN, 0};
+    int ready = poll(&pfd, 1, timeoutMs);
+    if (ready < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ready <= 0) {
+      return false;
+    }
+    ssize_t n = read(ptyFd, &byte, 1);
+    if (n == 1) {
+      return true;
+    }
+    if (n < 0 && errno != EINTR && errno != EAGAIN && errno != EIO) {
+      perror("read");
+      exit(1);
+    }
+    if (n < 0 && errno == EIO) {
+      usleep(10000);  // no host has the slave open right now
+    }
+  }
+}
+
+// Serve one I2C transaction record; false if none arrived in time
+static bool i2cTransaction(int timeoutMs) {
+  uint8_t header[4];
+  if (!readRaw(header[0], timeoutMs)) {
+    return false;
+  }
+  for (size_t i = 1; i < sizeof(header); i++) {
+    if (!readRaw(header[i], FRAME_BYTE_TIMEOUT_MS)) {
+      return false;
+    }
+  }
+  size_t len = header[2] | (header[3] << 8);
+  uint8_t answer = header[1] == I2C_TARGET_ADDRESS ? I2C_ACK : I2C_NACK;
+  if (header[0] == I2C_RECORD_WRITE) {
+    if (booting) {
+      answer = I2C_NACK;  // nothing listens until the BSL has started
+    }
+    for (size_t i = 0; i < len; i++) {
+      uint8_t byte;
+      if (!readRaw(byte, FRAME_BYTE_TIMEOUT_MS)) {
+        return false;
+      }
+      if (answer == I2C_ACK) {
+        i2cWritten.push_back(byte);
+      }
+    }
+    writeAll(&answer, 1);
+    return true;
+  }
+  // Read: the BSL does not answer its address until a reply is ready
+  if (answer == I2C_ACK && (heldReply.empty() || busyLeft > 0)) {
+    if (busyLeft > 0) {
+      busyLeft--;
+    }
+    answer = I2C_NACK;
+  }
+  writeAll(&answer, 1);
+  if (answer == I2C_ACK) {
+    for (size_t i = 0; i < len; i++) {
+      uint8_t byte = SPI_FILL_BYTE;  // the bus idles high past the reply
+      if (!heldReply.empty()) {
+        byte = heldReply.front();
+        heldReply.pop_front();
+      }
+      writeAll(&byte, 1);
+    }
+  }
+  return true;
+}
+
+// Next byte from the host, or false after timeoutMs (< 0 waits forever). In
+// SPI mode every byte is answered, in I2C mode bytes come from write
+// transactions while read transactions are served in between.
+static bool readByte(uint8_t& byte, int timeoutMs) {
+  if (i2cMode) {
+    uint32_t start = nowMs();
+    while (i2cWritten.empty()) {
+      int left = timeoutMs;
+      if (timeoutMs >= 0) {
+        left = timeoutMs - (int)(nowMs() - start);
+        if (left <= 0) {
+          return false;
+        }
+      }
+      i2cTransaction(left);
+    }
+    byte = i2cWritten.front();
+    i2cWritten.pop_front();
+    return true;
+  }
+  if (!readRaw(byte, timeoutMs)) {
+    return false;
+  }
+  if (spiMode) {
+    spiAnswer();
+  }
+  return true;
+}
+
+static void sendBytes(const uint8_t* data, size_t len) {
+  if (spiMode || i2cMode) {
+    // Queued until the host clocks or reads it out
+    if (heldReply.empty()) {
+      busyLeft = spiMode ? spiBusyBytes : i2cBusyReads;
+    }
+    heldReply.insert(heldReply.end(), data, data + len);
+    return;
+  }
+  writeAll(data, len);
+}
+
+static void sendAck(uint8_t ack) {
+  sendBytes(&ack, 1);
+}
+
+// ACK, then a core response packet [0x08][len][type][data][CRC]
+static void sendPacket(uint8_t type, const uint8_t* data, size_t len) {
+  static uint8_t rsp[1 + BSL_FRAME_OVERHEAD + 1024];
+  rsp[0] = ACK_OK;
+  uint8_t* packet = &rsp[1];
+  packet[BSL_HEADER_OFFSET] = RSP_HEADER;
+  bslPutLE16(&packet[BSL_LENGTH_OFFSET], (uint16_t)(1 + len));
+  packet[BSL_CMD_OFFSET] = type;
+  memcpy(&packet[BSL_CMD_DATA_OFFSET], data, len);
+  bslPutLE32(&packet[BSL_CMD_DATA_OFFSET + len], bslCrc32(&packet[BSL_CMD_OFFSET], 1 + len));
+  sendBytes(rsp, 1 + BSL_FRAME_OVERHEAD + len);
+}
+
+static void sendMessage(uint8_t status) {
+  sendPacket(RSP_MESSAGE, &status, 1);
+}
+
+static bool validRange(uint32_t address, uint32_t len) {
+  return address < FLASH_BYTES && len <= FLASH_BYTES - address;
+}
+
+static void dumpFlash() {
+  if (dumpPath == nullptr) {
+    return;
+  }
+  FILE* f = fopen(dumpPath, "wb");
+  if (f == nullptr || fwrite(flash, 1, sizeof(flash), f) != sizeof(flash)) {
+    perror(dumpPath);
+  }
+  if (f != nullptr) {
+    fclose(f);
+  }
+}
+
+static void dropInputFor(uint32_t ms) {
+  uint32_t start = nowMs();
+  uint8_t byte;
+  booting = true;
+  while (nowMs() - start < ms) {
+    readByte(byte, ms - (nowMs() - start));
+  }
+  booting = false;
+}
+
+static void setSpeed(uint8_t code) {
+  static const speed_t speeds[] = {0, B4800, B9600, B19200, B38400, B57600, B115200,
+                                   B1000000, B2000000, B3000000};
+  struct termios tio;
+  if (tcgetattr(ptyFd, &tio) == 0) {
+    cfsetispeed(&tio, speeds[code]);
+    cfsetospeed(&tio, speeds[code]);
+    tcsetattr(ptyFd, TCSADRAIN, &tio);
+  }
+}
+
+static void handleCommand(uint8_t cmd, const uint8_t* data, size_t len) {
+  switch (cmd) {
+    case CMD_CONNECTION:
+      sendAck(ACK_OK);
+      return;
+
+    case CMD_GET_ID: {
+      uint8_t info[24] = {};
+      bslPutLE16(&info[0], INTERPRETER_VERSION);
+      bslPutLE16(&info[2], BUILD_ID);
+      bslPutLE16(&info[8], PLUGIN_VERSION);
+      bslPutLE16(&info[10], MAX_BUFFER_BYTES);
+      bslPutLE32(&info[12], SRAM_BUFFER_START);
+      sendPacket(RSP_DEVICE_INFO, info, sizeof(info));
+      return;
+    }
+
+    case CMD_CHANGE_BAUD_RATE:
+      if (len != 1 || data[0] < BSL_BAUD_4800 || data[0] > BSL_BAUD_3000000) {
+        sendAck(ACK_UNKNOWN_BAUD);
+        return;
+      }
+      // ACK at the old speed, then switch
+      sendAck(ACK_OK);
+      if (!spiMode && !i2cMode) {
+        setSpeed(data[0]);
+      }
+      return;
+
+    case CMD_RX_PASSWORD:
+      unlocked = len == BSL_PASSWORD_BYTES && memcmp(data, DEFAULT_PASSWORD, len) == 0;
+      sendMessage(unlocked ? MSG_SUCCESS : MSG_PASSWORD_ERROR);
+      return;
+
+    case CMD_START_APP:
+      sendAck(ACK_OK);
+      tcdrain(ptyFd);
+      dumpFlash();
+      printf("start application\n");
+      fflush(stdout);
+      // The application runs until the next BSL entry, which resets the lock
+      unlocked = false;
+      dropInputFor(bootDelayMs);
+      return;
+  }
+
+  if (!unlocked) {
+    sendMessage(MSG_LOCKED);
+    return;
+  }
+
+  switch (cmd) {
+    case CMD_MASS_ERASE:
+      memset(flash, 0xFF, sizeof(flash));
+      sendMessage(MSG_SUCCESS);
+      return;
+
+    case CMD_PROGRAMDATA: {
+      if (len < BSL_ADDRESS_BYTES) {
+        sendMessage(MSG_INVALID_ADDRESS);
+        return;
+      }
+      uint32_t address = bslGetLE32(data);
+      size_t count = len - BSL_ADDRESS_BYTES;
+      if (!validRange(address, count) || address % FLASH_WORD_BYTES != 0 ||
+          count % FLASH_WORD_BYTES != 0) {
+        sendMessage(MSG_INVALID_ADDRESS);
+        return;
+      }
+      for (size_t i = 0; i < count; i++) {
+        flash[address + i] &= data[BSL_ADDRESS_BYTES + i];
+      }
+      sendMessage(MSG_SUCCESS);
+      return;
+    }
+
+    case CMD_MEMORY_READ_BACK:
+    case CMD_STANDALONE_VERIFICATION: {
+      if (len != 2 * BSL_ADDRESS_BYTES) {
+        sendMessage(MSG_INVALID_ADDRESS);
+        return;
+      }
+      uint32_t address = bslGetLE32(data);
+      uint32_t count = bslGetLE32(&data[BSL_ADDRESS_BYTES]);
+      if (!validRange(address, count)) {
+        sendMessage(MSG_INVALID_ADDRESS);
+        return;
+      }
+      if (cmd == CMD_MEMORY_READ_BACK) {
+        if (count > MAX_BUFFER_BYTES) {
+          sendMessage(MSG_INVALID_ADDRESS);
+          return;
+        }
+        sendPacket(RSP_MEMORY_READ_BACK, &flash[address], count);
+      } else {
+        if (count < 1024) {
+          sendMessage(MSG_INVALID_ADDRESS);
+          return;
+        }
+        uint8_t crc[4];
+        bslPutLE32(crc, bslCrc32(&flash[address], count));
+        sendPacket(RSP_STANDALONE_VERIFICATION, crc, sizeof(crc));
+      }
+      return;
+    }
+  }
+  sendMessage(MSG_UNKNOWN_COMMAND);
+}
+
+// Receive one frame and answer it; bytes outside a frame are ignored
+static void serveFrame() {
+  static uint8_t frame[BSL_MAX_FRAME_BYTES];
+  uint8_t byte;
+  if (!readByte(byte, -1)) {
+    return;
+  }
+  if (byte != PACKET_HEADER) {
+    if (!spiMode || byte != SPI_FILL_BYTE) {
+      sendAck(ACK_HEADER_INCORRECT);
+    }
+    return;
+  }
+  frame[BSL_HEADER_OFFSET] = byte;
+  for (size_t i = BSL_LENGTH_OFFSET; i < BSL_CMD_OFFSET; i++) {
+    if (!readByte(frame[i], FRAME_BYTE_TIMEOUT_MS)) {
+      return;
+    }
+  }
+  size_t len = frame[BSL_LENGTH_OFFSET] | (frame[BSL_LENGTH_OFFSET + 1] << 8);
+  if (len == 0) {
+    sendAck(ACK_PACKET_SIZE_ZERO);
+    return;
+  }
+  if (BSL_CMD_OFFSET + len + BSL_CRC_BYTES > sizeof(frame)) {
+    sendAck(ACK_PACKET_SIZE_TOO_BIG);
+    if (!spiMode && !i2cMode) {
+      tcflush(ptyFd, TCIFLUSH);  // over SPI and I2C the link still needs its answers
+    }
+    return;
+  }
+  for (size_t i = BSL_CMD_OFFSET; i < BSL_CMD_OFFSET + len + BSL_CRC_BYTES; i++) {
+    if (!readByte(frame[i], FRAME_BYTE_TIMEOUT_MS)) {
+      return;  // the BSL drops incomplete frames silently
+    }
+  }
+  if (bslGetLE32(&frame[BSL_CMD_OFFSET + len]) != bslCrc32(&frame[BSL_CMD_OFFSET], len)) {
+    sendAck(ACK_CHECKSUM_INCORRECT);
+    return;
+  }
+  handleCommand(frame[BSL_CMD_OFFSET], &frame[BSL_CMD_DATA_OFFSET], len - 1);
+}
+
+int main(int argc, char** argv) {
+  static const struct option longOptions[] = {
+      {"boot-delay", required_argument, nullptr, 'd'},
+      {"dump", required_argument, nullptr, 'o'},
+      {"spi", no_argument, nullptr, 's'},
+      {"spi-busy", required_argument, nullptr, 'b'},
+      {"i2c", no_argument, nullptr, 'i'},
+      {"i2c-busy", required_argument, nullptr, 'n'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "d:o:sb:in:", longOptions, nullptr)) != -1) {
+    switch (c) {
+      case 'd':
+        bootDelayMs = strtoul(optarg, nullptr, 0);
+        break;
+      case 'o':
+        dumpPath = optarg;
+        break;
+      case 's':
+        spiMode = true;
+        break;
+      case 'b':
+        spiBusyBytes = strtoul(optarg, nullptr, 0);
+        break;
+      case 'i':
+        i2cMode = true;
+        break;
+      case 'n':
+        i2cBusyReads = strtoul(optarg, nullptr, 0);
+        break;
+      default:
+        fprintf(stderr, "usage: bsl_sim [--boot-delay MS] [--dump FILE] [--spi [--spi-busy N]]\n"
+                "               [--i2c [--i2c-busy N]]\n");
+        return 2;
+    }
+  }
+
+  ptyFd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (ptyFd < 0 || grantpt(ptyFd) != 0 || unlockpt(ptyFd) != 0) {
+    perror("posix_openpt");
+    return 1;
+  }
+  const char* slave = ptsname(ptyFd);
+
+  // Keep the slave open so hosts can come and go without the master seeing
+  // a hangup, and make it raw so no byte is translated on the way
+  int slaveFd = open(slave, O_RDWR | O_NOCTTY);
+  struct termios tio;
+  if (slaveFd < 0 || tcgetattr(slaveFd, &tio) != 0) {
+    perror(slave);
+    return 1;
+  }
+  cfmakeraw(&tio);
+  tcsetattr(slaveFd, TCSANOW, &tio);
+
+  memset(flash, 0xFF, sizeof(flash));
+  printf("%s\n", slave);
+  fflush(stdout);
+
+  dropInputFor(bootDelayMs);
+  for (;;) {
+    serveFrame();
+  }
+}
@@ -0,0 +1,391 @@
+// Prathik Narsetty
+// Linux command-line programmer for the MSPM0 UART BSL
+//
+// Runs the gateway's protocol core (include/bsl_link.h, src/bsl_link.cpp)
+// over a termios serial port, so a USB-UART adapter can program a target and
+// the protocol can be exercised on the desk without the ESP32. The session is
+// the gateway's: connect, device info, baud change, password, mass erase,
+// program, verify, start application, with the wall time of every phase
+// printed at the end.
+//
+// Programming is sparse: only the bytes the image defines are sent, padded to
+// 8-byte flash words, and frames that are all 0xFF are skipped since the mass
+// erase already left them that way. Ranges of at least 1 KB are verified with
+// the BSL's own CRC32 (stand-alone verification), shorter ones by reading
+// them back.
+//
+// Build from OTA-ESP/:
+//   g++ -std=c++17 -O2 -Wall -Iinclude -o bslprog tools/bslprog/bslprog.cpp
+//       tools/bslprog/tty_transport.cpp tools/bslprog/image_file.cpp src/bsl_link.cpp
+//
+//   ./bslprog --port /dev/ttyUSB0 --baud 1000000 app.hex
+//   ./bslprog --port /dev/ttyUSB0 --entry rts-dtr --verify readback app.elf
+//   ./bslprog --port /dev/ttyUSB0 --address 0x4000 --no-start app.bin
+//
+// Without a target, tools/bslprog/bsl_sim.cpp emulates one on a pty.
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "bsl_link.h"
+#include "image_file.h"
+#include "tty_transport.h"
+
+#define BSL_BOOT_BAUD 9600      // the BSL always starts at 9600 baud
+#define FLASH_WORD_BYTES 8      // Program Data needs 8-byte aligned words
+#define MAX_RETRIES 3
+#define DEFAULT_CHUNK_BYTES 128  // Program Data payload unless --chunk says otherwise
+
+// Entry polling, as on the gateway
+#define ENTRY_TIMEOUT_MS 2000
+#define ENTRY_BACKOFF_MIN_MS 2
+#define ENTRY_BACKOFF_MAX_MS 50
+
+enum VerifyMode { VERIFY_CRC, VERIFY_READBACK, VERIFY_NONE };
+
+enum Phase {
+  PHASE_CONNECT,
+  PHASE_GET_ID,
+  PHASE_BAUD,
+  PHASE_PASSWORD,
+  PHASE_ERASE,
+  PHASE_PROGRAM,
+  PHASE_VERIFY,
+  PHASE_START_APP,
+  PHASE_COUNT
+};
+
+static const char* const PHASE_NAMES[PHASE_COUNT] = {
+    "connect", "get_id", "baud", "password", "erase", "program", "verify", "start_app",
+};
+
+struct PhaseTime {
+  bool ran;
+  uint32_t ms;
+  uint32_t bytes;  // payload bytes moved, for program and verify
+};
+
+struct Options {
+  const char* port = nullptr;
+  const char* image = nullptr;
+  uint32_t baud = 115200;
+  ImageFormat format = IMAGE_AUTO;
+  uint32_t address = 0;
+  uint32_t chunk = DEFAULT_CHUNK_BYTES;
+  VerifyMode verify = VERIFY_CRC;
+  bool start = true;
+  bool modemEntry = false;
+};
+
+// Password of a device whose BSL configuration was never changed
+static const uint8_t DEFAULT_PASSWORD[BSL_PASSWORD_BYTES] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+static TtyTransport tty;
+static BslLink bsl(tty);
+static PhaseTime phases[PHASE_COUNT];
+
+static void usage() {
+  fprintf(stderr,
+          "usage: bslprog --port TTY [options] IMAGE\n"
+          "  --baud N            programming speed after connect (default 115200)\n"
+          "  --format bin|hex|elf  image format (default: by content/extension)\n"
+          "  --address A         load address of a .bin (default 0)\n"
+          "  --chunk N           Program Data payload, multiple of 8, <= %u (default %u)\n"
+          "  --verify crc|readback|none  (default crc)\n"
+          "  --entry rts-dtr     reset into the BSL through RTS (invoke) and DTR (NRST)\n"
+          "  --no-start          leave the target in the BSL\n",
+          BSL_MAX_PROGRAM_BYTES, DEFAULT_CHUNK_BYTES);
+}
+
+static bool parseOptions(int argc, char** argv, Options& opt) {
+  static const struct option longOptions[] = {
+      {"port", required_argument, nullptr, 'p'},
+      {"baud", required_argument, nullptr, 'b'},
+      {"format", required_argument, nullptr, 'f'},
+      {"address", required_argument, nullptr, 'a'},
+      {"chunk", required_argument, nullptr, 'c'},
+      {"verify", required_argument, nullptr, 'v'},
+      {"entry", required_argument, nullptr, 'e'},
+      {"no-start", no_argument, nullptr, 'n'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "p:b:f:a:c:v:e:nh", longOptions, nullptr)) != -1) {
+    switch (c) {
+      case 'p':
+        opt.port = optarg;
+        break;
+      case 'b':
+        opt.baud = strtoul(optarg, nullptr, 0);
+        if (bslBaudCode(opt.baud) == 0 || ttySpeed(opt.baud) == 0) {
+          fprintf(stderr, "unsupported baud rate %s\n", optarg);
+          return false;
+        }
+        break;
+      case 'f':
+        if (strcmp(optarg, "bin") == 0) {
+          opt.format = IMAGE_BIN;
+        } else if (strcmp(optarg, "hex") == 0) {
+          opt.format = IMAGE_HEX;
+        } else if (strcmp(optarg, "elf") == 0) {
+          opt.format = IMAGE_ELF;
+        } else {
+          fprintf(stderr, "unknown format %s\n", optarg);
+          return false;
+        }
+        break;
+      case 'a':
+        opt.address = strtoul(optarg, nullptr, 0);
+        break;
+      case 'c':
+        opt.chunk = strtoul(optarg, nullptr, 0);
+        if (opt.chunk == 0 || opt.chunk % FLASH_WORD_BYTES != 0 || opt.chunk > BSL_MAX_PROGRAM_BYTES) {
+          fprintf(stderr, "chunk must be a multiple of %u up to %u\n", FLASH_WORD_BYTES,
+                  BSL_MAX_PROGRAM_BYTES);
+          return false;
+        }
+        break;
+      case 'v':
+        if (strcmp(optarg, "crc") == 0) {
+          opt.verify = VERIFY_CRC;
+        } else if (strcmp(optarg, "readback") == 0) {
+          opt.verify = VERIFY_READBACK;
+        } else if (strcmp(optarg, "none") == 0) {
+          opt.verify = VERIFY_NONE;
+        } else {
+          fprintf(stderr, "unknown verify mode %s\n", optarg);
+          return false;
+        }
+        break;
+      case 'e':
+        if (strcmp(optarg, "rts-dtr") != 0) {
+          fprintf(stderr, "unknown entry method %s\n", optarg);
+          return false;
+        }
+        opt.modemEntry = true;
+        break;
+      case 'n':
+        opt.start = false;
+        break;
+      default:
+        return false;
+    }
+  }
+  if (opt.port == nullptr || optind != argc - 1) {
+    return false;
+  }
+  opt.image = argv[optind];
+  return true;
+}
+
+// Run one phase, record its time and report a failure
+static bool runPhase(Phase phase, BSL_error_t (*step)(const Options&, std::vector<ImageSegment>&),
+                     const Options& opt, std::vector<ImageSegment>& segments) {
+  uint32_t start = tty.millis();
+  BSL_error_t result = step(opt, segments);
+  phases[phase].ran = true;
+  phases[phase].ms = tty.millis() - start;
+  if (result != eBSL_success) {
+    fprintf(stderr, "%s failed: 0x%02X\n", PHASE_NAMES[phase], result);
+    return false;
+  }
+  return true;
+}
+
+static BSL_error_t doConnect(const Options& opt, std::vector<ImageSegment>&) {
+  if (opt.modemEntry && !tty.enterBslByModemLines()) {
+    perror("modem lines");
+    return eBSL_unknownError;
+  }
+  uint16_t attempts;
+  BSL_error_t result = bsl.connect(ENTRY_TIMEOUT_MS, ENTRY_BACKOFF_MIN_MS, ENTRY_BACKOFF_MAX_MS,
+                                   attempts);
+  if (result == eBSL_success) {
+    printf("BSL ready after %u attempt(s)\n", attempts);
+  }
+  return result;
+}
+
+static BSL_error_t doGetId(const Options&, std::vector<ImageSegment>&) {
+  BslDeviceInfo info;
+  BSL_error_t result = bsl.getDeviceInfo(info);
+  if (result == eBSL_success) {
+    printf("BSL v%04X build %04X, buffer %u bytes at 0x%08X\n", info.commandInterpreterVersion,
+           info.buildId, info.maxBufferSize, info.bufferStart);
+  }
+  return result;
+}
+
+static BSL_error_t doBaud(const Options& opt, std::vector<ImageSegment>&) {
+  return bsl.changeBaudRate(opt.baud);
+}
+
+static BSL_error_t doPassword(const Options&, std::vector<ImageSegment>&) {
+  return bsl.unlock(DEFAULT_PASSWORD);
+}
+
+static BSL_error_t doErase(const Options&, std::vector<ImageSegment>&) {
+  return bsl.massErase();
+}
+
+static bool erased(const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    if (data[i] != 0xFF) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static BSL_error_t doProgram(const Options& opt, std::vector<ImageSegment>& segments) {
+  uint32_t sent = 0;
+  uint32_t skipped = 0;
+  for (const ImageSegment& seg : segments) {
+    for (size_t off = 0; off < seg.data.size(); off += opt.chunk) {
+      size_t len = seg.data.size() - off < opt.chunk ? seg.data.size() - off : opt.chunk;
+      const uint8_t* data = &seg.data[off];
+      if (erased(data, len)) {
+        skipped += len;
+        continue;
+      }
+      BSL_error_t result;
+      int tries = 0;
+      for (;;) {
+        result = bsl.programData(seg.address + off, data, len);
+        if (result == eBSL_success || ++tries >= MAX_RETRIES) {
+          break;
+        }
+        bsl.recover();
+      }
+      if (result != eBSL_success) {
+        fprintf(stderr, "Program Data at 0x%08zX failed\n", seg.address + off);
+        return result;
+      }
+      sent += len;
+    }
+  }
+  phases[PHASE_PROGRAM].bytes = sent;
+  printf("Programmed %u bytes in %zu segment(s), skipped %u erased bytes\n", sent,
+         segments.size(), skipped);
+  return eBSL_success;
+}
+
+static BSL_error_t verifyByReadback(const ImageSegment& seg) {
+  uint8_t buf[BslLink::maxReadBytes()];
+  for (size_t off = 0; off < seg.data.size(); off += sizeof(buf)) {
+    size_t len = seg.data.size() - off < sizeof(buf) ? seg.data.size() - off : sizeof(buf);
+    BSL_error_t result = bsl.readMemory(seg.address + off, buf, len);
+    if (result != eBSL_success) {
+      return result;
+    }
+    for (size_t i = 0; i < len; i++) {
+      if (buf[i] != seg.data[off + i]) {
+        fprintf(stderr, "Mismatch at 0x%08zX: expected 0x%02X, read 0x%02X\n",
+                seg.address + off + i, seg.data[off + i], buf[i]);
+        return eBSL_unknownError;
+      }
+    }
+  }
+  return eBSL_success;
+}
+
+static BSL_error_t doVerify(const Options& opt, std::vector<ImageSegment>& segments) {
+  uint32_t checked = 0;
+  for (const ImageSegment& seg : segments) {
+    BSL_error_t result;
+    if (opt.verify == VERIFY_CRC && seg.data.size() >= BSL_VERIFY_MIN_BYTES) {
+      uint32_t crc = 0;
+      result = bsl.verifyCrc(seg.address, seg.data.size(), crc);
+      uint32_t expected = bslCrc32(seg.data.data(), seg.data.size());
+      if (result == eBSL_success && crc != expected) {
+        fprintf(stderr, "CRC mismatch at 0x%08X+%zu: expected %08X, target %08X\n", seg.address,
+                seg.data.size(), expected, crc);
+        result = eBSL_unknownError;
+      }
+    } else {
+      result = verifyByReadback(seg);
+    }
+    if (result != eBSL_success) {
+      return result;
+    }
+    checked += seg.data.size();
+  }
+  phases[PHASE_VERIFY].bytes = checked;
+  printf("Verified %u bytes\n", checked);
+  return eBSL_success;
+}
+
+static BSL_error_t doStartApp(const Options&, std::vector<ImageSegment>&) {
+  return bsl.startApp();
+}
+
+static void printTiming() {
+  uint32_t total = 0;
+  printf("\n%-10s %8s %10s\n", "phase", "ms", "kB/s");
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    if (!phases[i].ran) {
+      continue;
+    }
+    total += phases[i].ms;
+    if (phases[i].bytes > 0 && phases[i].ms > 0) {
+      printf("%-10s %8u %10.1f\n", PHASE_NAMES[i], phases[i].ms,
+             phases[i].bytes / (double)phases[i].ms);
+    } else {
+      printf("%-10s %8u %10s\n", PHASE_NAMES[i], phases[i].ms, "-");
+    }
+  }
+  printf("%-10s %8u\n", "total", total);
+}
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!parseOptions(argc, argv, opt)) {
+    usage();
+    return 2;
+  }
+
+  std::vector<ImageSegment> segments;
+  std::string error;
+  if (!loadImage(opt.image, opt.format, opt.address, segments, error)) {
+    fprintf(stderr, "%s: %s\n", opt.image, error.c_str());
+    return 1;
+  }
+  alignSegments(segments, FLASH_WORD_BYTES);
+  for (const ImageSegment& seg : segments) {
+    printf("Segment 0x%08X..0x%08zX (%zu bytes)\n", seg.address, seg.address + seg.data.size(),
+           seg.data.size());
+  }
+
+  if (!tty.open(opt.port, BSL_BOOT_BAUD)) {
+    perror(opt.port);
+    return 1;
+  }
+
+  bool ok = runPhase(PHASE_CONNECT, doConnect, opt, segments) &&
+            runPhase(PHASE_GET_ID, doGetId, opt, segments);
+  if (ok && opt.baud != BSL_BOOT_BAUD && !runPhase(PHASE_BAUD, doBaud, opt, segments)) {
+    fprintf(stderr, "continuing at %u baud\n", BSL_BOOT_BAUD);
+  }
+  ok = ok && runPhase(PHASE_PASSWORD, doPassword, opt, segments) &&
+       runPhase(PHASE_ERASE, doErase, opt, segments) &&
+       runPhase(PHASE_PROGRAM, doProgram, opt, segments);
+  if (ok && opt.verify != VERIFY_NONE) {
+    ok = runPhase(PHASE_VERIFY, doVerify, opt, segments);
+  }
+  if (ok && opt.start) {
+    ok = runPhase(PHASE_START_APP, doStartApp, opt, segments);
+  }
+
+  printTiming();
+  return ok ? 0 : 1;
+}
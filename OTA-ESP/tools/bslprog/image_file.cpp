@@ -0,0 +1,242 @@
+// Prathik Narsetty
+// Firmware image files for the Linux programmer: raw binary, Intel HEX, ELF32
+#include "image_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+// ELF32 little-endian layout, only the fields needed to find PT_LOAD segments
+#define ELF_CLASS_32 1
+#define ELF_DATA_LE 1
+#define ELF_PT_LOAD 1
+#define ELF_HEADER_BYTES 52
+#define ELF_PHDR_BYTES 32
+
+// Intel HEX record types
+#define HEX_DATA 0x00
+#define HEX_EOF 0x01
+#define HEX_EXT_SEGMENT 0x02
+#define HEX_START_SEGMENT 0x03
+#define HEX_EXT_LINEAR 0x04
+#define HEX_START_LINEAR 0x05
+
+static uint16_t getLE16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+static uint32_t getLE32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Append data at address, extending the last segment when contiguous
+static void addBytes(std::vector<ImageSegment>& segments, uint32_t address,
+                     const uint8_t* data, size_t len) {
+  if (!segments.empty()) {
+    ImageSegment& last = segments.back();
+    if (last.address + last.data.size() == address) {
+      last.data.insert(last.data.end(), data, data + len);
+      return;
+    }
+  }
+  segments.push_back({address, std::vector<uint8_t>(data, data + len)});
+}
+
+// Sort and merge. Where segments overlap the later bytes win, or with
+// keepProgrammed the bytes are ANDed, so 0xFF padding never hides data.
+static void normalize(std::vector<ImageSegment>& segments, bool keepProgrammed = false) {
+  std::stable_sort(segments.begin(), segments.end(),
+                   [](const ImageSegment& a, const ImageSegment& b) { return a.address < b.address; });
+  std::vector<ImageSegment> merged;
+  for (ImageSegment& seg : segments) {
+    if (seg.data.empty()) {
+      continue;
+    }
+    if (!merged.empty()) {
+      ImageSegment& last = merged.back();
+      uint64_t lastEnd = last.address + (uint64_t)last.data.size();
+      if (seg.address <= lastEnd) {
+        uint64_t end = std::max<uint64_t>(lastEnd, seg.address + (uint64_t)seg.data.size());
+        last.data.resize(end - last.address, 0xFF);
+        uint8_t* dst = &last.data[seg.address - last.address];
+        for (size_t i = 0; i < seg.data.size(); i++) {
+          dst[i] = keepProgrammed ? dst[i] & seg.data[i] : seg.data[i];
+        }
+        continue;
+      }
+    }
+    merged.push_back(std::move(seg));
+  }
+  segments.swap(merged);
+}
+
+static bool parseHex(const std::vector<uint8_t>& file, std::vector<ImageSegment>& segments,
+                     std::string& error) {
+  uint32_t base = 0;
+  size_t lineNo = 0;
+  size_t pos = 0;
+  while (pos < file.size()) {
+    size_t end = pos;
+    while (end < file.size() && file[end] != '\n') {
+      end++;
+    }
+    std::string line((const char*)&file[pos], end - pos);
+    pos = end + 1;
+    lineNo++;
+    while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) {
+      line.pop_back();
+    }
+    if (line.empty()) {
+      continue;
+    }
+    if (line[0] != ':' || line.size() < 11 || (line.size() - 1) % 2 != 0) {
+      error = "line " + std::to_string(lineNo) + ": not an Intel HEX record";
+      return false;
+    }
+
+    uint8_t rec[260];
+    size_t recLen = (line.size() - 1) / 2;
+    if (recLen > sizeof(rec)) {
+      error = "line " + std::to_string(lineNo) + ": record too long";
+      return false;
+    }
+    uint8_t sum = 0;
+    for (size_t i = 0; i < recLen; i++) {
+      char hex[3] = {line[1 + 2 * i], line[2 + 2 * i], 0};
+      char* stop;
+      rec[i] = (uint8_t)strtoul(hex, &stop, 16);
+      if (*stop != 0) {
+        error = "line " + std::to_string(lineNo) + ": bad hex digit";
+        return false;
+      }
+      sum += rec[i];
+    }
+    uint8_t count = rec[0];
+    if (recLen != count + 5u || sum != 0) {
+      error = "line " + std::to_string(lineNo) + ": bad length or checksum";
+      return false;
+    }
+
+    uint16_t offset = (rec[1] << 8) | rec[2];
+    const uint8_t* data = &rec[4];
+    switch (rec[3]) {
+      case HEX_DATA:
+        addBytes(segments, base + offset, data, count);
+        break;
+      case HEX_EOF:
+        return true;
+      case HEX_EXT_SEGMENT:
+        base = ((data[0] << 8) | data[1]) << 4;
+        break;
+      case HEX_EXT_LINEAR:
+        base = (uint32_t)((data[0] << 8) | data[1]) << 16;
+        break;
+      case HEX_START_SEGMENT:
+      case HEX_START_LINEAR:
+        break;  // entry point, the BSL starts the application from its vector table
+      default:
+        error = "line " + std::to_string(lineNo) + ": unknown record type";
+        return false;
+    }
+  }
+  error = "missing end-of-file record";
+  return false;
+}
+
+static bool parseElf(const std::vector<uint8_t>& file, std::vector<ImageSegment>& segments,
+                     std::string& error) {
+  if (file.size() < ELF_HEADER_BYTES || file[4] != ELF_CLASS_32 || file[5] != ELF_DATA_LE) {
+    error = "only 32-bit little-endian ELF files are supported";
+    return false;
+  }
+  uint32_t phoff = getLE32(&file[28]);
+  uint16_t phentsize = getLE16(&file[42]);
+  uint16_t phnum = getLE16(&file[44]);
+  if (phentsize < ELF_PHDR_BYTES || phoff + (uint64_t)phnum * phentsize > file.size()) {
+    error = "bad program header table";
+    return false;
+  }
+
+  for (uint16_t i = 0; i < phnum; i++) {
+    const uint8_t* ph = &file[phoff + i * phentsize];
+    uint32_t type = getLE32(&ph[0]);
+    uint32_t offset = getLE32(&ph[4]);
+    uint32_t paddr = getLE32(&ph[12]);
+    uint32_t filesz = getLE32(&ph[16]);
+    if (type != ELF_PT_LOAD || filesz == 0) {
+      continue;  // .bss and friends only occupy RAM
+    }
+    if (offset + (uint64_t)filesz > file.size()) {
+      error = "program header " + std::to_string(i) + " points past the end of the file";
+      return false;
+    }
+    // Initialized data is loaded from flash, which is the physical address
+    addBytes(segments, paddr, &file[offset], filesz);
+  }
+  if (segments.empty()) {
+    error = "no loadable segments";
+    return false;
+  }
+  return true;
+}
+
+static ImageFormat detectFormat(const std::string& path, const std::vector<uint8_t>& file) {
+  if (file.size() >= 4 && memcmp(file.data(), "\x7f" "ELF", 4) == 0) {
+    return IMAGE_ELF;
+  }
+  std::string ext = path.substr(path.find_last_of('.') + 1);
+  if (ext == "hex" || ext == "ihex" || (!file.empty() && file[0] == ':' && ext != "bin")) {
+    return IMAGE_HEX;
+  }
+  return IMAGE_BIN;
+}
+
+bool loadImage(const std::string& path, ImageFormat format, uint32_t binAddress,
+               std::vector<ImageSegment>& segments, std::string& error) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    error = "cannot open " + path;
+    return false;
+  }
+  std::vector<uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+  segments.clear();
+  if (format == IMAGE_AUTO) {
+    format = detectFormat(path, file);
+  }
+  bool ok = true;
+  switch (format) {
+    case IMAGE_HEX:
+      ok = parseHex(file, segments, error);
+      break;
+    case IMAGE_ELF:
+      ok = parseElf(file, segments, error);
+      break;
+    default:
+      addBytes(segments, binAddress, file.data(), file.size());
+      break;
+  }
+  if (ok) {
+    normalize(segments);
+    if (segments.empty()) {
+      error = path + " is empty";
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+void alignSegments(std::vector<ImageSegment>& segments, uint32_t align) {
+  for (ImageSegment& seg : segments) {
+    uint32_t head = seg.address % align;
+    if (head != 0) {
+      seg.data.insert(seg.data.begin(), head, 0xFF);
+      seg.address -= head;
+    }
+    size_t tail = seg.data.size() % align;
+    if (tail != 0) {
+      seg.data.resize(seg.data.size() + align - tail, 0xFF);
+    }
+  }
+  normalize(segments, true);
+}
@@ -0,0 +1,25 @@
+// Prathik Narsetty
+// Firmware image files for the Linux programmer: raw binary, Intel HEX, ELF32
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+enum ImageFormat { IMAGE_AUTO, IMAGE_BIN, IMAGE_HEX, IMAGE_ELF };
+
+// Contiguous bytes at a target address
+struct ImageSegment {
+  uint32_t address;
+  std::vector<uint8_t> data;
+};
+
+// Load path into segments sorted by address, with adjacent ones merged. A
+// binary is placed at binAddress; HEX and ELF carry their own addresses (ELF
+// loadable segments at their physical address). Returns false with error set.
+bool loadImage(const std::string& path, ImageFormat format, uint32_t binAddress,
+               std::vector<ImageSegment>& segments, std::string& error);
+
+// Grow every segment to whole flash words of `align` bytes, filling with
+// 0xFF (the erased value), and merge segments that then touch or overlap
+void alignSegments(std::vector<ImageSegment>& segments, uint32_t align);
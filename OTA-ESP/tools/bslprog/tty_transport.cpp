@@ -0,0 +1,148 @@
+// Prathik Narsetty
+// termios serial port as a BslTransport for the Linux programmer
+#include "tty_transport.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+// Modem line timing for enterBslByModemLines()
+#define ENTRY_SETUP_MS 1
+#define ENTRY_RESET_PULSE_MS 2
+
+unsigned ttySpeed(uint32_t baud) {
+  switch (baud) {
+    case 4800:    return B4800;
+    case 9600:    return B9600;
+    case 19200:   return B19200;
+    case 38400:   return B38400;
+    case 57600:   return B57600;
+    case 115200:  return B115200;
+    case 1000000: return B1000000;
+    case 2000000: return B2000000;
+    case 3000000: return B3000000;
+    default:      return 0;
+  }
+}
+
+TtyTransport::~TtyTransport() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+bool TtyTransport::open(const char* path, uint32_t baud) {
+  fd_ = ::open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if (fd_ < 0) {
+    return false;
+  }
+  struct termios tio;
+  if (tcgetattr(fd_, &tio) != 0) {
+    return false;
+  }
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  if (tcsetattr(fd_, TCSANOW, &tio) != 0) {
+    return false;
+  }
+  return setBaudRate(baud);
+}
+
+bool TtyTransport::setModemLine(int line, bool asserted) {
+  return ioctl(fd_, asserted ? TIOCMBIS : TIOCMBIC, &line) == 0;
+}
+
+bool TtyTransport::enterBslByModemLines() {
+  // Invoke pin high (RTS asserted), then pulse NRST low (DTR asserted)
+  if (!setModemLine(TIOCM_RTS, true)) {
+    return false;
+  }
+  delayMs(ENTRY_SETUP_MS);
+  setModemLine(TIOCM_DTR, true);
+  delayMs(ENTRY_RESET_PULSE_MS);
+  return setModemLine(TIOCM_DTR, false);
+}
+
+bool TtyTransport::write(const uint8_t* data, size_t len) {
+  while (len > 0) {
+    ssize_t n = ::write(fd_, data, len);
+    if (n < 0) {
+      if (errno == EINTR || errno == EAGAIN) {
+        continue;
+      }
+      return false;
+    }
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+size_t TtyTransport::read(uint8_t* buf, size_t len, uint32_t timeoutMs) {
+  size_t got = 0;
+  uint32_t start = millis();
+  while (got < len) {
+    uint32_t elapsed = millis() - start;
+    if (elapsed >= timeoutMs) {
+      break;
+    }
+    struct pollfd pfd = {fd_, POLLIN, 0};
+    int ready = poll(&pfd, 1, timeoutMs - elapsed);
+    if (ready < 0 && errno != EINTR) {
+      break;
+    }
+    if (ready <= 0) {
+      continue;
+    }
+    ssize_t n = ::read(fd_, buf + got, len - got);
+    if (n < 0 && errno != EINTR && errno != EAGAIN) {
+      break;
+    }
+    if (n > 0) {
+      got += n;
+    }
+  }
+  return got;
+}
+
+void TtyTransport::discardInput() {
+  tcflush(fd_, TCIFLUSH);
+}
+
+void TtyTransport::drainInput(uint32_t quietMs) {
+  uint8_t buf[64];
+  while (read(buf, sizeof(buf), quietMs) > 0) {
+  }
+}
+
+bool TtyTransport::setBaudRate(uint32_t baud) {
+  speed_t speed = ttySpeed(baud);
+  struct termios tio;
+  if (speed == 0 || tcgetattr(fd_, &tio) != 0) {
+    return false;
+  }
+  // Let the ACK of Change Baud Rate and anything queued go out first
+  tcdrain(fd_);
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+  return tcsetattr(fd_, TCSANOW, &tio) == 0;
+}
+
+uint32_t TtyTransport::millis() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+void TtyTransport::delayMs(uint32_t ms) {
+  struct timespec ts = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000};
+  while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+  }
+}
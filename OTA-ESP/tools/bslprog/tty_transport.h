@@ -0,0 +1,35 @@
+// Prathik Narsetty
+// termios serial port as a BslTransport for the Linux programmer
+#pragma once
+
+#include <stdint.h>
+#include "bsl_link.h"
+
+class TtyTransport : public BslTransport {
+ public:
+  ~TtyTransport() override;
+
+  // Open the port raw, 8N1, no flow control, at baud. Returns false and
+  // leaves errno set on failure.
+  bool open(const char* path, uint32_t baud);
+
+  // Reset the target into the BSL through the modem lines: DTR drives NRST,
+  // RTS drives the BSL invoke pin (both active low on USB-UART adapters)
+  bool enterBslByModemLines();
+
+  bool write(const uint8_t* data, size_t len) override;
+  size_t read(uint8_t* buf, size_t len, uint32_t timeoutMs) override;
+  void discardInput() override;
+  void drainInput(uint32_t quietMs) override;
+  bool setBaudRate(uint32_t baud) override;
+  uint32_t millis() override;
+  void delayMs(uint32_t ms) override;
+
+ private:
+  bool setModemLine(int line, bool asserted);
+
+  int fd_ = -1;
+};
+
+// termios speed constant for baud, 0 if there is none
+unsigned ttySpeed(uint32_t baud);
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+# Prathik Narsetty
+# Resumable chunked firmware upload client (include/chunked_upload.h)
+#
+# Starts or resumes an upload session on the gateway, sends only the ranges
+# the gateway reports as missing, then commits the image. Rerunning the same
+# command after a dropped connection or a gateway reset continues where the
+# previous run stopped.
+#
+#   python3 tools/chunked_upload.py 192.168.1.100 mspm0_firmware.bin
+#   python3 tools/chunked_upload.py --chunk 512 --no-program localhost:8080 fw.bin
+
+import argparse
+import json
+import sys
+import time
+import urllib.error
+import urllib.request
+import zlib
+
+
+def request(base, method, path, body=None, timeout=10):
+    req = urllib.request.Request(base + path, data=body, method=method)
+    if body is not None:
+        req.add_header("Content-Type", "application/octet-stream")
+    try:
+        with urllib.request.urlopen(req, timeout=timeout) as rsp:
+            return rsp.status, json.loads(rsp.read() or b"{}")
+    except urllib.error.HTTPError as err:
+        text = err.read()
+        try:
+            return err.code, json.loads(text)
+        except ValueError:
+            return err.code, {"result": text.decode(errors="replace").strip()}
+
+
+def upload(base, image, chunk, program, retries):
+    crc = zlib.crc32(image)
+    path = "/upload/begin?size=%d&chunk=%d&crc=%08x" % (len(image), chunk, crc)
+    code, state = request(base, "POST", path)
+    if code != 200:
+        raise RuntimeError("begin failed: %d %s" % (code, state.get("result")))
+    print("session: %d/%d bytes already on the gateway" % (state["received"], len(image)))
+
+    sent = 0
+    started = time.monotonic()
+    while not state["complete"]:
+        for start, end in state["missing"]:
+            for offset in range(start, end, chunk):
+                data = image[offset:min(offset + chunk, end)]
+                path = "/upload/chunk?offset=%d&crc=%08x" % (offset, zlib.crc32(data))
+                for attempt in range(retries):
+                    try:
+                        code, rsp = request(base, "PUT", path, data)
+                    except OSError as err:
+                        code, rsp = 0, {"result": str(err)}
+                    if code == 200:
+                        break
+                    print("chunk %d: %s, retrying" % (offset, rsp.get("result")), file=sys.stderr)
+                    time.sleep(0.5 * (attempt + 1))
+                else:
+                    raise RuntimeError("chunk %d failed after %d attempts" % (offset, retries))
+                sent += len(data)
+        # Only the first MISSING_RANGES_MAX ranges are listed; ask again
+        code, state = request(base, "GET", "/upload/missing")
+
+    elapsed = time.monotonic() - started
+    if sent:
+        print("sent %d bytes in %.1f s (%.1f KiB/s)" % (sent, elapsed, sent / 1024 / max(elapsed, 1e-6)))
+
+    code, rsp = request(base, "POST", "/upload/commit" + ("" if program else "?program=0"))
+    if code != 202:
+        raise RuntimeError("commit failed: %d %s" % (code, rsp.get("result")))
+    print("committed %d bytes (crc %08x)" % (len(image), crc))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Resumable chunked firmware upload")
+    parser.add_argument("host", help="gateway host[:port]")
+    parser.add_argument("image", help="firmware image (.bin)")
+    parser.add_argument("--chunk", type=int, default=1024, help="chunk size in bytes (64-4096)")
+    parser.add_argument("--retries", type=int, default=5, help="attempts per chunk")
+    parser.add_argument("--no-program", action="store_true", help="store only, do not program")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    base = args.host if args.host.startswith("http") else "http://" + args.host
+    try:
+        upload(base.rstrip("/"), image, args.chunk, not args.no_program, args.retries)
+    except (RuntimeError, OSError) as err:
+        print("error: %s (rerun to resume)" % err, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
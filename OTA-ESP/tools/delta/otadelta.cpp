@@ -0,0 +1,325 @@
+// Prathik Narsetty
+// Makes and applies delta patches between firmware images (include/delta_patch.h)
+//
+// `make` diffs two raw images the way bsdiff does: a suffix array of the old
+// image finds long approximate matches, each match becomes a record whose
+// byte differences are mostly zero, and the bytes in between are sent as
+// they are. Every patch is applied again with the gateway's own patcher
+// (src/delta_patch.cpp) before it is written, so a patch that leaves this
+// tool rebuilds the new image.
+//
+// Build from OTA-ESP/:
+//   g++ -std=c++17 -O2 -Wall -Iinclude -o otadelta tools/delta/otadelta.cpp
+//       src/delta_patch.cpp
+//
+//   ./otadelta make v6.bin v7.bin v7.delta
+//   ./otadelta apply v6.bin v7.delta rebuilt.bin
+//   curl --data-binary @v7.delta http://<gateway>/upload/delta
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "bsl_frames.h"
+#include "delta_patch.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+// A record is only worth starting when the match beats the current
+// alignment by this many bytes, as in bsdiff
+#define MATCH_MARGIN 8
+
+static bool readFile(const char* path, Bytes& out) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+  out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  return true;
+}
+
+static bool writeFile(const char* path, const Bytes& data) {
+  std::ofstream out(path, std::ios::binary);
+  out.write((const char*)data.data(), data.size());
+  if (!out) {
+    fprintf(stderr, "cannot write %s\n", path);
+    return false;
+  }
+  return true;
+}
+
+static uint32_t imageCrc32(const Bytes& data) {
+  return ~bslCrc32(data.data(), data.size());
+}
+
+// Suffix array of `data` including the empty suffix, by prefix doubling
+static std::vector<int32_t> suffixArray(const Bytes& data) {
+  int32_t n = (int32_t)data.size() + 1;
+  std::vector<int32_t> sa(n), rank(n), next(n);
+  for (int32_t i = 0; i < n; i++) {
+    sa[i] = i;
+    rank[i] = i < n - 1 ? data[i] + 1 : 0;
+  }
+  for (int32_t k = 1;; k <<= 1) {
+    auto key = [&](int32_t i) { return i + k < n ? rank[i + k] : -1; };
+    auto less = [&](int32_t a, int32_t b) {
+      return rank[a] != rank[b] ? rank[a] < rank[b] : key(a) < key(b);
+    };
+    std::sort(sa.begin(), sa.end(), less);
+    next[sa[0]] = 0;
+    for (int32_t i = 1; i < n; i++) {
+      next[sa[i]] = next[sa[i - 1]] + (less(sa[i - 1], sa[i]) ? 1 : 0);
+    }
+    rank.swap(next);
+    if (rank[sa[n - 1]] == n - 1) {
+      return sa;
+    }
+  }
+}
+
+static int32_t matchLength(const uint8_t* a, int32_t aLen, const uint8_t* b, int32_t bLen) {
+  int32_t i = 0;
+  while (i < aLen && i < bLen && a[i] == b[i]) {
+    i++;
+  }
+  return i;
+}
+
+// Longest match of `target` in the old image; binary search over the suffix array
+static int32_t search(const std::vector<int32_t>& sa, const Bytes& old, const uint8_t* target,
+                      int32_t targetLen, int32_t& pos) {
+  int32_t oldSize = (int32_t)old.size();
+  int32_t lo = 0;
+  int32_t hi = oldSize;
+  while (hi - lo >= 2) {
+    int32_t mid = lo + (hi - lo) / 2;
+    int32_t len = std::min(oldSize - sa[mid], targetLen);
+    if (memcmp(old.data() + sa[mid], target, len) < 0) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  int32_t x = matchLength(old.data() + sa[lo], oldSize - sa[lo], target, targetLen);
+  int32_t y = matchLength(old.data() + sa[hi], oldSize - sa[hi], target, targetLen);
+  pos = x > y ? sa[lo] : sa[hi];
+  return std::max(x, y);
+}
+
+static void putVarint(Bytes& out, uint32_t value) {
+  while (value >= 0x80) {
+    out.push_back((uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((uint8_t)value);
+}
+
+// Differences as (zero run, literal count, literals) tokens
+static void putDiff(Bytes& out, const uint8_t* diff, uint32_t len) {
+  uint32_t i = 0;
+  while (i < len) {
+    uint32_t zeros = 0;
+    while (i + zeros < len && diff[i + zeros] == 0) {
+      zeros++;
+    }
+    putVarint(out, zeros);
+    i += zeros;
+    if (i == len) {
+      break;
+    }
+    // Literals run until two zeros in a row, where a new token pays off
+    uint32_t literals = 0;
+    while (i + literals < len &&
+           !(diff[i + literals] == 0 && i + literals + 1 < len && diff[i + literals + 1] == 0)) {
+      literals++;
+    }
+    putVarint(out, literals);
+    out.insert(out.end(), diff + i, diff + i + literals);
+    i += literals;
+  }
+}
+
+static void putRecord(Bytes& patch, const Bytes& old, const Bytes& img, int32_t lastScan,
+                      int32_t lastPos, int32_t diffLen, int32_t extraLen, int32_t seek) {
+  putVarint(patch, diffLen);
+  putVarint(patch, extraLen);
+  putVarint(patch, ((uint32_t)seek << 1) ^ (uint32_t)(seek >> 31));
+  Bytes diff(diffLen);
+  for (int32_t i = 0; i < diffLen; i++) {
+    diff[i] = img[lastScan + i] - old[lastPos + i];
+  }
+  putDiff(patch, diff.data(), diffLen);
+  patch.insert(patch.end(), img.begin() + lastScan + diffLen,
+               img.begin() + lastScan + diffLen + extraLen);
+}
+
+// bsdiff's record selection, writing this format's records
+static Bytes makePatch(const Bytes& old, const Bytes& img) {
+  DeltaHeader header = {DELTA_MAGIC, DELTA_VERSION, 0, (uint32_t)old.size(), imageCrc32(old),
+                        (uint32_t)img.size(), imageCrc32(img)};
+  Bytes patch((const uint8_t*)&header, (const uint8_t*)&header + sizeof(header));
+
+  std::vector<int32_t> sa = suffixArray(old);
+  int32_t oldSize = (int32_t)old.size();
+  int32_t newSize = (int32_t)img.size();
+  int32_t scan = 0, len = 0, pos = 0;
+  int32_t lastScan = 0, lastPos = 0, lastOffset = 0;
+  while (scan < newSize) {
+    int32_t oldScore = 0;
+    int32_t scsc = scan += len;
+    for (; scan < newSize; scan++) {
+      len = search(sa, old, img.data() + scan, newSize - scan, pos);
+      for (; scsc < scan + len; scsc++) {
+        if (scsc + lastOffset < oldSize && old[scsc + lastOffset] == img[scsc]) {
+          oldScore++;
+        }
+      }
+      if ((len == oldScore && len != 0) || len > oldScore + MATCH_MARGIN) {
+        break;
+      }
+      if (scan + lastOffset < oldSize && old[scan + lastOffset] == img[scan]) {
+        oldScore--;
+      }
+    }
+    if (len == oldScore && scan != newSize) {
+      continue;
+    }
+
+    // Extend the previous match forwards and this one backwards
+    int32_t lenF = 0;
+    for (int32_t i = 0, s = 0, best = 0; lastScan + i < scan && lastPos + i < oldSize;) {
+      if (old[lastPos + i] == img[lastScan + i]) {
+        s++;
+      }
+      i++;
+      if (s * 2 - i > best * 2 - lenF) {
+        best = s;
+        lenF = i;
+      }
+    }
+    int32_t lenB = 0;
+    if (scan < newSize) {
+      for (int32_t i = 1, s = 0, best = 0; scan >= lastScan + i && pos >= i; i++) {
+        if (old[pos - i] == img[scan - i]) {
+          s++;
+        }
+        if (s * 2 - i > best * 2 - lenB) {
+          best = s;
+          lenB = i;
+        }
+      }
+    }
+    if (lastScan + lenF > scan - lenB) {
+      int32_t overlap = lastScan + lenF - (scan - lenB);
+      int32_t s = 0, best = 0, lenS = 0;
+      for (int32_t i = 0; i < overlap; i++) {
+        if (img[lastScan + lenF - overlap + i] == old[lastPos + lenF - overlap + i]) {
+          s++;
+        }
+        if (img[scan - lenB + i] == old[pos - lenB + i]) {
+          s--;
+        }
+        if (s > best) {
+          best = s;
+          lenS = i + 1;
+        }
+      }
+      lenF += lenS - overlap;
+      lenB -= lenS;
+    }
+
+    putRecord(patch, old, img, lastScan, lastPos, lenF, scan - lenB - (lastScan + lenF),
+              pos - lenB - (lastPos + lenF));
+    lastScan = scan - lenB;
+    lastPos = pos - lenB;
+    lastOffset = pos - scan;
+  }
+  return patch;
+}
+
+// Patch target over files already in memory
+class MemoryTarget : public DeltaTarget {
+ public:
+  explicit MemoryTarget(const Bytes& old) : old_(old) {}
+
+  const uint8_t* base(uint32_t size, uint32_t crc) override {
+    return size == old_.size() && crc == imageCrc32(old_) ? old_.data() : nullptr;
+  }
+  bool write(const uint8_t* data, size_t len) override {
+    out.insert(out.end(), data, data + len);
+    return true;
+  }
+
+  Bytes out;
+
+ private:
+  const Bytes& old_;
+};
+
+static DeltaStatus applyPatch(const Bytes& old, const Bytes& patch, Bytes& out) {
+  MemoryTarget target(old);
+  DeltaPatcher patcher(target);
+  patcher.begin();
+  patcher.feed(patch.data(), patch.size());
+  DeltaStatus status = patcher.finish();
+  out.swap(target.out);
+  return status;
+}
+
+static int usage() {
+  fprintf(stderr,
+          "usage: otadelta make OLD NEW PATCH\n"
+          "       otadelta apply OLD PATCH NEW\n");
+  return 2;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 5) {
+    return usage();
+  }
+  std::string command = argv[1];
+  Bytes old, in, out;
+  if (!readFile(argv[2], old) || !readFile(argv[3], in)) {
+    return 1;
+  }
+
+  if (command == "make") {
+    if (old.empty()) {
+      fprintf(stderr, "%s is empty, there is nothing to patch against\n", argv[2]);
+      return 1;
+    }
+    Bytes patch = makePatch(old, in);
+    DeltaStatus status = applyPatch(old, patch, out);
+    if (status != DELTA_OK || out != in) {
+      fprintf(stderr, "patch does not rebuild %s (%s), not written\n", argv[3],
+              deltaStatusName(status));
+      return 1;
+    }
+    if (!writeFile(argv[4], patch)) {
+      return 1;
+    }
+    printf("%s: %zu bytes for a %zu-byte image (%.1f%%), from crc %08X to %08X\n", argv[4],
+           patch.size(), in.size(), 100.0 * patch.size() / (in.empty() ? 1 : in.size()),
+           imageCrc32(old), imageCrc32(in));
+    return 0;
+  }
+  if (command == "apply") {
+    DeltaStatus status = applyPatch(old, in, out);
+    if (status != DELTA_OK) {
+      fprintf(stderr, "%s: %s\n", argv[3], deltaStatusName(status));
+      return 1;
+    }
+    if (!writeFile(argv[4], out)) {
+      return 1;
+    }
+    printf("%s: %zu bytes, crc %08X\n", argv[4], out.size(), imageCrc32(out));
+    return 0;
+  }
+  return usage();
+}
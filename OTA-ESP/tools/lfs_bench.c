@@ -0,0 +1,217 @@
+// Prathik Narsetty
+// Host benchmark of the littlefs core used by the LittleFS storage backend
+//
+// Runs littlefs on a RAM block device with the ESP32 flash geometry and the
+// esp_littlefs default cache sizes, and measures sequential read throughput,
+// open latency and stat() (exists()) cost as the partition fills up. RAM has
+// no access latency, so the numbers show the filesystem's own CPU cost; the
+// "flash/B" column gives the bytes read from the device per image byte, which
+// is what dominates on real flash.
+//
+// Build against a littlefs checkout (https://github.com/littlefs-project/littlefs):
+//   cc -O2 -I<littlefs> tools/lfs_bench.c <littlefs>/lfs.c <littlefs>/lfs_util.c -o lfs_bench
+//   ./lfs_bench                  # 1 MiB partition, 128 KiB image
+//   ./lfs_bench 1536 256         # partition KiB, image KiB
+//
+// Every read is checked against the image written, and stat() must find the
+// image and miss a missing file; the exit status is 1 if any check or
+// littlefs call fails, so the benchmark doubles as a test of the setup
+// (test/CMakeLists.txt runs it when given LITTLEFS_DIR).
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lfs.h"
+
+#define BLOCK_SIZE      4096
+#define READ_SIZE       128
+#define PROG_SIZE       128
+#define CACHE_SIZE      512
+#define LOOKAHEAD_SIZE  128
+#define FILLER_BYTES    (16 * 1024)
+#define ITERATIONS      200
+
+static uint8_t* flash;
+static uint64_t flashBytesRead;
+
+static int bdRead(const struct lfs_config* c, lfs_block_t block, lfs_off_t off,
+                  void* buffer, lfs_size_t size) {
+  memcpy(buffer, flash + (size_t)block * c->block_size + off, size);
+  flashBytesRead += size;
+  return 0;
+}
+
+static int bdProg(const struct lfs_config* c, lfs_block_t block, lfs_off_t off,
+                  const void* buffer, lfs_size_t size) {
+  memcpy(flash + (size_t)block * c->block_size + off, buffer, size);
+  return 0;
+}
+
+static int bdErase(const struct lfs_config* c, lfs_block_t block) {
+  memset(flash + (size_t)block * c->block_size, 0xFF, c->block_size);
+  return 0;
+}
+
+static int bdSync(const struct lfs_config* c) {
+  (void)c;
+  return 0;
+}
+
+static double nowUs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int writeFile(lfs_t* lfs, const char* path, const uint8_t* data, size_t len) {
+  lfs_file_t file;
+  if (lfs_file_open(lfs, &file, path, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC) < 0) {
+    return -1;
+  }
+  lfs_ssize_t n = lfs_file_write(lfs, &file, data, len);
+  lfs_file_close(lfs, &file);
+  return n == (lfs_ssize_t)len ? 0 : -1;
+}
+
+// Read path back in pieces of chunk bytes; -1 if it is not `expected`
+static int readFile(lfs_t* lfs, const char* path, size_t chunk, uint8_t* buf,
+                    const uint8_t* expected, size_t expectedLen,
+                    double* mibPerSecond, double* flashPerByte) {
+  lfs_file_t file;
+  uint64_t before = flashBytesRead;
+  double start = nowUs();
+  size_t total = 0;
+  int mismatch = 0;
+  if (lfs_file_open(lfs, &file, path, LFS_O_RDONLY) < 0) {
+    return -1;
+  }
+  lfs_ssize_t n;
+  while ((n = lfs_file_read(lfs, &file, buf, chunk)) > 0) {
+    if (total + n > expectedLen || memcmp(buf, expected + total, n) != 0) {
+      mismatch = 1;
+    }
+    total += n;
+  }
+  lfs_file_close(lfs, &file);
+  double elapsed = nowUs() - start;
+  *mibPerSecond = total / (elapsed > 0 ? elapsed : 1) * 1e6 / (1024 * 1024);
+  *flashPerByte = total ? (double)(flashBytesRead - before) / total : 0;
+  return n < 0 || mismatch || total != expectedLen ? -1 : 0;
+}
+
+// One row of the table; -1 if littlefs failed or read back wrong data
+static int runFill(struct lfs_config* cfg, int fillPercent, size_t imageBytes) {
+  static uint8_t buf[BLOCK_SIZE];
+  lfs_t lfs;
+  memset(flash, 0xFF, (size_t)cfg->block_count * cfg->block_size);
+  if (lfs_format(&lfs, cfg) < 0 || lfs_mount(&lfs, cfg) < 0) {
+    printf("%3d%%  format or mount failed\n", fillPercent);
+    return -1;
+  }
+
+  uint8_t* image = malloc(imageBytes);
+  for (size_t i = 0; i < imageBytes; ++i) {
+    image[i] = (uint8_t)(i * 31 + 7);
+  }
+  if (writeFile(&lfs, "/slot0.bin", image, imageBytes) < 0) {
+    printf("%3d%%  image does not fit\n", fillPercent);
+    lfs_unmount(&lfs);
+    free(image);
+    return -1;
+  }
+
+  // Fill the rest with other files, like an image store with old slots and logs
+  lfs_mkdir(&lfs, "/fill");
+  size_t target = (size_t)cfg->block_count * cfg->block_size * fillPercent / 100;
+  int fillers = 0;
+  char path[32];
+  while ((size_t)lfs_fs_size(&lfs) * cfg->block_size < target) {
+    snprintf(path, sizeof(path), "/fill/%04d", fillers);
+    if (writeFile(&lfs, path, image, FILLER_BYTES < imageBytes ? FILLER_BYTES : imageBytes) < 0) {
+      break;
+    }
+    fillers++;
+  }
+
+  double mibs[3];
+  double ratio[3];
+  int result = 0;
+  static const size_t CHUNKS[3] = { 128, 1024, 4096 };
+  for (int i = 0; i < 3; ++i) {
+    if (readFile(&lfs, "/slot0.bin", CHUNKS[i], buf, image, imageBytes, &mibs[i], &ratio[i]) < 0) {
+      printf("%3d%%  read back of %u-byte pieces differs\n", fillPercent, (unsigned)CHUNKS[i]);
+      result = -1;
+    }
+  }
+
+  lfs_file_t file;
+  double start = nowUs();
+  for (int i = 0; i < ITERATIONS; ++i) {
+    lfs_file_open(&lfs, &file, "/slot0.bin", LFS_O_RDONLY);
+    lfs_file_close(&lfs, &file);
+  }
+  double openUs = (nowUs() - start) / ITERATIONS;
+
+  struct lfs_info info;
+  if (lfs_stat(&lfs, "/slot0.bin", &info) < 0 || info.size != imageBytes ||
+      lfs_stat(&lfs, "/missing.bin", &info) >= 0) {
+    printf("%3d%%  stat() wrong\n", fillPercent);
+    result = -1;
+  }
+  start = nowUs();
+  for (int i = 0; i < ITERATIONS; ++i) {
+    lfs_stat(&lfs, "/slot0.bin", &info);
+  }
+  double statHitUs = (nowUs() - start) / ITERATIONS;
+
+  start = nowUs();
+  for (int i = 0; i < ITERATIONS; ++i) {
+    lfs_stat(&lfs, "/missing.bin", &info);
+  }
+  double statMissUs = (nowUs() - start) / ITERATIONS;
+
+  printf("%3d%%  %5d  %7.1f %7.1f %7.1f  %6.2f  %7.2f  %7.2f  %7.2f\n",
+         fillPercent, fillers, mibs[0], mibs[1], mibs[2], ratio[0],
+         openUs, statHitUs, statMissUs);
+
+  lfs_unmount(&lfs);
+  free(image);
+  return result;
+}
+
+int main(int argc, char** argv) {
+  size_t partitionKiB = argc > 1 ? strtoul(argv[1], NULL, 0) : 1024;
+  size_t imageKiB = argc > 2 ? strtoul(argv[2], NULL, 0) : 128;
+
+  struct lfs_config cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.read = bdRead;
+  cfg.prog = bdProg;
+  cfg.erase = bdErase;
+  cfg.sync = bdSync;
+  cfg.read_size = READ_SIZE;
+  cfg.prog_size = PROG_SIZE;
+  cfg.block_size = BLOCK_SIZE;
+  cfg.block_count = partitionKiB * 1024 / BLOCK_SIZE;
+  cfg.block_cycles = 512;
+  cfg.cache_size = CACHE_SIZE;
+  cfg.lookahead_size = LOOKAHEAD_SIZE;
+
+  flash = malloc((size_t)cfg.block_count * BLOCK_SIZE);
+  if (flash == NULL) {
+    return 1;
+  }
+
+  printf("littlefs %u KiB partition, %u KiB image\n", (unsigned)partitionKiB, (unsigned)imageKiB);
+  printf("fill  files  MiB/s@128  @1024   @4096  flash/B  open us  stat us  miss us\n");
+  static const int FILLS[] = { 0, 50, 90 };
+  int failed = 0;
+  for (size_t i = 0; i < sizeof(FILLS) / sizeof(FILLS[0]); ++i) {
+    failed += runFill(&cfg, FILLS[i], imageKiB * 1024) < 0;
+  }
+
+  free(flash);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,291 @@
+#!/usr/bin/env python3
+# Prathik Narsetty
+# Performance regression gate for the programming pipeline
+#
+# Builds the native gateway (as env:native does), the BSL simulator and
+# tools/perf/perf_micro.cpp with the host compiler, then measures:
+#
+#   <link>.session_ms    whole session, SESSION_BEGIN to SESSION_END
+#   <link>.goodput_bps   Program Data goodput (PROGRAM_STATS)
+#   <link>.packet_us     program phase time per Program Data frame
+#   <link>.peak_rss_kb   peak resident memory of the gateway process
+#   micro.*              CRC, framing, reply parsing and SHA-256 per packet
+#
+# for one image over UART, UART with bit errors, SPI and I2C against the
+# simulator. The native clock is virtual, so the session numbers repeat
+# exactly from run to run; the micro-benchmarks are wall time and get wider
+# tolerances. Results are compared with tools/perf/baseline.json and the
+# exit status is 1 if any metric is worse than its baseline by more than
+# its tolerance, or a session fails.
+#
+#   python3 tools/perf/perf_gate.py
+#   python3 tools/perf/perf_gate.py --only uart --only micro
+#   python3 tools/perf/perf_gate.py --update      # record the current numbers
+
+import argparse
+import glob
+import json
+import os
+import random
+import re
+import shutil
+import subprocess
+import sys
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+sys.path.insert(0, os.path.join(ROOT, "tools"))
+import trace_decode  # noqa: E402
+
+BUILD_DIR = os.path.join(ROOT, ".pio", "build", "perf")
+BASELINE = os.path.join(ROOT, "tools", "perf", "baseline.json")
+
+IMAGE_BYTES = 16384
+IMAGE_SEED = 0x5EED
+SESSION_TIMEOUT_S = 120
+MICRO_RUNS = 3  # best of, against noise from other processes
+
+# name: (gateway build flags, gateway arguments ending in the tty option,
+#        simulator arguments)
+SCENARIOS = {
+    "uart": ([], ["--port"], []),
+    "uart_ber": ([], ["--ber", "3e-4,7", "--port"], []),
+    "spi": (["-DBSL_TRANSPORT_SPI"], ["--spi"], ["--spi"]),
+    "i2c": (["-DBSL_TRANSPORT_I2C"], ["--i2c"], ["--i2c"]),
+}
+
+# Tolerances for metrics new to the baseline, as a fraction of the baseline value
+DEFAULT_TOLERANCE = {
+    "session_ms": 0.02,
+    "goodput_bps": 0.02,
+    "packet_us": 0.02,
+    "peak_rss_kb": 0.10,
+}
+MICRO_TOLERANCE = 0.35  # wall time on a shared host; real regressions here are multiples
+MICRO_BYTES_TOLERANCE = 0.0
+
+TRACE_SESSION_BEGIN = 4
+TRACE_SESSION_END = 5
+TRACE_PROGRAM_STATS = 17
+
+
+def higher_is_better(unit):
+    return unit.endswith("/s")
+
+
+def default_tolerance(name, unit):
+    metric = name.split(".", 1)[1]
+    if metric in DEFAULT_TOLERANCE:
+        return DEFAULT_TOLERANCE[metric]
+    return MICRO_BYTES_TOLERANCE if unit == "B" else MICRO_TOLERANCE
+
+
+def newest_source():
+    paths = []
+    for pattern in ("src/*.cpp", "include/*.h", "native/src/*.cpp", "native/include/**/*.h",
+                    "tools/bslprog/bsl_sim.cpp", "tools/perf/perf_micro.cpp"):
+        paths += glob.glob(os.path.join(ROOT, pattern), recursive=True)
+    return max(os.path.getmtime(path) for path in paths)
+
+
+def build(output, sources, flags):
+    if os.path.exists(output) and os.path.getmtime(output) >= newest_source():
+        return output
+    cxx = os.environ.get("CXX", "g++")
+    command = [cxx, "-O2", "-Wall", "-I" + os.path.join(ROOT, "include")] + flags + \
+        [os.path.join(ROOT, source) for source in sources] + ["-o", output, "-lpthread"]
+    print("building %s" % os.path.relpath(output, ROOT), flush=True)
+    result = subprocess.run(command, capture_output=True, text=True)
+    if result.returncode != 0:
+        sys.exit("build of %s failed:\n%s" % (output, result.stderr))
+    return output
+
+
+def build_gateway(name, flags):
+    # Sources and flags of env:native in platformio.ini
+    sources = [os.path.relpath(path, ROOT) for path in sorted(glob.glob(os.path.join(ROOT, "src", "*.cpp")))
+               if os.path.basename(path) != "mainSoftwareInvoke.cpp"]
+    sources += [os.path.relpath(path, ROOT) for path in sorted(glob.glob(os.path.join(ROOT, "native", "src", "*.cpp")))]
+    native = ["-std=gnu++17", "-I" + os.path.join(ROOT, "native", "include"),
+              "-DLOG_LEVEL=LOG_LEVEL_INFO", "-DBSL_FAULT_INJECTION"]
+    return build(os.path.join(BUILD_DIR, "program_" + name), sources, native + flags)
+
+
+def test_image():
+    generator = random.Random(IMAGE_SEED)
+    return bytes(generator.getrandbits(8) for _ in range(IMAGE_BYTES))
+
+
+def wait_with_usage(process, timeout):
+    """Exit status and peak RSS in KiB of process, None if it timed out."""
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        pid, status, usage = os.wait4(process.pid, os.WNOHANG)
+        if pid != 0:
+            process.returncode = os.waitstatus_to_exitcode(status)
+            return process.returncode, usage.ru_maxrss
+        time.sleep(0.05)
+    process.kill()
+    process.wait()
+    return None
+
+
+def run_session(name, program, sim, image):
+    """Run one session against the simulator; returns the log, flash dump,
+    gateway exit status and peak RSS."""
+    gateway_args, sim_args = SCENARIOS[name][1:]
+    work = os.path.join(BUILD_DIR, name)
+    shutil.rmtree(work, ignore_errors=True)
+    os.makedirs(os.path.join(work, "fs"))
+    with open(os.path.join(work, "fs", "mspm0_firmware.bin"), "wb") as f:
+        f.write(image)
+    dump = os.path.join(work, "flash.bin")
+    log_path = os.path.join(work, "run.log")
+
+    simulator = subprocess.Popen([sim, "--dump", dump] + sim_args, stdout=subprocess.PIPE,
+                                 stderr=subprocess.DEVNULL, text=True)
+    try:
+        tty = simulator.stdout.readline().strip()
+        with open(log_path, "w") as log:
+            # The new image starts a session by itself; console input is held
+            # until it has ended, so the trace dump covers it
+            gateway = subprocess.Popen([program] + gateway_args + [tty, "--fs", os.path.join(work, "fs")],
+                                       stdin=subprocess.PIPE, stdout=log, stderr=subprocess.STDOUT)
+            gateway.stdin.write(b"trace\n")
+            gateway.stdin.close()
+            result = wait_with_usage(gateway, SESSION_TIMEOUT_S)
+    finally:
+        simulator.kill()
+        simulator.wait()
+    if result is None:
+        sys.exit("%s: no result after %u s, see %s" % (name, SESSION_TIMEOUT_S, log_path))
+    return log_path, dump, result[0], result[1]
+
+
+def session_metrics(name, program, sim, image):
+    log_path, dump, status, peak_kb = run_session(name, program, sim, image)
+    text = open(log_path, "rb").read()
+    flashed = open(dump, "rb").read(len(image)) if os.path.exists(dump) else b""
+    if status != 0 or flashed != image:
+        sys.exit("%s: session failed (exit %d, target %s), see %s" % (
+            name, status, "matches" if flashed == image else "differs", log_path))
+
+    trace = trace_decode.parse(trace_decode.extract_blob(text))
+    metrics = {name + ".peak_rss_kb": (peak_kb, "KiB")}
+    begin = None
+    goodput = 0
+    for _, now, _, (_, event, _, arg1) in trace_decode.timeline(trace):
+        if event == TRACE_SESSION_BEGIN:
+            begin = now
+        elif event == TRACE_SESSION_END and begin is not None:
+            metrics[name + ".session_ms"] = ((now - begin) / 1000.0, "ms")
+        elif event == TRACE_PROGRAM_STATS:
+            goodput = arg1
+    # A noisy link can wrap the trace ring past SESSION_BEGIN; goodput and the
+    # frame count are enough for the per-frame time
+    frames = re.findall(rb"(\d+) frames, \d+ failed", text)
+    if not frames or not goodput:
+        sys.exit("%s: no Program Data statistics in %s" % (name, log_path))
+    metrics[name + ".goodput_bps"] = (goodput, "B/s")
+    metrics[name + ".packet_us"] = (len(image) * 1e6 / goodput / int(frames[-1]), "us")
+    return metrics
+
+
+def micro_metrics(program, baseline):
+    metrics = {}
+    for _ in range(MICRO_RUNS):
+        output = subprocess.run([program], capture_output=True, text=True, check=True).stdout
+        for line in output.splitlines():
+            metric, value, unit = line.split()
+            name = "micro." + metric
+            value = float(value)
+            if name in metrics:
+                better = max if baseline.get(name, {}).get("better", "higher" if higher_is_better(unit)
+                                                            else "lower") == "higher" else min
+                value = better(value, metrics[name][0])
+            metrics[name] = (value, unit)
+    return metrics
+
+
+def compare(current, baseline, groups):
+    """Print the comparison; returns the number of regressions."""
+    regressions = 0
+    print()
+    print("%-28s %12s %12s %8s  %s" % ("metric", "baseline", "current", "change", "result"))
+    for name in sorted(set(current) | set(baseline)):
+        if name.split(".")[0] not in groups:
+            continue
+        if name not in baseline:
+            value, unit = current[name]
+            print("%-28s %12s %12.2f %8s  new (%s)" % (name, "-", value, "", unit))
+            continue
+        base = baseline[name]
+        if name not in current:
+            print("%-28s %12.2f %12s %8s  MISSING" % (name, base["value"], "-", ""))
+            regressions += 1
+            continue
+        value = current[name][0]
+        change = (value - base["value"]) / base["value"] if base["value"] else 0.0
+        worse = -change if base["better"] == "higher" else change
+        if worse > base["tolerance"]:
+            result = "REGRESSION (> %g%%)" % (base["tolerance"] * 100)
+            regressions += 1
+        elif -worse > base["tolerance"]:
+            result = "improved, --update to keep it"
+        else:
+            result = "ok"
+        print("%-28s %12.2f %12.2f %+7.1f%%  %s" % (name, base["value"], value, change * 100, result))
+    return regressions
+
+
+def update(current, baseline):
+    for name, (value, unit) in sorted(current.items()):
+        entry = baseline.setdefault(name, {
+            "unit": unit,
+            "better": "higher" if higher_is_better(unit) else "lower",
+            "tolerance": default_tolerance(name, unit),
+        })
+        entry["value"] = round(value, 2)
+    with open(BASELINE, "w") as f:
+        json.dump(baseline, f, indent=2, sort_keys=True)
+        f.write("\n")
+    print("baseline written to %s" % os.path.relpath(BASELINE, ROOT))
+
+
+def main():
+    groups = list(SCENARIOS) + ["micro"]
+    parser = argparse.ArgumentParser(description="Programming pipeline performance regression gate")
+    parser.add_argument("--only", action="append", choices=groups,
+                        help="run only this group of metrics (repeatable)")
+    parser.add_argument("--update", action="store_true",
+                        help="record the measured numbers as the new baseline")
+    args = parser.parse_args()
+    groups = args.only or groups
+
+    baseline = json.load(open(BASELINE)) if os.path.exists(BASELINE) else {}
+    os.makedirs(BUILD_DIR, exist_ok=True)
+    current = {}
+    if "micro" in groups:
+        micro = build(os.path.join(BUILD_DIR, "perf_micro"),
+                      ["tools/perf/perf_micro.cpp", "src/bsl_link.cpp", "src/sha256.cpp"], ["-std=c++17"])
+        current.update(micro_metrics(micro, baseline))
+    scenarios = [name for name in SCENARIOS if name in groups]
+    if scenarios:
+        sim = build(os.path.join(BUILD_DIR, "bsl_sim"), ["tools/bslprog/bsl_sim.cpp"], ["-std=c++17"])
+        image = test_image()
+        for name in scenarios:
+            program = build_gateway(name, SCENARIOS[name][0])
+            print("running %s session (%u bytes)" % (name, len(image)), flush=True)
+            current.update(session_metrics(name, program, sim, image))
+
+    if args.update:
+        update(current, baseline)
+        return 0
+    regressions = compare(current, baseline, groups)
+    print()
+    print("%d regression%s" % (regressions, "" if regressions == 1 else "s"))
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
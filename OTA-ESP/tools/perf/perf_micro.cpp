@@ -0,0 +1,161 @@
+// Prathik Narsetty
+// Host micro-benchmarks of the per-packet work in the programming pipeline
+//
+// Times the code every Program Data frame goes through, as the gateway and
+// tools/bslprog build it: the BSL CRC32, sealing a frame around a payload,
+// parsing the target's replies in BslLink (src/bsl_link.cpp) and the SHA-256
+// the session keeps over the programmed bytes. Replies come from a
+// transport that answers from memory, so only CPU time is measured. Each
+// result is the best of several rounds, printed as "name value unit" for
+// tools/perf/perf_gate.py, followed by the RAM the protocol objects take.
+//
+// Build from OTA-ESP/:
+//   g++ -std=c++17 -O2 -Wall -Iinclude -o perf_micro tools/perf/perf_micro.cpp
+//       src/bsl_link.cpp src/sha256.cpp
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include "bsl_link.h"
+#include "sha256.h"
+
+#define PAYLOAD_BYTES BSL_MAX_PROGRAM_BYTES
+#define ROUNDS 7
+#define ROUND_MIN_NS 20000000ULL  // 20 ms per round, so timer resolution does not matter
+
+static volatile uint32_t sink;
+
+// Answers every command with the reply armed last, from memory
+class MemoryTransport : public BslTransport {
+ public:
+  void arm(const uint8_t* reply, size_t len) {
+    reply_ = reply;
+    replyLength_ = len;
+    position_ = 0;
+  }
+
+  bool write(const uint8_t* data, size_t len) override {
+    sink = sink + data[len - 1];
+    position_ = 0;
+    return true;
+  }
+  size_t read(uint8_t* buf, size_t len, uint32_t timeoutMs) override {
+    (void)timeoutMs;
+    size_t n = replyLength_ - position_ < len ? replyLength_ - position_ : len;
+    memcpy(buf, reply_ + position_, n);
+    position_ += n;
+    return n;
+  }
+  void discardInput() override { position_ = replyLength_; }
+  bool setBaudRate(uint32_t baud) override {
+    (void)baud;
+    return true;
+  }
+  uint32_t millis() override { return 0; }
+  void delayMs(uint32_t ms) override { (void)ms; }
+
+ private:
+  const uint8_t* reply_ = nullptr;
+  size_t replyLength_ = 0;
+  size_t position_ = 0;
+};
+
+static uint64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Best time of one call of op, in ns
+template <typename Op>
+static double bestNsPerOp(Op op) {
+  double best = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    uint64_t calls = 0;
+    uint64_t start = nowNs();
+    uint64_t elapsed;
+    do {
+      for (int i = 0; i < 64; i++) {
+        op();
+      }
+      calls += 64;
+      elapsed = nowNs() - start;
+    } while (elapsed < ROUND_MIN_NS);
+    double perOp = (double)elapsed / calls;
+    if (round == 0 || perOp < best) {
+      best = perOp;
+    }
+  }
+  return best;
+}
+
+// Reply packet: ACK, then 0x08, length, type, data, CRC
+static size_t buildReply(uint8_t* out, uint8_t type, const uint8_t* data, size_t dataLen) {
+  out[0] = eBSL_success;
+  out[1] = RSP_HEADER;
+  bslPutLE16(&out[2], (uint16_t)(1 + dataLen));
+  out[4] = type;
+  memcpy(&out[5], data, dataLen);
+  bslPutLE32(&out[5 + dataLen], bslCrc32(&out[4], 1 + dataLen));
+  return 5 + dataLen + BSL_CRC_BYTES;
+}
+
+int main() {
+  alignas(64) static uint8_t payload[PAYLOAD_BYTES];
+  for (size_t i = 0; i < sizeof(payload); i++) {
+    payload[i] = (uint8_t)(i * 37 + 11);
+  }
+
+  double crcNs = bestNsPerOp([&] { sink = bslCrc32(payload, sizeof(payload)); });
+  printf("crc32_mbps %.2f MB/s\n", sizeof(payload) / crcNs * 1000.0);
+
+  static Sha256 sha;
+  double shaNs = bestNsPerOp([&] { sha.update(payload, sizeof(payload)); });
+  printf("sha256_mbps %.2f MB/s\n", sizeof(payload) / shaNs * 1000.0);
+
+  // Framing: copying a payload in (filesystem reads) and sealing around one
+  // in place (cache and mapped partition)
+  static BslProgramDataFrame<PAYLOAD_BYTES> frame;
+  uint32_t address = 0;
+  double buildNs = bestNsPerOp([&] {
+    sink = frame.build(address, payload, sizeof(payload));
+    address += PAYLOAD_BYTES;
+  });
+  printf("frame_build_ns %.1f ns\n", buildNs);
+  double sealNs = bestNsPerOp([&] {
+    sink = frame.sealExternal(address, payload, sizeof(payload));
+    address += PAYLOAD_BYTES;
+  });
+  printf("frame_seal_ns %.1f ns\n", sealNs);
+
+  // Parsing: a whole Program Data exchange answered with a success message,
+  // and a Memory Read Back reply of a full payload
+  MemoryTransport io;
+  static BslLink link(io);
+  uint8_t status = eBSL_success;
+  uint8_t messageReply[16];
+  size_t messageLength = buildReply(messageReply, RSP_MESSAGE, &status, 1);
+  io.arm(messageReply, messageLength);
+  if (link.programData(0, payload, sizeof(payload)) != eBSL_success) {
+    fprintf(stderr, "perf_micro: message reply not accepted\n");
+    return 1;
+  }
+  double programNs = bestNsPerOp([&] { sink = link.programData(address, payload, sizeof(payload)); });
+  printf("program_packet_ns %.1f ns\n", programNs);
+
+  static uint8_t readReply[BSL_MAX_FRAME_BYTES + 1];
+  size_t readLength = buildReply(readReply, RSP_MEMORY_READ_BACK, payload, sizeof(payload));
+  io.arm(readReply, readLength);
+  static uint8_t readBack[PAYLOAD_BYTES];
+  if (link.readMemory(0, readBack, sizeof(readBack)) != eBSL_success ||
+      memcmp(readBack, payload, sizeof(payload)) != 0) {
+    fprintf(stderr, "perf_micro: read back reply not accepted\n");
+    return 1;
+  }
+  double readNs = bestNsPerOp([&] { sink = link.readMemory(0, readBack, sizeof(readBack)); });
+  printf("readback_packet_ns %.1f ns\n", readNs);
+
+  printf("bsl_link_bytes %zu B\n", sizeof(BslLink));
+  printf("program_frame_bytes %zu B\n", sizeof(frame));
+  return 0;
+}
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+# Prathik Narsetty
+# Sign MSPM0 images for gateways built with IMAGE_SIGNING_KEY (include/image_signature.h)
+#
+# A signed image is the image followed by a 76-byte trailer holding an ECDSA
+# P-256 signature over the image's SHA-256. Keys and signatures come from the
+# openssl command line tool. Sign after tools/app_header.py, which changes
+# the image.
+#
+#   openssl ecparam -name prime256v1 -genkey -noout -out signing_key.pem
+#   python3 tools/sign_image.py key signing_key.pem      # build flag for platformio.ini
+#   python3 tools/sign_image.py sign signing_key.pem build/app.bin app.signed
+#   python3 tools/sign_image.py verify signing_key.pem app.signed
+
+import argparse
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+IMAGE_SIGN_MAGIC = 0x4E474953
+IMAGE_SIGN_VERSION = 1
+TRAILER = struct.Struct("<IHHI64s")
+KEY_BYTES = 65
+
+
+def openssl(args, data=None):
+    result = subprocess.run(["openssl"] + args, input=data, capture_output=True)
+    if result.returncode != 0:
+        sys.exit("openssl %s failed: %s" % (args[0], result.stderr.decode().strip()))
+    return result.stdout
+
+
+def public_key(pem):
+    """Uncompressed public point of a private or public key PEM."""
+    is_public = b"PUBLIC KEY" in open(pem, "rb").read()
+    der = openssl(["pkey"] + (["-pubin"] if is_public else []) +
+                  ["-in", pem, "-pubout", "-outform", "DER"])
+    point = der[-KEY_BYTES:]
+    if len(der) != 91 or point[0] != 0x04:
+        sys.exit("%s: not a P-256 key" % pem)
+    return point
+
+
+def der_integer(data, offset):
+    if data[offset] != 0x02:
+        raise ValueError("expected INTEGER")
+    length = data[offset + 1]
+    value = int.from_bytes(data[offset + 2:offset + 2 + length], "big")
+    return value, offset + 2 + length
+
+
+def signature_to_raw(der):
+    """ECDSA-Sig-Value (DER) to r || s, 32 bytes each."""
+    if der[0] != 0x30:
+        raise ValueError("expected SEQUENCE")
+    r, offset = der_integer(der, 2)
+    s, _ = der_integer(der, offset)
+    return r.to_bytes(32, "big") + s.to_bytes(32, "big")
+
+
+def raw_to_signature(raw):
+    def integer(value):
+        body = value.lstrip(b"\0") or b"\0"
+        if body[0] & 0x80:
+            body = b"\0" + body
+        return bytes([0x02, len(body)]) + body
+    body = integer(raw[:32]) + integer(raw[32:])
+    return bytes([0x30, len(body)]) + body
+
+
+def split(data):
+    """(image, signature) of a signed image, (data, None) otherwise."""
+    if len(data) > TRAILER.size:
+        magic, version, _, size, signature = TRAILER.unpack_from(data, len(data) - TRAILER.size)
+        if (magic == IMAGE_SIGN_MAGIC and version == IMAGE_SIGN_VERSION and
+                size == len(data) - TRAILER.size):
+            return data[:size], signature
+    return data, None
+
+
+def sign(args):
+    image = open(args.image, "rb").read()
+    if split(image)[1] is not None:
+        sys.exit("%s is already signed" % args.image)
+    if not image:
+        sys.exit("%s is empty" % args.image)
+    der = openssl(["dgst", "-sha256", "-sign", args.key], image)
+    signature = signature_to_raw(der)
+    trailer = TRAILER.pack(IMAGE_SIGN_MAGIC, IMAGE_SIGN_VERSION, 0, len(image), signature)
+    open(args.output, "wb").write(image + trailer)
+    print("%s: %u image bytes, signed with key %s..." % (
+        args.output, len(image), public_key(args.key)[1:5].hex().upper()))
+
+
+def verify(args):
+    image, signature = split(open(args.image, "rb").read())
+    if signature is None:
+        sys.exit("%s is not signed" % args.image)
+    with tempfile.TemporaryDirectory() as tmp:
+        pub = os.path.join(tmp, "pub.pem")
+        sig = os.path.join(tmp, "sig.der")
+        is_public = b"PUBLIC KEY" in open(args.key, "rb").read()
+        open(pub, "wb").write(openssl(["pkey"] + (["-pubin"] if is_public else []) +
+                                      ["-in", args.key, "-pubout"]))
+        open(sig, "wb").write(raw_to_signature(signature))
+        result = subprocess.run(["openssl", "dgst", "-sha256", "-verify", pub, "-signature", sig],
+                                input=image, capture_output=True)
+    ok = result.returncode == 0
+    print("%s: %u image bytes, signature %s" % (args.image, len(image), "ok" if ok else "INVALID"))
+    sys.exit(0 if ok else 1)
+
+
+def key(args):
+    print('-DIMAGE_SIGNING_KEY=\\"%s\\"' % public_key(args.key).hex())
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Sign MSPM0 images for the OTA gateway")
+    commands = parser.add_subparsers(dest="command", required=True)
+    command = commands.add_parser("key", help="print the gateway build flag for a key")
+    command.add_argument("key", help="P-256 private or public key, PEM")
+    command.set_defaults(run=key)
+    command = commands.add_parser("sign", help="append a signature trailer to an image")
+    command.add_argument("key", help="P-256 private key, PEM")
+    command.add_argument("image", help="raw binary image starting at address 0")
+    command.add_argument("output", help="signed image to write")
+    command.set_defaults(run=sign)
+    command = commands.add_parser("verify", help="check a signed image")
+    command.add_argument("key", help="P-256 private or public key, PEM")
+    command.add_argument("image", help="signed image")
+    command.set_defaults(run=verify)
+    args = parser.parse_args()
+    args.run(args)
+
+
+if __name__ == "__main__":
+    main()
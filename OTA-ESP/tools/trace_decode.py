@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+# Prathik Narsetty
+# Decoder for the gateway's persistent binary trace (include/bsl_trace.h)
+#
+# Input is either a raw binary export (e.g. fetched over HTTP) or a captured
+# serial log containing the hex dump printed by the "trace" console command.
+#
+#   python3 tools/trace_decode.py capture.log
+#   python3 tools/trace_decode.py --summary trace.bin
+
+import argparse
+import struct
+import sys
+
+TRACE_MAGIC = 0x45435254
+HEADER = struct.Struct("<IHHII")
+RECORD = struct.Struct("<IHHI")
+
+# Keep in sync with TraceEventId in include/bsl_trace.h
+EVENT_NAMES = {
+    1: "BOOT",
+    2: "SLEEP",
+    3: "WAKE",
+    4: "SESSION_BEGIN",
+    5: "SESSION_END",
+    6: "PHASE_BEGIN",
+    7: "PHASE_END",
+    8: "RETRY",
+    9: "NAK",
+    10: "MISMATCH",
+    11: "CRITICAL",
+    12: "TRIGGER",
+    13: "BSL_READY",
+    14: "FLOW_CONTROL",
+    15: "LINK_ERRORS",
+    16: "CHUNK_SIZE",
+    17: "PROGRAM_STATS",
+    18: "DIGEST",
+    19: "SIGNATURE",
+}
+
+PHASE_NAMES = {
+    1: "enter_bsl",
+    2: "connect",
+    3: "get_id",
+    4: "baud",
+    5: "password",
+    6: "erase",
+    7: "program",
+    8: "verify",
+    9: "start_app",
+    10: "check_app",
+    11: "signature",
+}
+
+TRACE_BOOT = 1
+TRACE_PHASE_BEGIN = 6
+TRACE_PHASE_END = 7
+
+
+def extract_blob(data):
+    """Return the binary trace from a raw export or a serial capture."""
+    if len(data) >= 4 and struct.unpack_from("<I", data)[0] == TRACE_MAGIC:
+        return data
+
+    text = data.decode("ascii", errors="replace")
+    begin = text.rfind("=== TRACE BEGIN ===")
+    end = text.find("=== TRACE END ===", begin)
+    if begin < 0 or end < 0:
+        raise ValueError("no trace dump found in input")
+    hex_lines = text[begin:end].splitlines()[1:]
+    return bytes.fromhex("".join(line.strip() for line in hex_lines))
+
+
+def parse(blob):
+    magic, version, capacity, head, boot_count = HEADER.unpack_from(blob, 0)
+    if magic != TRACE_MAGIC:
+        raise ValueError("bad trace magic 0x%08x" % magic)
+    if len(blob) < HEADER.size + capacity * RECORD.size:
+        raise ValueError("truncated trace: %d bytes" % len(blob))
+
+    count = min(head, capacity)
+    first = head - count
+    records = []
+    for seq in range(first, head):
+        offset = HEADER.size + (seq % capacity) * RECORD.size
+        records.append(RECORD.unpack_from(blob, offset))
+    return {"version": version, "capacity": capacity, "head": head,
+            "boot_count": boot_count, "records": records}
+
+
+def describe(event, arg0, arg1):
+    name = EVENT_NAMES.get(event, "EVENT_%d" % event)
+    if event in (TRACE_PHASE_BEGIN, TRACE_PHASE_END):
+        phase = PHASE_NAMES.get(arg0, str(arg0))
+        if event == TRACE_PHASE_END:
+            return "%-14s %-10s result=0x%02x" % (name, phase, arg1)
+        return "%-14s %s" % (name, phase)
+    if event in (8, 9, 10, 11):
+        return "%-14s arg0=%u addr=0x%08x" % (name, arg0, arg1)
+    if event == 13:
+        return "%-14s attempts=%u after=%ums" % (name, arg0, arg1)
+    if event == 16:
+        return "%-14s bytes=%u addr=0x%08x" % (name, arg0, arg1)
+    if event == 17:
+        return "%-14s failed=%u goodput=%uB/s" % (name, arg0, arg1)
+    if event == 18:
+        result = {0: "mismatch", 1: "match", 2: "unknown"}.get(arg0, str(arg0))
+        return "%-14s %-8s sha256=%08x..." % (name, result, arg1)
+    if event == 19:
+        result = {0: "invalid", 1: "valid", 2: "missing"}.get(arg0, str(arg0))
+        return "%-14s %-8s verify=%uus" % (name, result, arg1)
+    if event == 14:
+        return "%-14s %s" % (name, "on" if arg0 else "off")
+    if event == 15:
+        return "%-14s overruns=%u buffer_full=%u framing=%u" % (
+            name, arg0, arg1 & 0xFFFF, arg1 >> 16)
+    return "%-14s arg0=%u arg1=%u" % (name, arg0, arg1)
+
+
+def timeline(trace):
+    """Yield (boot, time_us, delta_us, record); time is unwrapped per boot."""
+    boot = 0
+    last = None
+    base = 0
+    for record in trace["records"]:
+        time_us, event, _, arg1 = record
+        if event == TRACE_BOOT:
+            boot = arg1
+            last = None
+            base = 0
+        if last is not None and time_us + base < last:
+            base += 1 << 32
+        now = time_us + base
+        delta = 0 if last is None else now - last
+        last = now
+        yield boot, now, delta, record
+
+
+def phase_summary(trace):
+    open_phases = {}
+    stats = {}
+    for boot, now, _, (_, event, arg0, _) in timeline(trace):
+        key = (boot, arg0)
+        if event == TRACE_PHASE_BEGIN:
+            open_phases[key] = now
+        elif event == TRACE_PHASE_END and key in open_phases:
+            duration = now - open_phases.pop(key)
+            stats.setdefault(arg0, []).append(duration)
+    return stats
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode the gateway binary event trace")
+    parser.add_argument("input", help="binary export or serial capture ('-' for stdin)")
+    parser.add_argument("--summary", action="store_true",
+                        help="print per-phase duration statistics only")
+    args = parser.parse_args()
+
+    data = sys.stdin.buffer.read() if args.input == "-" else open(args.input, "rb").read()
+    trace = parse(extract_blob(data))
+
+    if not args.summary:
+        print("capacity=%d records=%d boot_count=%d" %
+              (trace["capacity"], len(trace["records"]), trace["boot_count"]))
+        for boot, now, delta, (_, event, arg0, arg1) in timeline(trace):
+            print("boot %-4d %12.3f ms  +%10.3f ms  %s" %
+                  (boot, now / 1000.0, delta / 1000.0, describe(event, arg0, arg1)))
+        print()
+
+    print("%-10s %6s %10s %10s %10s" % ("phase", "count", "min ms", "avg ms", "max ms"))
+    for phase, durations in sorted(phase_summary(trace).items()):
+        print("%-10s %6d %10.1f %10.1f %10.1f" % (
+            PHASE_NAMES.get(phase, str(phase)), len(durations),
+            min(durations) / 1000.0, sum(durations) / len(durations) / 1000.0,
+            max(durations) / 1000.0))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,4 @@
+// Prathik Narsetty
+// Application image for CAN_Plugin builds; the image does not depend on the
+// interface it is sent over
+#include "application_image_uart.h"
@@ -0,0 +1,416 @@
+// Prathik Narsetty
+// BSL host commands over CAN / CAN FD (CAN_Plugin), same interface as bsl_uart.c
+#include <bsl_can.h>
+
+#include "bsl_timing.h"
+#include "stdbool.h"
+#include "string.h"
+#include "ti_msp_dl_config.h"
+#include "can.h"
+
+uint32_t BSL_entry_cycles;
+uint16_t BSL_entry_attempts;
+
+// 1 Mbit/s nominal, 5 Mbit/s data phase with a 40 MHz CAN clock
+CANFD_baudrate_config br_cfg = {
+    .timing =
+        {
+            .nomRatePrescalar   = 0,
+            .nomTimeSeg1        = 29,
+            .nomTimeSeg2        = 8,
+            .nomSynchJumpWidth  = 8,
+            .dataRatePrescalar  = 0,
+            .dataTimeSeg1       = 4,
+            .dataTimeSeg2       = 1,
+            .dataSynchJumpWidth = 1,
+        },
+    .fdMode    = 1,
+    .brsEnable = 1,
+};
+
+//*****************************************************************************
+//
+// ! BSL Entry Sequence
+// ! Forces target to enter BSL mode
+//
+//*****************************************************************************
+void Host_BSL_entry_sequence()
+{
+    /* NRST low, invoke low, then invoke high and release NRST (see bsl_uart.c) */
+    DL_GPIO_clearPins(GPIO_BSL_PORT, GPIO_BSL_NRST_PIN);
+    DL_GPIO_clearPins(GPIO_BSL_PORT, GPIO_BSL_Invoke_PIN);
+    delay_cycles(BSL_DELAY);
+
+    DL_GPIO_setPins(GPIO_BSL_PORT, GPIO_BSL_Invoke_PIN);
+    delay_cycles(BSL_DELAY);
+    DL_GPIO_setPins(GPIO_BSL_PORT, GPIO_BSL_NRST_PIN);
+    /* Hold invoke until the boot code has sampled it, readiness is polled after */
+    delay_cycles(BSL_DELAY);
+    DL_GPIO_clearPins(GPIO_BSL_PORT, GPIO_BSL_Invoke_PIN);
+}
+
+/*
+ * Turn on the error LED
+ */
+void TurnOnErrorLED(void)
+{
+    DL_GPIO_setPins(GPIO_LED_Error_PORT, GPIO_LED_Error_PIN);
+}
+
+//*****************************************************************************
+//
+// ! Host_BSL_software_trigger
+// ! The application on the target watches CAN_ID_HOST for this byte
+//
+//*****************************************************************************
+void Host_BSL_software_trigger(void)
+{
+    uint8_t ui8Trigger = SOFTWARE_TRIGGER;
+
+    CAN_writeBuffer(&ui8Trigger, 1);
+}
+
+//*****************************************************************************
+//
+// ! Host_BSL_sendPacket
+// ! Completes the command in BSL_TX_buffer (header, length, CRC over the
+// ! ui16PayloadSize bytes from the command on) and sends it
+//
+//*****************************************************************************
+static BSL_error_t Host_BSL_sendPacket(uint16_t ui16PayloadSize)
+{
+    uint32_t ui32CRC = softwareCRC(&BSL_TX_buffer[HDR_BYTES], ui16PayloadSize);
+
+    BSL_TX_buffer[0] = (uint8_t) PACKET_HEADER;
+    BSL_TX_buffer[1] = LSB(ui16PayloadSize);
+    BSL_TX_buffer[2] = MSB(ui16PayloadSize);
+
+    /* The CRC offset follows the payload size and need not be aligned */
+    memcpy(&BSL_TX_buffer[HDR_BYTES + ui16PayloadSize], &ui32CRC, CRC_BYTES);
+
+    if (!CAN_writeBuffer(
+            BSL_TX_buffer, HDR_BYTES + ui16PayloadSize + CRC_BYTES)) {
+        TurnOnErrorLED();
+        return eBSL_busError;
+    }
+    return eBSL_success;
+}
+
+//*****************************************************************************
+//
+// ! Host_BSL_readReply
+// ! Waits for the ACK and, with bPacket, reassembles the response packet
+// ! into BSL_RX_buffer from as many frames as it spans. Bytes after the
+// ! packet's CRC are frame padding and are dropped.
+//
+//*****************************************************************************
+static BSL_error_t Host_BSL_readReply(bool bPacket, uint32_t ui32Timeout)
+{
+    uint8_t ui8Frame[CAN_FD_BYTES];
+    uint8_t ui8Len;
+    uint8_t ui8Off;
+    uint16_t ui16Got  = 0;
+    uint16_t ui16Need = HDR_BYTES;
+
+    while (1) {
+        if (!CAN_readFrame(ui8Frame, &ui8Len, &ui32Timeout)) {
+            TurnOnErrorLED();
+            return eBSL_replyTimeout;
+        }
+        ui8Off = 0;
+        if (ui16Got == 0 && ui8Len > 0 && ui8Frame[0] != RESPONSE_HEADER) {
+            /* ACK byte, possibly followed by the start of the packet */
+            if (ui8Frame[0] != can_noError) {
+                TurnOnErrorLED();
+                return ui8Frame[0];
+            }
+            if (!bPacket) {
+                return eBSL_success;
+            }
+            ui8Off = ACK_BYTE;
+            if (ui8Off >= ui8Len || ui8Frame[ui8Off] != RESPONSE_HEADER) {
+                continue;
+            }
+        }
+        while (ui8Off < ui8Len && ui16Got < ui16Need) {
+            BSL_RX_buffer[ui16Got++] = ui8Frame[ui8Off++];
+            if (ui16Got == HDR_BYTES) {
+                ui16Need = HDR_BYTES +
+                           (BSL_RX_buffer[1] | (BSL_RX_buffer[2] << 8)) +
+                           CRC_BYTES;
+                if (ui16Need > sizeof(BSL_RX_buffer)) {
+                    TurnOnErrorLED();
+                    return packetsize_Error;
+                }
+            }
+        }
+        if (ui16Got == ui16Need) {
+            return eBSL_success;
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// ! Host_BSL_waitForBSL
+// ! Polls the target with the connection command until the BSL acknowledges
+// ! it, with a growing pause between probes, instead of waiting a fixed time
+//
+//*****************************************************************************
+BSL_error_t Host_BSL_waitForBSL(void)
+{
+    uint32_t ui32Backoff = BSL_POLL_BACKOFF_MIN;
+    uint32_t ui32Wait;
+    uint8_t ui8Frame[CAN_FD_BYTES];
+    uint8_t ui8Len;
+
+    BSL_entry_cycles   = 0;
+    BSL_entry_attempts = 0;
+    while (BSL_entry_cycles < BSL_ENTRY_TIMEOUT) {
+        BSL_TX_buffer[HDR_BYTES] = CMD_CONNECTION;
+        BSL_entry_attempts++;
+
+        ui32Wait = BSL_POLL_ACK;
+        if (Host_BSL_sendPacket(CMD_BYTE) == eBSL_success &&
+            CAN_readFrame(ui8Frame, &ui8Len, &ui32Wait) && ui8Len > 0 &&
+            ui8Frame[0] == can_noError) {
+            BSL_entry_cycles += BSL_POLL_ACK - ui32Wait;
+            return eBSL_success;
+        }
+        delay_cycles(ui32Backoff);
+        BSL_entry_cycles += BSL_POLL_ACK - ui32Wait + ui32Backoff;
+        ui32Backoff = (ui32Backoff * 2 > BSL_POLL_BACKOFF_MAX)
+                          ? BSL_POLL_BACKOFF_MAX
+                          : ui32Backoff * 2;
+    }
+    TurnOnErrorLED();
+    return eBSL_entryTimeout;
+}
+
+//*****************************************************************************
+//
+// ! Host_BSL_Connection
+// ! Need to send first to build connection with target
+//
+//*****************************************************************************
+BSL_error_t Host_BSL_Connection(void)
+{
+    BSL_error_t bsl_err;
+
+    BSL_TX_buffer[HDR_BYTES] = CMD_CONNECTION;
+    bsl_err                  = Host_BSL_sendPacket(CMD_BYTE);
+    if (bsl_err != eBSL_success) {
+        return bsl_err;
+    }
+    return Host_BSL_readReply(false, BSL_REPLY_TIMEOUT);
+}
+
+//*****************************************************************************
+//
+// ! Host_BSL_Change_Bitrate
+// ! Sends the new rates at the current one; once the BSL has acknowledged
+// ! them both ends switch, and later packets go out as FD frames
+//
+//*****************************************************************************
+BSL_error_t Host_BSL_Change_Bitrate(const CANFD_baudrate_config *pConfig)
+{
+    const DL_MCAN_BitTimingParams *pT = &pConfig->timing;
+    BSL_error_t bsl_err;
+    uint64_t ui64Word;
+    uint8_t i;
+
+    ui64Word = ((uint64_t) (pT->dataRatePrescalar & 0x1F)) |
+               ((uint64_t) (pT->dataSynchJumpWidth & 0xF) << 5) |
+               ((uint64_t) (pT->dataTimeSeg2 & 0xF) << 9) |
+               ((uint64_t) (pT->dataTimeSeg1 & 0x1F) << 13) |
+               ((uint64_t) (pT->nomRatePrescalar & 0x1FF) << 18) |
+               ((uint64_t) (pT->nomSynchJumpWidth & 0x7F) << 27) |
+               ((uint64_t) (pT->nomTimeSeg2 & 0x7F) << 34) |
+               ((uint64_t) (pT->nomTimeSeg1 & 0xFF) << 41) |
+               ((uint64_t) (pConfig->brsEnable & 1) << 49) |
+               ((uint64_t) (pConfig->fdMode & 1) << 50);
+
+    BSL_TX_buffer[HDR_BYTES] = CMD_CHANGE_BITRATE;
+    for (i = 0; i < BITRATE_BYTES; i++) {
+        BSL_TX_buffer[HDR_LEN_CMD_BYTES + i] = (uint8_t) (ui64Word >> (8 * i));
+    }
+    bsl_err = Host_BSL_sendPacket(CMD_BYTE + BITRATE_BYTES);
+    if (bsl_err == eBSL_success) {
+        bsl_err = Host_BSL_readReply(false, BSL_REPLY_TIMEOUT);
+    }
+    if (bsl_err != eBSL_success) {
+        return bsl_err;
+    }
+    if (!CAN_setBitrate(pT, pConfig->fdMode, pConfig->brsEnable)) {
+        TurnOnErrorLED();
+        return eBSL_busError;
+    }
+    return eBSL_success;
+}
+
+//*****************************************************************************
+// ! Host_BSL_GetID
+// ! Need to send when build connection to get RAM BSL_RX_buffer size and other information
+//
+//*****************************************************************************
+BSL_error_t Host_BSL_GetID(void)
+{
+    BSL_error_t bsl_err;
+
+    BSL_maxBufferSize        = 0;
+    BSL_TX_buffer[HDR_BYTES] = CMD_GET_ID;
+    bsl_err                  = Host_BSL_sendPacket(CMD_BYTE);
+    if (bsl_err == eBSL_success) {
+        bsl_err = Host_BSL_readReply(true, BSL_REPLY_TIMEOUT);
+    }
+    if (bsl_err != eBSL_success) {
+        return bsl_err;
+    }
+    BSL_maxBufferSize =
+        *(uint16_t *) &BSL_RX_buffer[HDR_LEN_CMD_BYTES + ID_BACK - 14];
+    return eBSL_success;
+}
+
+//*****************************************************************************
+// ! Unlock BSL for programming
+// ! If first time, assume blank device.
+// ! This will cause a mass erase and destroy previous password.
+//
+//*****************************************************************************
+BSL_error_t Host_BSL_loadPassword(uint8_t *pPassword)
+{
+    BSL_error_t bsl_err;
+
+    BSL_TX_buffer[HDR_BYTES] = CMD_RX_PASSWORD;
+    memcpy(&BSL_TX_buffer[HDR_LEN_CMD_BYTES], pPassword, PASSWORD_SIZE);
+
+    bsl_err = Host_BSL_sendPacket(PASSWORD_SIZE + CMD_BYTE);
+    if (bsl_err != eBSL_success) {
+        return bsl_err;
+    }
+    return Host_BSL_getResponse(BSL_REPLY_TIMEOUT);
+}
+
+//*****************************************************************************
+// ! Host_BSL_MassErase
+// ! Need to do mess erase before write new image
+//
+//*****************************************************************************
+BSL_error_t Host_BSL_MassErase(void)
+{
+    BSL_error_t bsl_err;
+
+    BSL_TX_buffer[HDR_BYTES] = CMD_MASS_ERASE;
+    bsl_err                  = Host_BSL_sendPacket(CMD_BYTE);
+    if (bsl_err != eBSL_success) {
+        return bsl_err;
+    }
+    return Host_BSL_getResponse(BSL_ERASE_TIMEOUT);
+}
+
+//*****************************************************************************
+//
+// ! Host_BSL_writeMemory
+// ! Writes memory section to target. Each packet is sent as soon as the
+// ! previous one has been answered.
+//
+//*****************************************************************************
+BSL_error_t Host_BSL_writeMemory(
+    uint32_t addr, const uint8_t *data, uint32_t len)
+{
+    BSL_error_t bsl_err = eBSL_success;
+    uint16_t ui16DataLength;
+    uint32_t ui32BytesToWrite = len;
+    uint32_t TargetAddress    = addr;
+
+    while (ui32BytesToWrite > 0) {
+        if (ui32BytesToWrite >= MAX_PAYLOAD_DATA_SIZE)
+            ui16DataLength = MAX_PAYLOAD_DATA_SIZE;
+        else
+            ui16DataLength = ui32BytesToWrite;
+
+        ui32BytesToWrite -= ui16DataLength;
+        BSL_timing_packetBegin();
+
+        BSL_TX_buffer[HDR_BYTES] = (uint8_t) CMD_PROGRAMDATA;
+        *(uint32_t *) &BSL_TX_buffer[HDR_LEN_CMD_BYTES] = TargetAddress;
+        memcpy(&BSL_TX_buffer[HDR_LEN_CMD_BYTES + ADDRS_BYTES], data,
+            ui16DataLength);
+
+        TargetAddress += ui16DataLength;
+        data += ui16DataLength;
+
+        bsl_err = Host_BSL_sendPacket(CMD_BYTE + ADDRS_BYTES + ui16DataLength);
+        if (bsl_err == eBSL_success) {
+            bsl_err = Host_BSL_getResponse(BSL_REPLY_TIMEOUT);
+        }
+        BSL_timing_packetEnd();
+        if (bsl_err != eBSL_success) break;
+    }
+
+    return (bsl_err);
+}
+
+//*****************************************************************************
+// ! Host_BSL_StartApp
+// ! Start the new application. The BSL resets the target right after, so no
+// ! reply is waited for.
+//
+//*****************************************************************************
+BSL_error_t Host_BSL_StartApp(void)
+{
+    BSL_TX_buffer[HDR_BYTES] = CMD_START_APP;
+    return Host_BSL_sendPacket(CMD_BYTE);
+}
+
+//*****************************************************************************
+//
+// ! softwareCRC
+// ! CRC32 as computed by the BSL on the target
+//
+//*****************************************************************************
+#define CRC32_POLY 0xEDB88320
+uint32_t softwareCRC(const uint8_t *data, uint8_t length)
+{
+    uint32_t ii, jj, byte, crc, mask;
+
+    crc = 0xFFFFFFFF;
+
+    for (ii = 0; ii < length; ii++) {
+        byte = data[ii];
+        crc  = crc ^ byte;
+
+        for (jj = 0; jj < 8; jj++) {
+            mask = -(crc & 1);
+            crc  = (crc >> 1) ^ (CRC32_POLY & mask);
+        }
+    }
+
+    return crc;
+}
+
+//*****************************************************************************
+//
+// ! Host_BSL_getResponse
+// ! Reads the message packet that follows the ACK of commands without
+// ! specific data, checks its CRC and returns its status
+//
+//*****************************************************************************
+BSL_error_t Host_BSL_getResponse(uint32_t ui32Timeout)
+{
+    BSL_error_t bsl_err;
+    uint16_t ui16Payload;
+    uint32_t ui32CRC;
+
+    bsl_err = Host_BSL_readReply(true, ui32Timeout);
+    if (bsl_err != eBSL_success) {
+        return bsl_err;
+    }
+    ui16Payload = BSL_RX_buffer[1] | (BSL_RX_buffer[2] << 8);
+    memcpy(&ui32CRC, &BSL_RX_buffer[HDR_BYTES + ui16Payload], CRC_BYTES);
+    if (ui32CRC != softwareCRC(&BSL_RX_buffer[HDR_BYTES], ui16Payload)) {
+        TurnOnErrorLED();
+        return checksum_Error;
+    }
+    return BSL_RX_buffer[HDR_LEN_CMD_BYTES + ACK_BYTE - 1];
+}
@@ -0,0 +1,139 @@
+// Prathik Narsetty
+// BSL host commands over CAN / CAN FD (CAN_Plugin), same interface as bsl_uart.h
+//
+// The BSL starts in classic CAN at the nominal rate set in SysConfig.
+// Host_BSL_Change_Bitrate() moves both ends to the rates in br_cfg, with FD
+// frames of up to 64 bytes and a faster data phase. Packets are the UART
+// ones, cut into frames by can.c and put back together here.
+#include "stdint.h"
+#include "ti_msp_dl_config.h"
+
+#define BSL_DELAY (1000000)
+#define DELAY_BSL_OP (50000)
+
+// Times in CPU cycles, 32 MHz
+#define BSL_CYCLES_PER_MS (32000)
+#define BSL_ENTRY_TIMEOUT (2000 * BSL_CYCLES_PER_MS)
+#define BSL_POLL_ACK (20 * BSL_CYCLES_PER_MS)
+#define BSL_POLL_BACKOFF_MIN (2 * BSL_CYCLES_PER_MS)
+#define BSL_POLL_BACKOFF_MAX (50 * BSL_CYCLES_PER_MS)
+#define BSL_REPLY_TIMEOUT (500 * BSL_CYCLES_PER_MS)
+#define BSL_ERASE_TIMEOUT (2000 * BSL_CYCLES_PER_MS)
+
+#define MAX_PAYLOAD_DATA_SIZE (128)
+//MAX_PACKET_SIZE = MAX_PAYLOAD_DATA_SIZE + HDR_LEN_CMD_BYTES + CRC_BYTES = 128 + 8 = 136
+#define MAX_PACKET_SIZE (136)
+
+//#define Hardware_Invoke
+#define Software_Invoke  //This just work when the code "Application_demo_with_software_trigger_LP_MSPM0G3507_0_address" exist on the device
+
+uint8_t BSL_TX_buffer[MAX_PACKET_SIZE + 2];
+uint8_t BSL_RX_buffer[MAX_PACKET_SIZE + 2];
+// ! Define BSL CORE commands
+#define CMD_CONNECTION (0x12)
+#define CMD_GET_ID (0x19)
+#define CMD_RX_PASSWORD (0x21)
+#define CMD_MASS_ERASE (0x15)
+#define CMD_PROGRAMDATA (0x20)
+#define CMD_START_APP (0x40)
+#define CMD_CHANGE_BITRATE (0x52)
+
+// ! Other useful macros
+#define PACKET_HEADER (0x80)
+#define RESPONSE_HEADER (0x08)
+#define SOFTWARE_TRIGGER (0x22)
+
+#define CMD_BYTE (1)
+#define HDR_BYTES (3)
+#define HDR_LEN_CMD_BYTES (4)
+#define CRC_BYTES (4)
+#define PASSWORD_SIZE (uint8_t)(32)
+#define ACK_BYTE (1)
+#define ID_BACK (24)
+#define ADDRS_BYTES (4)
+#define BITRATE_BYTES (7)
+
+//================================================================================
+// ! Conversion MACROS
+#define LSB(x) (x & 0x00FF)
+#define MSB(x) ((x & 0xFF00) >> 8)
+
+enum {
+    //! No Error Occurred! The operation was successful.
+    eBSL_success = 0,
+
+    //! Flash write check failed. After programming, a CRC is run on the programmed data
+    //! If the CRC does not match the expected result, this error is returned.
+    eBSL_flashWriteCheckFailed = 1,
+
+    //! BSL locked.  The correct password has not yet been supplied to unlock the BSL.
+    eBSL_locked = 4,
+
+    //! BSL password error. An incorrect password was supplied to the BSL when attempting an unlock.
+    eBSL_passwordError = 5,
+
+    //! Unknown error.  The command given to the BSL was not recognized
+    eBSL_unknownError = 7,
+
+    //! The target did not answer the connection probe within BSL_ENTRY_TIMEOUT.
+    eBSL_entryTimeout = 9,
+
+    //! No reply frame arrived within the command's timeout.
+    eBSL_replyTimeout = 10,
+
+    //! A frame was not acknowledged on the bus, or the bit timing was rejected.
+    eBSL_busError = 11,
+
+    eBSL_responseCommand = 0x3B
+
+};
+typedef uint8_t BSL_error_t;
+
+enum {
+    can_noError      = 0,     //normal ACK
+    header_Error     = 0x51,  //Header incorrect
+    checksum_Error   = 0x52,  //Checksum incorrect.
+    unknown_Error    = 0x55,  //Unknown error
+    bitrate_Error    = 0x56,  //Unknown bit rate.
+    packetsize_Error = 0x57,  //Packet Size Error.
+};
+
+typedef uint8_t can_error_t;
+
+// Rates for Host_BSL_Change_Bitrate(). timing uses the DL_MCAN_BitTimingParams
+// encoding (register values, one less than the time quanta). The command
+// sends it packed little-endian, LSB first: DRP 5 bits, DSJW 4, DTSEG2 4,
+// DTSEG1 5, NRP 9, NSJW 7, NTSEG2 7, NTSEG1 8, BRS 1, FD 1.
+typedef struct {
+    DL_MCAN_BitTimingParams timing;
+    uint8_t fdMode;
+    uint8_t brsEnable;
+} CANFD_baudrate_config;
+
+extern CANFD_baudrate_config br_cfg;
+
+uint16_t BSL_maxBufferSize;
+
+// Measured by Host_BSL_waitForBSL: cycles from the invoke until the BSL
+// answered (approximate, summed from the poll waits) and probes sent
+extern uint32_t BSL_entry_cycles;
+extern uint16_t BSL_entry_attempts;
+
+void Host_BSL_entry_sequence(void);
+
+void TurnOnErrorLED(void);
+
+void Host_BSL_software_trigger(void);
+BSL_error_t Host_BSL_waitForBSL(void);
+
+BSL_error_t Host_BSL_Connection(void);
+BSL_error_t Host_BSL_Change_Bitrate(const CANFD_baudrate_config* pConfig);
+BSL_error_t Host_BSL_GetID(void);
+BSL_error_t Host_BSL_loadPassword(uint8_t* pPassword);
+BSL_error_t Host_BSL_MassErase(void);
+BSL_error_t Host_BSL_writeMemory(
+    uint32_t addr, const uint8_t* data, uint32_t len);
+BSL_error_t Host_BSL_StartApp(void);
+
+uint32_t softwareCRC(const uint8_t* data, uint8_t length);
+BSL_error_t Host_BSL_getResponse(uint32_t ui32Timeout);
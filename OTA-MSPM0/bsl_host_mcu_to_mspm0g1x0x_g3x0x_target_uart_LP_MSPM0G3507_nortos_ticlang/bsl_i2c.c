@@ -0,0 +1,281 @@
+// Prathik Narsetty
+// BSL host commands over I2C (I2C_Plugin), same interface as bsl_uart.c
+#include <bsl_i2c.h>
+
+#include "bsl_timing.h"
+#include "string.h"
+#include "ti_msp_dl_config.h"
+#include "i2c.h"
+
+uint32_t BSL_entry_cycles;
+uint16_t BSL_entry_attempts;
+
+// Reply sizes read in one transaction: ACK, then the response packet if any
+#define REPLY_ACK (ACK_BYTE)
+#define REPLY_MESSAGE (ACK_BYTE + HDR_LEN_CMD_BYTES + MESSAGE_BYTES + CRC_BYTES)
+#define REPLY_ID (ACK_BYTE + HDR_LEN_CMD_BYTES + ID_BACK + CRC_BYTES)
+
+//*****************************************************************************
+//
+// ! BSL Entry Sequence
+// ! Forces target to enter BSL mode
+//
+//*****************************************************************************
+void Host_BSL_entry_sequence()
+{
+    /* NRST low, invoke low, then invoke high and release NRST (see bsl_uart.c) */
+    DL_GPIO_clearPins(GPIO_BSL_PORT, GPIO_BSL_NRST_PIN);
+    DL_GPIO_clearPins(GPIO_BSL_PORT, GPIO_BSL_Invoke_PIN);
+    delay_cycles(BSL_DELAY);
+
+    DL_GPIO_setPins(GPIO_BSL_PORT, GPIO_BSL_Invoke_PIN);
+    delay_cycles(BSL_DELAY);
+    DL_GPIO_setPins(GPIO_BSL_PORT, GPIO_BSL_NRST_PIN);
+    /* Hold invoke until the boot code has sampled it, readiness is polled after */
+    delay_cycles(BSL_DELAY);
+    DL_GPIO_clearPins(GPIO_BSL_PORT, GPIO_BSL_Invoke_PIN);
+}
+
+//*****************************************************************************
+//
+// ! Host_BSL_waitForBSL
+// ! Polls the target with the status probe until the BSL answers, with a
+// ! growing pause between probes, instead of waiting a fixed time
+//
+//*****************************************************************************
+BSL_error_t Host_BSL_waitForBSL(void)
+{
+    uint32_t ui32Backoff = BSL_POLL_BACKOFF_MIN;
+    uint32_t ui32Wait;
+    uint8_t ui8Probe = BSL_STATUS_PROBE;
+    uint8_t ui8Res;
+
+    BSL_entry_cycles   = 0;
+    BSL_entry_attempts = 0;
+    while (BSL_entry_cycles < BSL_ENTRY_TIMEOUT) {
+        BSL_entry_attempts++;
+
+        ui32Wait = BSL_POLL_ACK;
+        if (I2C_writeBuffer(&ui8Probe, 1) &&
+            I2C_readBufferTimeout(&ui8Res, 1, &ui32Wait) &&
+            ui8Res == BSL_STATUS_READY) {
+            BSL_entry_cycles += BSL_POLL_ACK - ui32Wait;
+            return eBSL_success;
+        }
+        delay_cycles(ui32Backoff);
+        BSL_entry_cycles += BSL_POLL_ACK - ui32Wait + ui32Backoff;
+        ui32Backoff = (ui32Backoff * 2 > BSL_POLL_BACKOFF_MAX)
+                          ? BSL_POLL_BACKOFF_MAX
+                          : ui32Backoff * 2;
+    }
+    TurnOnErrorLED();
+    return eBSL_entryTimeout;
+}
+
+void Host_BSL_software_trigger(void)
+{
+    uint8_t ui8Trigger = 0x22;
+
+    I2C_writeBuffer(&ui8Trigger, 1);
+}
+
+/*
+ * Turn on the error LED
+ */
+void TurnOnErrorLED(void)
+{
+    DL_GPIO_setPins(GPIO_LED_Error_PORT, GPIO_LED_Error_PIN);
+}
+
+//*****************************************************************************
+//
+// ! Host_BSL_exchange
+// ! Completes the command in BSL_TX_buffer (header, length, CRC over the
+// ! ui16PayloadSize bytes from the command on), writes it in one transaction
+// ! and reads ui16ReplySize bytes of reply into BSL_RX_buffer in one more,
+// ! polling until the BSL answers. Returns the ACK.
+//
+//*****************************************************************************
+static BSL_error_t Host_BSL_exchange(
+    uint16_t ui16PayloadSize, uint16_t ui16ReplySize, uint32_t ui32Timeout)
+{
+    uint32_t ui32CRC = softwareCRC(&BSL_TX_buffer[3], ui16PayloadSize);
+
+    BSL_TX_buffer[0] = (uint8_t) PACKET_HEADER;
+    BSL_TX_buffer[1] = LSB(ui16PayloadSize);
+    BSL_TX_buffer[2] = MSB(ui16PayloadSize);
+    /* The CRC offset follows the payload size and need not be aligned */
+    memcpy(&BSL_TX_buffer[3 + ui16PayloadSize], &ui32CRC, CRC_BYTES);
+
+    if (!I2C_writeBuffer(BSL_TX_buffer, 3 + ui16PayloadSize + CRC_BYTES) ||
+        !I2C_readBufferTimeout(BSL_RX_buffer, ui16ReplySize, &ui32Timeout)) {
+        TurnOnErrorLED();
+        return eBSL_replyTimeout;
+    }
+    if (BSL_RX_buffer[0] != i2c_noError) {
+        TurnOnErrorLED();
+    }
+    return BSL_RX_buffer[0];
+}
+
+// Status of a message response read by Host_BSL_exchange
+static BSL_error_t Host_BSL_messageStatus(BSL_error_t bsl_err)
+{
+    if (bsl_err != eBSL_success) {
+        return bsl_err;
+    }
+    return BSL_RX_buffer[ACK_BYTE + HDR_LEN_CMD_BYTES];
+}
+
+//*****************************************************************************
+//
+// ! Host_BSL_Connection
+// ! Need to send first to build connection with target
+//
+//*****************************************************************************
+BSL_error_t Host_BSL_Connection(void)
+{
+    BSL_TX_buffer[3] = CMD_CONNECTION;
+    return Host_BSL_exchange(CMD_BYTE, REPLY_ACK, BSL_REPLY_TIMEOUT);
+}
+
+//*****************************************************************************
+// ! Host_BSL_GetID
+// ! Need to send when build connection to get RAM BSL_RX_buffer size and other information
+//
+//*****************************************************************************
+BSL_error_t Host_BSL_GetID(void)
+{
+    BSL_error_t bsl_err;
+    uint8_t *pSize = &BSL_RX_buffer[ACK_BYTE + HDR_LEN_CMD_BYTES + ID_BACK - 14];
+
+    BSL_MAX_BUFFER_SIZE = 0;
+    BSL_TX_buffer[3]    = CMD_GET_ID;
+    bsl_err = Host_BSL_exchange(CMD_BYTE, REPLY_ID, BSL_REPLY_TIMEOUT);
+    if (bsl_err != eBSL_success) {
+        return bsl_err;
+    }
+    BSL_MAX_BUFFER_SIZE = pSize[0] | (pSize[1] << 8);
+    return eBSL_success;
+}
+
+//*****************************************************************************
+// ! Unlock BSL for programming
+// ! If first time, assume blank device.
+// ! This will cause a mass erase and destroy previous password.
+//
+//*****************************************************************************
+BSL_error_t Host_BSL_loadPassword(uint8_t *pPassword)
+{
+    BSL_TX_buffer[3] = CMD_RX_PASSWORD;
+    memcpy(&BSL_TX_buffer[4], pPassword, PASSWORD_SIZE);
+
+    return Host_BSL_messageStatus(Host_BSL_exchange(
+        PASSWORD_SIZE + CMD_BYTE, REPLY_MESSAGE, BSL_REPLY_TIMEOUT));
+}
+
+//*****************************************************************************
+// ! Host_BSL_MassErase
+// ! Need to do mess erase before write new image
+//
+//*****************************************************************************
+BSL_error_t Host_BSL_MassErase(void)
+{
+    BSL_TX_buffer[3] = CMD_MASS_ERASE;
+    return Host_BSL_messageStatus(
+        Host_BSL_exchange(CMD_BYTE, REPLY_MESSAGE, BSL_ERASE_TIMEOUT));
+}
+
+//*****************************************************************************
+//
+// ! Host_BSL_writeMemory
+// ! Writes memory section to target. Each packet is sent as soon as the
+// ! previous one has been answered.
+//
+//*****************************************************************************
+BSL_error_t Host_BSL_writeMemory(
+    uint32_t addr, const uint8_t *data, uint32_t len)
+{
+    BSL_error_t bsl_err = eBSL_success;
+    uint16_t ui16DataLength;
+    uint32_t ui32BytesToWrite = len;
+    uint32_t TargetAddress    = addr;
+
+    while (ui32BytesToWrite > 0) {
+        if (ui32BytesToWrite >= MAX_PAYLOAD_DATA_SIZE)
+            ui16DataLength = MAX_PAYLOAD_DATA_SIZE;
+        else
+            ui16DataLength = ui32BytesToWrite;
+
+        ui32BytesToWrite -= ui16DataLength;
+        BSL_timing_packetBegin();
+
+        BSL_TX_buffer[3] = (uint8_t) CMD_PROGRAMDATA;
+        *(uint32_t *) &BSL_TX_buffer[HDR_LEN_CMD_BYTES] = TargetAddress;
+        memcpy(&BSL_TX_buffer[HDR_LEN_CMD_BYTES + ADDRS_BYTES], data,
+            ui16DataLength);
+
+        TargetAddress += ui16DataLength;
+        data += ui16DataLength;
+
+        bsl_err = Host_BSL_messageStatus(
+            Host_BSL_exchange(CMD_BYTE + ADDRS_BYTES + ui16DataLength,
+                REPLY_MESSAGE, BSL_REPLY_TIMEOUT));
+        BSL_timing_packetEnd();
+        if (bsl_err != eBSL_success) break;
+    }
+
+    return (bsl_err);
+}
+
+//*****************************************************************************
+// ! Host_BSL_StartApp
+// ! Start the new application
+//
+//*****************************************************************************
+BSL_error_t Host_BSL_StartApp(void)
+{
+    BSL_TX_buffer[3] = CMD_START_APP;
+    return Host_BSL_exchange(CMD_BYTE, REPLY_ACK, BSL_REPLY_TIMEOUT);
+}
+
+//*****************************************************************************
+//
+// ! softwareCRC
+// ! CRC32 as computed by the BSL on the target
+//
+//*****************************************************************************
+#define CRC32_POLY 0xEDB88320
+uint32_t softwareCRC(const uint8_t *data, uint8_t length)
+{
+    uint32_t ii, jj, byte, crc, mask;
+
+    crc = 0xFFFFFFFF;
+
+    for (ii = 0; ii < length; ii++) {
+        byte = data[ii];
+        crc  = crc ^ byte;
+
+        for (jj = 0; jj < 8; jj++) {
+            mask = -(crc & 1);
+            crc  = (crc >> 1) ^ (CRC32_POLY & mask);
+        }
+    }
+
+    return crc;
+}
+
+//*****************************************************************************
+//
+// ! Host_BSL_getResponse
+// ! Reads a message response (ACK and packet) and returns its status
+//
+//*****************************************************************************
+BSL_error_t Host_BSL_getResponse(uint32_t ui32Timeout)
+{
+    if (!I2C_readBufferTimeout(BSL_RX_buffer, REPLY_MESSAGE, &ui32Timeout)) {
+        TurnOnErrorLED();
+        return eBSL_replyTimeout;
+    }
+    return Host_BSL_messageStatus(BSL_RX_buffer[0]);
+}
@@ -0,0 +1,143 @@
+// Prathik Narsetty
+// Phase and per-packet timing of the host's BSL sessions (see bsl_timing.h)
+#include "bsl_timing.h"
+
+#include "string.h"
+
+BSL_Timing BSL_timing;
+
+static BSL_clock_t BSL_timing_clock;
+
+static const char *const BSL_phaseNames[BSL_PHASE_COUNT] = {"entry",
+    "connect", "bitrate", "get_id", "password", "erase", "write",
+    "start_app"};
+
+void BSL_timing_init(BSL_clock_t clock)
+{
+    memset(&BSL_timing, 0, sizeof(BSL_timing));
+    BSL_timing_clock = clock;
+}
+
+void BSL_timing_record(BSL_TimingStat *pStat, uint32_t ui32Us)
+{
+    if (pStat->count == 0 || ui32Us < pStat->min_us) {
+        pStat->min_us = ui32Us;
+    }
+    if (ui32Us > pStat->max_us) {
+        pStat->max_us = ui32Us;
+    }
+    pStat->count++;
+    pStat->total_us += ui32Us;
+}
+
+uint32_t BSL_timing_average(const BSL_TimingStat *pStat)
+{
+    return pStat->count ? (uint32_t)(pStat->total_us / pStat->count) : 0;
+}
+
+//*****************************************************************************
+//
+// ! Begin / end pairs
+// ! Differences of the 32-bit clock stay right across its wrap, for spans
+// ! up to 71 minutes
+//
+//*****************************************************************************
+void BSL_timing_sessionBegin(void)
+{
+    BSL_timing.sessionStart_us = BSL_timing_clock();
+}
+
+void BSL_timing_sessionEnd(void)
+{
+    BSL_timing_record(
+        &BSL_timing.session, BSL_timing_clock() - BSL_timing.sessionStart_us);
+}
+
+void BSL_timing_phaseBegin(BSL_phase_t phase)
+{
+    BSL_timing.phaseStart_us[phase] = BSL_timing_clock();
+}
+
+void BSL_timing_phaseEnd(BSL_phase_t phase)
+{
+    BSL_timing_record(&BSL_timing.phase[phase],
+        BSL_timing_clock() - BSL_timing.phaseStart_us[phase]);
+}
+
+void BSL_timing_packetBegin(void)
+{
+    BSL_timing.packetStart_us = BSL_timing_clock();
+}
+
+void BSL_timing_packetEnd(void)
+{
+    BSL_timing_record(
+        &BSL_timing.packet, BSL_timing_clock() - BSL_timing.packetStart_us);
+}
+
+//*****************************************************************************
+//
+// ! Report
+// ! Fixed-width text without printf, so the library's is not linked in
+//
+//*****************************************************************************
+static void BSL_timing_putString(BSL_putChar_t putChar, const char *pString)
+{
+    while (*pString) {
+        putChar(*pString++);
+    }
+}
+
+// ui32Value right-aligned in ui8Width columns
+static void BSL_timing_putNumber(
+    BSL_putChar_t putChar, uint32_t ui32Value, uint8_t ui8Width)
+{
+    char digits[10];
+    uint8_t ui8Count = 0;
+
+    do {
+        digits[ui8Count++] = (char) ('0' + ui32Value % 10);
+        ui32Value /= 10;
+    } while (ui32Value);
+    while (ui8Width-- > ui8Count) {
+        putChar(' ');
+    }
+    while (ui8Count) {
+        putChar(digits[--ui8Count]);
+    }
+}
+
+static void BSL_timing_putLine(
+    BSL_putChar_t putChar, const char *pName, const BSL_TimingStat *pStat)
+{
+    uint8_t ui8Pad = 10;
+
+    BSL_timing_putString(putChar, pName);
+    while (*pName++) {
+        ui8Pad--;
+    }
+    while (ui8Pad--) {
+        putChar(' ');
+    }
+    BSL_timing_putNumber(putChar, pStat->count, 6);
+    BSL_timing_putNumber(putChar, pStat->min_us, 10);
+    BSL_timing_putNumber(putChar, BSL_timing_average(pStat), 10);
+    BSL_timing_putNumber(putChar, pStat->max_us, 10);
+    BSL_timing_putString(putChar, "\r\n");
+}
+
+void BSL_timing_report(BSL_putChar_t putChar)
+{
+    uint8_t phase;
+
+    BSL_timing_putString(
+        putChar, "phase      count    min us    avg us    max us\r\n");
+    for (phase = 0; phase < BSL_PHASE_COUNT; phase++) {
+        if (BSL_timing.phase[phase].count) {
+            BSL_timing_putLine(
+                putChar, BSL_phaseNames[phase], &BSL_timing.phase[phase]);
+        }
+    }
+    BSL_timing_putLine(putChar, "packet", &BSL_timing.packet);
+    BSL_timing_putLine(putChar, "session", &BSL_timing.session);
+}
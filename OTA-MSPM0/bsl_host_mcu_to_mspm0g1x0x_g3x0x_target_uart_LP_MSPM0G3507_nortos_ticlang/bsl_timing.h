@@ -0,0 +1,68 @@
+// Prathik Narsetty
+// Phase and per-packet timing of the host's BSL sessions
+//
+// main.c marks the start and end of each session phase (entry, connection,
+// Get ID, password, mass erase, write, start application) and the plugins'
+// Host_BSL_writeMemory() marks each Program Data packet, from building the
+// frame to the BSL's reply. Every duration goes into a min/avg/max record in
+// BSL_timing, which stays in RAM for inspection in the debugger (like
+// BSL_entry_cycles), and BSL_timing_report() prints the table through any
+// character output, e.g. a spare UART.
+//
+// Times come from the clock given to BSL_timing_init(), in microseconds:
+// Timestamp_getMicros() (timestamp.h, SysTick) on the LaunchPad. This file
+// and bsl_timing.c use no DriverLib, so the statistics build with gcc on
+// Linux against a fake clock.
+#include "stdint.h"
+
+typedef enum {
+    BSL_PHASE_ENTRY = 0,  // invoke until the BSL answers the status probe
+    BSL_PHASE_CONNECT,
+    BSL_PHASE_BITRATE,    // CAN plugin only
+    BSL_PHASE_GET_ID,
+    BSL_PHASE_PASSWORD,
+    BSL_PHASE_ERASE,
+    BSL_PHASE_WRITE,      // all Program Data packets, with the pauses between them
+    BSL_PHASE_START_APP,
+    BSL_PHASE_COUNT
+} BSL_phase_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;
+} BSL_TimingStat;
+
+typedef struct {
+    BSL_TimingStat phase[BSL_PHASE_COUNT];
+    BSL_TimingStat packet;   // one Program Data packet and its reply
+    BSL_TimingStat session;  // whole session, including the waits between phases
+    uint32_t phaseStart_us[BSL_PHASE_COUNT];
+    uint32_t packetStart_us;
+    uint32_t sessionStart_us;
+} BSL_Timing;
+
+typedef uint32_t (*BSL_clock_t)(void);
+typedef void (*BSL_putChar_t)(char c);
+
+extern BSL_Timing BSL_timing;
+
+// Clear all statistics and take times from clock from now on
+void BSL_timing_init(BSL_clock_t clock);
+
+void BSL_timing_sessionBegin(void);
+void BSL_timing_sessionEnd(void);
+void BSL_timing_phaseBegin(BSL_phase_t phase);
+void BSL_timing_phaseEnd(BSL_phase_t phase);
+void BSL_timing_packetBegin(void);
+void BSL_timing_packetEnd(void);
+
+// Add one duration to a record
+void BSL_timing_record(BSL_TimingStat *pStat, uint32_t ui32Us);
+// Mean of a record in us, 0 if it is empty
+uint32_t BSL_timing_average(const BSL_TimingStat *pStat);
+
+// Print the table (count, min, avg, max in us per phase, packet and
+// session), skipping phases that never ran
+void BSL_timing_report(BSL_putChar_t putChar);
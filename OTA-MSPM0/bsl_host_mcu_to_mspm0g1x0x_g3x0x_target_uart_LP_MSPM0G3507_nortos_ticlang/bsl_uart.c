@@ -33,9 +33,13 @@
 
 #include "stdio.h"
 #include "string.h"
+#include "bsl_timing.h"
 #include "ti_msp_dl_config.h"
 #include "uart.h"
 
+uint32_t BSL_entry_cycles;
+uint16_t BSL_entry_attempts;
+
 //*****************************************************************************
 //
 // ! BSL Entry Sequence
@@ -62,15 +66,54 @@ void Host_BSL_entry_sequence()
     /* Invoke GPIO high*/
     DL_GPIO_setPins(GPIO_BSL_PORT, GPIO_BSL_Invoke_PIN);
     delay_cycles(BSL_DELAY);
-    delay_cycles(33000000);
     /* NRST high*/
     DL_GPIO_setPins(GPIO_BSL_PORT, GPIO_BSL_NRST_PIN);
-    delay_cycles(BSL_DELAY);
-    delay_cycles(BSL_DELAY);
+    /* Hold invoke until the boot code has sampled it, readiness is polled after */
     delay_cycles(BSL_DELAY);
     DL_GPIO_clearPins(GPIO_BSL_PORT, GPIO_BSL_Invoke_PIN);
 }
 
+//*****************************************************************************
+//
+// ! Host_BSL_waitForBSL
+// ! Polls the target with the status probe until the BSL answers, with a
+// ! growing pause between probes, instead of waiting a fixed time
+//
+//*****************************************************************************
+BSL_error_t Host_BSL_waitForBSL(void)
+{
+    uint32_t ui32Backoff = BSL_POLL_BACKOFF_MIN;
+    uint32_t ui32Wait;
+    uint8_t ui8Res;
+
+    BSL_entry_cycles   = 0;
+    BSL_entry_attempts = 0;
+    while (BSL_entry_cycles < BSL_ENTRY_TIMEOUT) {
+        /* Drop anything sent while the target was booting */
+        while (!DL_UART_isRXFIFOEmpty(UART_0_INST)) {
+            DL_UART_receiveData(UART_0_INST);
+        }
+        while (DL_UART_Main_isBusy(UART_0_INST))
+            ;
+        DL_UART_transmitDataBlocking(UART_0_INST, BSL_STATUS_PROBE);
+        BSL_entry_attempts++;
+
+        ui32Wait = BSL_POLL_ACK;
+        if (UART_readByteTimeout(&ui8Res, &ui32Wait) &&
+            ui8Res == BSL_STATUS_READY) {
+            BSL_entry_cycles += BSL_POLL_TX + BSL_POLL_ACK - ui32Wait;
+            return eBSL_success;
+        }
+        delay_cycles(ui32Backoff);
+        BSL_entry_cycles += BSL_POLL_TX + BSL_POLL_ACK - ui32Wait + ui32Backoff;
+        ui32Backoff = (ui32Backoff * 2 > BSL_POLL_BACKOFF_MAX)
+                          ? BSL_POLL_BACKOFF_MAX
+                          : ui32Backoff * 2;
+    }
+    TurnOnErrorLED();
+    return eBSL_entryTimeout;
+}
+
 void Host_BSL_software_trigger(void)
 {
     /* Wait until all bytes have been transmitted and the TX FIFO is empty */
@@ -241,6 +284,7 @@ BSL_error_t Host_BSL_writeMemory(
 
     while (ui16BytesToWrite > 0) {
         delay_cycles(2000000);  //allow target deal with the packet send before
+        BSL_timing_packetBegin();
 
         if (ui16BytesToWrite >= MAX_PAYLOAD_DATA_SIZE)
             ui16DataLength = MAX_PAYLOAD_DATA_SIZE;
@@ -285,6 +329,7 @@ BSL_error_t Host_BSL_writeMemory(
 
         // Check operation was complete
         bsl_err = Host_BSL_getResponse();
+        BSL_timing_packetEnd();
         if (bsl_err != eBSL_success) break;
 
     }  // end while
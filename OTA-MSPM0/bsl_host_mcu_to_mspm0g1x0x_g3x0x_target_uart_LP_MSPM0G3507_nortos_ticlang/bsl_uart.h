@@ -33,6 +33,17 @@
 
 #define BSL_DELAY (1000000)
 
+// BSL entry polling: after the invoke, 0xBB is sent until the BSL answers
+// 0x51 (the application answers 0x22 or nothing). Times in CPU cycles, 32 MHz.
+#define BSL_CYCLES_PER_MS (32000)
+#define BSL_ENTRY_TIMEOUT (2000 * BSL_CYCLES_PER_MS)
+#define BSL_POLL_ACK (20 * BSL_CYCLES_PER_MS)
+#define BSL_POLL_BACKOFF_MIN (2 * BSL_CYCLES_PER_MS)
+#define BSL_POLL_BACKOFF_MAX (50 * BSL_CYCLES_PER_MS)
+#define BSL_POLL_TX (BSL_CYCLES_PER_MS)  //one byte at 9600 baud
+#define BSL_STATUS_PROBE (0xBB)
+#define BSL_STATUS_READY (0x51)
+
 #define MAX_PAYLOAD_DATA_SIZE (128)
 //MAX_PACKET_SIZE = MAX_PAYLOAD_DATA_SIZE + HDR_LEN_CMD_BYTES + CRC_BYTES = 128 + 8 = 136
 #define MAX_PACKET_SIZE (136)
@@ -83,6 +94,9 @@ enum {
     //! Unknown error.  The command given to the BSL was not recognized
     eBSL_unknownError = 7,
 
+    //! The target did not answer the status probe within BSL_ENTRY_TIMEOUT.
+    eBSL_entryTimeout = 9,
+
     eBSL_responseCommand = 0x3B
 
 };
@@ -104,11 +118,17 @@ typedef uint8_t uart_error_t;
 
 uint16_t BSL_MAX_BUFFER_SIZE;
 
+// Measured by Host_BSL_waitForBSL: cycles from the invoke until the BSL
+// answered (approximate, summed from the poll waits) and probes sent
+extern uint32_t BSL_entry_cycles;
+extern uint16_t BSL_entry_attempts;
+
 void Host_BSL_entry_sequence(void);
 
 void TurnOnErrorLED(void);
 
 void Host_BSL_software_trigger(void);
+BSL_error_t Host_BSL_waitForBSL(void);
 
 BSL_error_t Host_BSL_Connection(void);
 BSL_error_t Host_BSL_GetID(void);
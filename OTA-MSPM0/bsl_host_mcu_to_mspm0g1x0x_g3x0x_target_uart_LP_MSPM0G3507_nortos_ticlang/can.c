@@ -0,0 +1,162 @@
+// Prathik Narsetty
+// MCAN side of the BSL CAN link (CAN_Plugin)
+#include "can.h"
+#include "string.h"
+
+// Standard IDs sit in ID[28:18] of the message RAM element
+#define CAN_STD_ID_SHIFT (18)
+
+static const uint8_t dlcBytes[16] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+
+static bool gFdMode;
+static bool gBrsMode;
+
+static void CAN_waitOpMode(DL_MCAN_OperationMode mode)
+{
+    while (DL_MCAN_getOpMode(MCAN0_INST) != mode)
+        ;
+}
+
+void CAN_initialize(void)
+{
+    DL_MCAN_RxFIFOStatus rxFS;
+
+    CAN_waitOpMode(DL_MCAN_OPERATION_MODE_NORMAL);
+    gFdMode  = false;
+    gBrsMode = false;
+
+    /* Drop anything received while the MCAN was being configured */
+    rxFS.num = DL_MCAN_RX_FIFO_NUM_0;
+    DL_MCAN_getRxFIFOStatus(MCAN0_INST, &rxFS);
+    while (rxFS.fillLvl != 0) {
+        DL_MCAN_writeRxFIFOAck(MCAN0_INST, rxFS.num, rxFS.getIdx);
+        DL_MCAN_getRxFIFOStatus(MCAN0_INST, &rxFS);
+    }
+}
+
+//*****************************************************************************
+//
+// ! CAN_setBitrate
+// ! Reprograms the bit timing and switches to FD frames (and bit rate
+// ! switching) for everything sent afterwards. The SysConfig MCAN instance
+// ! must have FD operation and bit rate switching enabled and 64-byte
+// ! TX buffer and RX FIFO elements. Returns 1 on success.
+//
+//*****************************************************************************
+uint8_t CAN_setBitrate(
+    const DL_MCAN_BitTimingParams *pTiming, bool bFd, bool bBrs)
+{
+    int32_t status;
+
+    /* Let the last frame at the old rate leave first */
+    while (DL_MCAN_getTxBufReqPend(MCAN0_INST))
+        ;
+    DL_MCAN_setOpMode(MCAN0_INST, DL_MCAN_OPERATION_MODE_SW_INIT);
+    CAN_waitOpMode(DL_MCAN_OPERATION_MODE_SW_INIT);
+
+    DL_MCAN_writeProtectedRegAccessUnlock(MCAN0_INST);
+    status = DL_MCAN_setBitTime(MCAN0_INST, pTiming);
+    DL_MCAN_writeProtectedRegAccessLock(MCAN0_INST);
+
+    DL_MCAN_setOpMode(MCAN0_INST, DL_MCAN_OPERATION_MODE_NORMAL);
+    CAN_waitOpMode(DL_MCAN_OPERATION_MODE_NORMAL);
+    if (status != 0) {
+        return 0;
+    }
+    gFdMode  = bFd;
+    gBrsMode = bFd && bBrs;
+    return 1;
+}
+
+//*****************************************************************************
+//
+// ! CAN_writeBuffer
+// ! Sends ui16Cnt bytes as consecutive frames of at most 8 (classic) or 64
+// ! (FD) bytes. Returns 1 when every frame was sent.
+//
+//*****************************************************************************
+uint8_t CAN_writeBuffer(const uint8_t *pData, uint16_t ui16Cnt)
+{
+    DL_MCAN_TxBufElement txMsg;
+    uint8_t ui8Max = gFdMode ? CAN_FD_BYTES : CAN_CLASSIC_BYTES;
+    uint8_t ui8Len;
+    uint8_t ui8Dlc;
+    uint8_t i;
+    uint32_t ui32Wait;
+
+    memset(&txMsg, 0, sizeof(txMsg));
+    txMsg.id  = ((uint32_t) CAN_ID_HOST) << CAN_STD_ID_SHIFT;
+    txMsg.fdf = gFdMode;
+    txMsg.brs = gBrsMode;
+
+    while (ui16Cnt > 0) {
+        ui8Len = (ui16Cnt > ui8Max) ? ui8Max : ui16Cnt;
+        for (ui8Dlc = 0; dlcBytes[ui8Dlc] < ui8Len; ui8Dlc++)
+            ;
+        /* DriverLib keeps one byte per 16-bit data element, so no memcpy */
+        for (i = 0; i < dlcBytes[ui8Dlc]; i++) {
+            txMsg.data[i] = (i < ui8Len) ? pData[i] : CAN_PAD_BYTE;
+        }
+        txMsg.dlc = ui8Dlc;
+
+        DL_MCAN_writeMsgRam(MCAN0_INST, DL_MCAN_MEM_TYPE_BUF, 0, &txMsg);
+        DL_MCAN_TXBufAddReq(MCAN0_INST, 0);
+        ui32Wait = CAN_TX_TIMEOUT;
+        while (DL_MCAN_getTxBufReqPend(MCAN0_INST)) {
+            if (ui32Wait < CAN_POLL_STEP) {
+                /* No node acknowledged the frame, stop retransmitting it */
+                DL_MCAN_txBufCancellationReq(MCAN0_INST, 0);
+                return 0;
+            }
+            delay_cycles(CAN_POLL_STEP);
+            ui32Wait -= CAN_POLL_STEP;
+        }
+        pData += ui8Len;
+        ui16Cnt -= ui8Len;
+    }
+    return 1;
+}
+
+//*****************************************************************************
+//
+// ! CAN_readFrame
+// ! Waits at most *pui32Cycles CPU cycles for a frame from the BSL and copies
+// ! its data (up to 64 bytes) to pData. Frames with other IDs are dropped.
+// ! Returns 1 if a frame arrived; *pui32Cycles is reduced by the time waited.
+//
+//*****************************************************************************
+uint8_t CAN_readFrame(uint8_t *pData, uint8_t *pui8Len, uint32_t *pui32Cycles)
+{
+    DL_MCAN_RxBufElement rxMsg;
+    DL_MCAN_RxFIFOStatus rxFS;
+    uint8_t i;
+
+    rxFS.num = DL_MCAN_RX_FIFO_NUM_0;
+    while (1) {
+        DL_MCAN_getRxFIFOStatus(MCAN0_INST, &rxFS);
+        if (rxFS.fillLvl != 0) {
+            DL_MCAN_readMsgRam(
+                MCAN0_INST, DL_MCAN_MEM_TYPE_FIFO, 0U, rxFS.num, &rxMsg);
+            DL_MCAN_writeRxFIFOAck(MCAN0_INST, rxFS.num, rxFS.getIdx);
+            if (!rxMsg.xtd &&
+                (rxMsg.id >> CAN_STD_ID_SHIFT) == CAN_ID_BSL) {
+                /* Classic frames carry 8 bytes for every DLC above 8 */
+                *pui8Len = (!rxMsg.fdf && rxMsg.dlc > CAN_CLASSIC_BYTES)
+                               ? CAN_CLASSIC_BYTES
+                               : dlcBytes[rxMsg.dlc & 0xF];
+                for (i = 0; i < *pui8Len; i++) {
+                    pData[i] = (uint8_t) rxMsg.data[i];
+                }
+                return 1;
+            }
+            continue;
+        }
+        if (*pui32Cycles < CAN_POLL_STEP) {
+            *pui32Cycles = 0;
+            return 0;
+        }
+        delay_cycles(CAN_POLL_STEP);
+        *pui32Cycles -= CAN_POLL_STEP;
+    }
+}
@@ -0,0 +1,25 @@
+// Prathik Narsetty
+// MCAN side of the BSL CAN link (CAN_Plugin)
+//
+// BSL packets travel as a byte stream cut into frames: the host sends with
+// standard ID CAN_ID_HOST, the BSL answers with CAN_ID_BSL. Frames carry up to
+// 8 bytes until CAN_setBitrate() switches to CAN FD, then up to 64. A frame
+// that would not fill a valid FD length is padded with CAN_PAD_BYTE; the
+// receiver knows the packet length from its header and drops the padding.
+#include "stdbool.h"
+#include "stdint.h"
+#include "ti_msp_dl_config.h"
+
+#define CAN_ID_HOST (0x003)
+#define CAN_ID_BSL (0x004)
+#define CAN_PAD_BYTE (0xFF)
+#define CAN_CLASSIC_BYTES (8)
+#define CAN_FD_BYTES (64)
+#define CAN_POLL_STEP (320)  //10 us at 32 MHz between RX FIFO checks
+#define CAN_TX_TIMEOUT (10 * 32000)  //10 ms at 32 MHz per frame
+
+void CAN_initialize(void);
+uint8_t CAN_setBitrate(
+    const DL_MCAN_BitTimingParams *pTiming, bool bFd, bool bBrs);
+uint8_t CAN_writeBuffer(const uint8_t *pData, uint16_t ui16Cnt);
+uint8_t CAN_readFrame(uint8_t *pData, uint8_t *pui8Len, uint32_t *pui32Cycles);
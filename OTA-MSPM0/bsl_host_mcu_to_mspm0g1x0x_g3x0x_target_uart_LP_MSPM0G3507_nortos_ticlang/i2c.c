@@ -0,0 +1,134 @@
+// Prathik Narsetty
+// I2C controller side of the BSL I2C link (I2C_Plugin)
+#include "i2c.h"
+#include "stdbool.h"
+#include "stdint.h"
+#include "ti_msp_dl_config.h"
+
+//*****************************************************************************
+//
+// ! I2C_waitIdle
+// ! Waits for the transfer to end, clock stretching included, for at most
+// ! I2C_TRANSFER_TIMEOUT. Returns 1 if it ended without error (the target
+// ! acknowledged its address and every byte).
+//
+//*****************************************************************************
+static uint8_t I2C_waitIdle(void)
+{
+    uint32_t ui32Wait = I2C_TRANSFER_TIMEOUT;
+
+    while (DL_I2C_getControllerStatus(I2C_INST) &
+           DL_I2C_CONTROLLER_STATUS_BUSY_BUS) {
+        if (ui32Wait < I2C_POLL_STEP) {
+            return 0;
+        }
+        delay_cycles(I2C_POLL_STEP);
+        ui32Wait -= I2C_POLL_STEP;
+    }
+    return !(DL_I2C_getControllerStatus(I2C_INST) &
+             DL_I2C_CONTROLLER_STATUS_ERROR);
+}
+
+//*****************************************************************************
+//
+// ! I2C_writeBuffer
+// ! Sends ui16Cnt bytes in a single write transaction, refilling the TX FIFO
+// ! while the transfer runs. Returns 1 if the target acknowledged it.
+//
+//*****************************************************************************
+uint8_t I2C_writeBuffer(const uint8_t *pData, uint16_t ui16Cnt)
+{
+    uint16_t ui16Sent;
+
+    DL_I2C_flushControllerTXFIFO(I2C_INST);
+    ui16Sent = DL_I2C_fillControllerTXFIFO(I2C_INST, pData, ui16Cnt);
+    DL_I2C_startControllerTransfer(I2C_INST, I2C_TARGET_ADDRESS,
+        DL_I2C_CONTROLLER_DIRECTION_TX, ui16Cnt);
+    while (ui16Sent < ui16Cnt) {
+        if (DL_I2C_getControllerStatus(I2C_INST) &
+            DL_I2C_CONTROLLER_STATUS_ERROR) {
+            break;  //address or data not acknowledged
+        }
+        ui16Sent += DL_I2C_fillControllerTXFIFO(
+            I2C_INST, &pData[ui16Sent], ui16Cnt - ui16Sent);
+    }
+    if (!I2C_waitIdle()) {
+        DL_I2C_flushControllerTXFIFO(I2C_INST);
+        return 0;
+    }
+    return 1;
+}
+
+//*****************************************************************************
+//
+// ! I2C_readBuffer
+// ! Reads ui16Cnt bytes in a single read transaction. Returns 1 if the
+// ! target acknowledged its address and all bytes arrived.
+//
+//*****************************************************************************
+uint8_t I2C_readBuffer(uint8_t *pData, uint16_t ui16Cnt)
+{
+    uint16_t ui16Got  = 0;
+    uint32_t ui32Wait = I2C_TRANSFER_TIMEOUT;
+
+    DL_I2C_startControllerTransfer(I2C_INST, I2C_TARGET_ADDRESS,
+        DL_I2C_CONTROLLER_DIRECTION_RX, ui16Cnt);
+    while (ui16Got < ui16Cnt) {
+        if (!DL_I2C_isControllerRXFIFOEmpty(I2C_INST)) {
+            pData[ui16Got++] = DL_I2C_receiveControllerData(I2C_INST);
+            ui32Wait         = I2C_TRANSFER_TIMEOUT;
+            continue;
+        }
+        if ((DL_I2C_getControllerStatus(I2C_INST) &
+                DL_I2C_CONTROLLER_STATUS_ERROR) ||
+            ui32Wait < I2C_POLL_STEP) {
+            I2C_waitIdle();
+            return 0;
+        }
+        delay_cycles(I2C_POLL_STEP);
+        ui32Wait -= I2C_POLL_STEP;
+    }
+    return I2C_waitIdle();
+}
+
+//*****************************************************************************
+//
+// ! I2C_readBufferTimeout
+// ! I2C_readBuffer, retried while the target does not answer, for at most
+// ! *pui32Cycles CPU cycles. Returns 1 if the read succeeded; *pui32Cycles is
+// ! reduced by the time spent between attempts.
+//
+//*****************************************************************************
+uint8_t I2C_readBufferTimeout(
+    uint8_t *pData, uint16_t ui16Cnt, uint32_t *pui32Cycles)
+{
+    while (!I2C_readBuffer(pData, ui16Cnt)) {
+        if (*pui32Cycles < I2C_POLL_STEP) {
+            *pui32Cycles = 0;
+            return 0;
+        }
+        delay_cycles(I2C_POLL_STEP);
+        *pui32Cycles -= I2C_POLL_STEP;
+    }
+    return 1;
+}
+
+//*****************************************************************************
+//
+// ! Status_check
+// ! The BSL answers the unknown byte 0xBB with 0x51 (header incorrect); 0 if
+// ! nothing answered
+//
+//*****************************************************************************
+uint8_t Status_check(void)
+{
+    uint8_t ui8Probe = 0xBB;
+    uint8_t res;
+    uint32_t ui32Wait = I2C_TRANSFER_TIMEOUT;
+
+    if (!I2C_writeBuffer(&ui8Probe, 1) ||
+        !I2C_readBufferTimeout(&res, 1, &ui32Wait)) {
+        return 0;
+    }
+    return res;
+}
@@ -0,0 +1,20 @@
+// Prathik Narsetty
+// I2C controller side of the BSL I2C link (I2C_Plugin)
+//
+// The BSL is an I2C target at I2C_TARGET_ADDRESS; the application demo listens
+// for the software trigger at the same address. Each BSL frame is written in
+// one transaction and each reply (ACK and response packet) read in one. While
+// the BSL is busy it holds SCL low or does not acknowledge its address: a
+// stretch is waited out for up to I2C_TRANSFER_TIMEOUT, a NACK makes
+// I2C_readBufferTimeout() try again after I2C_POLL_STEP.
+#include "stdint.h"
+
+#define I2C_TARGET_ADDRESS (0x48)
+#define I2C_POLL_STEP (1600)  //50 us at 32 MHz between read attempts
+#define I2C_TRANSFER_TIMEOUT (20 * 32000)  //20 ms at 32 MHz per transaction
+
+uint8_t I2C_writeBuffer(const uint8_t *pData, uint16_t ui16Cnt);
+uint8_t I2C_readBuffer(uint8_t *pData, uint16_t ui16Cnt);
+uint8_t I2C_readBufferTimeout(
+    uint8_t *pData, uint16_t ui16Cnt, uint32_t *pui32Cycles);
+uint8_t Status_check(void);
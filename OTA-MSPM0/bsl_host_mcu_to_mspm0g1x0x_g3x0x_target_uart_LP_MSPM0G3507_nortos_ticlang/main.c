@@ -31,6 +31,8 @@
  */
 
 #include <ti_msp_dl_config.h>
+#include "bsl_timing.h"
+#include "timestamp.h"
 
 #ifdef I2C_Plugin
 #include <application_image_i2c.h>
@@ -55,6 +57,9 @@ extern CANFD_baudrate_config br_cfg;
 #endif
 
 void ToggleLeds(void);
+#ifdef BSL_TIMING_UART
+static void BSL_timing_putUart(char c);
+#endif
 
 BSL_error_t bsl_err;
 uint8_t status;
@@ -70,6 +75,12 @@ int main(void)
     uint8_t section;
 
     SYSCFG_DL_init();
+    Timestamp_init();
+    BSL_timing_init(Timestamp_getMicros);
+
+#ifdef UART_Plugin
+    UART_initFlowControl();
+#endif
 
 #ifdef SPI_Plugin
     SPI_Initialize();
@@ -88,34 +99,65 @@ int main(void)
             if (!DL_GPIO_readPins(GPIO_Button_PORT, GPIO_Button_PIN_0_PIN)) {
                 bsl_err = eBSL_success;
                 ToggleLeds();  // Show we are starting BSL
+                BSL_timing_sessionBegin();
+#ifdef UART_Plugin
+                UART_initFlowControl();  // the BSL restarts without RTS/CTS
+#endif
+                BSL_timing_phaseBegin(BSL_PHASE_ENTRY);
 #ifdef Hardware_Invoke
                 Host_BSL_entry_sequence();  //PLACE TARGET INTO BSL MODE by hardware invoke
 				//Note: need the application code(include software invoke) exist on the chip
+#if defined(UART_Plugin) || defined(SPI_Plugin) || defined(I2C_Plugin) || \
+    defined(CAN_Plugin)
+                bsl_err = Host_BSL_waitForBSL();  //poll until the BSL answers
+#else
                 delay_cycles(500000);
 #endif
+#endif
 #ifdef Software_Invoke
                 Host_BSL_software_trigger();  //PLACE TARGET INTO BSL MODE by software invoke
+#if defined(UART_Plugin) || defined(SPI_Plugin) || defined(I2C_Plugin) || \
+    defined(CAN_Plugin)
+                bsl_err = Host_BSL_waitForBSL();  //poll until the BSL answers
+#else
                 delay_cycles(20000000);  //wait for target go into BSL
-#ifdef CAN_Plugin
-                delay_cycles(40000000);  //wait for target go into BSL
 #endif
 #endif
-                bsl_err = Host_BSL_Connection();
-                delay_cycles(100000);
+                BSL_timing_phaseEnd(BSL_PHASE_ENTRY);
+                if (bsl_err == eBSL_success) {
+                    BSL_timing_phaseBegin(BSL_PHASE_CONNECT);
+                    bsl_err = Host_BSL_Connection();
+                    BSL_timing_phaseEnd(BSL_PHASE_CONNECT);
+                    delay_cycles(100000);
+                }
+#if defined(UART_Plugin) && defined(UART_FLOW_CONTROL)
+                if (bsl_err == eBSL_success) {
+                    UART_enableFlowControl();  //RTS/CTS if the target drives CTS
+                }
+#endif
 #ifdef CAN_Plugin
                 if (bsl_err == eBSL_success) {
+                    BSL_timing_phaseBegin(BSL_PHASE_BITRATE);
                     bsl_err = Host_BSL_Change_Bitrate(&br_cfg);
+                    BSL_timing_phaseEnd(BSL_PHASE_BITRATE);
 
                     if (bsl_err == eBSL_success) {
+                        BSL_timing_phaseBegin(BSL_PHASE_GET_ID);
                         bsl_err = Host_BSL_GetID();
+                        BSL_timing_phaseEnd(BSL_PHASE_GET_ID);
                         if (BSL_maxBufferSize >= MAX_PACKET_SIZE) {
+                            BSL_timing_phaseBegin(BSL_PHASE_PASSWORD);
                             bsl_err =
                                 Host_BSL_loadPassword((uint8_t*) BSL_PW_RESET);
+                            BSL_timing_phaseEnd(BSL_PHASE_PASSWORD);
                             if (bsl_err == eBSL_success) {
+                                BSL_timing_phaseBegin(BSL_PHASE_ERASE);
                                 bsl_err = Host_BSL_MassErase();
+                                BSL_timing_phaseEnd(BSL_PHASE_ERASE);
                                 if (bsl_err == eBSL_success) {
                                     delay_cycles(DELAY_BSL_OP);
                                     /*WRITE THE ENTIRE PROGRAM MEMORY SECTION TO TARGET*/
+                                    BSL_timing_phaseBegin(BSL_PHASE_WRITE);
                                     for (section = 0;
                                          section < (sizeof(App1_Addr) /
                                                        sizeof(App1_Addr[0]));
@@ -126,8 +168,11 @@ int main(void)
                                             App1_Size[section]);
                                         if (bsl_err != eBSL_success) break;
                                     }
+                                    BSL_timing_phaseEnd(BSL_PHASE_WRITE);
                                     /* Start the application */
+                                    BSL_timing_phaseBegin(BSL_PHASE_START_APP);
                                     Host_BSL_StartApp();
+                                    BSL_timing_phaseEnd(BSL_PHASE_START_APP);
                                 } else {
                                     /* Mass Erase failed error */
                                     TurnOnErrorLED();
@@ -150,20 +195,28 @@ int main(void)
                     }
                 }
 #else
-                status =
-                    Status_check();  //Check the status of the target: BSL mode or application mode
+                status = (bsl_err == eBSL_success)
+                             ? Status_check()  //Check the status of the target: BSL mode or application mode
+                             : 0;
                 if (status == 0x51)  //BSL mode 0x51; application mode 0x22
                 {
                     delay_cycles(50000);
+                    BSL_timing_phaseBegin(BSL_PHASE_GET_ID);
                     bsl_err = Host_BSL_GetID();
+                    BSL_timing_phaseEnd(BSL_PHASE_GET_ID);
                     if (BSL_MAX_BUFFER_SIZE >= MAX_PACKET_SIZE) {
+                        BSL_timing_phaseBegin(BSL_PHASE_PASSWORD);
                         bsl_err =
                             Host_BSL_loadPassword((uint8_t*) BSL_PW_RESET);
+                        BSL_timing_phaseEnd(BSL_PHASE_PASSWORD);
                         if (bsl_err == eBSL_success) {
+                            BSL_timing_phaseBegin(BSL_PHASE_ERASE);
                             bsl_err = Host_BSL_MassErase();
+                            BSL_timing_phaseEnd(BSL_PHASE_ERASE);
                             if (bsl_err == eBSL_success) {
                                 delay_cycles(50000);
                                 //WRITE THE ENTIRE PROGRAM MEMORY SECTION TO TARGET
+                                BSL_timing_phaseBegin(BSL_PHASE_WRITE);
                                 for (section = 0;
                                      section < (sizeof(App1_Addr) /
                                                    sizeof(App1_Addr[0]));
@@ -176,10 +229,13 @@ int main(void)
                                         break;
                                     }
                                 }
+                                BSL_timing_phaseEnd(BSL_PHASE_WRITE);
                                 delay_cycles(
                                     50000);  //allow target deal with the packet send before new package
                                 //Start the application
+                                BSL_timing_phaseBegin(BSL_PHASE_START_APP);
                                 bsl_err = Host_BSL_StartApp();
+                                BSL_timing_phaseEnd(BSL_PHASE_START_APP);
                             } else {
                                 TurnOnErrorLED();  // Mass Erase failed error
                                                    // __BKPT(0);
@@ -192,6 +248,10 @@ int main(void)
                         TurnOnErrorLED();  //Buffer less than MAX_PACKET_SIZE error
                     }
                 }
+#endif
+                BSL_timing_sessionEnd();
+#ifdef BSL_TIMING_UART
+                BSL_timing_report(BSL_timing_putUart);
 #endif
             }
             delay_cycles(50000);
@@ -199,6 +259,16 @@ int main(void)
     }
 }
 
+#ifdef BSL_TIMING_UART
+/*
+ * Timing report output on the spare UART_REPORT instance
+ */
+static void BSL_timing_putUart(char c)
+{
+    DL_UART_transmitDataBlocking(UART_REPORT_INST, (uint8_t) c);
+}
+#endif
+
 /*
  * Toggle the LEDs to show we are going to BSL the target
  */
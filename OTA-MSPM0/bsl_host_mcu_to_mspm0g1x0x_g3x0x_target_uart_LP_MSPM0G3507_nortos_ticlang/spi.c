@@ -0,0 +1,87 @@
+// Prathik Narsetty
+// SPI controller side of the BSL SPI link (SPI_Plugin)
+#include "spi.h"
+#include "stdint.h"
+#include "ti_msp_dl_config.h"
+
+#define STATUS_TIMEOUT (20 * 32000)  //20 ms at 32 MHz
+
+void SPI_Initialize(void)
+{
+    /* Drop anything received while the SPI was being configured */
+    while (!DL_SPI_isRXFIFOEmpty(SPI_0_INST)) {
+        DL_SPI_receiveData8(SPI_0_INST);
+    }
+}
+
+//*****************************************************************************
+//
+// ! SPI_transferByte
+// ! One full-duplex exchange: returns the byte shifted in while ui8Byte was
+// ! shifted out
+//
+//*****************************************************************************
+uint8_t SPI_transferByte(uint8_t ui8Byte)
+{
+    DL_SPI_transmitData8(SPI_0_INST, ui8Byte);
+    while (DL_SPI_isBusy(SPI_0_INST))
+        ;
+    return DL_SPI_receiveDataBlocking8(SPI_0_INST);
+}
+
+void SPI_writeBuffer(const uint8_t *pData, uint16_t ui16Cnt)
+{
+    while (ui16Cnt--) {
+        SPI_transferByte(*pData++);
+    }
+}
+
+void SPI_readBuffer(uint8_t *pData, uint16_t ui16Cnt)
+{
+    while (ui16Cnt--) {
+        *pData++ = SPI_transferByte(SPI_FILL_BYTE);
+    }
+}
+
+//*****************************************************************************
+//
+// ! SPI_readByteTimeout
+// ! Clock fill bytes until the BSL sends something else, for at most
+// ! *pui32Cycles CPU cycles. Returns 1 if a byte arrived; *pui32Cycles is
+// ! reduced by the time waited.
+//
+//*****************************************************************************
+uint8_t SPI_readByteTimeout(uint8_t *pData, uint32_t *pui32Cycles)
+{
+    uint8_t ui8Res;
+
+    while ((ui8Res = SPI_transferByte(SPI_FILL_BYTE)) == SPI_FILL_BYTE) {
+        if (*pui32Cycles < SPI_POLL_STEP) {
+            *pui32Cycles = 0;
+            return 0;
+        }
+        delay_cycles(SPI_POLL_STEP);
+        *pui32Cycles -= SPI_POLL_STEP;
+    }
+    *pData = ui8Res;
+    return 1;
+}
+
+//*****************************************************************************
+//
+// ! Status_check
+// ! The BSL answers the unknown byte 0xBB with 0x51 (header incorrect); 0 if
+// ! nothing answered
+//
+//*****************************************************************************
+uint8_t Status_check(void)
+{
+    uint8_t res;
+    uint32_t ui32Wait = STATUS_TIMEOUT;
+
+    SPI_transferByte(0xBB);
+    if (!SPI_readByteTimeout(&res, &ui32Wait)) {
+        return 0;
+    }
+    return res;
+}
@@ -0,0 +1,18 @@
+// Prathik Narsetty
+// SPI controller side of the BSL SPI link (SPI_Plugin)
+//
+// The BSL is an SPI peripheral and can only answer while the host clocks. To
+// read, the host sends SPI_FILL_BYTE; while the BSL is still working on a
+// command it returns the same value, so the first other byte is the start
+// of the reply (an ACK or the 0x08 packet header, never 0xFF).
+#include "stdint.h"
+
+#define SPI_FILL_BYTE (0xFF)
+#define SPI_POLL_STEP (320)  //10 us at 32 MHz between fill bytes
+
+void SPI_Initialize(void);
+uint8_t SPI_transferByte(uint8_t ui8Byte);
+void SPI_writeBuffer(const uint8_t *pData, uint16_t ui16Cnt);
+void SPI_readBuffer(uint8_t *pData, uint16_t ui16Cnt);
+uint8_t SPI_readByteTimeout(uint8_t *pData, uint32_t *pui32Cycles);
+uint8_t Status_check(void);
@@ -0,0 +1,39 @@
+// Prathik Narsetty
+// Assertions for the host tests of the BSL host code
+//
+// CHECK() and CHECK_EQ() report a failed condition with its location and
+// carry on, so one run lists every failure; main() ends with
+// return Check_result("name"), which fails the test if any check did.
+#include "stdio.h"
+
+static int Check_failures = 0;
+
+#define CHECK(condition)                                                      \
+    do {                                                                      \
+        if (!(condition)) {                                                   \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,  \
+                #condition);                                                  \
+            Check_failures++;                                                 \
+        }                                                                     \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                            \
+    do {                                                                      \
+        unsigned long long ui64Actual   = (unsigned long long) (actual);      \
+        unsigned long long ui64Expected = (unsigned long long) (expected);    \
+        if (ui64Actual != ui64Expected) {                                     \
+            fprintf(stderr, "%s:%d: %s is %llu, expected %llu\n", __FILE__,   \
+                __LINE__, #actual, ui64Actual, ui64Expected);                 \
+            Check_failures++;                                                 \
+        }                                                                     \
+    } while (0)
+
+static int Check_result(const char *pName)
+{
+    if (Check_failures) {
+        fprintf(stderr, "%s: %d checks failed\n", pName, Check_failures);
+        return 1;
+    }
+    printf("%s: all checks passed\n", pName);
+    return 0;
+}
@@ -0,0 +1,324 @@
+// Prathik Narsetty
+// Host stand-in for the DriverLib calls of the BSL host code (see
+// ti_msp_dl_config.h)
+#include "ti_msp_dl_config.h"
+#include "string.h"
+
+uint64_t Fake_cycles;
+uint32_t Fake_gpioPins;
+Fake_Mcan Fake_mcan;
+Fake_Spi Fake_spi;
+Fake_I2c Fake_i2c;
+
+static DL_MCAN_TxBufElement Fake_txBuffer;
+static uint32_t Fake_opMode;
+
+void delay_cycles(uint32_t cycles)
+{
+    Fake_cycles += cycles;
+}
+
+void DL_GPIO_setPins(uint32_t port, uint32_t pins)
+{
+    (void) port;
+    Fake_gpioPins |= pins;
+}
+
+void DL_GPIO_clearPins(uint32_t port, uint32_t pins)
+{
+    (void) port;
+    Fake_gpioPins &= ~pins;
+}
+
+uint32_t Fake_clockUs(void)
+{
+    return (uint32_t) (Fake_cycles / 32);
+}
+
+//*****************************************************************************
+//
+// ! MCAN
+// ! A frame is handed to the target model as soon as it is requested; a
+// ! stuck frame stays pending until it is cancelled
+//
+//*****************************************************************************
+void Fake_mcanReset(void)
+{
+    memset(&Fake_mcan, 0, sizeof(Fake_mcan));
+    Fake_opMode = DL_MCAN_OPERATION_MODE_NORMAL;
+}
+
+void Fake_mcanReceive(const DL_MCAN_RxBufElement *pMsg)
+{
+    if (Fake_mcan.fifoPut - Fake_mcan.fifoGet < FAKE_MCAN_FIFO_DEPTH) {
+        Fake_mcan.fifo[Fake_mcan.fifoPut++ % FAKE_MCAN_FIFO_DEPTH] = *pMsg;
+    }
+}
+
+uint32_t DL_MCAN_getOpMode(void *mcan)
+{
+    (void) mcan;
+    return Fake_opMode;
+}
+
+void DL_MCAN_setOpMode(void *mcan, uint32_t mode)
+{
+    (void) mcan;
+    Fake_opMode = mode;
+}
+
+void DL_MCAN_getRxFIFOStatus(void *mcan, DL_MCAN_RxFIFOStatus *pStatus)
+{
+    (void) mcan;
+    pStatus->fillLvl  = Fake_mcan.fifoPut - Fake_mcan.fifoGet;
+    pStatus->getIdx   = Fake_mcan.fifoGet % FAKE_MCAN_FIFO_DEPTH;
+    pStatus->putIdx   = Fake_mcan.fifoPut % FAKE_MCAN_FIFO_DEPTH;
+    pStatus->fifoFull = pStatus->fillLvl == FAKE_MCAN_FIFO_DEPTH;
+    pStatus->msgLost  = 0;
+}
+
+int32_t DL_MCAN_writeRxFIFOAck(void *mcan, uint32_t fifoNum, uint32_t idx)
+{
+    (void) mcan;
+    (void) fifoNum;
+    if (Fake_mcan.fifoPut == Fake_mcan.fifoGet ||
+        idx != Fake_mcan.fifoGet % FAKE_MCAN_FIFO_DEPTH) {
+        return -1;
+    }
+    Fake_mcan.fifoGet++;
+    return 0;
+}
+
+uint32_t DL_MCAN_getTxBufReqPend(void *mcan)
+{
+    (void) mcan;
+    return Fake_mcan.txStuck ? 1 : 0;
+}
+
+void DL_MCAN_writeProtectedRegAccessUnlock(void *mcan)
+{
+    (void) mcan;
+}
+
+void DL_MCAN_writeProtectedRegAccessLock(void *mcan)
+{
+    (void) mcan;
+}
+
+int32_t DL_MCAN_setBitTime(void *mcan, const DL_MCAN_BitTimingParams *pTiming)
+{
+    (void) mcan;
+    if (Fake_opMode != DL_MCAN_OPERATION_MODE_SW_INIT) {
+        return -1;
+    }
+    if (Fake_mcan.setBitTimeStatus == 0) {
+        Fake_mcan.timing = *pTiming;
+    }
+    return Fake_mcan.setBitTimeStatus;
+}
+
+void DL_MCAN_writeMsgRam(void *mcan, uint32_t memType, uint32_t bufNum,
+    const DL_MCAN_TxBufElement *pElem)
+{
+    (void) mcan;
+    (void) memType;
+    (void) bufNum;
+    Fake_txBuffer = *pElem;
+}
+
+int32_t DL_MCAN_TXBufAddReq(void *mcan, uint32_t bufNum)
+{
+    (void) mcan;
+    (void) bufNum;
+    if (!Fake_mcan.txStuck && Fake_mcan.onTx != NULL) {
+        Fake_mcan.onTx(&Fake_txBuffer);
+    }
+    return 0;
+}
+
+int32_t DL_MCAN_txBufCancellationReq(void *mcan, uint32_t bufNum)
+{
+    (void) mcan;
+    (void) bufNum;
+    Fake_mcan.txCancelled++;
+    return 0;
+}
+
+void DL_MCAN_readMsgRam(void *mcan, uint32_t memType, uint32_t bufNum,
+    uint32_t fifoNum, DL_MCAN_RxBufElement *pElem)
+{
+    (void) mcan;
+    (void) memType;
+    (void) bufNum;
+    (void) fifoNum;
+    *pElem = Fake_mcan.fifo[Fake_mcan.fifoGet % FAKE_MCAN_FIFO_DEPTH];
+}
+
+//*****************************************************************************
+//
+// ! SPI
+// ! Every transmitted byte is exchanged with the target model at once
+//
+//*****************************************************************************
+void DL_SPI_transmitData8(void *spi, uint8_t data)
+{
+    (void) spi;
+    Fake_spi.ui8Received =
+        Fake_spi.exchange != NULL ? Fake_spi.exchange(data) : 0xFF;
+}
+
+bool DL_SPI_isBusy(void *spi)
+{
+    (void) spi;
+    return false;
+}
+
+uint8_t DL_SPI_receiveDataBlocking8(void *spi)
+{
+    (void) spi;
+    return Fake_spi.ui8Received;
+}
+
+bool DL_SPI_isRXFIFOEmpty(void *spi)
+{
+    (void) spi;
+    return Fake_spi.ui8Stale == 0;
+}
+
+uint8_t DL_SPI_receiveData8(void *spi)
+{
+    (void) spi;
+    if (Fake_spi.ui8Stale != 0) {
+        Fake_spi.ui8Stale--;
+    }
+    return 0xFF;
+}
+
+//*****************************************************************************
+//
+// ! I2C
+// ! Each status poll shifts out what the TX FIFO holds; a write is handed to
+// ! the target model once all its bytes are out, a read is filled by the
+// ! model when it starts
+//
+//*****************************************************************************
+static struct {
+    bool bActive;
+    bool bError;
+    uint32_t ui32Direction;
+    uint16_t ui16Length;
+    uint16_t ui16BusyLeft;
+    uint8_t ui8Tx[FAKE_I2C_TRANSFER_MAX];
+    uint16_t ui16TxFilled;
+    uint16_t ui16TxShifted;
+    uint8_t ui8Rx[FAKE_I2C_TRANSFER_MAX];
+    uint16_t ui16RxTaken;
+} Fake_i2cBus;
+
+void Fake_i2cReset(void)
+{
+    memset(&Fake_i2c, 0, sizeof(Fake_i2c));
+    memset(&Fake_i2cBus, 0, sizeof(Fake_i2cBus));
+}
+
+uint32_t DL_I2C_getControllerStatus(void *i2c)
+{
+    (void) i2c;
+    if (Fake_i2cBus.bActive &&
+        Fake_i2cBus.ui32Direction == DL_I2C_CONTROLLER_DIRECTION_TX) {
+        Fake_i2cBus.ui16TxShifted = Fake_i2cBus.ui16TxFilled;
+        if (Fake_i2cBus.ui16TxShifted < Fake_i2cBus.ui16Length) {
+            return DL_I2C_CONTROLLER_STATUS_BUSY_BUS;  //waiting for data
+        }
+        Fake_i2c.ui32Writes++;
+        Fake_i2cBus.bError =
+            Fake_i2c.write != NULL &&
+            !Fake_i2c.write(Fake_i2cBus.ui8Tx, Fake_i2cBus.ui16Length);
+        Fake_i2cBus.bActive = false;
+    }
+    if (Fake_i2cBus.bActive &&
+        Fake_i2cBus.ui16RxTaken < Fake_i2cBus.ui16Length) {
+        return DL_I2C_CONTROLLER_STATUS_BUSY_BUS;
+    }
+    Fake_i2cBus.bActive = false;
+    if (Fake_i2cBus.ui16BusyLeft > 0) {
+        Fake_i2cBus.ui16BusyLeft--;
+        return DL_I2C_CONTROLLER_STATUS_BUSY_BUS;
+    }
+    return Fake_i2cBus.bError ? DL_I2C_CONTROLLER_STATUS_ERROR : 0;
+}
+
+void DL_I2C_flushControllerTXFIFO(void *i2c)
+{
+    (void) i2c;
+    Fake_i2cBus.ui16TxFilled  = 0;
+    Fake_i2cBus.ui16TxShifted = 0;
+}
+
+uint16_t DL_I2C_fillControllerTXFIFO(
+    void *i2c, const uint8_t *buffer, uint16_t count)
+{
+    uint16_t ui16Level =
+        Fake_i2cBus.ui16TxFilled - Fake_i2cBus.ui16TxShifted;
+    uint16_t ui16Free = FAKE_I2C_FIFO_DEPTH - ui16Level;
+
+    (void) i2c;
+    if (count > ui16Free) {
+        count = ui16Free;
+    }
+    if (count > FAKE_I2C_TRANSFER_MAX - Fake_i2cBus.ui16TxFilled) {
+        count = FAKE_I2C_TRANSFER_MAX - Fake_i2cBus.ui16TxFilled;
+    }
+    memcpy(&Fake_i2cBus.ui8Tx[Fake_i2cBus.ui16TxFilled], buffer, count);
+    Fake_i2cBus.ui16TxFilled += count;
+    if (ui16Level + count > Fake_i2c.ui8TxFifoMax) {
+        Fake_i2c.ui8TxFifoMax = (uint8_t) (ui16Level + count);
+    }
+    return count;
+}
+
+void DL_I2C_startControllerTransfer(
+    void *i2c, uint32_t targetAddr, uint32_t direction, uint16_t length)
+{
+    (void) i2c;
+    Fake_i2c.ui32LastAddress   = targetAddr;
+    Fake_i2cBus.ui32Direction  = direction;
+    Fake_i2cBus.ui16Length     = length < FAKE_I2C_TRANSFER_MAX
+                                     ? length : FAKE_I2C_TRANSFER_MAX;
+    Fake_i2cBus.ui16RxTaken    = 0;
+    Fake_i2cBus.bError         = false;
+    Fake_i2cBus.bActive        = false;
+    Fake_i2cBus.ui16BusyLeft   = 0;
+
+    if (direction == DL_I2C_CONTROLLER_DIRECTION_TX) {
+        if (Fake_i2c.ui16AddressNacks > 0) {
+            Fake_i2c.ui16AddressNacks--;
+            Fake_i2cBus.bError = true;
+            return;
+        }
+    } else if (Fake_i2c.read == NULL ||
+               !Fake_i2c.read(Fake_i2cBus.ui8Rx, Fake_i2cBus.ui16Length)) {
+        Fake_i2c.ui32ReadNacks++;
+        Fake_i2cBus.bError = true;
+        return;
+    } else {
+        Fake_i2c.ui32Reads++;
+        Fake_i2c.ui16LastReadCnt = length;
+    }
+    Fake_i2cBus.bActive      = true;
+    Fake_i2cBus.ui16BusyLeft = Fake_i2c.ui16Stretch;
+}
+
+bool DL_I2C_isControllerRXFIFOEmpty(void *i2c)
+{
+    (void) i2c;
+    return !Fake_i2cBus.bActive ||
+           Fake_i2cBus.ui32Direction != DL_I2C_CONTROLLER_DIRECTION_RX ||
+           Fake_i2cBus.ui16RxTaken >= Fake_i2cBus.ui16Length;
+}
+
+uint8_t DL_I2C_receiveControllerData(void *i2c)
+{
+    (void) i2c;
+    return Fake_i2cBus.ui8Rx[Fake_i2cBus.ui16RxTaken++];
+}
@@ -0,0 +1,211 @@
+// Prathik Narsetty
+// Host stand-in for the SysConfig output and the DriverLib calls of the BSL
+// host code
+//
+// Only what can.c, spi.c, i2c.c and the plugins use. GPIO writes land in
+// Fake_gpioPins, delay_cycles() adds to Fake_cycles instead of waiting,
+// and the MCAN, SPI and I2C peripherals pass every frame, byte or
+// transaction the host sends to a target model the test installs
+// (fake_driverlib.c).
+#ifndef TI_MSP_DL_CONFIG_H
+#define TI_MSP_DL_CONFIG_H
+
+#include "stdbool.h"
+#include "stdint.h"
+
+//*****************************************************************************
+//
+// ! Clock and GPIO
+//
+//*****************************************************************************
+#define GPIO_BSL_PORT (0)
+#define GPIO_BSL_NRST_PIN (1u << 0)
+#define GPIO_BSL_Invoke_PIN (1u << 1)
+#define GPIO_LED_Error_PORT (0)
+#define GPIO_LED_Error_PIN (1u << 2)
+
+extern uint64_t Fake_cycles;
+extern uint32_t Fake_gpioPins;
+
+void delay_cycles(uint32_t cycles);
+void DL_GPIO_setPins(uint32_t port, uint32_t pins);
+void DL_GPIO_clearPins(uint32_t port, uint32_t pins);
+
+// Microseconds of Fake_cycles at 32 MHz, a clock for BSL_timing_init()
+uint32_t Fake_clockUs(void);
+
+//*****************************************************************************
+//
+// ! MCAN
+//
+//*****************************************************************************
+#define MCAN0_INST ((void *) 0)
+
+typedef enum {
+    DL_MCAN_OPERATION_MODE_NORMAL  = 0,
+    DL_MCAN_OPERATION_MODE_SW_INIT = 1
+} DL_MCAN_OperationMode;
+
+#define DL_MCAN_MEM_TYPE_BUF (0u)
+#define DL_MCAN_MEM_TYPE_FIFO (1u)
+#define DL_MCAN_RX_FIFO_NUM_0 (0u)
+
+typedef struct {
+    uint32_t nomRatePrescalar;
+    uint32_t nomTimeSeg1;
+    uint32_t nomTimeSeg2;
+    uint32_t nomSynchJumpWidth;
+    uint32_t dataRatePrescalar;
+    uint32_t dataTimeSeg1;
+    uint32_t dataTimeSeg2;
+    uint32_t dataSynchJumpWidth;
+} DL_MCAN_BitTimingParams;
+
+typedef struct {
+    uint32_t id;
+    uint32_t rtr;
+    uint32_t xtd;
+    uint32_t esi;
+    uint32_t dlc;
+    uint32_t brs;
+    uint32_t fdf;
+    uint32_t efc;
+    uint32_t mm;
+    uint16_t data[64];
+} DL_MCAN_TxBufElement;
+
+typedef struct {
+    uint32_t id;
+    uint32_t rtr;
+    uint32_t xtd;
+    uint32_t esi;
+    uint32_t rxts;
+    uint32_t dlc;
+    uint32_t brs;
+    uint32_t fdf;
+    uint32_t fidx;
+    uint32_t anmf;
+    uint16_t data[64];
+} DL_MCAN_RxBufElement;
+
+typedef struct {
+    uint32_t num;
+    uint32_t fillLvl;
+    uint32_t getIdx;
+    uint32_t putIdx;
+    uint32_t fifoFull;
+    uint32_t msgLost;
+} DL_MCAN_RxFIFOStatus;
+
+#define FAKE_MCAN_FIFO_DEPTH (64)
+
+typedef struct {
+    // Called for every frame the host sends; NULL drops them
+    void (*onTx)(const DL_MCAN_TxBufElement *pMsg);
+    // The frame is never acknowledged, as with no other node on the bus
+    bool txStuck;
+    uint32_t txCancelled;
+    int32_t setBitTimeStatus;
+    DL_MCAN_BitTimingParams timing;
+    DL_MCAN_RxBufElement fifo[FAKE_MCAN_FIFO_DEPTH];
+    uint32_t fifoGet;
+    uint32_t fifoPut;
+} Fake_Mcan;
+
+extern Fake_Mcan Fake_mcan;
+
+void Fake_mcanReset(void);
+// Queue a frame in RX FIFO 0
+void Fake_mcanReceive(const DL_MCAN_RxBufElement *pMsg);
+
+uint32_t DL_MCAN_getOpMode(void *mcan);
+void DL_MCAN_setOpMode(void *mcan, uint32_t mode);
+void DL_MCAN_getRxFIFOStatus(void *mcan, DL_MCAN_RxFIFOStatus *pStatus);
+int32_t DL_MCAN_writeRxFIFOAck(void *mcan, uint32_t fifoNum, uint32_t idx);
+uint32_t DL_MCAN_getTxBufReqPend(void *mcan);
+void DL_MCAN_writeProtectedRegAccessUnlock(void *mcan);
+void DL_MCAN_writeProtectedRegAccessLock(void *mcan);
+int32_t DL_MCAN_setBitTime(void *mcan, const DL_MCAN_BitTimingParams *pTiming);
+void DL_MCAN_writeMsgRam(void *mcan, uint32_t memType, uint32_t bufNum,
+    const DL_MCAN_TxBufElement *pElem);
+int32_t DL_MCAN_TXBufAddReq(void *mcan, uint32_t bufNum);
+int32_t DL_MCAN_txBufCancellationReq(void *mcan, uint32_t bufNum);
+void DL_MCAN_readMsgRam(void *mcan, uint32_t memType, uint32_t bufNum,
+    uint32_t fifoNum, DL_MCAN_RxBufElement *pElem);
+
+//*****************************************************************************
+//
+// ! SPI
+//
+//*****************************************************************************
+#define SPI_0_INST ((void *) 0)
+
+typedef struct {
+    // Gets every byte the host shifts out and returns the one shifted in;
+    // NULL answers 0xFF, an idle line
+    uint8_t (*exchange)(uint8_t ui8Byte);
+    // Bytes left in the RX FIFO from before SPI_Initialize()
+    uint8_t ui8Stale;
+    uint8_t ui8Received;
+} Fake_Spi;
+
+extern Fake_Spi Fake_spi;
+
+void DL_SPI_transmitData8(void *spi, uint8_t data);
+bool DL_SPI_isBusy(void *spi);
+uint8_t DL_SPI_receiveDataBlocking8(void *spi);
+bool DL_SPI_isRXFIFOEmpty(void *spi);
+uint8_t DL_SPI_receiveData8(void *spi);
+
+//*****************************************************************************
+//
+// ! I2C
+//
+//*****************************************************************************
+#define I2C_INST ((void *) 0)
+
+#define DL_I2C_CONTROLLER_DIRECTION_TX (0u)
+#define DL_I2C_CONTROLLER_DIRECTION_RX (1u)
+
+#define DL_I2C_CONTROLLER_STATUS_ERROR (1u << 1)
+#define DL_I2C_CONTROLLER_STATUS_BUSY_BUS (1u << 6)
+
+#define FAKE_I2C_FIFO_DEPTH (8)
+#define FAKE_I2C_TRANSFER_MAX (512)
+
+typedef struct {
+    // Gets every complete write transaction; false leaves its last byte
+    // unacknowledged. NULL acknowledges everything.
+    bool (*write)(const uint8_t *pData, uint16_t ui16Cnt);
+    // Fills a read transaction of ui16Cnt bytes; false does not acknowledge
+    // the address, as a BSL still at work does. NULL never answers.
+    bool (*read)(uint8_t *pData, uint16_t ui16Cnt);
+    // Write transactions whose address is not acknowledged, before the
+    // model sees any
+    uint16_t ui16AddressNacks;
+    // Status polls each transaction holds the bus for, as clock stretching
+    uint16_t ui16Stretch;
+
+    // Seen from the host
+    uint32_t ui32LastAddress;
+    uint32_t ui32Writes;
+    uint32_t ui32Reads;
+    uint32_t ui32ReadNacks;
+    uint16_t ui16LastReadCnt;
+    uint8_t ui8TxFifoMax;  // TX FIFO level the host reached
+} Fake_I2c;
+
+extern Fake_I2c Fake_i2c;
+
+void Fake_i2cReset(void);
+
+uint32_t DL_I2C_getControllerStatus(void *i2c);
+void DL_I2C_flushControllerTXFIFO(void *i2c);
+uint16_t DL_I2C_fillControllerTXFIFO(
+    void *i2c, const uint8_t *buffer, uint16_t count);
+void DL_I2C_startControllerTransfer(
+    void *i2c, uint32_t targetAddr, uint32_t direction, uint16_t length);
+bool DL_I2C_isControllerRXFIFOEmpty(void *i2c);
+uint8_t DL_I2C_receiveControllerData(void *i2c);
+
+#endif
@@ -0,0 +1,394 @@
+// Prathik Narsetty
+// CAN plugin (bsl_can.c, can.c) against a BSL target model on the fake MCAN
+//
+// The model puts the host's packets back together from its frames, checks
+// IDs, padding and CRCs, and answers like the BSL: an ACK, then a response
+// packet where the command has one, cut into classic frames or, after the
+// bit rate change, FD frames.
+#include <bsl_can.h>
+#include "bsl_timing.h"
+#include "can.h"
+#include "check.h"
+#include "string.h"
+
+#define TARGET_MEMORY_BYTES (1024)
+#define CMD_RESPONSE_GET_ID (0x31)
+#define CMD_RESPONSE_MESSAGE (0x3B)
+#define BUFFER_SIZE_REPORTED (0x1234)
+#define FOREIGN_ID (0x123)
+
+static const uint8_t dlcBytes[16] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+
+static struct {
+    bool bFd;
+    uint8_t ui8Packet[MAX_PACKET_SIZE + 8];
+    uint16_t ui16Got;
+    uint16_t ui16Need;
+    uint8_t ui8Memory[TARGET_MEMORY_BYTES];
+
+    // Behaviour
+    uint8_t ui8Ack;             // ACK byte sent for every packet
+    uint8_t ui8Status;          // status in message packets
+    uint8_t ui8ProbesToIgnore;  // connection probes left unanswered
+    bool bSilent;               // answers nothing
+    bool bBadCrc;               // response packets with a wrong CRC
+    bool bForeignFrame;         // a frame with another ID before each reply
+
+    // Seen from the host
+    uint32_t ui32Frames;
+    uint32_t ui32BadFrames;  // wrong ID, FD flags or padding
+    uint32_t ui32BadPackets;
+    uint32_t ui32Packets;
+    uint32_t ui32Triggers;
+    uint8_t ui8LastCommand;
+    uint8_t ui8LastFrameDlc;
+    uint64_t ui64BitrateWord;
+    bool bStarted;
+} Target;
+
+static uint32_t Test_crc32(const uint8_t *pData, uint16_t ui16Len)
+{
+    uint32_t ui32Crc = 0xFFFFFFFF;
+    uint8_t ui8Bit;
+
+    while (ui16Len--) {
+        ui32Crc ^= *pData++;
+        for (ui8Bit = 0; ui8Bit < 8; ui8Bit++) {
+            ui32Crc = (ui32Crc & 1) ? (ui32Crc >> 1) ^ 0xEDB88320 : ui32Crc >> 1;
+        }
+    }
+    return ui32Crc;
+}
+
+//*****************************************************************************
+//
+// ! Target replies
+// ! Bytes go out in frames of 8 or, in FD mode, up to 64, padded with 0xFF
+// ! to the next valid length
+//
+//*****************************************************************************
+static void Target_sendFrame(uint32_t ui32Id, const uint8_t *pData, uint8_t ui8Len)
+{
+    DL_MCAN_RxBufElement rxMsg;
+    uint8_t ui8Dlc = 0;
+    uint8_t i;
+
+    memset(&rxMsg, 0, sizeof(rxMsg));
+    while (dlcBytes[ui8Dlc] < ui8Len) {
+        ui8Dlc++;
+    }
+    rxMsg.id  = ui32Id << 18;
+    rxMsg.fdf = Target.bFd;
+    rxMsg.brs = Target.bFd;
+    rxMsg.dlc = ui8Dlc;
+    for (i = 0; i < dlcBytes[ui8Dlc]; i++) {
+        rxMsg.data[i] = i < ui8Len ? pData[i] : CAN_PAD_BYTE;
+    }
+    Fake_mcanReceive(&rxMsg);
+}
+
+static void Target_send(const uint8_t *pData, uint16_t ui16Len)
+{
+    uint8_t ui8Max = Target.bFd ? CAN_FD_BYTES : CAN_CLASSIC_BYTES;
+    uint8_t ui8Len;
+
+    if (Target.bForeignFrame) {
+        uint8_t ui8Noise[2] = {RESPONSE_HEADER, 0x55};
+        Target_sendFrame(FOREIGN_ID, ui8Noise, sizeof(ui8Noise));
+    }
+    while (ui16Len > 0) {
+        ui8Len = ui16Len > ui8Max ? ui8Max : (uint8_t) ui16Len;
+        Target_sendFrame(CAN_ID_BSL, pData, ui8Len);
+        pData += ui8Len;
+        ui16Len -= ui8Len;
+    }
+}
+
+// ACK, then a response packet of ui8Command and ui16Len data bytes
+static void Target_reply(uint8_t ui8Command, const uint8_t *pData, uint16_t ui16Len)
+{
+    uint8_t ui8Reply[ACK_BYTE + HDR_LEN_CMD_BYTES + 64 + CRC_BYTES];
+    uint32_t ui32Crc;
+
+    ui8Reply[0] = Target.ui8Ack;
+    ui8Reply[1] = RESPONSE_HEADER;
+    ui8Reply[2] = LSB((ui16Len + CMD_BYTE));
+    ui8Reply[3] = MSB((ui16Len + CMD_BYTE));
+    ui8Reply[4] = ui8Command;
+    memcpy(&ui8Reply[5], pData, ui16Len);
+    ui32Crc = Test_crc32(&ui8Reply[4], ui16Len + CMD_BYTE) ^ (Target.bBadCrc ? 1 : 0);
+    memcpy(&ui8Reply[5 + ui16Len], &ui32Crc, CRC_BYTES);
+    Target_send(ui8Reply, Target.ui8Ack != can_noError ? ACK_BYTE
+                                                       : 5 + ui16Len + CRC_BYTES);
+}
+
+static void Target_replyMessage(void)
+{
+    Target_reply(CMD_RESPONSE_MESSAGE, &Target.ui8Status, 1);
+}
+
+static void Target_handlePacket(void)
+{
+    uint8_t *pPayload = &Target.ui8Packet[HDR_BYTES];
+    uint16_t ui16Payload = Target.ui16Need - HDR_BYTES - CRC_BYTES;
+    uint32_t ui32Crc;
+    uint32_t ui32Address;
+    uint8_t ui8Id[ID_BACK];
+    uint8_t i;
+
+    memcpy(&ui32Crc, &pPayload[ui16Payload], CRC_BYTES);
+    if (ui32Crc != Test_crc32(pPayload, ui16Payload)) {
+        Target.ui32BadPackets++;
+        return;
+    }
+    Target.ui32Packets++;
+    Target.ui8LastCommand = pPayload[0];
+    if (Target.bSilent) {
+        return;
+    }
+    switch (pPayload[0]) {
+        case CMD_CONNECTION:
+            if (Target.ui8ProbesToIgnore > 0) {
+                Target.ui8ProbesToIgnore--;
+                break;
+            }
+            Target_send(&Target.ui8Ack, ACK_BYTE);
+            break;
+        case CMD_CHANGE_BITRATE:
+            Target.ui64BitrateWord = 0;
+            for (i = 0; i < BITRATE_BYTES; i++) {
+                Target.ui64BitrateWord |= (uint64_t) pPayload[1 + i] << (8 * i);
+            }
+            Target_send(&Target.ui8Ack, ACK_BYTE);
+            Target.bFd = Target.ui8Ack == can_noError;
+            break;
+        case CMD_GET_ID:
+            for (i = 0; i < ID_BACK; i++) {
+                ui8Id[i] = (uint8_t) (0xA0 + i);
+            }
+            ui8Id[10] = LSB(BUFFER_SIZE_REPORTED);
+            ui8Id[11] = MSB(BUFFER_SIZE_REPORTED);
+            Target_reply(CMD_RESPONSE_GET_ID, ui8Id, ID_BACK);
+            break;
+        case CMD_MASS_ERASE:
+            memset(Target.ui8Memory, 0xFF, sizeof(Target.ui8Memory));
+            Target_replyMessage();
+            break;
+        case CMD_PROGRAMDATA:
+            memcpy(&ui32Address, &pPayload[CMD_BYTE], ADDRS_BYTES);
+            if (ui32Address + ui16Payload - CMD_BYTE - ADDRS_BYTES <=
+                TARGET_MEMORY_BYTES) {
+                memcpy(&Target.ui8Memory[ui32Address],
+                    &pPayload[CMD_BYTE + ADDRS_BYTES],
+                    ui16Payload - CMD_BYTE - ADDRS_BYTES);
+            }
+            Target_replyMessage();
+            break;
+        case CMD_RX_PASSWORD:
+            Target_replyMessage();
+            break;
+        case CMD_START_APP:
+            Target.bStarted = true;
+            break;
+        default:
+            break;
+    }
+}
+
+//*****************************************************************************
+//
+// ! Host frames
+// ! Bytes after the end of the packet must be padding
+//
+//*****************************************************************************
+static void Target_onFrame(const DL_MCAN_TxBufElement *pMsg)
+{
+    uint8_t ui8Len = dlcBytes[pMsg->dlc & 0xF];
+    uint8_t i;
+
+    Target.ui32Frames++;
+    Target.ui8LastFrameDlc = (uint8_t) pMsg->dlc;
+    if (pMsg->xtd || (pMsg->id >> 18) != CAN_ID_HOST ||
+        (bool) pMsg->fdf != Target.bFd || (bool) pMsg->brs != Target.bFd ||
+        (!Target.bFd && ui8Len > CAN_CLASSIC_BYTES)) {
+        Target.ui32BadFrames++;
+        return;
+    }
+    for (i = 0; i < ui8Len; i++) {
+        uint8_t ui8Byte = (uint8_t) pMsg->data[i];
+
+        if (Target.ui16Got == 0 && ui8Byte != PACKET_HEADER) {
+            if (ui8Byte == SOFTWARE_TRIGGER) {
+                Target.ui32Triggers++;
+            } else if (ui8Byte != CAN_PAD_BYTE) {
+                Target.ui32BadFrames++;
+            }
+            continue;
+        }
+        Target.ui8Packet[Target.ui16Got++] = ui8Byte;
+        if (Target.ui16Got == HDR_BYTES) {
+            Target.ui16Need = HDR_BYTES +
+                              (Target.ui8Packet[1] | (Target.ui8Packet[2] << 8)) +
+                              CRC_BYTES;
+        }
+        if (Target.ui16Got >= HDR_BYTES && Target.ui16Got == Target.ui16Need) {
+            Target_handlePacket();
+            Target.ui16Got = 0;
+        }
+    }
+}
+
+static void Test_reset(void)
+{
+    memset(&Target, 0, sizeof(Target));
+    Target.ui8Ack    = can_noError;
+    Target.ui8Status = eBSL_success;
+    Fake_mcanReset();
+    Fake_mcan.onTx = Target_onFrame;
+    Fake_cycles    = 0;
+    Fake_gpioPins  = 0;
+    CAN_initialize();
+    BSL_timing_init(Fake_clockUs);
+}
+
+//*****************************************************************************
+//
+// ! A whole session
+// ! Classic frames up to the bit rate change, FD frames after it
+//
+//*****************************************************************************
+static void Test_session(void)
+{
+    static uint8_t ui8Image[300];
+    uint8_t ui8Password[PASSWORD_SIZE];
+    DL_MCAN_RxBufElement stale;
+    uint64_t w;
+    uint16_t i;
+
+    // Frames received before the session are dropped
+    Test_reset();
+    memset(&stale, 0, sizeof(stale));
+    stale.id = CAN_ID_BSL << 18;
+    stale.dlc = 1;
+    Fake_mcanReceive(&stale);
+    Fake_mcanReceive(&stale);
+    CAN_initialize();
+    CHECK_EQ(Fake_mcan.fifoPut - Fake_mcan.fifoGet, 0);
+
+    Host_BSL_software_trigger();
+    CHECK_EQ(Target.ui32Triggers, 1);
+
+    // The first probes go unanswered while the BSL starts
+    Target.ui8ProbesToIgnore = 2;
+    CHECK_EQ(Host_BSL_waitForBSL(), eBSL_success);
+    CHECK_EQ(BSL_entry_attempts, 3);
+    CHECK(BSL_entry_cycles >= 2 * BSL_POLL_ACK);
+
+    CHECK_EQ(Host_BSL_Connection(), eBSL_success);
+    CHECK_EQ(Target.ui8LastFrameDlc, 8);
+
+    // The Get ID reply spans several classic frames after the ACK
+    Target.bForeignFrame = true;
+    CHECK_EQ(Host_BSL_GetID(), eBSL_success);
+    CHECK_EQ(BSL_maxBufferSize, BUFFER_SIZE_REPORTED);
+    Target.bForeignFrame = false;
+
+    CHECK_EQ(Host_BSL_Change_Bitrate(&br_cfg), eBSL_success);
+    w = Target.ui64BitrateWord;
+    CHECK_EQ(w & 0x1F, br_cfg.timing.dataRatePrescalar);
+    CHECK_EQ((w >> 5) & 0xF, br_cfg.timing.dataSynchJumpWidth);
+    CHECK_EQ((w >> 9) & 0xF, br_cfg.timing.dataTimeSeg2);
+    CHECK_EQ((w >> 13) & 0x1F, br_cfg.timing.dataTimeSeg1);
+    CHECK_EQ((w >> 18) & 0x1FF, br_cfg.timing.nomRatePrescalar);
+    CHECK_EQ((w >> 27) & 0x7F, br_cfg.timing.nomSynchJumpWidth);
+    CHECK_EQ((w >> 34) & 0x7F, br_cfg.timing.nomTimeSeg2);
+    CHECK_EQ((w >> 41) & 0xFF, br_cfg.timing.nomTimeSeg1);
+    CHECK_EQ((w >> 49) & 1, br_cfg.brsEnable);
+    CHECK_EQ((w >> 50) & 1, br_cfg.fdMode);
+    CHECK(memcmp(&Fake_mcan.timing, &br_cfg.timing, sizeof(br_cfg.timing)) == 0);
+
+    // 40 bytes go out as one FD frame padded to 48
+    memset(ui8Password, 0xFF, sizeof(ui8Password));
+    CHECK_EQ(Host_BSL_loadPassword(ui8Password), eBSL_success);
+    CHECK_EQ(Target.ui8LastCommand, CMD_RX_PASSWORD);
+    CHECK_EQ(dlcBytes[Target.ui8LastFrameDlc], 48);
+
+    CHECK_EQ(Host_BSL_MassErase(), eBSL_success);
+
+    for (i = 0; i < sizeof(ui8Image); i++) {
+        ui8Image[i] = (uint8_t) (i * 7 + 3);
+    }
+    CHECK_EQ(Host_BSL_writeMemory(0x100, ui8Image, sizeof(ui8Image)), eBSL_success);
+    CHECK(memcmp(&Target.ui8Memory[0x100], ui8Image, sizeof(ui8Image)) == 0);
+    CHECK_EQ(Target.ui8Memory[0x100 + sizeof(ui8Image)], 0xFF);
+    CHECK_EQ(BSL_timing.packet.count, 3);
+
+    CHECK_EQ(Host_BSL_StartApp(), eBSL_success);
+    CHECK(Target.bStarted);
+    CHECK_EQ(Target.ui32BadFrames, 0);
+    CHECK_EQ(Target.ui32BadPackets, 0);
+    CHECK_EQ(Fake_gpioPins & GPIO_LED_Error_PIN, 0);
+}
+
+//*****************************************************************************
+//
+// ! Failures
+// ! NAK, error status, bad response CRC, no reply, no bus acknowledgement
+//
+//*****************************************************************************
+static void Test_failures(void)
+{
+    uint8_t ui8Data[16] = {0};
+    uint64_t ui64Start;
+
+    Test_reset();
+    Target.ui8Ack = checksum_Error;
+    CHECK_EQ(Host_BSL_Connection(), checksum_Error);
+    CHECK(Fake_gpioPins & GPIO_LED_Error_PIN);
+
+    Test_reset();
+    Target.ui8Status = eBSL_locked;
+    CHECK_EQ(Host_BSL_writeMemory(0, ui8Data, sizeof(ui8Data)), eBSL_locked);
+
+    Test_reset();
+    Target.bBadCrc = true;
+    CHECK_EQ(Host_BSL_MassErase(), checksum_Error);
+
+    // The bit rate change is refused: the host stays on classic frames
+    Test_reset();
+    Target.ui8Ack = bitrate_Error;
+    CHECK_EQ(Host_BSL_Change_Bitrate(&br_cfg), bitrate_Error);
+    Target.ui8Ack = can_noError;
+    CHECK_EQ(Host_BSL_Connection(), eBSL_success);
+    CHECK_EQ(Target.ui32BadFrames, 0);
+
+    // The MCAN refuses the bit timing after the BSL has switched
+    Test_reset();
+    Fake_mcan.setBitTimeStatus = -1;
+    CHECK_EQ(Host_BSL_Change_Bitrate(&br_cfg), eBSL_busError);
+
+    Test_reset();
+    Target.bSilent = true;
+    ui64Start = Fake_cycles;
+    CHECK_EQ(Host_BSL_MassErase(), eBSL_replyTimeout);
+    CHECK(Fake_cycles - ui64Start >= BSL_ERASE_TIMEOUT - CAN_POLL_STEP);
+    CHECK(Fake_cycles - ui64Start <= BSL_ERASE_TIMEOUT);
+
+    Test_reset();
+    Target.bSilent = true;
+    CHECK_EQ(Host_BSL_waitForBSL(), eBSL_entryTimeout);
+    CHECK(BSL_entry_cycles >= BSL_ENTRY_TIMEOUT);
+
+    Test_reset();
+    Fake_mcan.txStuck = true;
+    CHECK_EQ(Host_BSL_Connection(), eBSL_busError);
+    CHECK_EQ(Fake_mcan.txCancelled, 1);
+}
+
+int main(void)
+{
+    Test_session();
+    Test_failures();
+    return Check_result("test_bsl_can");
+}
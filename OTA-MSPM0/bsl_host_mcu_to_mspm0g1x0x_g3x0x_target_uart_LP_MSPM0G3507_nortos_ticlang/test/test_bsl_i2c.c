@@ -0,0 +1,364 @@
+// Prathik Narsetty
+// I2C plugin (bsl_i2c.c, i2c.c) against a BSL target model on the fake I2C
+//
+// The model gets every write transaction whole, checks the packet's CRC and
+// queues the reply. A read transaction takes the whole reply at once; while
+// the model is still at work it does not acknowledge the address, as the
+// BSL does, so the host has to poll for it.
+#include <bsl_i2c.h>
+#include "bsl_timing.h"
+#include "check.h"
+#include "i2c.h"
+#include "stdbool.h"
+#include "string.h"
+#include "ti_msp_dl_config.h"
+
+#define TARGET_MEMORY_BYTES (1024)
+#define HDR_BYTES (3)
+#define RESPONSE_HEADER (0x08)
+#define CMD_RESPONSE_GET_ID (0x31)
+#define CMD_RESPONSE_MESSAGE (0x3B)
+#define BUFFER_SIZE_REPORTED (0x0ABC)
+#define SOFTWARE_TRIGGER (0x22)
+
+#define REPLY_ACK_BYTES (ACK_BYTE)
+#define REPLY_MESSAGE_BYTES (ACK_BYTE + HDR_LEN_CMD_BYTES + MESSAGE_BYTES + CRC_BYTES)
+#define REPLY_ID_BYTES (ACK_BYTE + HDR_LEN_CMD_BYTES + ID_BACK + CRC_BYTES)
+
+static struct {
+    uint8_t ui8Out[64];
+    uint8_t ui8OutLength;
+    uint16_t ui16BusyLeft;
+    uint8_t ui8Memory[TARGET_MEMORY_BYTES];
+
+    // Behaviour
+    uint8_t ui8Ack;
+    uint8_t ui8Status;
+    uint16_t ui16Busy;       // reads not acknowledged before each reply
+    uint16_t ui16EraseBusy;  // the same before the mass erase reply
+    bool bNackData;          // leave every write unacknowledged
+    bool bSilent;
+
+    // Seen from the host
+    uint32_t ui32Packets;
+    uint32_t ui32BadPackets;
+    uint32_t ui32SplitReads;  // reads of another length than the reply
+    uint32_t ui32Triggers;
+    uint32_t ui32Probes;
+    uint8_t ui8LastCommand;
+    bool bStarted;
+} Target;
+
+static uint32_t Test_crc32(const uint8_t *pData, uint16_t ui16Len)
+{
+    uint32_t ui32Crc = 0xFFFFFFFF;
+    uint8_t ui8Bit;
+
+    while (ui16Len--) {
+        ui32Crc ^= *pData++;
+        for (ui8Bit = 0; ui8Bit < 8; ui8Bit++) {
+            ui32Crc = (ui32Crc & 1) ? (ui32Crc >> 1) ^ 0xEDB88320 : ui32Crc >> 1;
+        }
+    }
+    return ui32Crc;
+}
+
+static void Target_queue(const uint8_t *pData, uint8_t ui8Len, uint16_t ui16Busy)
+{
+    memcpy(Target.ui8Out, pData, ui8Len);
+    Target.ui8OutLength = ui8Len;
+    Target.ui16BusyLeft = ui16Busy;
+}
+
+// ACK, then a response packet of ui8Command and ui8Len data bytes
+static void Target_reply(uint8_t ui8Command, const uint8_t *pData, uint8_t ui8Len,
+    uint16_t ui16Busy)
+{
+    uint8_t ui8Reply[REPLY_ID_BYTES];
+    uint32_t ui32Crc;
+
+    ui8Reply[0] = Target.ui8Ack;
+    ui8Reply[1] = RESPONSE_HEADER;
+    ui8Reply[2] = ui8Len + CMD_BYTE;
+    ui8Reply[3] = 0;
+    ui8Reply[4] = ui8Command;
+    memcpy(&ui8Reply[5], pData, ui8Len);
+    ui32Crc = Test_crc32(&ui8Reply[4], ui8Len + CMD_BYTE);
+    memcpy(&ui8Reply[5 + ui8Len], &ui32Crc, CRC_BYTES);
+    Target_queue(ui8Reply, Target.ui8Ack != i2c_noError ? ACK_BYTE
+                                                        : 5 + ui8Len + CRC_BYTES,
+        ui16Busy);
+}
+
+static void Target_handlePacket(const uint8_t *pPacket, uint16_t ui16Cnt)
+{
+    const uint8_t *pPayload = &pPacket[HDR_BYTES];
+    uint16_t ui16Payload = pPacket[1] | (pPacket[2] << 8);
+    uint16_t ui16Data;
+    uint32_t ui32Crc;
+    uint32_t ui32Address;
+    uint8_t ui8Id[ID_BACK];
+    uint8_t i;
+
+    if (ui16Cnt != HDR_BYTES + ui16Payload + CRC_BYTES) {
+        Target.ui32BadPackets++;
+        return;
+    }
+    memcpy(&ui32Crc, &pPayload[ui16Payload], CRC_BYTES);
+    if (ui32Crc != Test_crc32(pPayload, ui16Payload)) {
+        Target.ui32BadPackets++;
+        return;
+    }
+    Target.ui32Packets++;
+    Target.ui8LastCommand = pPayload[0];
+    switch (pPayload[0]) {
+        case CMD_CONNECTION:
+            Target_queue(&Target.ui8Ack, ACK_BYTE, Target.ui16Busy);
+            break;
+        case CMD_GET_ID:
+            for (i = 0; i < ID_BACK; i++) {
+                ui8Id[i] = (uint8_t) (0xC0 + i);
+            }
+            ui8Id[10] = LSB(BUFFER_SIZE_REPORTED);
+            ui8Id[11] = MSB(BUFFER_SIZE_REPORTED);
+            Target_reply(CMD_RESPONSE_GET_ID, ui8Id, ID_BACK, Target.ui16Busy);
+            break;
+        case CMD_MASS_ERASE:
+            memset(Target.ui8Memory, 0xFF, sizeof(Target.ui8Memory));
+            Target_reply(CMD_RESPONSE_MESSAGE, &Target.ui8Status, 1,
+                Target.ui16EraseBusy);
+            break;
+        case CMD_PROGRAMDATA:
+            memcpy(&ui32Address, &pPayload[CMD_BYTE], ADDRS_BYTES);
+            ui16Data = ui16Payload - CMD_BYTE - ADDRS_BYTES;
+            if (ui32Address + ui16Data <= TARGET_MEMORY_BYTES) {
+                memcpy(&Target.ui8Memory[ui32Address],
+                    &pPayload[CMD_BYTE + ADDRS_BYTES], ui16Data);
+            }
+            Target_reply(CMD_RESPONSE_MESSAGE, &Target.ui8Status, 1, Target.ui16Busy);
+            break;
+        case CMD_RX_PASSWORD:
+            Target_reply(CMD_RESPONSE_MESSAGE, &Target.ui8Status, 1, Target.ui16Busy);
+            break;
+        case CMD_START_APP:
+            Target.bStarted = true;
+            Target_queue(&Target.ui8Ack, ACK_BYTE, Target.ui16Busy);
+            break;
+        default:
+            break;
+    }
+}
+
+//*****************************************************************************
+//
+// ! Target_write
+// ! One write transaction: a packet, the status probe 0xBB or the software
+// ! trigger
+//
+//*****************************************************************************
+static bool Target_write(const uint8_t *pData, uint16_t ui16Cnt)
+{
+    if (Target.bNackData) {
+        return false;
+    }
+    if (Target.bSilent) {
+        return true;
+    }
+    if (pData[0] == PACKET_HEADER && ui16Cnt >= HDR_BYTES) {
+        Target_handlePacket(pData, ui16Cnt);
+    } else if (pData[0] == BSL_STATUS_PROBE && ui16Cnt == 1) {
+        uint8_t ui8Ready = BSL_STATUS_READY;
+
+        Target.ui32Probes++;
+        Target_queue(&ui8Ready, 1, Target.ui16Busy);
+    } else if (pData[0] == SOFTWARE_TRIGGER && ui16Cnt == 1) {
+        Target.ui32Triggers++;
+    }
+    return true;
+}
+
+//*****************************************************************************
+//
+// ! Target_read
+// ! One read transaction, the whole queued reply; not acknowledged while
+// ! the target is busy or has nothing to send
+//
+//*****************************************************************************
+static bool Target_read(uint8_t *pData, uint16_t ui16Cnt)
+{
+    if (Target.ui8OutLength == 0) {
+        return false;
+    }
+    if (Target.ui16BusyLeft > 0) {
+        Target.ui16BusyLeft--;
+        return false;
+    }
+    if (ui16Cnt != Target.ui8OutLength) {
+        Target.ui32SplitReads++;
+    }
+    memset(pData, 0xFF, ui16Cnt);
+    memcpy(pData, Target.ui8Out,
+        ui16Cnt < Target.ui8OutLength ? ui16Cnt : Target.ui8OutLength);
+    Target.ui8OutLength = 0;
+    return true;
+}
+
+static void Test_reset(void)
+{
+    memset(&Target, 0, sizeof(Target));
+    Target.ui8Ack    = i2c_noError;
+    Target.ui8Status = eBSL_success;
+    Target.ui16Busy  = 3;
+    Fake_i2cReset();
+    Fake_i2c.write = Target_write;
+    Fake_i2c.read  = Target_read;
+    Fake_cycles    = 0;
+    Fake_gpioPins  = 0;
+    BSL_timing_init(Fake_clockUs);
+}
+
+//*****************************************************************************
+//
+// ! A whole session
+// ! Each command is one write and one read of the whole reply
+//
+//*****************************************************************************
+static void Test_session(void)
+{
+    static uint8_t ui8Image[300];
+    uint8_t ui8Password[PASSWORD_SIZE];
+    uint64_t ui64Start;
+    uint32_t ui32Reads;
+    uint32_t ui32Nacks;
+    uint16_t i;
+
+    Test_reset();
+    Host_BSL_software_trigger();
+    CHECK_EQ(Target.ui32Triggers, 1);
+    CHECK_EQ(Fake_i2c.ui32LastAddress, I2C_TARGET_ADDRESS);
+
+    // The BSL does not acknowledge its address until it has started
+    Fake_i2c.ui16AddressNacks = 2;
+    CHECK_EQ(Host_BSL_waitForBSL(), eBSL_success);
+    CHECK_EQ(BSL_entry_attempts, 3);
+    CHECK(BSL_entry_cycles >= 3 * BSL_POLL_BACKOFF_MIN);
+    CHECK_EQ(Target.ui32Probes, 1);
+    CHECK_EQ(Status_check(), BSL_STATUS_READY);
+
+    ui32Reads = Fake_i2c.ui32Reads;
+    ui32Nacks = Fake_i2c.ui32ReadNacks;
+    CHECK_EQ(Host_BSL_Connection(), eBSL_success);
+    CHECK_EQ(Fake_i2c.ui32Reads, ui32Reads + 1);
+    CHECK_EQ(Fake_i2c.ui16LastReadCnt, REPLY_ACK_BYTES);
+    CHECK_EQ(Fake_i2c.ui32ReadNacks, ui32Nacks + Target.ui16Busy);
+
+    CHECK_EQ(Host_BSL_GetID(), eBSL_success);
+    CHECK_EQ(Fake_i2c.ui16LastReadCnt, REPLY_ID_BYTES);
+    CHECK_EQ(BSL_MAX_BUFFER_SIZE, BUFFER_SIZE_REPORTED);
+
+    memset(ui8Password, 0xFF, sizeof(ui8Password));
+    CHECK_EQ(Host_BSL_loadPassword(ui8Password), eBSL_success);
+    CHECK_EQ(Target.ui8LastCommand, CMD_RX_PASSWORD);
+    CHECK_EQ(Fake_i2c.ui16LastReadCnt, REPLY_MESSAGE_BYTES);
+
+    // The erase reply comes after a long run of unacknowledged reads, each
+    // one poll step apart
+    Target.ui16EraseBusy = 500;
+    ui64Start            = Fake_cycles;
+    ui32Nacks            = Fake_i2c.ui32ReadNacks;
+    CHECK_EQ(Host_BSL_MassErase(), eBSL_success);
+    CHECK_EQ(Fake_i2c.ui32ReadNacks, ui32Nacks + 500);
+    CHECK(Fake_cycles - ui64Start >= 500 * I2C_POLL_STEP);
+
+    // Packets longer than the TX FIFO, refilled while they go out
+    for (i = 0; i < sizeof(ui8Image); i++) {
+        ui8Image[i] = (uint8_t) (i * 11 + 5);
+    }
+    ui32Reads = Fake_i2c.ui32Reads;
+    CHECK_EQ(Host_BSL_writeMemory(0x80, ui8Image, sizeof(ui8Image)), eBSL_success);
+    CHECK(memcmp(&Target.ui8Memory[0x80], ui8Image, sizeof(ui8Image)) == 0);
+    CHECK_EQ(Target.ui8Memory[0x80 + sizeof(ui8Image)], 0xFF);
+    CHECK_EQ(Fake_i2c.ui32Reads, ui32Reads + 3);
+    CHECK_EQ(Fake_i2c.ui8TxFifoMax, FAKE_I2C_FIFO_DEPTH);
+    CHECK_EQ(BSL_timing.packet.count, 3);
+
+    CHECK_EQ(Host_BSL_StartApp(), eBSL_success);
+    CHECK(Target.bStarted);
+    CHECK_EQ(Target.ui32BadPackets, 0);
+    CHECK_EQ(Target.ui32SplitReads, 0);
+    CHECK_EQ(Fake_i2c.ui32LastAddress, I2C_TARGET_ADDRESS);
+    CHECK_EQ(Fake_gpioPins & GPIO_LED_Error_PIN, 0);
+}
+
+//*****************************************************************************
+//
+// ! Clock stretching
+// ! Waited out up to I2C_TRANSFER_TIMEOUT per transaction
+//
+//*****************************************************************************
+static void Test_stretch(void)
+{
+    uint64_t ui64Start;
+
+    Test_reset();
+    Fake_i2c.ui16Stretch = 100;
+    ui64Start            = Fake_cycles;
+    CHECK_EQ(Host_BSL_Connection(), eBSL_success);
+    CHECK(Fake_cycles - ui64Start >= 2 * 100 * I2C_POLL_STEP);
+
+    Test_reset();
+    Fake_i2c.ui16Stretch = I2C_TRANSFER_TIMEOUT / I2C_POLL_STEP + 1;
+    CHECK_EQ(Host_BSL_Connection(), eBSL_replyTimeout);
+    CHECK_EQ(Fake_i2c.ui32Reads + Fake_i2c.ui32ReadNacks, 0);
+    CHECK(Fake_gpioPins & GPIO_LED_Error_PIN);
+}
+
+//*****************************************************************************
+//
+// ! Failures
+// ! NAK, error status, unacknowledged data, no reply, no BSL at all
+//
+//*****************************************************************************
+static void Test_failures(void)
+{
+    uint8_t ui8Data[16] = {0};
+    uint64_t ui64Start;
+
+    Test_reset();
+    Target.ui8Ack = checksum_Error;
+    CHECK_EQ(Host_BSL_Connection(), checksum_Error);
+    CHECK(Fake_gpioPins & GPIO_LED_Error_PIN);
+
+    Test_reset();
+    Target.ui8Status = eBSL_locked;
+    CHECK_EQ(Host_BSL_writeMemory(0, ui8Data, sizeof(ui8Data)), eBSL_locked);
+
+    // A write the target does not acknowledge is not followed by a read
+    Test_reset();
+    Target.bNackData = true;
+    CHECK_EQ(Host_BSL_Connection(), eBSL_replyTimeout);
+    CHECK_EQ(Fake_i2c.ui32Reads + Fake_i2c.ui32ReadNacks, 0);
+
+    Test_reset();
+    Target.bSilent = true;
+    ui64Start      = Fake_cycles;
+    CHECK_EQ(Host_BSL_Connection(), eBSL_replyTimeout);
+    CHECK(Fake_cycles - ui64Start >= BSL_REPLY_TIMEOUT - I2C_POLL_STEP);
+    CHECK(Fake_cycles - ui64Start <= BSL_REPLY_TIMEOUT);
+    CHECK_EQ(Fake_i2c.ui32Reads, 0);
+    CHECK(Fake_gpioPins & GPIO_LED_Error_PIN);
+
+    Test_reset();
+    Target.bSilent = true;
+    CHECK_EQ(Host_BSL_waitForBSL(), eBSL_entryTimeout);
+    CHECK(BSL_entry_cycles >= BSL_ENTRY_TIMEOUT);
+    CHECK_EQ(Status_check(), 0);
+}
+
+int main(void)
+{
+    Test_session();
+    Test_stretch();
+    Test_failures();
+    return Check_result("test_bsl_i2c");
+}
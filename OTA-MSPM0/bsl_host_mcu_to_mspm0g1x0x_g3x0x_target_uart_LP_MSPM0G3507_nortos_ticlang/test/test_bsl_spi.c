@@ -0,0 +1,304 @@
+// Prathik Narsetty
+// SPI plugin (bsl_spi.c, spi.c) against a BSL target model on the fake SPI
+//
+// The model sees every byte the host clocks out. It puts packets back
+// together, checks their CRCs and queues the reply, which it shifts out
+// only when the host clocks fill bytes, after answering a number of them
+// with the fill value itself as a BSL still at work does.
+#include <bsl_spi.h>
+#include "bsl_timing.h"
+#include "check.h"
+#include "spi.h"
+#include "stdbool.h"
+#include "string.h"
+#include "ti_msp_dl_config.h"
+
+#define TARGET_MEMORY_BYTES (1024)
+#define HDR_BYTES (3)
+#define RESPONSE_HEADER (0x08)
+#define CMD_RESPONSE_GET_ID (0x31)
+#define CMD_RESPONSE_MESSAGE (0x3B)
+#define BUFFER_SIZE_REPORTED (0x0ABC)
+#define SOFTWARE_TRIGGER (0x22)
+
+static struct {
+    uint8_t ui8Packet[MAX_PACKET_SIZE + 8];
+    uint16_t ui16Got;
+    uint16_t ui16Need;
+    uint8_t ui8Out[64];
+    uint8_t ui8OutHead;
+    uint8_t ui8OutLength;
+    uint16_t ui16BusyLeft;
+    uint8_t ui8Memory[TARGET_MEMORY_BYTES];
+
+    // Behaviour
+    uint8_t ui8Ack;
+    uint8_t ui8Status;
+    uint16_t ui16Busy;       // fill bytes before each reply
+    uint16_t ui16EraseBusy;  // fill bytes before the mass erase reply
+    uint8_t ui8ProbesToIgnore;
+    bool bSilent;
+
+    // Seen from the host
+    uint32_t ui32Packets;
+    uint32_t ui32BadPackets;
+    uint32_t ui32Triggers;
+    uint32_t ui32Probes;
+    uint8_t ui8LastCommand;
+    bool bStarted;
+} Target;
+
+static uint32_t Test_crc32(const uint8_t *pData, uint16_t ui16Len)
+{
+    uint32_t ui32Crc = 0xFFFFFFFF;
+    uint8_t ui8Bit;
+
+    while (ui16Len--) {
+        ui32Crc ^= *pData++;
+        for (ui8Bit = 0; ui8Bit < 8; ui8Bit++) {
+            ui32Crc = (ui32Crc & 1) ? (ui32Crc >> 1) ^ 0xEDB88320 : ui32Crc >> 1;
+        }
+    }
+    return ui32Crc;
+}
+
+static void Target_queue(const uint8_t *pData, uint8_t ui8Len, uint16_t ui16Busy)
+{
+    memcpy(Target.ui8Out, pData, ui8Len);
+    Target.ui8OutHead   = 0;
+    Target.ui8OutLength = ui8Len;
+    Target.ui16BusyLeft = ui16Busy;
+}
+
+// ACK, then a response packet of ui8Command and ui8Len data bytes
+static void Target_reply(uint8_t ui8Command, const uint8_t *pData, uint8_t ui8Len,
+    uint16_t ui16Busy)
+{
+    uint8_t ui8Reply[ACK_BYTE + HDR_LEN_CMD_BYTES + ID_BACK + CRC_BYTES];
+    uint32_t ui32Crc;
+
+    ui8Reply[0] = Target.ui8Ack;
+    ui8Reply[1] = RESPONSE_HEADER;
+    ui8Reply[2] = ui8Len + CMD_BYTE;
+    ui8Reply[3] = 0;
+    ui8Reply[4] = ui8Command;
+    memcpy(&ui8Reply[5], pData, ui8Len);
+    ui32Crc = Test_crc32(&ui8Reply[4], ui8Len + CMD_BYTE);
+    memcpy(&ui8Reply[5 + ui8Len], &ui32Crc, CRC_BYTES);
+    Target_queue(ui8Reply, Target.ui8Ack != spi_noError ? ACK_BYTE
+                                                        : 5 + ui8Len + CRC_BYTES,
+        ui16Busy);
+}
+
+static void Target_handlePacket(void)
+{
+    uint8_t *pPayload = &Target.ui8Packet[HDR_BYTES];
+    uint16_t ui16Payload = Target.ui16Need - HDR_BYTES - CRC_BYTES;
+    uint16_t ui16Data;
+    uint32_t ui32Crc;
+    uint32_t ui32Address;
+    uint8_t ui8Id[ID_BACK];
+    uint8_t i;
+
+    memcpy(&ui32Crc, &pPayload[ui16Payload], CRC_BYTES);
+    if (ui32Crc != Test_crc32(pPayload, ui16Payload)) {
+        Target.ui32BadPackets++;
+        return;
+    }
+    Target.ui32Packets++;
+    Target.ui8LastCommand = pPayload[0];
+    if (Target.bSilent) {
+        return;
+    }
+    switch (pPayload[0]) {
+        case CMD_CONNECTION:
+            Target_queue(&Target.ui8Ack, ACK_BYTE, Target.ui16Busy);
+            break;
+        case CMD_GET_ID:
+            for (i = 0; i < ID_BACK; i++) {
+                ui8Id[i] = (uint8_t) (0xC0 + i);
+            }
+            ui8Id[10] = LSB(BUFFER_SIZE_REPORTED);
+            ui8Id[11] = MSB(BUFFER_SIZE_REPORTED);
+            Target_reply(CMD_RESPONSE_GET_ID, ui8Id, ID_BACK, Target.ui16Busy);
+            break;
+        case CMD_MASS_ERASE:
+            memset(Target.ui8Memory, 0xFF, sizeof(Target.ui8Memory));
+            Target_reply(CMD_RESPONSE_MESSAGE, &Target.ui8Status, 1,
+                Target.ui16EraseBusy);
+            break;
+        case CMD_PROGRAMDATA:
+            memcpy(&ui32Address, &pPayload[CMD_BYTE], ADDRS_BYTES);
+            ui16Data = ui16Payload - CMD_BYTE - ADDRS_BYTES;
+            if (ui32Address + ui16Data <= TARGET_MEMORY_BYTES) {
+                memcpy(&Target.ui8Memory[ui32Address],
+                    &pPayload[CMD_BYTE + ADDRS_BYTES], ui16Data);
+            }
+            Target_reply(CMD_RESPONSE_MESSAGE, &Target.ui8Status, 1, Target.ui16Busy);
+            break;
+        case CMD_RX_PASSWORD:
+            Target_reply(CMD_RESPONSE_MESSAGE, &Target.ui8Status, 1, Target.ui16Busy);
+            break;
+        case CMD_START_APP:
+            Target.bStarted = true;
+            Target_queue(&Target.ui8Ack, ACK_BYTE, Target.ui16Busy);
+            break;
+        default:
+            break;
+    }
+}
+
+//*****************************************************************************
+//
+// ! Target_exchange
+// ! One byte each way. Outside a packet the host's fill bytes clock out the
+// ! queued reply; 0xBB is the status probe
+//
+//*****************************************************************************
+static uint8_t Target_exchange(uint8_t ui8Byte)
+{
+    if (Target.ui16Got > 0 || ui8Byte == PACKET_HEADER) {
+        Target.ui8Packet[Target.ui16Got++] = ui8Byte;
+        if (Target.ui16Got == HDR_BYTES) {
+            Target.ui16Need = HDR_BYTES +
+                              (Target.ui8Packet[1] | (Target.ui8Packet[2] << 8)) +
+                              CRC_BYTES;
+        }
+        if (Target.ui16Got >= HDR_BYTES && Target.ui16Got == Target.ui16Need) {
+            Target.ui16Got = 0;
+            Target_handlePacket();
+        }
+        return SPI_FILL_BYTE;
+    }
+    if (ui8Byte == BSL_STATUS_PROBE) {
+        Target.ui32Probes++;
+        if (Target.ui8ProbesToIgnore > 0) {
+            Target.ui8ProbesToIgnore--;
+        } else if (!Target.bSilent) {
+            uint8_t ui8Ready = BSL_STATUS_READY;
+            Target_queue(&ui8Ready, 1, Target.ui16Busy);
+        }
+        return SPI_FILL_BYTE;
+    }
+    if (ui8Byte == SOFTWARE_TRIGGER) {
+        Target.ui32Triggers++;
+        return SPI_FILL_BYTE;
+    }
+    if (Target.ui16BusyLeft > 0) {
+        Target.ui16BusyLeft--;
+        return SPI_FILL_BYTE;
+    }
+    if (Target.ui8OutHead < Target.ui8OutLength) {
+        return Target.ui8Out[Target.ui8OutHead++];
+    }
+    return SPI_FILL_BYTE;
+}
+
+static void Test_reset(void)
+{
+    memset(&Target, 0, sizeof(Target));
+    Target.ui8Ack    = spi_noError;
+    Target.ui8Status = eBSL_success;
+    Target.ui16Busy  = 3;
+    memset(&Fake_spi, 0, sizeof(Fake_spi));
+    Fake_spi.exchange = Target_exchange;
+    Fake_cycles       = 0;
+    Fake_gpioPins     = 0;
+    BSL_timing_init(Fake_clockUs);
+}
+
+//*****************************************************************************
+//
+// ! A whole session
+//
+//*****************************************************************************
+static void Test_session(void)
+{
+    static uint8_t ui8Image[300];
+    uint8_t ui8Password[PASSWORD_SIZE];
+    uint64_t ui64Start;
+    uint16_t i;
+
+    Test_reset();
+    Fake_spi.ui8Stale = 3;
+    SPI_Initialize();
+    CHECK_EQ(Fake_spi.ui8Stale, 0);
+
+    Host_BSL_software_trigger();
+    CHECK_EQ(Target.ui32Triggers, 1);
+
+    Target.ui8ProbesToIgnore = 2;
+    CHECK_EQ(Host_BSL_waitForBSL(), eBSL_success);
+    CHECK_EQ(BSL_entry_attempts, 3);
+    CHECK(BSL_entry_cycles >= 2 * BSL_POLL_ACK);
+    CHECK_EQ(Status_check(), BSL_STATUS_READY);
+
+    CHECK_EQ(Host_BSL_Connection(), eBSL_success);
+    CHECK_EQ(Host_BSL_GetID(), eBSL_success);
+    CHECK_EQ(BSL_MAX_BUFFER_SIZE, BUFFER_SIZE_REPORTED);
+
+    memset(ui8Password, 0xFF, sizeof(ui8Password));
+    CHECK_EQ(Host_BSL_loadPassword(ui8Password), eBSL_success);
+    CHECK_EQ(Target.ui8LastCommand, CMD_RX_PASSWORD);
+
+    // The erase reply comes after a long run of fill bytes, each one poll
+    Target.ui16EraseBusy = 500;
+    ui64Start            = Fake_cycles;
+    CHECK_EQ(Host_BSL_MassErase(), eBSL_success);
+    CHECK(Fake_cycles - ui64Start >= 500 * SPI_POLL_STEP);
+
+    for (i = 0; i < sizeof(ui8Image); i++) {
+        ui8Image[i] = (uint8_t) (i * 11 + 5);
+    }
+    CHECK_EQ(Host_BSL_writeMemory(0x80, ui8Image, sizeof(ui8Image)), eBSL_success);
+    CHECK(memcmp(&Target.ui8Memory[0x80], ui8Image, sizeof(ui8Image)) == 0);
+    CHECK_EQ(Target.ui8Memory[0x80 + sizeof(ui8Image)], 0xFF);
+    CHECK_EQ(BSL_timing.packet.count, 3);
+
+    CHECK_EQ(Host_BSL_StartApp(), eBSL_success);
+    CHECK(Target.bStarted);
+    CHECK_EQ(Target.ui32BadPackets, 0);
+    CHECK_EQ(Fake_gpioPins & GPIO_LED_Error_PIN, 0);
+}
+
+//*****************************************************************************
+//
+// ! Failures
+// ! NAK, error status, no reply, no BSL at all
+//
+//*****************************************************************************
+static void Test_failures(void)
+{
+    uint8_t ui8Data[16] = {0};
+    uint64_t ui64Start;
+
+    Test_reset();
+    Target.ui8Ack = checksum_Error;
+    CHECK_EQ(Host_BSL_Connection(), checksum_Error);
+    CHECK(Fake_gpioPins & GPIO_LED_Error_PIN);
+
+    Test_reset();
+    Target.ui8Status = eBSL_locked;
+    CHECK_EQ(Host_BSL_writeMemory(0, ui8Data, sizeof(ui8Data)), eBSL_locked);
+
+    Test_reset();
+    Target.bSilent = true;
+    ui64Start      = Fake_cycles;
+    CHECK_EQ(Host_BSL_MassErase(), eBSL_replyTimeout);
+    CHECK(Fake_cycles - ui64Start >= BSL_REPLY_TIMEOUT - SPI_POLL_STEP);
+    CHECK(Fake_cycles - ui64Start <= BSL_REPLY_TIMEOUT);
+    CHECK(Fake_gpioPins & GPIO_LED_Error_PIN);
+
+    Test_reset();
+    Target.bSilent = true;
+    CHECK_EQ(Host_BSL_waitForBSL(), eBSL_entryTimeout);
+    CHECK(BSL_entry_cycles >= BSL_ENTRY_TIMEOUT);
+    CHECK_EQ(Status_check(), 0);
+}
+
+int main(void)
+{
+    Test_session();
+    Test_failures();
+    return Check_result("test_bsl_spi");
+}
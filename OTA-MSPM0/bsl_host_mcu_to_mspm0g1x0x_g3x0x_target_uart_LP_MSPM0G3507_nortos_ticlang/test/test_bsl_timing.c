@@ -0,0 +1,142 @@
+// Prathik Narsetty
+// BSL_timing statistics and report against a fake clock
+#include "bsl_timing.h"
+#include "check.h"
+#include "string.h"
+
+static uint32_t Fake_now_us;
+static char Fake_output[1024];
+static uint32_t Fake_outputLength;
+
+static uint32_t Fake_clock(void)
+{
+    return Fake_now_us;
+}
+
+static void Fake_putChar(char c)
+{
+    if (Fake_outputLength + 1 < sizeof(Fake_output)) {
+        Fake_output[Fake_outputLength++] = c;
+        Fake_output[Fake_outputLength]   = '\0';
+    }
+}
+
+//*****************************************************************************
+//
+// ! Records
+// ! min, max and the average of a few durations; an empty record averages 0
+//
+//*****************************************************************************
+static void Test_record(void)
+{
+    BSL_TimingStat stat;
+
+    memset(&stat, 0, sizeof(stat));
+    CHECK_EQ(BSL_timing_average(&stat), 0);
+    BSL_timing_record(&stat, 300);
+    BSL_timing_record(&stat, 100);
+    BSL_timing_record(&stat, 200);
+    CHECK_EQ(stat.count, 3);
+    CHECK_EQ(stat.min_us, 100);
+    CHECK_EQ(stat.max_us, 300);
+    CHECK_EQ(stat.total_us, 600);
+    CHECK_EQ(BSL_timing_average(&stat), 200);
+
+    // A zero duration is still the minimum
+    BSL_timing_record(&stat, 0);
+    CHECK_EQ(stat.min_us, 0);
+
+    // The total does not overflow with long sessions
+    memset(&stat, 0, sizeof(stat));
+    BSL_timing_record(&stat, 0xFFFFFFF0);
+    BSL_timing_record(&stat, 0xFFFFFFF0);
+    CHECK_EQ(stat.total_us, 2 * 0xFFFFFFF0ULL);
+    CHECK_EQ(BSL_timing_average(&stat), 0xFFFFFFF0);
+}
+
+//*****************************************************************************
+//
+// ! Begin / end pairs
+// ! Phases, packets and the session time from the clock, also across the
+// ! wrap of the 32-bit clock
+//
+//*****************************************************************************
+static void Test_spans(void)
+{
+    uint8_t ui8Packet;
+
+    Fake_now_us = 1000;
+    BSL_timing_init(Fake_clock);
+    BSL_timing_sessionBegin();
+
+    BSL_timing_phaseBegin(BSL_PHASE_CONNECT);
+    Fake_now_us += 250;
+    BSL_timing_phaseEnd(BSL_PHASE_CONNECT);
+
+    // The write phase spans the packets and the pauses between them
+    Fake_now_us = 0xFFFFFF00;
+    BSL_timing_phaseBegin(BSL_PHASE_WRITE);
+    for (ui8Packet = 0; ui8Packet < 4; ui8Packet++) {
+        BSL_timing_packetBegin();
+        Fake_now_us += 100 + 10 * ui8Packet;
+        BSL_timing_packetEnd();
+        Fake_now_us += 5;
+    }
+    BSL_timing_phaseEnd(BSL_PHASE_WRITE);
+    BSL_timing_sessionEnd();
+
+    CHECK_EQ(BSL_timing.phase[BSL_PHASE_CONNECT].count, 1);
+    CHECK_EQ(BSL_timing.phase[BSL_PHASE_CONNECT].min_us, 250);
+    CHECK_EQ(BSL_timing.phase[BSL_PHASE_WRITE].count, 1);
+    CHECK_EQ(BSL_timing.phase[BSL_PHASE_WRITE].max_us, 4 * 105 + 60);
+    CHECK_EQ(BSL_timing.phase[BSL_PHASE_ERASE].count, 0);
+    CHECK_EQ(BSL_timing.packet.count, 4);
+    CHECK_EQ(BSL_timing.packet.min_us, 100);
+    CHECK_EQ(BSL_timing.packet.max_us, 130);
+    CHECK_EQ(BSL_timing_average(&BSL_timing.packet), 115);
+    CHECK_EQ(BSL_timing.session.max_us, Fake_now_us - 1000);
+
+    // init clears everything
+    BSL_timing_init(Fake_clock);
+    CHECK_EQ(BSL_timing.packet.count, 0);
+    CHECK_EQ(BSL_timing.phase[BSL_PHASE_WRITE].count, 0);
+}
+
+//*****************************************************************************
+//
+// ! Report
+// ! Phases that never ran are left out; columns are right-aligned
+//
+//*****************************************************************************
+static void Test_report(void)
+{
+    Fake_now_us = 0;
+    BSL_timing_init(Fake_clock);
+    BSL_timing_sessionBegin();
+    BSL_timing_phaseBegin(BSL_PHASE_GET_ID);
+    Fake_now_us += 1234;
+    BSL_timing_phaseEnd(BSL_PHASE_GET_ID);
+    BSL_timing_packetBegin();
+    Fake_now_us += 7;
+    BSL_timing_packetEnd();
+    BSL_timing_sessionEnd();
+
+    Fake_outputLength = 0;
+    BSL_timing_report(Fake_putChar);
+    CHECK(strcmp(Fake_output,
+              "phase      count    min us    avg us    max us\r\n"
+              "get_id         1      1234      1234      1234\r\n"
+              "packet         1         7         7         7\r\n"
+              "session        1      1241      1241      1241\r\n") == 0);
+    if (Check_failures) {
+        fprintf(stderr, "report was:\n%s", Fake_output);
+    }
+}
+
+int main(void)
+{
+    Test_record();
+    Test_spans();
+    Test_report();
+    return Check_result("test_bsl_timing");
+}
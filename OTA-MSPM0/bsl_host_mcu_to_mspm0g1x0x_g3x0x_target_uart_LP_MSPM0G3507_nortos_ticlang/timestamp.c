@@ -0,0 +1,40 @@
+// Prathik Narsetty
+// Microsecond timestamps from SysTick (see timestamp.h)
+#include "timestamp.h"
+
+#include "ti_msp_dl_config.h"
+
+static volatile uint32_t Timestamp_wraps;
+
+void SysTick_Handler(void)
+{
+    Timestamp_wraps++;
+}
+
+void Timestamp_init(void)
+{
+    Timestamp_wraps = 0;
+    DL_SYSTICK_init(TIMESTAMP_PERIOD);
+    DL_SYSTICK_enableInterrupt();
+}
+
+uint32_t Timestamp_getMicros(void)
+{
+    uint32_t ui32Wraps;
+    uint32_t ui32Count;
+
+    /* Read again if the counter wrapped in between */
+    do {
+        ui32Wraps = Timestamp_wraps;
+        ui32Count = DL_SYSTICK_getValue();
+    } while (ui32Wraps != Timestamp_wraps);
+    /* A wrap whose interrupt has not been taken yet */
+    if ((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) &&
+        ui32Count > TIMESTAMP_PERIOD / 2) {
+        ui32Wraps++;
+    }
+
+    return (uint32_t)(((uint64_t) ui32Wraps * TIMESTAMP_PERIOD +
+                          (TIMESTAMP_PERIOD - 1 - ui32Count)) /
+                      TIMESTAMP_CYCLES_PER_US);
+}
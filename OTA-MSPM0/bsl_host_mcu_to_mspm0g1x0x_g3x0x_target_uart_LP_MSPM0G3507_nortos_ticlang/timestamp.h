@@ -0,0 +1,14 @@
+// Prathik Narsetty
+// Microsecond timestamps from SysTick, for bsl_timing.c
+//
+// SysTick counts down from 2^24 at the 32 MHz MCLK and wraps every 524 ms;
+// its interrupt counts the wraps. Timestamp_getMicros() joins the two into
+// microseconds since Timestamp_init(), wrapping after 2^32 us (71 minutes).
+// It must be called with interrupts enabled, as everywhere in main.c.
+#include "stdint.h"
+
+#define TIMESTAMP_CYCLES_PER_US (32)
+#define TIMESTAMP_PERIOD (1UL << 24)  //SysTick reload, the counter is 24 bits
+
+void Timestamp_init(void);
+uint32_t Timestamp_getMicros(void);
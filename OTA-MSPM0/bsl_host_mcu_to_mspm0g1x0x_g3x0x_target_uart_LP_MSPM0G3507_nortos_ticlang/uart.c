@@ -34,6 +34,67 @@
 #include "ti_msp_dl_config.h"
 
 uint8_t test_d;
+uint32_t UART_overrunCount;
+uint8_t UART_flowControl;
+
+//*****************************************************************************
+//
+// ! UART_checkOverrun
+// ! Count and clear an RX overrun reported since the last check
+//
+//*****************************************************************************
+static void UART_checkOverrun(void)
+{
+    if (DL_UART_getRawInterruptStatus(
+            UART_0_INST, DL_UART_INTERRUPT_OVERRUN_ERROR)) {
+        UART_overrunCount++;
+        DL_UART_clearInterruptStatus(
+            UART_0_INST, DL_UART_INTERRUPT_OVERRUN_ERROR);
+    }
+}
+
+//*****************************************************************************
+//
+// ! UART_setFlowControl
+// ! CTL0 is only changed while the UART is disabled
+//
+//*****************************************************************************
+static void UART_setFlowControl(DL_UART_FLOW_CONTROL config)
+{
+    while (DL_UART_Main_isBusy(UART_0_INST))
+        ;
+    DL_UART_disable(UART_0_INST);
+    DL_UART_setFlowControl(UART_0_INST, config);
+    DL_UART_enable(UART_0_INST);
+}
+
+void UART_initFlowControl(void)
+{
+    UART_flowControl = 0;
+#ifdef UART_FLOW_CONTROL
+    UART_setFlowControl(DL_UART_FLOW_CONTROL_NONE);
+#endif
+}
+
+//*****************************************************************************
+//
+// ! UART_enableFlowControl
+// ! Turn RTS/CTS on if the target drives CTS. An unconnected CTS reads
+// ! deasserted and would stall every transmission, so it is left off then.
+// ! Returns 1 if flow control is on.
+//
+//*****************************************************************************
+uint8_t UART_enableFlowControl(void)
+{
+#ifdef UART_FLOW_CONTROL
+    if (DL_UART_isClearToSend(UART_0_INST)) {
+        UART_setFlowControl(DL_UART_FLOW_CONTROL_RTS_CTS);
+        UART_flowControl = 1;
+    }
+#endif
+    return UART_flowControl;
+}
+
 uint8_t UART_writeBuffer(uint8_t *pData, uint8_t ui8Cnt)
 {
     uint8_t res;
@@ -44,6 +105,7 @@ uint8_t UART_writeBuffer(uint8_t *pData, uint8_t ui8Cnt)
         // __delay_cycles(10000);
     }
     res = DL_UART_receiveDataBlocking(UART_0_INST);
+    UART_checkOverrun();
     return res;
 }
 
@@ -54,6 +116,29 @@ void UART_readBuffer(uint8_t *pData, uint8_t ui8Cnt)
         *pData = DL_UART_receiveDataBlocking(UART_0_INST);
         pData++;
     }
+    UART_checkOverrun();
+}
+
+//*****************************************************************************
+//
+// ! UART_readByteTimeout
+// ! Wait for one byte for at most *pui32Cycles CPU cycles.
+// ! Returns 1 if a byte arrived; *pui32Cycles is reduced by the time waited.
+//
+//*****************************************************************************
+uint8_t UART_readByteTimeout(uint8_t *pData, uint32_t *pui32Cycles)
+{
+    while (DL_UART_isRXFIFOEmpty(UART_0_INST)) {
+        if (*pui32Cycles < UART_POLL_STEP) {
+            *pui32Cycles = 0;
+            return 0;
+        }
+        delay_cycles(UART_POLL_STEP);
+        *pui32Cycles -= UART_POLL_STEP;
+    }
+    *pData = DL_UART_receiveData(UART_0_INST);
+    UART_checkOverrun();
+    return 1;
 }
 
 //uint8_t test_d;
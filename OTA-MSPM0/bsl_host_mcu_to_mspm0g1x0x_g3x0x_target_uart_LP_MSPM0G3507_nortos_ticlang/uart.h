@@ -32,6 +32,25 @@
 #include "stdint.h"
 
 #define TIMEOUT_COUNT 1500000
+#define UART_POLL_STEP (3200)  //100 us at 32 MHz
+
+//*****************************************************************************
+//
+// Optional RTS/CTS under the UART_FLOW_CONTROL predefined symbol. Enable RTS
+// and CTS for UART_0 in SysConfig as well; bsl_host_mcu_uart.syscfg routes
+// only RX and TX. UART_initFlowControl() turns flow control off after init so
+// nothing stalls before the BSL runs, and UART_enableFlowControl() turns it
+// on once the BSL has answered, if the target holds CTS asserted.
+//
+// UART_overrunCount counts RX overrun errors seen on UART_0 (for inspection
+// in the debugger, like BSL_entry_cycles).
+//
+//*****************************************************************************
+extern uint32_t UART_overrunCount;
+extern uint8_t UART_flowControl;
+
+void UART_initFlowControl(void);
+uint8_t UART_enableFlowControl(void);
 
 void Host_BSL_entry_software(void);
 uint8_t Status_check(void);
@@ -39,3 +58,4 @@ void BSL_sendSingleByte(uint8_t ui8Byte);
 uint8_t BSL_getResponse(void);
 uint8_t UART_writeBuffer(uint8_t *pData, uint8_t ui8Cnt);
 void UART_readBuffer(uint8_t *pData, uint8_t ui8Cnt);
+uint8_t UART_readByteTimeout(uint8_t *pData, uint32_t *pui32Cycles);
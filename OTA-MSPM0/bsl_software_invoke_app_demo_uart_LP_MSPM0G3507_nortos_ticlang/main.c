@@ -34,6 +34,27 @@
 
 volatile bool BSL_trigger_flag;
 
+/*
+ * Application header (OTA-ESP/include/app_header.h), placed right after the
+ * vector table by the linker command file. length and crc stay erased in the
+ * build output; run OTA-ESP/tools/app_header.py on the .bin to fill them in.
+ * The gateway reads the header back to skip reprogramming the same image.
+ */
+#define APP_HEADER_MAGIC (0x48505041) /* "APPH" */
+#define APP_HEADER_ERASED (0xFFFFFFFF)
+#define APP_VERSION (1)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t length;
+    uint32_t crc; /* BSL CRC32 over [0, length) without this field */
+} AppHeader;
+
+const AppHeader gAppHeader __attribute__((used, section(".appHeader"))) = {
+    APP_HEADER_MAGIC, APP_VERSION, APP_HEADER_ERASED, APP_HEADER_ERASED};
+
+static bool appHeaderValid(void);
 __STATIC_INLINE void invokeBSLAsm(void);
 volatile uint8_t gData = 0;
 volatile bool gServiceInt;
@@ -47,6 +68,11 @@ int main(void)
 {
     SYSCFG_DL_init();
 
+    /* A damaged image stays in the BSL until the host reprograms it */
+    if (!appHeaderValid()) {
+        invokeBSLAsm();
+    }
+
     NVIC_EnableIRQ(GPIO_SWITCHES_INT_IRQN);
 #ifdef UART_INTERFACE
     NVIC_ClearPendingIRQ(UART_0_INST_INT_IRQN);
@@ -124,6 +150,34 @@ int main(void)
     }
 }
 
+/*
+ * Recompute the image CRC with the CRC module, configured like the BSL's
+ * (CRC32, reflected), and compare it with the header. Images without a
+ * filled in header, e.g. debug downloads, are accepted.
+ */
+static bool appHeaderValid(void)
+{
+    /* Read through a volatile pointer, the linker output has the erased values */
+    const volatile AppHeader *header = &gAppHeader;
+    uint32_t crc;
+
+    if (header->length == APP_HEADER_ERASED) {
+        return true;
+    }
+
+    DL_CRC_enablePower(CRC);
+    delay_cycles(16);
+    DL_CRC_init(CRC, DL_CRC_32_POLYNOMIAL, DL_CRC_BIT_REVERSED,
+        DL_CRC_INPUT_ENDIANESS_LITTLE_ENDIAN, DL_CRC_OUTPUT_BYTESWAP_DISABLED);
+    crc = DL_CRC_calculateMemoryRange32(
+        CRC, 0xFFFFFFFF, (uint32_t *) 0, (uint32_t *) &header->crc);
+    crc = DL_CRC_calculateMemoryRange32(CRC, crc,
+        (uint32_t *) (&header->crc + 1), (uint32_t *) header->length);
+    DL_CRC_disablePower(CRC);
+
+    return crc == header->crc;
+}
+
 void GROUP1_IRQHandler(void)
 {
     switch (DL_Interrupt_getPendingGroup(DL_INTERRUPT_GROUP_1)) {
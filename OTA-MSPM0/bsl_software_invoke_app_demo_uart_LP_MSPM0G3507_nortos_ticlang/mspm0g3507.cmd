@@ -47,6 +47,7 @@ MEMORY
 SECTIONS
 {
     .intvecs:   > 0x00000000
+    .appHeader: > 0x000000C0    /* after the 48 vectors, see main.c */
     .text   : palign(8) {} > FLASH | FLASH2
     .const  : palign(8) {} >> FLASH | FLASH2
     .cinit  : palign(8) {} > FLASH | FLASH2